@@ -0,0 +1,134 @@
+/**
+* @file BenchMain.cpp
+*
+* Entry point for peek_bench, which runs one of peek's benchmark suites:
+*
+*     peek_bench <suite> [--option value ...]
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace peek::bench;
+
+namespace {
+
+	/** A benchmark suite that can be run by name */
+	struct Suite {
+		const char *name;
+		const char *description;
+		int (*run)(const Arguments &args);
+	};
+
+	const Suite suites[] = {
+		{ "normals", "vertex normal generation (--max-faces N, --repetitions N)", runNormalsBench },
+		{ "matrix", "matrix products, inverses and point transforms (--count N, --repetitions N)", runMatrixBench },
+		{ "set", "point sets: build, has, retainAll and setUnion (--count N, --legacy-count N, --repetitions N)", runSetBench },
+		{ "idle", "run loop CPU time per second, idle and animating (--seconds N, --max-fps N, --vsync)", runIdleBench },
+		{ "capture", "frame time added by capturing, headless (--width N, --height N, --frames N, --ring N, --png)", runCaptureBench },
+		{ "pick", "picking rays: bounding volume hierarchy vs every face (--cells N, --rays N, --brute-rays N)", runPickBench },
+		{ "idpick", "ID buffer picking of points and rectangles vs rays, headless (--side N, --points N, --repetitions N)", runIdPickBench },
+		{ "queue", "render queue, plain and instanced, vs scene graph drawing, with state change and batch counts, headless (--side N, --materials N, --frames N, --wireframe)", runQueueBench },
+		{ "transform", "world transformation and bounds updates after moving one part of an assembly (--depth N, --fanout N, --repetitions N)", runTransformBench },
+		{ "compiled", "culling and queueing from the compiled scene graph, on one thread and on the job system, vs walking the nodes, and keeping it in step (--depth N, --fanout N, --threads N, --repetitions N)", runCompiledBench },
+		{ "update", "frame rate and input lag with slow handlers, between frames vs on the update thread, headless (--frames N, --frame-ms N, --handler-ms N, --interval-ms N, --side N)", runUpdateBench },
+		{ "post", "custom events posted from several threads into a running engine, and the frames they coalesce into, headless (--threads N, --events N, --bursts N)", runPostBench },
+		{ "profile", "profiler summary of queued frames, and the cost of a scope recording and not, headless (--side N, --materials N, --frames N, --scopes N, --trace FILE)", runProfileBench },
+		{ "scenes", "frame time percentiles, draw calls, state changes and memory of synthetic scenes along camera paths, headless (--frames N, --seed N, --scene NAME, --cells N, --depth N, --count N, --materials N, --instancing, --json FILE, --label TEXT)", runSceneBench },
+		{ "replay", "recording scripted input to a log, and replaying it as fast as possible and at the recorded pace, with frame times and camera checks, headless (--events N, --interval-ms N, --side N, --seed N, --log FILE)", runReplayBench },
+		{ "strip", "triangle soups made into strips and fans, with average lengths, indices saved and face checks (--side N, --segments N, --repetitions N, --seed N)", runStripBench },
+		{ "optimize", "vertex cache miss ratios (ACMR, ATVR) and overdraw before and after reordering meshes, with mesh checks, headless (--side N, --shells N, --segments N, --cache N, --threshold X, --size N, --seed N)", runOptimizeBench }
+	};
+
+	const size_t suiteCount = sizeof(suites) / sizeof(suites[0]);
+
+	void printUsage() {
+		printf("usage: peek_bench <suite|all> [--option value ...]\n\nsuites:\n");
+		for (size_t i = 0; i < suiteCount; i++) {
+			printf("  %-12s %s\n", suites[i].name, suites[i].description);
+		}
+	}
+
+}
+
+namespace peek {
+namespace bench {
+
+	/*!
+	* @param args The suite arguments
+	* @param name The option name, without the leading dashes
+	* @param defaultValue The value to use if the option is absent
+	*/
+	std::string getOption(const Arguments &args, const std::string &name, const std::string &defaultValue) {
+		for (size_t i = 0; i + 1 < args.size(); i++) {
+			if (args[i] == "--" + name) {
+				return args[i+1];
+			}
+		}
+
+		return defaultValue;
+	}
+
+	/*!
+	* @param args The suite arguments
+	* @param name The option name, without the leading dashes
+	* @param defaultValue The value to use if the option is absent
+	*/
+	long getOption(const Arguments &args, const std::string &name, long defaultValue) {
+		std::string value = getOption(args, name, std::string());
+		return (value.empty() ? defaultValue : atol(value.c_str()));
+	}
+
+	/*!
+	* @param args The suite arguments
+	* @param name The flag name, without the leading dashes
+	*/
+	bool hasFlag(const Arguments &args, const std::string &name) {
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == "--" + name) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		printUsage();
+		return 1;
+	}
+
+	Arguments args(argv + 2, argv + argc);
+	bool all = (strcmp(argv[1], "all") == 0);
+	bool found = false;
+	int result = 0;
+
+	for (size_t i = 0; i < suiteCount; i++) {
+		if (all || strcmp(argv[1], suites[i].name) == 0) {
+			found = true;
+			printf("== %s\n", suites[i].name);
+
+			// A suite that can't run (no headless context, say) shouldn't stop the rest of "all"
+			try {
+				result |= suites[i].run(args);
+			} catch (const std::exception &e) {
+				printf("%s failed: %s\n", suites[i].name, e.what());
+				result |= 1;
+			}
+		}
+	}
+
+	if (!found) {
+		printUsage();
+		return 1;
+	}
+
+	return result;
+}
@@ -0,0 +1,127 @@
+/**
+* @file Benchmark.hpp
+*/
+#pragma once
+
+#include "SmoothMesh.hpp"
+#include "SceneGraphNode.hpp"
+#include <boost/chrono.hpp>
+#include <string>
+#include <vector>
+
+namespace peek {
+namespace bench {
+
+	/** The arguments that follow the suite name on the command line */
+	typedef std::vector<std::string> Arguments;
+
+	/**
+	* @brief Measures elapsed wall-clock time
+	*/
+	class Stopwatch {
+	public:
+
+		/** Constructs a stopwatch that starts immediately */
+		Stopwatch() { restart(); }
+
+		/** Restarts the stopwatch */
+		inline void restart() { this->start = boost::chrono::high_resolution_clock::now(); }
+
+		/** Gets the time elapsed since the stopwatch was started, in seconds */
+		inline double getSeconds() const {
+			return boost::chrono::duration<double>(boost::chrono::high_resolution_clock::now() - this->start).count();
+		}
+
+	protected:
+
+		/** When the stopwatch was started */
+		boost::chrono::high_resolution_clock::time_point start;
+
+	};
+
+	/** Runs a callable the given number of times and returns the fastest run, in seconds */
+	template <typename Callable>
+	double timeBest(Callable &callable, int repetitions) {
+		double best = 0;
+
+		for (int i = 0; i < repetitions; i++) {
+			Stopwatch stopwatch;
+			callable();
+			double seconds = stopwatch.getSeconds();
+
+			if (i == 0 || seconds < best) {
+				best = seconds;
+			}
+		}
+
+		return best;
+	}
+
+	/** Gets the value following "--name" in the arguments, or the default if it is absent */
+	std::string getOption(const Arguments &args, const std::string &name, const std::string &defaultValue);
+
+	/** Gets the integer value following "--name" in the arguments, or the default if it is absent */
+	long getOption(const Arguments &args, const std::string &name, long defaultValue);
+
+	/** Checks whether "--name" appears in the arguments */
+	bool hasFlag(const Arguments &args, const std::string &name);
+
+	/** Builds a unit cube centred on the origin, as six quads wound outwards, in a material */
+	SmoothMesh::handle makeCube(const Material &material = Material::DEFAULT);
+
+	/** Lays out a square field of cubes two units apart in rows of nodes, each a model of one of the given meshes chosen at random, raised at random by up to one */
+	SceneGraphNode::handle makeCubeField(int side, const SmoothMesh::list &meshes, bool wireframe = false);
+
+	/** Benchmarks vertex normal generation */
+	int runNormalsBench(const Arguments &args);
+
+	/** Benchmarks matrix products, inverses and point transforms */
+	int runMatrixBench(const Arguments &args);
+
+	/** Benchmarks point set construction, membership and set algebra */
+	int runSetBench(const Arguments &args);
+
+	/** Measures the CPU time the engine's run loop uses while idle and while animating */
+	int runIdleBench(const Arguments &args);
+
+	/** Measures the frame time that capturing frames adds */
+	int runCaptureBench(const Arguments &args);
+
+	/** Benchmarks casting picking rays through the bounding volume hierarchy against testing every face */
+	int runPickBench(const Arguments &args);
+
+	/** Benchmarks picking many points and rectangles through the ID buffer against casting rays */
+	int runIdPickBench(const Arguments &args);
+
+	/** Benchmarks drawing through the state-sorted render queue against drawing straight from the scene graph */
+	int runQueueBench(const Arguments &args);
+
+	/** Benchmarks bringing world transformations and bounds up to date after moving parts of a large assembly */
+	int runTransformBench(const Arguments &args);
+
+	/** Benchmarks culling and queueing from the compiled scene graph against walking the nodes */
+	int runCompiledBench(const Arguments &args);
+
+	/** Benchmarks frame rate and input lag with events handled between frames and on the update thread */
+	int runUpdateBench(const Arguments &args);
+
+	/** Benchmarks posting custom events into a running engine from several threads */
+	int runPostBench(const Arguments &args);
+
+	/** Profiles the engine's frames, and measures what a profiler scope costs */
+	int runProfileBench(const Arguments &args);
+
+	/** Benchmarks synthetic scenes along scripted camera paths, optionally writing the results as JSON */
+	int runSceneBench(const Arguments &args);
+
+	/** Benchmarks recording scripted input and replaying it, checking the replays end where the recording did */
+	int runReplayBench(const Arguments &args);
+
+	/** Benchmarks turning triangle soups into strips and fans, with the indices saved */
+	int runStripBench(const Arguments &args);
+
+	/** Benchmarks reordering meshes for the vertex cache, overdraw and fetch locality, with cache miss ratios and overdraw */
+	int runOptimizeBench(const Arguments &args);
+
+}
+}
@@ -0,0 +1,124 @@
+/**
+* @file CaptureBench.cpp
+*
+* Measures how much frame time capturing adds, reading frames back
+* synchronously and through the ring of pixel-pack buffers, rendering
+* headlessly.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Draws a screenful of triangles, so that frames have some work in them */
+		class TriangleField : public Drawable {
+		public:
+			TriangleField(int rows) : rows(rows), frame(0) {}
+
+			void draw() {
+				glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				glMatrixMode(GL_PROJECTION);
+				glLoadIdentity();
+				glMatrixMode(GL_MODELVIEW);
+				glLoadIdentity();
+				glRotated(this->frame++, 0.0, 0.0, 1.0);
+
+				double step = 2.0 / this->rows;
+				glBegin(GL_TRIANGLES);
+				for (int i = 0; i < this->rows; i++) {
+					for (int j = 0; j < this->rows; j++) {
+						double x = -1.0 + i * step, y = -1.0 + j * step;
+						glColor3d((double) i / this->rows, (double) j / this->rows, 0.5);
+						glVertex2d(x, y);
+						glVertex2d(x + step, y);
+						glVertex2d(x, y + step);
+					}
+				}
+				glEnd();
+			}
+
+		protected:
+			int rows;
+			int frame;
+		};
+
+		/** Draws frames with the given capture (or none) and prints the time per frame */
+		void measure(Engine &engine, FrameCapture *capture, const char *mode, unsigned long frames, double baseline, double &seconds) {
+			engine.setFrameCapture(capture);
+
+			// Warm up, so buffers and the worker already exist
+			engine.run(3);
+
+			Stopwatch stopwatch;
+			engine.run(frames);
+			seconds = stopwatch.getSeconds() / frames;
+
+			if (capture) {
+				capture->finish();
+			}
+			engine.setFrameCapture(NULL);
+
+			// Without a baseline, this is the baseline
+			printf("%-12s  %10.3f  %10.3f  %8lu\n", mode, seconds * 1000.0, baseline < 0 ? 0.0 : (seconds - baseline) * 1000.0,
+				capture ? capture->getStallCount() : 0UL);
+		}
+
+		/** Removes the files a capture wrote */
+		void removeFiles(const FrameCapture &capture) {
+			for (unsigned long i = 0; i < capture.getNextFrameNumber(); i++) {
+				remove(capture.getFileName(i).c_str());
+			}
+		}
+
+	}
+
+	/*!
+	* Frames are written as raw files named with the --output prefix, which
+	* are removed afterwards unless --keep is given.
+	*
+	* Options: --width N, --height N (default 1280x720), --frames N (default
+	* 120), --rows N (triangle grid rows, default 100), --ring N (default 3),
+	* --output PREFIX (default "capture_bench_"), --png, --keep.
+	*/
+	int runCaptureBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 1280L);
+		unsigned int height = (unsigned int) getOption(args, "height", 720L);
+		unsigned long frames = (unsigned long) getOption(args, "frames", 120L);
+		int rows = (int) getOption(args, "rows", 100L);
+		unsigned int ringSize = (unsigned int) getOption(args, "ring", 3L);
+		std::string output = getOption(args, "output", std::string("capture_bench_"));
+		FrameCapture::Format format = hasFlag(args, "png") ? FrameCapture::FORMAT_PNG : FrameCapture::FORMAT_RAW;
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(width, height)));
+		TriangleField field(rows);
+		engine.setDrawable(&field);
+
+		printf("renderer: %s, %ux%u\n", (const char *) glGetString(GL_RENDERER), width, height);
+		printf("%-12s  %10s  %10s  %8s\n", "capture", "ms/frame", "added ms", "stalls");
+
+		double baseline, seconds;
+		measure(engine, NULL, "none", frames, -1.0, baseline);
+
+		FrameCapture synchronous(output + "sync_", format, 0);
+		measure(engine, &synchronous, "synchronous", frames, baseline, seconds);
+
+		FrameCapture ring(output, format, ringSize);
+		measure(engine, &ring, ring.isAsynchronous() ? "ring" : "ring (n/a)", frames, baseline, seconds);
+
+		if (!hasFlag(args, "keep")) {
+			removeFiles(synchronous);
+			removeFiles(ring);
+		}
+
+		return 0;
+	}
+
+}
+}
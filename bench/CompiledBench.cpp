@@ -0,0 +1,194 @@
+/**
+* @file CompiledBench.cpp
+*
+* Compares culling and queueing a large assembly by walking the scene graph
+* against scanning the compiled arrays, on one thread and split into runs
+* between the job system's threads, and times compiling the graph and
+* keeping it in step after moving one part.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "CompiledSceneGraph.hpp"
+#include "PerspectiveCamera.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include "JobSystem.hpp"
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/**
+		* Builds an assembly of the given depth, with the given number of
+		* children under each node, every leaf placing the same model.  The
+		* levels are spread along x and y in turn, so the leaves make a square.
+		*/
+		SceneGraphNodeBase::handle assembly(const Model::handle &model, int depth, int fanout) {
+			if (depth == 0) {
+				return SceneGraphNodeBase::handle(new SceneGraphLeaf(model));
+			}
+
+			SceneGraphNode::handle node(new SceneGraphNode());
+			double spacing = 2.0 * std::pow((double) fanout, (depth - 1) / 2);
+			for (int i = 0; i < fanout; i++) {
+				SceneGraphNodeBase::handle child = assembly(model, depth - 1, fanout);
+				child->setOrigin(depth % 2 ? Vector3d(spacing * i, 0.0, 0.0) : Vector3d(0.0, spacing * i, 0.0));
+				node->addChild(child);
+			}
+			return node;
+		}
+
+		/** Reports whether two sets of counters agree */
+		bool sameStats(const CullingStats &a, const CullingStats &b) {
+			return a.nodesVisited == b.nodesVisited && a.nodesCulled == b.nodesCulled && a.leavesDrawn == b.leavesDrawn && a.leavesCulled == b.leavesCulled;
+		}
+
+	}
+
+	/*!
+	* Nothing is drawn: each path fills the render queue for a frame, and
+	* the queue's size and the culling counters are compared between them.
+	*
+	* Options: --depth N (levels of nodes, default 5), --fanout N (children
+	* of each node, default 10, so 100000 leaves), --threads N (the most
+	* job system threads, doubled from 1, default the number of cores),
+	* --repetitions N (default 20).
+	*/
+	int runCompiledBench(const Arguments &args) {
+		int depth = (int) getOption(args, "depth", 5L);
+		int fanout = (int) getOption(args, "fanout", 10L);
+		int threads = (int) getOption(args, "threads", (long) std::max(1u, boost::thread::hardware_concurrency()));
+		int repetitions = (int) getOption(args, "repetitions", 20L);
+
+		Model::handle model(new Model());
+		model->addMesh(makeCube());
+
+		SceneGraphNodeBase::handle root = assembly(model, depth, fanout);
+		BoundingBox bounds = root->getBoundingBox();
+		Point3d center = bounds.getCenter();
+		root->setOrigin(Vector3d(-center.x, -center.y, -center.z));
+
+		// Look down on the square from a third of its width away, so a part of it is in view
+		Camera::handle camera(new PerspectiveCamera(45.0, 16.0 / 9.0, 1.0, 10000.0));
+		FixedTargetCameraRigging rigging(camera, 30.0, 50.0, (bounds.getHigh().x - bounds.getLow().x) / 3.0);
+		Frustum frustum = rigging.getFrustum();
+
+		Stopwatch stopwatch;
+		CompiledSceneGraph compiled(root);
+		double compile = stopwatch.getSeconds();
+
+		printf("%u leaves in %lu entries under %d levels of %d; compiled in %.3f ms\n", root->getLeafCount(),
+			(unsigned long) compiled.size(), depth, fanout, compile * 1000.0);
+
+		RenderQueue queue;
+		CullingStats graphStats, compiledStats, threadedStats;
+		size_t graphSize = 0, compiledSize = 0, threadedSize = 0;
+
+		printf("%-18s  %10s  %10s  %10s  %10s  %10s\n", "path", "ms/frame", "cull", "queued", "visited", "culled");
+
+		stopwatch.restart();
+		for (int r = 0; r < repetitions; r++) {
+			queue.begin(rigging.getViewMatrix());
+			graphStats.reset();
+			root->enqueue(queue, frustum, graphStats);
+		}
+		double graph = stopwatch.getSeconds() / repetitions;
+		graphSize = queue.size();
+		printf("%-18s  %10.3f  %10s  %10lu  %10u  %10u\n", "scene graph", graph * 1000.0, "-", (unsigned long) graphSize,
+			graphStats.nodesVisited, graphStats.leavesCulled);
+
+		std::vector<boost::uint32_t> allVisible;
+		double cull = 0;
+		stopwatch.restart();
+		for (int r = 0; r < repetitions; r++) {
+			Stopwatch phase;
+			allVisible.clear();
+			compiledStats.reset();
+			compiled.cull(frustum, allVisible, compiledStats);
+			cull += phase.getSeconds();
+
+			queue.begin(rigging.getViewMatrix());
+			compiled.enqueue(queue, allVisible);
+		}
+		double linear = stopwatch.getSeconds() / repetitions;
+		compiledSize = queue.size();
+		printf("%-18s  %10.3f  %10.3f  %10lu  %10u  %10u\n", "compiled", linear * 1000.0, cull / repetitions * 1000.0, (unsigned long) compiledSize,
+			compiledStats.nodesVisited, compiledStats.leavesCulled);
+
+		// The job system's threads each cull and queue runs of entries, and the calling thread appends their queues
+		bool agree = (graphSize == compiledSize && sameStats(graphStats, compiledStats));
+		for (int t = 1; t <= threads; t = (t == threads ? t + 1 : std::min(2 * t, threads))) {
+			JobSystem jobs(t - 1);
+
+			stopwatch.restart();
+			for (int r = 0; r < repetitions; r++) {
+				queue.begin(rigging.getViewMatrix());
+				threadedStats.reset();
+				compiled.enqueue(queue, frustum, threadedStats, jobs);
+			}
+			double threaded = stopwatch.getSeconds() / repetitions;
+			threadedSize = queue.size();
+
+			char name[32];
+			sprintf(name, "jobs, %d threads", t);
+			printf("%-18s  %10.3f  %10s  %10lu  %10u  %10u\n", name, threaded * 1000.0, "-", (unsigned long) threadedSize,
+				threadedStats.nodesVisited, threadedStats.leavesCulled);
+
+			agree = agree && graphSize == threadedSize && graphStats.leavesDrawn == threadedStats.leavesDrawn
+				&& graphStats.leavesCulled == threadedStats.leavesCulled;
+		}
+		printf("paths agree: %s\n", agree ? "yes" : "NO");
+
+		// Move one leaf back and forth, and time bringing the arrays up to date
+		size_t moved = compiled.size() / 2;
+		while (!compiled.getLeaf(moved)) {
+			moved++;
+		}
+		SceneGraphNodeBase *leaf = const_cast<SceneGraphNodeBase *>(compiled.getNode(moved));
+		Vector3d origin = leaf->getOrigin();
+		size_t refreshed = 0;
+
+		stopwatch.restart();
+		for (int r = 0; r < repetitions; r++) {
+			leaf->setOrigin(Vector3d(origin.x, origin.y, (r & 1) ? 0.0 : 1.0));
+			refreshed = compiled.sync();
+		}
+		double sync = stopwatch.getSeconds() / repetitions;
+		leaf->setOrigin(origin);
+		compiled.sync();
+
+		printf("sync after moving one leaf: %.3f us, %lu entries refreshed\n", sync * 1e6, (unsigned long) refreshed);
+
+		// Adding a leaf must be seen, and leave the culling in step with the graph's
+		SceneGraphNode *parent = const_cast<SceneGraphNode *>(dynamic_cast<const SceneGraphNode *>(compiled.getNode(compiled.getParent(moved))));
+		parent->addChild(SceneGraphNodeBase::handle(new SceneGraphLeaf(model)));
+
+		stopwatch.restart();
+		refreshed = compiled.sync();
+		double grow = stopwatch.getSeconds();
+
+		graphStats.reset();
+		compiledStats.reset();
+		queue.begin(rigging.getViewMatrix());
+		root->enqueue(queue, frustum, graphStats);
+		graphSize = queue.size();
+		queue.begin(rigging.getViewMatrix());
+		compiled.enqueue(queue, frustum, compiledStats);
+		compiledSize = queue.size();
+
+		printf("sync after adding a leaf: %.3f us, %lu entries refreshed; %lu entries, paths agree: %s\n", grow * 1e6,
+			(unsigned long) refreshed, (unsigned long) compiled.size(),
+			graphSize == compiledSize && sameStats(graphStats, compiledStats) ? "yes" : "NO");
+
+		return 0;
+	}
+
+}
+}
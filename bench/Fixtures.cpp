@@ -0,0 +1,66 @@
+/**
+* @file Fixtures.cpp
+*
+* The cube and field of cubes that the suites drawing scene graphs share.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Model.hpp"
+#include "Numerics.hpp"
+#include "SceneGraphLeaf.hpp"
+
+namespace peek {
+namespace bench {
+
+	/*!
+	* @param material The cube's material
+	* @return A new mesh with eight corners, half a unit from the origin along each axis
+	*/
+	SmoothMesh::handle makeCube(const Material &material) {
+		Vertex3d::list verts;
+		for (int i = 0; i < 8; i++) {
+			verts.push_back(Vertex3d(i & 1 ? 0.5 : -0.5, i & 2 ? 0.5 : -0.5, i & 4 ? 0.5 : -0.5));
+		}
+
+		PrimitiveStreams streams;
+		streams.addQuad(0, 2, 3, 1);
+		streams.addQuad(4, 5, 7, 6);
+		streams.addQuad(0, 1, 5, 4);
+		streams.addQuad(2, 6, 7, 3);
+		streams.addQuad(0, 4, 6, 2);
+		streams.addQuad(1, 3, 7, 5);
+
+		return SmoothMesh::handle(new SmoothMesh(verts, streams, material));
+	}
+
+	/*!
+	* The field is about the origin in x and y, with a node for each
+	* row and a leaf for each cube.
+	*
+	* @param side The number of cubes along each side of the field
+	* @param meshes The meshes to choose among, at least one
+	* @param wireframe Whether to outline each cube too
+	* @return The field's root node
+	*/
+	SceneGraphNode::handle makeCubeField(int side, const SmoothMesh::list &meshes, bool wireframe) {
+		SceneGraphNode::handle root(new SceneGraphNode());
+
+		for (int j = 0; j < side; j++) {
+			SceneGraphNode::handle row(new SceneGraphNode());
+			for (int i = 0; i < side; i++) {
+				Model::handle model(new Model());
+				model->addMesh(meshes[(size_t) uniformRand(0, (double) meshes.size()) % meshes.size()]);
+				model->setOrigin(Vector3d(2.0 * i - side, 2.0 * j - side, uniformRand(0, 1)));
+				if (wireframe) {
+					model->toggleShowWireframe();
+				}
+				row->addChild(SceneGraphNodeBase::handle(new SceneGraphLeaf(model)));
+			}
+			root->addChild(row);
+		}
+
+		return root;
+	}
+
+}
+}
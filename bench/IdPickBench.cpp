@@ -0,0 +1,111 @@
+/**
+* @file IdPickBench.cpp
+*
+* Compares picking many points at once through the ID buffer against
+* casting a ray for each, and times marquee (rectangle) picks, on a field
+* of small parts rendered headlessly.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "IdBuffer.hpp"
+#include "Numerics.hpp"
+#include "PerspectiveCamera.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	/*!
+	* Points where the ID buffer and the rays disagree are counted; they
+	* should only be at the edges of parts, where a pixel's centre and the
+	* rasterizer's coverage rules can differ.
+	*
+	* Options: --width N, --height N (default 1280x720), --side N (cubes
+	* along each side of the field, default 100), --points N (default 1000),
+	* --repetitions N (default 5).
+	*/
+	int runIdPickBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 1280L);
+		unsigned int height = (unsigned int) getOption(args, "height", 720L);
+		int side = (int) getOption(args, "side", 100L);
+		size_t pointCount = (size_t) getOption(args, "points", 1000L);
+		int repetitions = (int) getOption(args, "repetitions", 5L);
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(width, height)));
+		if (!IdBuffer::isSupported()) {
+			printf("framebuffer objects are not available\n");
+			return 1;
+		}
+
+		SceneGraphNode::handle scene = makeCubeField(side, SmoothMesh::list(1, makeCube()));
+		Camera::handle camera(new PerspectiveCamera(45.0, (double) width / height, 1.0, 1000.0));
+		FixedTargetCameraRigging rigging(camera, 30.0, 50.0, 1.6 * side);
+
+		std::vector<IdBuffer::Pixel> points;
+		for (size_t i = 0; i < pointCount; i++) {
+			points.push_back(IdBuffer::Pixel((int) uniformRand(0, width), (int) uniformRand(0, height)));
+		}
+
+		printf("renderer: %s, %ux%u, %d parts\n", (const char *) glGetString(GL_RENDERER), width, height, side * side);
+		printf("%-16s  %8s  %10s  %10s\n", "query", "points", "ms each", "found");
+
+		// Warm up, so every mesh is uploaded and every hierarchy built
+		IdBuffer ids;
+		ids.pick(*scene, rigging, points);
+		ids.finish();
+		for (size_t i = 0; i < points.size(); i++) {
+			scene->castRay(rigging, points[i].x, points[i].y);
+		}
+
+		double rays = 0, idPoints = 0, idSubmit = 0, idRectangle = 0;
+		size_t rayHits = 0, idHits = 0, disagreements = 0, inRectangle = 0;
+		std::vector<const SceneGraphLeaf *> rayLeaves(points.size());
+
+		for (int r = 0; r < repetitions; r++) {
+			Stopwatch stopwatch;
+			rayHits = 0;
+			for (size_t i = 0; i < points.size(); i++) {
+				rayLeaves[i] = scene->castRay(rigging, points[i].x, points[i].y).leaf;
+				rayHits += rayLeaves[i] ? 1 : 0;
+			}
+			double seconds = stopwatch.getSeconds();
+			rays = (r == 0 ? seconds : std::min(rays, seconds));
+
+			stopwatch.restart();
+			ids.pick(*scene, rigging, points);
+			seconds = stopwatch.getSeconds();
+			idSubmit = (r == 0 ? seconds : std::min(idSubmit, seconds));
+			ids.finish();
+			seconds = stopwatch.getSeconds();
+			idPoints = (r == 0 ? seconds : std::min(idPoints, seconds));
+
+			idHits = disagreements = 0;
+			for (size_t i = 0; i < points.size(); i++) {
+				const SceneGraphLeaf *leaf = ids.getLeavesAtPoints()[i];
+				idHits += leaf ? 1 : 0;
+				disagreements += (leaf != rayLeaves[i]) ? 1 : 0;
+			}
+
+			stopwatch.restart();
+			ids.pick(*scene, rigging, width / 4, height / 4, width / 2, height / 2);
+			ids.finish();
+			seconds = stopwatch.getSeconds();
+			idRectangle = (r == 0 ? seconds : std::min(idRectangle, seconds));
+			inRectangle = ids.getLeavesInRectangle().size();
+		}
+
+		printf("%-16s  %8lu  %10.3f  %10lu\n", "rays", (unsigned long) pointCount, rays * 1000.0, (unsigned long) rayHits);
+		printf("%-16s  %8lu  %10.3f  %10s\n", "id submit", (unsigned long) pointCount, idSubmit * 1000.0, "-");
+		printf("%-16s  %8lu  %10.3f  %10lu\n", "id points", (unsigned long) pointCount, idPoints * 1000.0, (unsigned long) idHits);
+		printf("%-16s  %8s  %10.3f  %10lu\n", "id rectangle", "-", idRectangle * 1000.0, (unsigned long) inRectangle);
+		printf("disagreements: %lu of %lu points\n", (unsigned long) disagreements, (unsigned long) pointCount);
+
+		return 0;
+	}
+
+}
+}
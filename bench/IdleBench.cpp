@@ -0,0 +1,119 @@
+/**
+* @file IdleBench.cpp
+*
+* Measures how much CPU time Engine::run() uses while it has nothing to
+* draw, and while another thread keeps invalidating it, with the run loop
+* polling for events and with it waiting for them.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include <boost/chrono/process_cpu_clocks.hpp>
+#include <boost/thread.hpp>
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Just clears the screen */
+		class ClearScreen : public Drawable {
+		public:
+			void draw() {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			}
+		};
+
+		/** Stops an engine after some time */
+		struct StopAfter {
+			Engine &engine;
+			double seconds;
+
+			StopAfter(Engine &engine, double seconds) : engine(engine), seconds(seconds) {}
+
+			void operator()() {
+				boost::this_thread::sleep_for(boost::chrono::duration<double>(this->seconds));
+				this->engine.stop();
+			}
+		};
+
+		/** Invalidates an engine every millisecond until interrupted, like a simulation thread */
+		struct KeepInvalidating {
+			Engine &engine;
+
+			KeepInvalidating(Engine &engine) : engine(engine) {}
+
+			void operator()() {
+				while (true) {
+					this->engine.invalidate();
+					boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+				}
+			}
+		};
+
+		/** Gets the user and system CPU time used by the process so far, in seconds */
+		double getCpuSeconds() {
+			boost::chrono::process_cpu_clock::times times = boost::chrono::process_cpu_clock::now().time_since_epoch().count();
+			return (times.user + times.system) * 1e-9;
+		}
+
+		/** Runs the engine for some time and prints its CPU use and frame rate */
+		void measure(Engine &engine, const char *scenario, bool waiting, bool animating, double seconds) {
+			engine.setWaitingWhenIdle(waiting);
+
+			unsigned long frames = engine.getFrameCount();
+			double cpuSeconds = getCpuSeconds();
+			Stopwatch stopwatch;
+
+			boost::thread stopper((StopAfter(engine, seconds)));
+			boost::thread invalidator;
+			if (animating) {
+				invalidator = boost::thread(KeepInvalidating(engine));
+			}
+
+			engine.run();
+
+			double elapsed = stopwatch.getSeconds();
+			cpuSeconds = getCpuSeconds() - cpuSeconds;
+			frames = engine.getFrameCount() - frames;
+
+			stopper.join();
+			invalidator.interrupt();
+			invalidator.join();
+
+			printf("%-10s  %-8s  %10.1f  %10.1f\n", scenario, waiting ? "waiting" : "polling",
+				cpuSeconds * 1000.0 / elapsed, frames / elapsed);
+		}
+
+	}
+
+	/*!
+	* The animating scenarios include the invalidating thread's own CPU time,
+	* which is small next to drawing.
+	*
+	* Options: --seconds N (default 5 per scenario), --max-fps N (default 60),
+	* --vsync.
+	*/
+	int runIdleBench(const Arguments &args) {
+		double seconds = (double) getOption(args, "seconds", 5L);
+		double maxFrameRate = (double) getOption(args, "max-fps", 60L);
+
+		Engine engine(320, 240, false, hasFlag(args, "vsync"));
+		ClearScreen clearScreen;
+		engine.setDrawable(&clearScreen);
+		engine.setMaxFrameRate(maxFrameRate);
+
+		printf("vsync: %s, frame rate cap: %.0f\n", engine.isVsync() ? "on" : "off", maxFrameRate);
+		printf("%-10s  %-8s  %10s  %10s\n", "scenario", "loop", "cpu ms/s", "frames/s");
+
+		measure(engine, "idle", false, false, seconds);
+		measure(engine, "idle", true, false, seconds);
+		measure(engine, "animating", false, true, seconds);
+		measure(engine, "animating", true, true, seconds);
+
+		return 0;
+	}
+
+}
+}
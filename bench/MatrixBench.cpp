@@ -0,0 +1,210 @@
+/**
+* @file MatrixBench.cpp
+*
+* Compares Matrix<double> against the heap-backed matrix it replaced, for
+* products, inverses, and transforming large point sets.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Geometry.hpp"
+#include "Simd.hpp"
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/**
+		* The previous Matrix: sixteen elements in a vector, read through the
+		* bounds-checked at().
+		*/
+		class LegacyMatrix {
+		public:
+			LegacyMatrix() : m(16) {
+				for (int i = 0; i < 16; i++) this->m[i] = (i % 5 == 0 ? 1.0 : 0.0);
+			}
+
+			LegacyMatrix(const Matrix<double> &a) : m(a.getArray(), a.getArray() + 16) {}
+
+			double &operator()(unsigned int i, unsigned int j) {
+				if (i >= 4 || j >= 4) throw -1;
+				return this->m[i*4+j];
+			}
+
+			double at(unsigned int i, unsigned int j) const {
+				if (i >= 4 || j >= 4) throw -1;
+				return this->m.at(i*4+j);
+			}
+
+		protected:
+			vector<double> m;
+		};
+
+		LegacyMatrix operator*(const LegacyMatrix &a, const LegacyMatrix &b) {
+			LegacyMatrix m;
+			for (int i = 0; i < 4; i++) {
+				for (int j = 0; j < 4; j++) {
+					m(i, j) = 0.0;
+					for (int k = 0; k < 4; k++) {
+						m(i, j) += a.at(k, j) * b.at(i, k);
+					}
+				}
+			}
+			return m;
+		}
+
+		Point3d operator*(const LegacyMatrix &a, const Point3d &b) {
+			Point3d p;
+			p.x = (b.x * a.at(0, 0)) + (b.y * a.at(1, 0)) + (b.z * a.at(2, 0)) + (b.h * a.at(3, 0));
+			p.y = (b.x * a.at(0, 1)) + (b.y * a.at(1, 1)) + (b.z * a.at(2, 1)) + (b.h * a.at(3, 1));
+			p.z = (b.x * a.at(0, 2)) + (b.y * a.at(1, 2)) + (b.z * a.at(2, 2)) + (b.h * a.at(3, 2));
+			p.h = (b.x * a.at(0, 3)) + (b.y * a.at(1, 3)) + (b.z * a.at(2, 3)) + (b.h * a.at(3, 3));
+			return p;
+		}
+
+		/** Builds a chain of products, as a transform hierarchy would */
+		template <typename M>
+		struct ProductChain {
+			const vector<M> &matrices;
+			M result;
+
+			ProductChain(const vector<M> &matrices) : matrices(matrices) {}
+
+			void operator()() {
+				M product;
+				for (size_t i = 0; i < this->matrices.size(); i++) {
+					product = product * this->matrices[i];
+				}
+				this->result = product;
+			}
+		};
+
+		/** The same chain through the generic template, which is the plain scalar loop */
+		struct ScalarProductChain {
+			const vector<Matrix<double> > &matrices;
+			Matrix<double> result;
+
+			ScalarProductChain(const vector<Matrix<double> > &matrices) : matrices(matrices) {}
+
+			void operator()() {
+				Matrix<double> product;
+				for (size_t i = 0; i < this->matrices.size(); i++) {
+					product = peek::operator*<double>(product, this->matrices[i]);
+				}
+				this->result = product;
+			}
+		};
+
+		/** Inverts every matrix in a list, either generally or as an affine transformation */
+		struct InverseAll {
+			const vector<Matrix<double> > &matrices;
+			bool affine;
+			double checksum;
+
+			InverseAll(const vector<Matrix<double> > &matrices, bool affine) : matrices(matrices), affine(affine), checksum(0) {}
+
+			void operator()() {
+				Matrix<double> inverse;
+				for (size_t i = 0; i < this->matrices.size(); i++) {
+					if (this->affine) invertAffine(this->matrices[i], inverse);
+					else invert(this->matrices[i], inverse);
+					this->checksum += inverse.getArray()[12];
+				}
+			}
+		};
+
+		/** Transforms every point one at a time */
+		template <typename M>
+		struct TransformEach {
+			const M &matrix;
+			const Point3d::list &in;
+			Point3d::list &out;
+
+			TransformEach(const M &matrix, const Point3d::list &in, Point3d::list &out) : matrix(matrix), in(in), out(out) {}
+
+			void operator()() {
+				for (size_t i = 0; i < this->in.size(); i++) {
+					this->out[i] = this->matrix * this->in[i];
+				}
+			}
+		};
+
+		/** Transforms every point in one batch */
+		struct TransformBatch {
+			const Matrix<double> &matrix;
+			const Point3d::list &in;
+			Point3d::list &out;
+
+			TransformBatch(const Matrix<double> &matrix, const Point3d::list &in, Point3d::list &out) : matrix(matrix), in(in), out(out) {}
+
+			void operator()() {
+				transformPoints(this->matrix, this->in, this->out);
+			}
+		};
+
+		Matrix<double> randomAffine() {
+			return translationMatrix(uniformRand(-10, 10), uniformRand(-10, 10), uniformRand(-10, 10))
+				* rotationMatrix(uniformRand(0, 360), uniformRand(-1, 1), uniformRand(-1, 1), uniformRand(-1, 1))
+				* scalingMatrix(uniformRand(0.5, 2), uniformRand(0.5, 2), uniformRand(0.5, 2));
+		}
+
+		void printRow(const char *operation, const char *path, size_t count, double seconds, double baseline) {
+			printf("%-10s  %-14s  %10lu  %10.2f  %8.2f\n", operation, path, (unsigned long) count,
+				seconds * 1e9 / count, baseline / seconds);
+		}
+
+	}
+
+	/*!
+	* Options: --count N (default 1000000 matrices and points), --repetitions N (default 3).
+	*/
+	int runMatrixBench(const Arguments &args) {
+		size_t count = (size_t) getOption(args, "count", 1000000L);
+		int repetitions = (int) getOption(args, "repetitions", 3L);
+
+		printf("cpu: %s\n", getSimdLevelName(getSimdLevel()));
+		printf("%-10s  %-14s  %10s  %10s  %8s\n", "operation", "path", "count", "ns each", "speedup");
+
+		vector<Matrix<double> > matrices;
+		vector<LegacyMatrix> legacyMatrices;
+		matrices.reserve(count);
+		legacyMatrices.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			matrices.push_back(randomAffine());
+			legacyMatrices.push_back(LegacyMatrix(matrices.back()));
+		}
+
+		ProductChain<LegacyMatrix> legacyProduct(legacyMatrices);
+		ScalarProductChain scalarProduct(matrices);
+		ProductChain<Matrix<double> > product(matrices);
+		double baseline = timeBest(legacyProduct, repetitions);
+		printRow("multiply", "legacy", count, baseline, baseline);
+		printRow("multiply", "inline scalar", count, timeBest(scalarProduct, repetitions), baseline);
+		printRow("multiply", getSimdLevelName(getSimdLevel()), count, timeBest(product, repetitions), baseline);
+
+		InverseAll general(matrices, false), affine(matrices, true);
+		baseline = timeBest(general, repetitions);
+		printRow("inverse", "general", count, baseline, baseline);
+		printRow("inverse", "affine", count, timeBest(affine, repetitions), baseline);
+
+		Point3d::list points, transformed(count);
+		points.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			points.push_back(Point3d(uniformRand(-100, 100), uniformRand(-100, 100), uniformRand(-100, 100)));
+		}
+
+		LegacyMatrix legacyMatrix(matrices[0]);
+		TransformEach<LegacyMatrix> legacyEach(legacyMatrix, points, transformed);
+		TransformEach<Matrix<double> > each(matrices[0], points, transformed);
+		TransformBatch batch(matrices[0], points, transformed);
+		baseline = timeBest(legacyEach, repetitions);
+		printRow("transform", "legacy", count, baseline, baseline);
+		printRow("transform", "per point", count, timeBest(each, repetitions), baseline);
+		printRow("transform", "batch", count, timeBest(batch, repetitions), baseline);
+
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,90 @@
+/**
+* @file Meshes.cpp
+*/
+#include "Peek_base.hpp"
+#include "Meshes.hpp"
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** Collects the faces of a set of streams, leaving out degenerate ones */
+		struct FaceCollector {
+			const std::vector<vertexIndex> *numbers;
+			std::vector<Face> faces;
+
+			FaceCollector(const std::vector<vertexIndex> *numbers) : numbers(numbers) {}
+
+			inline vertexIndex number(vertexIndex v) const {
+				return this->numbers ? (*this->numbers)[v] : v;
+			}
+
+			inline void triangle(vertexIndex v0, vertexIndex v1, vertexIndex v2) {
+				if (v0 != v1 && v1 != v2 && v2 != v0) {
+					this->faces.push_back(Face(number(v0), number(v1), number(v2)));
+				}
+			}
+
+			inline void quad(vertexIndex v0, vertexIndex v1, vertexIndex v2, vertexIndex v3) {
+				triangle(v0, v1, v2);
+				triangle(v0, v2, v3);
+			}
+		};
+
+	}
+
+	/*!
+	* @param streams The streams to add the triangles to
+	* @param side The number of vertices along each side of the grid
+	* @param base The number of the grid's first vertex
+	*/
+	void addGridTriangles(PrimitiveStreams &streams, size_t side, vertexIndex base) {
+		for (size_t j = 0; j + 1 < side; j++) {
+			for (size_t i = 0; i + 1 < side; i++) {
+				vertexIndex a = (vertexIndex) (base + j * side + i);
+				vertexIndex b = a + 1;
+				vertexIndex c = (vertexIndex) (a + side + 1);
+				vertexIndex d = (vertexIndex) (a + side);
+
+				streams.addTriangle(a, b, c);
+				streams.addTriangle(a, c, d);
+			}
+		}
+	}
+
+	/*!
+	* @param faces The faces' corners, face after face
+	* @param corners The number of corners to a face
+	* @return The faces in a random order, drawn from rand()
+	*/
+	PrimitiveStreams::indexList shuffled(const PrimitiveStreams::indexList &faces, size_t corners) {
+		std::vector<size_t> order;
+		for (size_t f = 0; f < faces.size() / corners; f++) {
+			order.push_back(f);
+		}
+		std::random_shuffle(order.begin(), order.end());
+
+		PrimitiveStreams::indexList result;
+		for (size_t i = 0; i < order.size(); i++) {
+			result.insert(result.end(), faces.begin() + order[i] * corners, faces.begin() + (order[i] + 1) * corners);
+		}
+		return result;
+	}
+
+	/*!
+	* @param streams The streams whose faces to get, strips, fans and quads included
+	* @param numbers The number to give each vertex, or NULL to keep the streams' own
+	* @return The faces, sorted so that two meshes' lists compare equal when they hold the same faces
+	*/
+	std::vector<Face> sortedFaces(const PrimitiveStreams &streams, const std::vector<vertexIndex> *numbers) {
+		FaceCollector collector(numbers);
+		streams.visitFaces(collector);
+		std::sort(collector.faces.begin(), collector.faces.end());
+		return collector.faces;
+	}
+
+}
+}
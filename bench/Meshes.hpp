@@ -0,0 +1,61 @@
+/**
+* @file Meshes.hpp
+*
+* Index-only meshes shared by the suites that rework index streams, and a
+* way to check a reworked mesh still holds the faces it started with.
+*/
+#pragma once
+
+#include "PrimitiveStreams.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace peek {
+namespace bench {
+
+	/** Adds a triangulated grid over side by side vertices numbered in rows from base, two triangles to a cell, in row order */
+	void addGridTriangles(PrimitiveStreams &streams, size_t side, PrimitiveStreams::index base = 0);
+
+	/** Shuffles a list of faces of the given number of corners, keeping each face's corners in order */
+	PrimitiveStreams::indexList shuffled(const PrimitiveStreams::indexList &faces, size_t corners);
+
+	/**
+	* @brief A triangle, rotated so its smallest index is first
+	*
+	* Rotating keeps the winding, so a face and its back face compare
+	* different, while the same face started from another corner compares
+	* the same.
+	*/
+	struct Face {
+
+		/** Constructs a face from its corners, in winding order */
+		Face(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2) {
+			if (v1 < v0 && v1 < v2) {
+				v[0] = v1; v[1] = v2; v[2] = v0;
+			}
+			else if (v2 < v0 && v2 < v1) {
+				v[0] = v2; v[1] = v0; v[2] = v1;
+			}
+			else {
+				v[0] = v0; v[1] = v1; v[2] = v2;
+			}
+		}
+
+		inline bool operator<(const Face &other) const {
+			return std::lexicographical_compare(v, v + 3, other.v, other.v + 3);
+		}
+
+		inline bool operator==(const Face &other) const {
+			return v[0] == other.v[0] && v[1] == other.v[1] && v[2] == other.v[2];
+		}
+
+		/** The corners, smallest first */
+		PrimitiveStreams::index v[3];
+
+	};
+
+	/** Gets the sorted faces of a set of streams, leaving out degenerate ones, optionally renumbering the vertices first */
+	std::vector<Face> sortedFaces(const PrimitiveStreams &streams, const std::vector<PrimitiveStreams::index> *numbers = NULL);
+
+}
+}
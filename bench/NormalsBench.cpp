@@ -0,0 +1,158 @@
+/**
+* @file NormalsBench.cpp
+*
+* Compares vertex normal generation through the per-primitive path
+* (Primitive::addVertexNormals) against NormalGenerator at each instruction
+* set and thread count, on bumpy triangulated grids of increasing size.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "NormalGenerator.hpp"
+#include "Numerics.hpp"
+#include "Triangle.hpp"
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/**
+		* A triangulated grid with a bumpy surface, in both mesh representations.
+		*/
+		struct GridMesh {
+			Vertex3d::list verts;
+			PrimitiveStreams streams;
+			Primitive::list primitives;
+
+			GridMesh(size_t faceCount, bool withPrimitives) {
+				size_t side = (size_t) sqrt(faceCount / 2.0) + 1;
+
+				this->verts.reserve(side * side);
+				for (size_t j = 0; j < side; j++) {
+					for (size_t i = 0; i < side; i++) {
+						this->verts.push_back(Vertex3d((double) i, (double) j, uniformRand(0, 0.5)));
+					}
+				}
+
+				for (size_t j = 0; j + 1 < side; j++) {
+					for (size_t i = 0; i + 1 < side; i++) {
+						PrimitiveStreams::index a = (PrimitiveStreams::index) (j * side + i);
+						PrimitiveStreams::index b = a + 1;
+						PrimitiveStreams::index c = (PrimitiveStreams::index) (a + side + 1);
+						PrimitiveStreams::index d = (PrimitiveStreams::index) (a + side);
+
+						this->streams.addTriangle(a, b, c);
+						this->streams.addTriangle(a, c, d);
+
+						if (withPrimitives) {
+							this->primitives.push_back(Primitive::handle(new Triangle(a, b, c)));
+							this->primitives.push_back(Primitive::handle(new Triangle(a, c, d)));
+						}
+					}
+				}
+			}
+		};
+
+		/** Generates normals the way SmoothMesh did before NormalGenerator */
+		struct PrimitivePath {
+			const GridMesh &mesh;
+			Normal3d::list &normals;
+
+			PrimitivePath(const GridMesh &mesh, Normal3d::list &normals) : mesh(mesh), normals(normals) {}
+
+			void operator()() {
+				this->normals.assign(this->mesh.verts.size(), Normal3d());
+
+				for (Primitive::list::const_iterator i = this->mesh.primitives.begin(); i < this->mesh.primitives.end(); ++i) {
+					(*i)->addVertexNormals(this->mesh.verts, this->normals);
+				}
+
+				for (Normal3d::listIndex i = 0; i < this->normals.size(); i++) {
+					this->normals[i].normalize();
+				}
+			}
+		};
+
+		/** Generates normals with a configured NormalGenerator */
+		struct GeneratorPath {
+			const GridMesh &mesh;
+			const NormalGenerator &generator;
+			Normal3d::list &normals;
+
+			GeneratorPath(const GridMesh &mesh, const NormalGenerator &generator, Normal3d::list &normals)
+				: mesh(mesh), generator(generator), normals(normals) {}
+
+			void operator()() {
+				this->generator.generate(this->mesh.verts, this->mesh.streams, this->normals);
+			}
+		};
+
+		/** Gets the largest distance between corresponding normals */
+		double maxDifference(const Normal3d::list &a, const Normal3d::list &b) {
+			double difference = 0;
+
+			for (Normal3d::listIndex i = 0; i < a.size() && i < b.size(); i++) {
+				Normal3d delta = a[i] - b[i];
+				difference = std::max(difference, delta.magnitude());
+			}
+
+			return difference;
+		}
+
+	}
+
+	/*!
+	* Options: --max-faces N (default 10000000), --repetitions N (default 3),
+	* --skip-reference to leave out the per-primitive path.
+	*/
+	int runNormalsBench(const Arguments &args) {
+		long maxFaces = getOption(args, "max-faces", 10000000L);
+		int repetitions = (int) getOption(args, "repetitions", 3L);
+		bool withReference = !hasFlag(args, "skip-reference");
+
+		unsigned int cores = NormalGenerator().getThreadCount();
+		printf("cpu: %s, %u threads\n", getSimdLevelName(getSimdLevel()), cores);
+		printf("%10s  %-10s  %-7s  %7s  %10s  %8s  %9s\n", "faces", "path", "simd", "threads", "ms", "speedup", "max diff");
+
+		for (long faces = 100000; faces <= maxFaces; faces *= 10) {
+			GridMesh mesh((size_t) faces, withReference);
+			Normal3d::list reference, normals;
+			double referenceSeconds = 0;
+
+			if (withReference) {
+				PrimitivePath path(mesh, reference);
+				referenceSeconds = timeBest(path, repetitions);
+				printf("%10ld  %-10s  %-7s  %7u  %10.2f  %8s  %9s\n", faces, "primitive", "scalar", 1u, referenceSeconds * 1000, "1.00", "-");
+			}
+
+			for (int level = SIMD_SCALAR; level <= getSimdLevel(); level++) {
+				for (unsigned int threads = 1; ; threads = std::min(threads * 2, cores)) {
+					NormalGenerator generator;
+					generator.setSimdLevel((SimdLevel) level);
+					generator.setThreadCount(threads);
+
+					GeneratorPath path(mesh, generator, normals);
+					double seconds = timeBest(path, repetitions);
+
+					if (withReference) {
+						printf("%10ld  %-10s  %-7s  %7u  %10.2f  %8.2f  %9.2g\n", faces, "generator", getSimdLevelName((SimdLevel) level),
+							threads, seconds * 1000, referenceSeconds / seconds, maxDifference(reference, normals));
+					}
+					else {
+						printf("%10ld  %-10s  %-7s  %7u  %10.2f  %8s  %9s\n", faces, "generator", getSimdLevelName((SimdLevel) level),
+							threads, seconds * 1000, "-", "-");
+					}
+
+					if (threads == cores) {
+						break;
+					}
+				}
+			}
+		}
+
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,298 @@
+/**
+* @file OptimizeBench.cpp
+*
+* Reorders meshes with MeshOptimizer and reports the post-transform vertex
+* cache's miss ratios (ACMR, vertices transformed per triangle, and ATVR,
+* per vertex used) and the overdraw before and after.  The meshes are a
+* bumpy grid in row order, as a generator would make it, the same grid
+* shuffled, nested spheres shuffled, which overdraw badly when the inner
+* ones are drawn first, and shuffled quads with rows of triangle strips.
+*
+* Overdraw is measured headless: the mesh is drawn from fourteen
+* directions with back faces culled, adding one to a pixel for every
+* fragment that passes the depth test, and the sum is divided by the
+* pixels covered.  Each reordered mesh is checked against the original
+* for the same faces, winding and vertex normals.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "Meshes.hpp"
+#include "MeshOptimizer.hpp"
+#include "Numerics.hpp"
+#include "SmoothMesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** A mesh to optimize */
+		struct TestMesh {
+			const char *name;
+			Vertex3d::list verts;
+			PrimitiveStreams streams;
+		};
+
+		/** Adds a bumpy grid's vertices, side by side, at a height */
+		vertexIndex addGridVertices(TestMesh &mesh, size_t side, double z) {
+			vertexIndex base = (vertexIndex) mesh.verts.size();
+			for (size_t j = 0; j < side; j++) {
+				for (size_t i = 0; i < side; i++) {
+					mesh.verts.push_back(Vertex3d((double) i, (double) j, z + uniformRand(0, 0.5)));
+				}
+			}
+			return base;
+		}
+
+		/** A bumpy grid, two triangles to a cell, in row order */
+		void makeGrid(TestMesh &mesh, size_t side) {
+			mesh.name = "grid";
+			addGridTriangles(mesh.streams, side, addGridVertices(mesh, side, 0));
+		}
+
+		/** The same grid with its triangles in a random order */
+		void makeShuffled(TestMesh &mesh, const TestMesh &from) {
+			mesh.name = "shuffled";
+			mesh.verts = from.verts;
+			PrimitiveStreams::indexList triangles = shuffled(from.streams.getTriangles(), 3);
+			mesh.streams.swapTriangles(triangles);
+		}
+
+		/** Nested spheres, wound outwards, with their triangles in a random order */
+		void makeShells(TestMesh &mesh, size_t shells, size_t segments) {
+			mesh.name = "shells";
+			PrimitiveStreams::indexList triangles;
+			size_t rings = segments / 2;
+			const double pi = 3.14159265358979323846;
+
+			for (size_t k = 0; k < shells; k++) {
+				double radius = 1.0 + k;
+				vertexIndex north = (vertexIndex) mesh.verts.size();
+				mesh.verts.push_back(Vertex3d(0, 0, radius));
+				for (size_t r = 0; r + 1 < rings; r++) {
+					double theta = pi * (r + 1) / rings;
+					for (size_t s = 0; s < segments; s++) {
+						double phi = 2 * pi * s / segments;
+						mesh.verts.push_back(Vertex3d(radius * sin(theta) * cos(phi), radius * sin(theta) * sin(phi), radius * cos(theta)));
+					}
+				}
+				vertexIndex south = (vertexIndex) mesh.verts.size();
+				mesh.verts.push_back(Vertex3d(0, 0, -radius));
+
+				// Vertex north + 1 + r * segments + s is on ring r and segment s
+				for (size_t s = 0; s < segments; s++) {
+					vertexIndex a = (vertexIndex) (north + 1 + s), b = (vertexIndex) (north + 1 + (s + 1) % segments);
+					vertexIndex c = (vertexIndex) (a + (rings - 2) * segments), d = (vertexIndex) (b + (rings - 2) * segments);
+					vertexIndex top[] = { north, a, b }, bottom[] = { south, d, c };
+					triangles.insert(triangles.end(), top, top + 3);
+					triangles.insert(triangles.end(), bottom, bottom + 3);
+				}
+				for (size_t r = 0; r + 2 < rings; r++) {
+					for (size_t s = 0; s < segments; s++) {
+						vertexIndex a = (vertexIndex) (north + 1 + r * segments + s);
+						vertexIndex b = (vertexIndex) (north + 1 + r * segments + (s + 1) % segments);
+						vertexIndex c = (vertexIndex) (b + segments), d = (vertexIndex) (a + segments);
+						vertexIndex quad[] = { a, d, c, a, c, b };
+						triangles.insert(triangles.end(), quad, quad + 6);
+					}
+				}
+			}
+
+			triangles = shuffled(triangles, 3);
+			mesh.streams.swapTriangles(triangles);
+		}
+
+		/** A bumpy grid of quads in a random order, above a grid drawn as a triangle strip per row */
+		void makeMixed(TestMesh &mesh, size_t side) {
+			mesh.name = "mixed";
+			vertexIndex base = addGridVertices(mesh, side, 2);
+			PrimitiveStreams::indexList quads;
+			for (size_t j = 0; j + 1 < side; j++) {
+				for (size_t i = 0; i + 1 < side; i++) {
+					vertexIndex a = (vertexIndex) (base + j * side + i);
+					vertexIndex quad[] = { a, a + 1, (vertexIndex) (a + side + 1), (vertexIndex) (a + side) };
+					quads.insert(quads.end(), quad, quad + 4);
+				}
+			}
+			quads = shuffled(quads, 4);
+			mesh.streams.swapQuads(quads);
+
+			base = addGridVertices(mesh, side, 0);
+			for (size_t j = 0; j + 1 < side; j++) {
+				vector<vertexIndex> strip;
+				for (size_t i = 0; i < side; i++) {
+					strip.push_back((vertexIndex) (base + (j + 1) * side + i));
+					strip.push_back((vertexIndex) (base + j * side + i));
+				}
+				mesh.streams.addTriangleStrip(strip.begin(), strip.end());
+			}
+		}
+
+		/** A vertex position, for finding a vertex again after it has been renumbered */
+		struct Position {
+			double x, y, z;
+
+			Position(const Vertex3d &v) : x(v.x), y(v.y), z(v.z) {}
+
+			inline bool operator<(const Position &other) const {
+				return x < other.x || (x == other.x && (y < other.y || (y == other.y && z < other.z)));
+			}
+		};
+
+		/** Checks that a reordered mesh has the original's faces, winding and normals */
+		bool sameMesh(const SmoothMesh &original, const SmoothMesh &reordered) {
+			const Vertex3d::list &originalVerts = original.getVertices(), &verts = reordered.getVertices();
+			if (verts.size() != originalVerts.size()) {
+				return false;
+			}
+
+			std::map<Position, vertexIndex> positions;
+			vector<vertexIndex> numbers(verts.size());
+			for (size_t i = 0; i < originalVerts.size(); i++) {
+				positions[Position(originalVerts[i])] = (vertexIndex) i;
+			}
+			for (size_t i = 0; i < verts.size(); i++) {
+				std::map<Position, vertexIndex>::const_iterator found = positions.find(Position(verts[i]));
+				if (found == positions.end()) {
+					return false;
+				}
+				numbers[i] = found->second;
+
+				Normal3d delta = reordered.getVertexNormals()[i] - original.getVertexNormals()[found->second];
+				if (delta.magnitude() != 0) {
+					return false;
+				}
+			}
+
+			return sortedFaces(reordered.getPrimitives(), &numbers) == sortedFaces(original.getPrimitives());
+		}
+
+		/** Gets the fragments drawn per pixel covered, over views from fourteen directions */
+		double measureOverdraw(const SmoothMesh &mesh, unsigned int size) {
+			const BoundingBox &box = mesh.getBoundingBox();
+			Point3d centre = box.getLow() + 0.5 * box.getDimensions();
+			double radius = 0.5 * box.getDimensions().magnitude();
+
+			glViewport(0, 0, size, size);
+			glMatrixMode(GL_PROJECTION);
+			glLoadIdentity();
+			glOrtho(-radius, radius, -radius, radius, -radius, radius);
+			glMatrixMode(GL_MODELVIEW);
+
+			glDisable(GL_LIGHTING);
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LESS);
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_BACK);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			glColor3f(1.0f / 255, 0, 0);
+
+			// The six axes, then the eight diagonals
+			const double views[][2] = {
+				{ 0, 0 }, { 90, 0 }, { 180, 0 }, { 270, 0 }, { 0, 90 }, { 0, -90 },
+				{ 45, 35 }, { 135, 35 }, { 225, 35 }, { 315, 35 }, { 45, -35 }, { 135, -35 }, { 225, -35 }, { 315, -35 }
+			};
+			const size_t viewCount = sizeof(views) / sizeof(views[0]);
+
+			vector<unsigned char> pixels(size * size);
+			double fragments = 0, covered = 0;
+			for (size_t v = 0; v < viewCount; v++) {
+				glClearColor(0, 0, 0, 0);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glLoadIdentity();
+				glRotated(views[v][1], 1, 0, 0);
+				glRotated(views[v][0], 0, 1, 0);
+				glTranslated(-centre.x, -centre.y, -centre.z);
+				mesh.drawGeometry();
+
+				glReadPixels(0, 0, size, size, GL_RED, GL_UNSIGNED_BYTE, &pixels[0]);
+				for (size_t i = 0; i < pixels.size(); i++) {
+					fragments += pixels[i];
+					covered += (pixels[i] > 0 ? 1 : 0);
+				}
+			}
+
+			glDisable(GL_BLEND);
+			glDisable(GL_CULL_FACE);
+			return covered > 0 ? fragments / covered : 0.0;
+		}
+
+	}
+
+	/*!
+	* Options: --side N (grid vertices along each side, default 300),
+	* --shells N (default 4), --segments N (around each shell, default 96),
+	* --cache N (vertices in the simulated cache, default 16), --threshold X
+	* (overdraw threshold, default 1.05), --size N (overdraw views in
+	* pixels, default 256), --seed N (default 1).
+	*/
+	int runOptimizeBench(const Arguments &args) {
+		size_t side = (size_t) getOption(args, "side", 300L);
+		size_t shells = (size_t) getOption(args, "shells", 4L);
+		size_t segments = std::max((size_t) getOption(args, "segments", 96L), (size_t) 6);
+		unsigned int cacheSize = (unsigned int) getOption(args, "cache", 16L);
+		double threshold = atof(getOption(args, "threshold", std::string("1.05")).c_str());
+		unsigned int size = (unsigned int) getOption(args, "size", 256L);
+		srand((unsigned int) getOption(args, "seed", 1L));
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(size, size)));
+
+		TestMesh meshes[4];
+		makeGrid(meshes[0], side);
+		makeShuffled(meshes[1], meshes[0]);
+		makeShells(meshes[2], shells, segments);
+		makeMixed(meshes[3], side);
+
+		// Reorder for the cache alone, then with clusters sorted for overdraw as well
+		const char *configNames[] = { "cache", "overdraw" };
+		MeshOptimizer configs[2];
+		for (int c = 0; c < 2; c++) {
+			configs[c].setCacheSize(cacheSize);
+		}
+		configs[0].setOverdrawThreshold(0);
+		configs[1].setOverdrawThreshold(threshold);
+
+		printf("renderer: %s, %u-vertex FIFO cache, overdraw threshold %.2f, %ux%u views\n", (const char *) glGetString(GL_RENDERER),
+			cacheSize, threshold, size, size);
+		printf("%-9s  %-9s  %9s  %8s  %13s  %13s  %13s  %9s  %s\n", "mesh", "reorder", "triangles", "vertices",
+			"ACMR", "ATVR", "overdraw", "ms", "mesh");
+
+		int result = 0;
+		for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++) {
+			SmoothMesh original(meshes[m].verts, meshes[m].streams);
+			double overdrawBefore = measureOverdraw(original, size);
+
+			for (int c = 0; c < 2; c++) {
+				SmoothMesh mesh(meshes[m].verts, meshes[m].streams);
+				VertexCacheStats before, after;
+
+				Stopwatch stopwatch;
+				mesh.optimize(configs[c], &before, &after);
+				double seconds = stopwatch.getSeconds();
+
+				double overdrawAfter = measureOverdraw(mesh, size);
+				bool same = sameMesh(original, mesh);
+				if (!same) {
+					result = 1;
+				}
+
+				printf("%-9s  %-9s  %9lu  %8lu  %5.3f > %5.3f  %5.3f > %5.3f  %5.3f > %5.3f  %9.2f  %s\n", meshes[m].name, configNames[c],
+					(unsigned long) before.triangles, (unsigned long) before.vertices, before.getAcmr(), after.getAcmr(),
+					before.getAtvr(), after.getAtvr(), overdrawBefore, overdrawAfter, seconds * 1000, same ? "same" : "DIFFERENT");
+			}
+		}
+
+		return result;
+	}
+
+}
+}
@@ -0,0 +1,169 @@
+/**
+* @file PickBench.cpp
+*
+* Compares casting picking rays into a scene through each mesh's bounding
+* volume hierarchy against testing every face, on a bumpy triangulated grid,
+* and times building the hierarchy.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Numerics.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Builds a bumpy grid with the given number of cells along each side, two triangles to a cell */
+		SmoothMesh::handle bumpyGrid(size_t cells) {
+			size_t side = cells + 1;
+			Vertex3d::list verts;
+			PrimitiveStreams streams;
+
+			verts.reserve(side * side);
+			for (size_t j = 0; j < side; j++) {
+				for (size_t i = 0; i < side; i++) {
+					verts.push_back(Vertex3d((double) i, (double) j, uniformRand(0, 0.5)));
+				}
+			}
+
+			for (size_t j = 0; j < cells; j++) {
+				for (size_t i = 0; i < cells; i++) {
+					PrimitiveStreams::index a = (PrimitiveStreams::index) (j * side + i);
+					streams.addTriangle(a, a + 1, (PrimitiveStreams::index) (a + side + 1));
+					streams.addTriangle(a, (PrimitiveStreams::index) (a + side + 1), (PrimitiveStreams::index) (a + side));
+				}
+			}
+
+			return SmoothMesh::handle(new SmoothMesh(verts, streams));
+		}
+
+		/** Finds the nearest face a ray hits by testing every one of them */
+		struct BruteForce {
+			const Vertex3d::list *verts;
+			Ray ray;
+			double distance;
+			size_t face;
+			size_t nextFace;
+
+			BruteForce(const Vertex3d::list &verts, const Ray &ray)
+				: verts(&verts), ray(ray), distance(std::numeric_limits<double>::infinity()), face(0), nextFace(0) {}
+
+			void test(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2) {
+				const Vertex3d::list &verts = *this->verts;
+				Point3d p0 = verts[v0], p1 = verts[v1], p2 = verts[v2], origin = this->ray.origin;
+				Vector3d e1 = p1 - p0, e2 = p2 - p0;
+				Vector3d p = cross(this->ray.direction, e2);
+				double det = e1.x*p.x + e1.y*p.y + e1.z*p.z;
+				if (det == 0.0) {
+					return;
+				}
+
+				Vector3d s = origin - p0;
+				double u = (s.x*p.x + s.y*p.y + s.z*p.z) / det;
+				if (u < 0.0 || u > 1.0) {
+					return;
+				}
+
+				Vector3d q = cross(s, e1);
+				double v = (this->ray.direction.x*q.x + this->ray.direction.y*q.y + this->ray.direction.z*q.z) / det;
+				double t = (e2.x*q.x + e2.y*q.y + e2.z*q.z) / det;
+				if (v >= 0.0 && u + v <= 1.0 && t >= 0.0 && t < this->distance) {
+					this->distance = t;
+					this->face = this->nextFace;
+				}
+			}
+
+			void triangle(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2) {
+				test(v0, v1, v2);
+				this->nextFace++;
+			}
+
+			void quad(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2, PrimitiveStreams::index v3) {
+				test(v0, v1, v2);
+				test(v0, v2, v3);
+				this->nextFace++;
+			}
+		};
+
+		/** Makes rays looking down on the grid from random points above it, at a slant */
+		std::vector<Ray> makeRays(size_t count, double extent) {
+			std::vector<Ray> rays;
+			for (size_t i = 0; i < count; i++) {
+				Vector3d direction(uniformRand(-0.3, 0.3), uniformRand(-0.3, 0.3), -1.0);
+				direction.normalize();
+				rays.push_back(Ray(Point3d(uniformRand(0, extent), uniformRand(0, extent), 10.0), direction));
+			}
+			return rays;
+		}
+
+	}
+
+	/*!
+	* The brute-force rays are also checked against the hierarchy's answers.
+	*
+	* Options: --cells N (grid cells along each side, default 1000, for two
+	* million triangles), --rays N (default 100000), --brute-rays N (default
+	* 20).
+	*/
+	int runPickBench(const Arguments &args) {
+		size_t cells = (size_t) getOption(args, "cells", 1000L);
+		size_t rayCount = (size_t) getOption(args, "rays", 100000L);
+		size_t bruteCount = (size_t) getOption(args, "brute-rays", 20L);
+
+		SmoothMesh::handle mesh = bumpyGrid(cells);
+		Model::handle model(new Model());
+		model->addMesh(mesh);
+		SceneGraphNode scene;
+		scene.addChild(SceneGraphNodeBase::handle(new SceneGraphLeaf(model)));
+
+		Stopwatch build;
+		const MeshBvh &bvh = mesh->getBvh();
+		double buildSeconds = build.getSeconds();
+		printf("triangles: %lu, nodes: %lu, depth: %u, build: %.1f ms\n", (unsigned long) bvh.getTriangleCount(),
+			(unsigned long) bvh.getNodeCount(), bvh.getDepth(), buildSeconds * 1000.0);
+
+		std::vector<Ray> rays = makeRays(std::max(rayCount, bruteCount), (double) cells);
+
+		size_t hits = 0;
+		Stopwatch stopwatch;
+		for (size_t i = 0; i < rayCount; i++) {
+			if (scene.castRay(rays[i]).isHit()) {
+				hits++;
+			}
+		}
+		double bvhSeconds = stopwatch.getSeconds() / rayCount;
+
+		std::vector<BruteForce> brute;
+		stopwatch.restart();
+		for (size_t i = 0; i < bruteCount; i++) {
+			brute.push_back(BruteForce(mesh->getVertices(), rays[i]));
+			mesh->getPrimitives().visitFaces(brute.back());
+		}
+		double bruteSeconds = stopwatch.getSeconds() / bruteCount;
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < bruteCount; i++) {
+			RayHit hit = scene.castRay(rays[i]);
+			bool bruteHit = (brute[i].distance < std::numeric_limits<double>::infinity());
+			// Faces sharing an edge the ray passes through are equally good answers
+			if (hit.isHit() != bruteHit || (bruteHit && hit.primitive != brute[i].face && fabs(hit.distance - brute[i].distance) > 1e-9)) {
+				mismatches++;
+			}
+		}
+
+		printf("%-12s  %10s  %10s  %10s\n", "method", "rays", "us each", "speedup");
+		printf("%-12s  %10lu  %10.2f  %10s\n", "every face", (unsigned long) bruteCount, bruteSeconds * 1e6, "-");
+		printf("%-12s  %10lu  %10.2f  %10.0f\n", "hierarchy", (unsigned long) rayCount, bvhSeconds * 1e6, bruteSeconds / bvhSeconds);
+		printf("hits: %lu of %lu, mismatches: %lu\n", (unsigned long) hits, (unsigned long) rayCount, (unsigned long) mismatches);
+
+		return mismatches ? 1 : 0;
+	}
+
+}
+}
@@ -0,0 +1,131 @@
+/**
+* @file PostBench.cpp
+*
+* Has several threads post bursts of custom events into a running engine,
+* as a network ingest thread or file watcher would, and measures what a
+* post costs, how long the engine takes to handle them all, and how many
+* frames the bursts were coalesced into.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <vector>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Counts the frames drawn and the events handled, and checks each thread's events arrive in order */
+		class Counter : public Drawable, public CustomEventHandler {
+		public:
+
+			Counter(int threads) : handled(0), lastSeen(threads, -1) {
+				this->outOfOrder = 0;
+				this->frames = 0;
+			}
+
+			void draw() {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				this->frames++;
+			}
+
+			/** The event is the posting thread's number in the top byte, and the event's number in the rest */
+			void handleCustomEvent(int customEvent) {
+				int thread = customEvent >> 24, number = customEvent & 0xffffff;
+				if (number <= this->lastSeen[thread]) {
+					this->outOfOrder++;
+				}
+				this->lastSeen[thread] = number;
+				this->handled++;
+			}
+
+			boost::atomic<long> handled;
+			std::vector<int> lastSeen;
+			long outOfOrder;
+			unsigned long frames;
+		};
+
+		/** Posts a run of events, and records how long it took */
+		void postEvents(Engine *engine, int thread, int count, double *seconds) {
+			Stopwatch stopwatch;
+			for (int i = 0; i < count; i++) {
+				engine->postEvent((thread << 24) | i);
+			}
+			*seconds = stopwatch.getSeconds();
+		}
+
+		/** Starts the posting threads, then stops the engine once every event has been handled */
+		void drive(Engine *engine, Counter *counter, int threads, int count, int bursts, std::vector<double> *seconds) {
+			for (int b = 0; b < bursts; b++) {
+				boost::thread_group group;
+				for (int t = 0; t < threads; t++) {
+					group.create_thread(boost::bind(postEvents, engine, t, count, &(*seconds)[b * threads + t]));
+				}
+				group.join_all();
+
+				while (counter->handled < (long) (b + 1) * threads * count) {
+					boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+				}
+			}
+			engine->stop();
+		}
+
+	}
+
+	/*!
+	* Each burst has every thread post its events at once; the next burst
+	* starts when the engine has handled the last.  Event numbers restart
+	* in each burst, so only the first burst is checked for order.
+	*
+	* Options: --threads N (posting threads, default 4), --events N (per
+	* thread per burst, default 25000), --bursts N (default 10).
+	*/
+	int runPostBench(const Arguments &args) {
+		int threads = (int) getOption(args, "threads", 4L);
+		int count = (int) getOption(args, "events", 25000L);
+		int bursts = (int) getOption(args, "bursts", 10L);
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(64, 64)));
+		Counter counter(threads);
+		engine.setDrawable(&counter);
+		engine.setCustomEventHandler(&counter);
+
+		// The first frame, for the engine's own invalidation, is drawn before timing
+		engine.run(1);
+		counter.frames = 0;
+
+		std::vector<double> seconds(bursts * threads, 0.0);
+		Stopwatch stopwatch;
+		boost::thread driver(boost::bind(drive, &engine, &counter, threads, count, 1, &seconds));
+		engine.run();
+		driver.join();
+		long firstOutOfOrder = counter.outOfOrder;
+		long firstHandled = counter.handled;
+		counter.handled = 0;
+
+		boost::thread rest(boost::bind(drive, &engine, &counter, threads, count, bursts, &seconds));
+		engine.run();
+		rest.join();
+		double elapsed = stopwatch.getSeconds();
+
+		double postSeconds = 0;
+		for (size_t i = 0; i < seconds.size(); i++) {
+			postSeconds += seconds[i];
+		}
+		long total = (long) (bursts + 1) * threads * count;
+
+		printf("%d threads posting %d events each, in %d bursts\n", threads, count, bursts + 1);
+		printf("post: %.1f ns each; all handled in %.3f s\n", postSeconds / (bursts * threads * count) * 1e9, elapsed);
+		printf("handled %ld of %ld events, %ld out of order; %lu frames drawn for %d bursts\n", firstHandled + counter.handled, total,
+			firstOutOfOrder, counter.frames, bursts + 1);
+
+		return 0;
+	}
+
+}
+}
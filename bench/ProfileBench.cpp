@@ -0,0 +1,148 @@
+/**
+* @file ProfileBench.cpp
+*
+* Runs the engine over a field of outlined cubes drawn through the compiled
+* scene graph and the render queue with the profiler recording, prints the
+* profiler's summary of the engine's scopes and passes, optionally writes
+* the trace, and measures what a scope costs with recording on and off.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "CompiledSceneGraph.hpp"
+#include "Numerics.hpp"
+#include "PerspectiveCamera.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "GlExtensions.hpp"
+#include "Profiler.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraphNode.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Draws the compiled graph through the queue, culled and queued on the engine's job system */
+		class QueuedScene : public Drawable {
+		public:
+
+			QueuedScene(Engine &engine, SceneGraphNodeBase::handle root, CameraRigging &rigging)
+				: engine(engine), compiled(root), rigging(rigging) {
+			}
+
+			void draw() {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glMatrixMode(GL_PROJECTION);
+				glLoadMatrixd(this->rigging.getCamera()->getProjectionMatrix().getArray());
+				glMatrixMode(GL_MODELVIEW);
+				this->rigging.initModelviewMatrix();
+
+				this->compiled.sync();
+				this->queue.begin(this->rigging.getViewMatrix());
+				this->stats.reset();
+				this->compiled.enqueue(this->queue, this->rigging.getFrustum(), this->stats, this->engine.getJobSystem());
+				this->queue.execute();
+			}
+
+			Engine &engine;
+			CompiledSceneGraph compiled;
+			CameraRigging &rigging;
+			RenderQueue queue;
+			CullingStats stats;
+		};
+
+		/** Times a number of empty scopes, returning the nanoseconds each took */
+		double timeScopes(long count) {
+			Stopwatch stopwatch;
+			for (long i = 0; i < count; i++) {
+				ProfileScope scope("ProfileBench scope");
+			}
+			return stopwatch.getSeconds() / count * 1e9;
+		}
+
+	}
+
+	/*!
+	* The library's scopes are only compiled in when PEEK_PROFILING is
+	* defined, so build the Profile configuration; without it the summary is
+	* empty, and only the cost of scopes marked by hand is measured.
+	*
+	* Options: --width N, --height N (default 1280x720), --side N (cubes
+	* along each side of the field, default 100), --materials N (default
+	* 16), --frames N (default 100), --scopes N (scopes timed, default
+	* 1000000), --trace FILE (write the Chrome trace there).
+	*/
+	int runProfileBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 1280L);
+		unsigned int height = (unsigned int) getOption(args, "height", 720L);
+		int side = (int) getOption(args, "side", 100L);
+		int materialCount = (int) getOption(args, "materials", 16L);
+		unsigned long frames = (unsigned long) getOption(args, "frames", 100L);
+		long scopes = getOption(args, "scopes", 1000000L);
+		std::string trace = getOption(args, "trace", std::string());
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(width, height)));
+
+		SmoothMesh::list meshes;
+		for (int i = 0; i < materialCount; i++) {
+			Color diffuse((float) uniformRand(0, 1), (float) uniformRand(0, 1), (float) uniformRand(0, 1));
+			meshes.push_back(makeCube(Material(Color(0.2f, 0.2f, 0.2f), diffuse, Color(1.0f, 1.0f, 1.0f), Color(0.0f, 0.0f, 0.0f), 32.0f)));
+		}
+
+		// Outlined, so the queue draws a solid and a wireframe pass
+		SceneGraphNode::handle root = makeCubeField(side, meshes, true);
+
+		Camera::handle camera(new PerspectiveCamera(45.0, (double) width / height, 1.0, 1000.0));
+		FixedTargetCameraRigging rigging(camera, 30.0, 50.0, 0.8 * side);
+		QueuedScene scene(engine, root, rigging);
+		engine.setDrawable(&scene);
+
+		printf("renderer: %s, %ux%u, %d parts, %d materials, %u job threads\n", (const char *) glGetString(GL_RENDERER),
+			width, height, side * side, materialCount, (unsigned int) engine.getJobSystem().getThreadCount());
+#ifndef PEEK_PROFILING
+		printf("built without PEEK_PROFILING: the library's scopes are compiled out\n");
+#endif
+		printf("GPU timer queries: %s\n", haveTimerQueries() ? "available" : "not available");
+
+		// Warm up, so every mesh is uploaded, then record
+		engine.run(2);
+		Profiler::setEnabled(true);
+		Stopwatch stopwatch;
+		engine.run(frames);
+		double elapsed = stopwatch.getSeconds();
+
+		// GPU times are collected a frame or more late; one more frame, unrecorded, collects the last
+		Profiler::setEnabled(false);
+		glFinish();
+		engine.run(1);
+
+		printf("%lu frames in %.3f s, %.3f ms each\n\n", frames, elapsed, elapsed / frames * 1000.0);
+		fflush(stdout);
+		Profiler::printSummary(std::cout);
+		std::cout.flush();
+
+		if (!trace.empty()) {
+			Profiler::writeChromeTrace(trace);
+			printf("\ntrace written to %s\n", trace.c_str());
+		}
+
+		Profiler::setEnabled(false);
+		double disabled = timeScopes(scopes);
+		Profiler::setEnabled(true);
+		double enabled = timeScopes(scopes);
+		Profiler::setEnabled(false);
+		Profiler::clear();
+
+		printf("\nscope cost: %.1f ns recording, %.1f ns not recording\n", enabled, disabled);
+
+		scene.queue.release();
+		Profiler::release();
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,143 @@
+/**
+* @file QueueBench.cpp
+*
+* Compares drawing a field of parts that share a few dozen materials
+* straight from the scene graph against drawing it through the render
+* queue, with and without instancing, and counts the state changes the
+* queue's cache makes and skips and the batches it draws.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "Numerics.hpp"
+#include "PerspectiveCamera.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraphNode.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Clears the frame and loads the camera's matrices, as a frame would begin */
+		void beginFrame(CameraRigging &rigging) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glMatrixMode(GL_PROJECTION);
+			glLoadMatrixd(rigging.getCamera()->getProjectionMatrix().getArray());
+			glMatrixMode(GL_MODELVIEW);
+			rigging.initModelviewMatrix();
+		}
+
+	}
+
+	/*!
+	* Options: --width N, --height N (default 1280x720), --side N (cubes
+	* along each side of the field, default 150), --materials N (default
+	* 32), --frames N (default 20), --wireframe (outline the cubes too).
+	*/
+	int runQueueBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 1280L);
+		unsigned int height = (unsigned int) getOption(args, "height", 720L);
+		int side = (int) getOption(args, "side", 150L);
+		int materialCount = (int) getOption(args, "materials", 32L);
+		int frames = (int) getOption(args, "frames", 20L);
+		bool wireframe = hasFlag(args, "wireframe");
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(width, height)));
+
+		SmoothMesh::list meshes;
+		for (int i = 0; i < materialCount; i++) {
+			Color diffuse((float) uniformRand(0, 1), (float) uniformRand(0, 1), (float) uniformRand(0, 1));
+			meshes.push_back(makeCube(Material(Color(0.2f, 0.2f, 0.2f), diffuse, Color(1.0f, 1.0f, 1.0f), Color(0.0f, 0.0f, 0.0f), 32.0f)));
+		}
+
+		SceneGraphNode::handle scene = makeCubeField(side, meshes, wireframe);
+		Camera::handle camera(new PerspectiveCamera(45.0, (double) width / height, 1.0, 1000.0));
+		FixedTargetCameraRigging rigging(camera, 30.0, 50.0, 1.2 * side);
+		Frustum frustum = rigging.getFrustum();
+
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_LIGHT0);
+
+		printf("renderer: %s, %ux%u, %d parts, %d materials%s\n", (const char *) glGetString(GL_RENDERER),
+			width, height, side * side, materialCount, wireframe ? ", with outlines" : "");
+
+		// Warm up, so every mesh is uploaded
+		CullingStats stats;
+		beginFrame(rigging);
+		scene->draw(frustum, stats);
+		glFinish();
+
+		Stopwatch stopwatch;
+		for (int f = 0; f < frames; f++) {
+			beginFrame(rigging);
+			scene->draw(frustum, stats);
+		}
+		glFinish();
+		double direct = stopwatch.getSeconds() / frames;
+
+		printf("%-16s  %10s  %10s  %10s\n", "path", "ms/frame", "enqueue", "draw");
+		printf("%-16s  %10.3f  %10s  %10s\n", "scene graph", direct * 1000.0, "-", "-");
+
+		RenderQueue queue;
+		const char *names[] = { "render queue", "instanced queue" };
+		std::vector<GLubyte> pixels[2];
+		for (int instancing = 0; instancing < 2; instancing++) {
+			queue.setInstancing(instancing != 0);
+
+			double enqueue = 0, execute = 0;
+			stopwatch.restart();
+			for (int f = 0; f < frames; f++) {
+				beginFrame(rigging);
+				queue.getStateCache().resetCounts();
+
+				Stopwatch phase;
+				queue.begin(rigging.getViewMatrix());
+				stats.reset();
+				scene->enqueue(queue, frustum, stats);
+				enqueue += phase.getSeconds();
+
+				phase.restart();
+				queue.execute();
+				execute += phase.getSeconds();
+			}
+			glFinish();
+			double queued = stopwatch.getSeconds() / frames;
+
+			pixels[instancing].resize(width * height * 4);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[instancing][0]);
+
+			printf("%-16s  %10.3f  %10.3f  %10.3f\n", names[instancing], queued * 1000.0, enqueue / frames * 1000.0, execute / frames * 1000.0);
+		}
+
+		const GlStateCache &cache = queue.getStateCache();
+		const InstancingStats &instancingStats = queue.getInstancingStats();
+		printf("queued %lu meshes from %lu leaves; %lu materials\n", (unsigned long) queue.size(),
+			(unsigned long) stats.leavesDrawn, (unsigned long) queue.getMaterialCount());
+		printf("per frame: %lu state changes made, %lu skipped, %lu material changes\n",
+			cache.getChangeCount(), cache.getSkippedCount(), cache.getMaterialChangeCount());
+		printf("instancing: %u batches of %u instances (largest %u), %u single draws\n", instancingStats.batches,
+			instancingStats.batchedInstances, instancingStats.largestBatch, instancingStats.singleDraws);
+
+		// The program's lighting is done in single precision, so allow a little rounding
+		size_t differing = 0;
+		for (size_t i = 0; i < pixels[0].size(); i += 4) {
+			for (int c = 0; c < 3; c++) {
+				if (std::abs((int) pixels[0][i + c] - (int) pixels[1][i + c]) > 2) {
+					differing++;
+					break;
+				}
+			}
+		}
+		printf("pixels differing between plain and instanced frames: %lu of %lu\n", (unsigned long) differing, (unsigned long) (width * height));
+
+		queue.release();
+		return 0;
+	}
+
+}
+}
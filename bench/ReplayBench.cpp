@@ -0,0 +1,427 @@
+/**
+* @file ReplayBench.cpp
+*
+* Drives the camera riggings with a scripted stream of key presses, mouse
+* drags and wheel clicks, recording what the engine takes to an input log,
+* then replays the log as fast as possible and at the recorded pace, with
+* the frame times of each.  Every replay must end with the cameras where
+* the recording left them, and no pose along the way may go bad, so the
+* replays double as a soak test of the riggings.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "FirstPersonCameraRigging.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "InputLog.hpp"
+#include "Numerics.hpp"
+#include "PerspectiveCamera.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using boost::chrono::steady_clock;
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** The actions the keys are bound to */
+		enum Action {
+			ACTION_LEFT = 1,
+			ACTION_RIGHT,
+			ACTION_UP,
+			ACTION_DOWN,
+			ACTION_IN,
+			ACTION_OUT,
+			ACTION_SWITCH
+		};
+
+		/** The keys bound, in action order */
+		const SDLKey keys[] = { SDLK_LEFT, SDLK_RIGHT, SDLK_UP, SDLK_DOWN, SDLK_PAGEUP, SDLK_PAGEDOWN, SDLK_TAB };
+
+		const int keyCount = sizeof(keys) / sizeof(keys[0]);
+
+		/** A headless context whose window receives a scripted event every so often */
+		class ScriptedContext : public HeadlessRenderContext {
+		public:
+
+			ScriptedContext(unsigned int width, unsigned int height, const std::vector<SDL_Event> &script, double intervalMs)
+				: HeadlessRenderContext(width, height), script(script) {
+				this->interval = boost::chrono::duration_cast<steady_clock::duration>(boost::chrono::duration<double, boost::milli>(intervalMs));
+				this->next = steady_clock::now() + this->interval;
+				this->sent = 0;
+			}
+
+			virtual bool pollEvent(SDL_Event &evt) {
+				if (isDone() || steady_clock::now() < this->next) {
+					return false;
+				}
+
+				evt = this->script[this->sent++];
+				this->next += this->interval;
+				return true;
+			}
+
+			virtual bool hasPendingEvents() {
+				return !isDone() && steady_clock::now() >= this->next;
+			}
+
+			/** Whether every event has been sent */
+			bool isDone() const { return this->sent == this->script.size(); }
+
+		protected:
+			std::vector<SDL_Event> script;
+			size_t sent;
+			steady_clock::duration interval;
+			steady_clock::time_point next;
+		};
+
+		/**
+		* Moves whichever of an orbiting and a walking camera is in use: the
+		* arrow and page keys turn, tilt and zoom or walk, dragging with the
+		* left button looks around, the wheel zooms, and tab switches camera.
+		* Each frame checks both cameras' poses are still sound.
+		*/
+		class Driver : public Drawable, public CustomEventHandler, public MouseButtonEventHandler, public MouseMotionEventHandler {
+		public:
+
+			Driver(Engine &engine, SceneGraphNodeBase::handle root, ScriptedContext *script)
+				: engine(engine), root(root), script(script) {
+				reset();
+			}
+
+			/** Puts the cameras back where they started */
+			void reset() {
+				double aspect = (double) this->engine.getScreenWidth() / this->engine.getScreenHeight();
+				this->orbit.reset(new FixedTargetCameraRigging(Camera::handle(new PerspectiveCamera(45.0, aspect, 1.0, 1000.0)), 30.0, 50.0, 80.0));
+				this->walk.reset(new FirstPersonCameraRigging(Camera::handle(new PerspectiveCamera(60.0, aspect, 0.1, 500.0)),
+					Point3d(-40.0, -40.0, 2.0), 45.0, 0.0));
+				this->walking = false;
+				this->dragging = false;
+				this->handled = 0;
+				this->badPoses = 0;
+			}
+
+			void draw() {
+				CameraRigging &rigging = current();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glMatrixMode(GL_PROJECTION);
+				glLoadMatrixd(rigging.getCamera()->getProjectionMatrix().getArray());
+				glMatrixMode(GL_MODELVIEW);
+				rigging.initModelviewMatrix();
+
+				// Finished here, so the frame times include the GPU's work
+				CullingStats stats;
+				this->root->draw(rigging.getFrustum(), stats);
+				glFinish();
+
+				if (!isSound(*this->orbit) || !isSound(*this->walk)) {
+					this->badPoses++;
+				}
+
+				// A recording ends once its script has been taken and handled
+				if (this->script && this->script->isDone() && !this->script->hasPendingEvents()) {
+					this->engine.stop();
+				}
+				this->engine.invalidate();
+			}
+
+			void handleCustomEvent(int action) {
+				this->handled++;
+				if (this->walking) {
+					switch (action) {
+						case ACTION_LEFT: this->walk->turnLeft(); break;
+						case ACTION_RIGHT: this->walk->turnRight(); break;
+						case ACTION_UP: this->walk->moveForward(); break;
+						case ACTION_DOWN: this->walk->moveBackward(); break;
+						case ACTION_IN: this->walk->moveUp(); break;
+						case ACTION_OUT: this->walk->moveDown(); break;
+					}
+				}
+				else {
+					switch (action) {
+						case ACTION_LEFT: this->orbit->changeLongitude(-5.0); break;
+						case ACTION_RIGHT: this->orbit->changeLongitude(5.0); break;
+						case ACTION_UP: this->orbit->changeLatitude(5.0); break;
+						case ACTION_DOWN: this->orbit->changeLatitude(-5.0); break;
+						case ACTION_IN: this->orbit->changeDistance(-4.0); break;
+						case ACTION_OUT: this->orbit->changeDistance(4.0); break;
+					}
+				}
+
+				if (action == ACTION_SWITCH) {
+					this->walking = !this->walking;
+				}
+			}
+
+			void handleMouseButtonEvent(const SDL_MouseButtonEvent &buttonEvent) {
+				this->handled++;
+				if (buttonEvent.button == SDL_BUTTON_LEFT) {
+					this->dragging = (buttonEvent.state == SDL_PRESSED);
+				}
+				else if (buttonEvent.state == SDL_PRESSED && !this->walking) {
+					if (buttonEvent.button == SDL_BUTTON_WHEELUP) {
+						this->orbit->changeDistance(-2.0);
+					}
+					else if (buttonEvent.button == SDL_BUTTON_WHEELDOWN) {
+						this->orbit->changeDistance(2.0);
+					}
+				}
+			}
+
+			void handleMouseMotionEvent(const SDL_MouseMotionEvent &motionEvent) {
+				this->handled++;
+				if (!this->dragging) {
+					return;
+				}
+
+				if (this->walking) {
+					this->walk->look(motionEvent.xrel, motionEvent.yrel);
+				}
+				else {
+					this->orbit->changeLongitude(-0.5 * motionEvent.xrel);
+					this->orbit->changeLatitude(0.5 * motionEvent.yrel);
+				}
+			}
+
+			/** Sets the script whose end stops the engine, or NULL to draw until stopped otherwise */
+			void setScript(ScriptedContext *script) {
+				this->script = script;
+			}
+
+			/** Gets both cameras' view matrices, one after the other */
+			std::vector<double> getPoses() {
+				std::vector<double> poses;
+				Matrix<double> views[] = { this->orbit->getViewMatrix(), this->walk->getViewMatrix() };
+				for (int v = 0; v < 2; v++) {
+					poses.insert(poses.end(), views[v].getArray(), views[v].getArray() + 16);
+				}
+				return poses;
+			}
+
+			/** The number of events handled */
+			unsigned long handled;
+
+			/** The number of frames after which either camera's pose was unsound */
+			unsigned long badPoses;
+
+		protected:
+
+			/** Gets the camera in use */
+			CameraRigging &current() {
+				return this->walking ? (CameraRigging &) *this->walk : (CameraRigging &) *this->orbit;
+			}
+
+			/** Checks a view matrix is finite, and keeps its rotation a rotation */
+			static bool isSound(CameraRigging &rigging) {
+				Matrix<double> view = rigging.getViewMatrix();
+				const double *m = view.getArray();
+				for (int i = 0; i < 16; i++) {
+					if (m[i] != m[i] || std::fabs(m[i]) > 1e12) {
+						return false;
+					}
+				}
+
+				// Each column of the rotation is a unit vector
+				for (int c = 0; c < 3; c++) {
+					double length = m[4 * c] * m[4 * c] + m[4 * c + 1] * m[4 * c + 1] + m[4 * c + 2] * m[4 * c + 2];
+					if (std::fabs(length - 1.0) > 1e-6) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			Engine &engine;
+			SceneGraphNodeBase::handle root;
+			ScriptedContext *script;
+			boost::shared_ptr<FixedTargetCameraRigging> orbit;
+			boost::shared_ptr<FirstPersonCameraRigging> walk;
+			bool walking;
+			bool dragging;
+		};
+
+		/** Writes a script of random events: key presses, drags and wheel clicks */
+		std::vector<SDL_Event> makeScript(int count, unsigned int width, unsigned int height) {
+			std::vector<SDL_Event> script;
+			int x = width / 2, y = height / 2;
+			bool pressed = false;
+
+			while ((int) script.size() < count) {
+				SDL_Event evt;
+				memset(&evt, 0, sizeof(evt));
+				double choice = uniformRand();
+
+				if (choice < 0.4) {
+					evt.type = SDL_KEYDOWN;
+					evt.key.state = SDL_PRESSED;
+					evt.key.keysym.sym = keys[rand() % keyCount];
+				}
+				else if (choice < 0.5) {
+					pressed = !pressed;
+					evt.type = (pressed ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP);
+					evt.button.button = SDL_BUTTON_LEFT;
+					evt.button.state = (pressed ? SDL_PRESSED : SDL_RELEASED);
+					evt.button.x = (Uint16) x;
+					evt.button.y = (Uint16) y;
+				}
+				else if (choice < 0.55) {
+					evt.type = SDL_MOUSEBUTTONDOWN;
+					evt.button.button = (rand() % 2 ? SDL_BUTTON_WHEELUP : SDL_BUTTON_WHEELDOWN);
+					evt.button.state = SDL_PRESSED;
+					evt.button.x = (Uint16) x;
+					evt.button.y = (Uint16) y;
+				}
+				else {
+					int dx = rand() % 21 - 10, dy = rand() % 21 - 10;
+					x = std::max(0, std::min((int) width - 1, x + dx));
+					y = std::max(0, std::min((int) height - 1, y + dy));
+					evt.type = SDL_MOUSEMOTION;
+					evt.motion.state = (pressed ? 1 : 0);
+					evt.motion.x = (Uint16) x;
+					evt.motion.y = (Uint16) y;
+					evt.motion.xrel = (Sint16) dx;
+					evt.motion.yrel = (Sint16) dy;
+				}
+
+				script.push_back(evt);
+			}
+
+			return script;
+		}
+
+		/** Builds a square field of cubes in rows of nodes, each cube a leaf placing the same model */
+		SceneGraphNodeBase::handle cubeField(int side) {
+			Model::handle model(new Model());
+			model->addMesh(makeCube());
+
+			SceneGraphNode::handle root(new SceneGraphNode());
+			for (int j = 0; j < side; j++) {
+				SceneGraphNode::handle row(new SceneGraphNode());
+				for (int i = 0; i < side; i++) {
+					SceneGraphNodeBase::handle leaf(new SceneGraphLeaf(model));
+					leaf->setOrigin(Vector3d(2.0 * i - side, 2.0 * j - side, 0.0));
+					row->addChild(leaf);
+				}
+				root->addChild(row);
+			}
+			return root;
+		}
+
+		/** Prints the percentiles of some frame times */
+		void printFrameTimes(const char *name, std::vector<double> times, double seconds) {
+			std::sort(times.begin(), times.end());
+			size_t n = times.size();
+			printf("%-14s %7lu %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, (unsigned long) n, seconds,
+				times[n / 2], times[std::min(n - 1, n * 9 / 10)], times[std::min(n - 1, n * 99 / 100)], times[n - 1]);
+		}
+
+	}
+
+	/*!
+	* Options: --width N, --height N (default 640x480), --events N
+	* (default 2000), --interval-ms N (between scripted events, default 2),
+	* --side N (cubes along each side of the field, default 30), --seed N
+	* (default 1), --log FILE (save the recording there and replay it from
+	* the file).
+	*/
+	int runReplayBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 640L);
+		unsigned int height = (unsigned int) getOption(args, "height", 480L);
+		int count = (int) getOption(args, "events", 2000L);
+		double intervalMs = (double) getOption(args, "interval-ms", 2L);
+		int side = (int) getOption(args, "side", 30L);
+		srand((unsigned int) getOption(args, "seed", 1L));
+		std::string logFile = getOption(args, "log", std::string());
+
+		ScriptedContext *context = new ScriptedContext(width, height, makeScript(count, width, height), intervalMs);
+		Engine engine((RenderContext::handle(context)));
+		for (int k = 0; k < keyCount; k++) {
+			engine.bindKey(keys[k], k + 1);
+		}
+
+		Driver driver(engine, cubeField(side), context);
+		engine.setDrawable(&driver);
+		engine.setCustomEventHandler(&driver);
+		engine.setMouseButtonEventHandler(&driver);
+		engine.setMouseMotionEventHandler(&driver);
+		glEnable(GL_LIGHTING);
+		glEnable(GL_LIGHT0);
+
+		// Record, drawing as often as events arrive
+		InputLog recorded;
+		engine.setInputLog(&recorded);
+		Stopwatch stopwatch;
+		unsigned long firstFrame = engine.getFrameCount();
+		engine.run();
+		double recordSeconds = stopwatch.getSeconds();
+		engine.setInputLog(0);
+		unsigned long recordedFrames = engine.getFrameCount() - firstFrame;
+		std::vector<double> recordedPoses = driver.getPoses();
+		unsigned long recordedHandled = driver.handled, recordedBad = driver.badPoses;
+		driver.setScript(0);
+
+		// Through a file or a buffer, so the replays read back what was written
+		InputLog log;
+		size_t bytes;
+		if (logFile.empty()) {
+			std::stringstream buffer(std::ios::in | std::ios::out | std::ios::binary);
+			recorded.save(buffer);
+			bytes = buffer.str().size();
+			log.load(buffer);
+		}
+		else {
+			recorded.save(logFile);
+			log.load(logFile);
+			std::ostringstream buffer(std::ios::out | std::ios::binary);
+			recorded.save(buffer);
+			bytes = buffer.str().size();
+		}
+
+		bool same = (log.size() == recorded.size());
+		for (size_t i = 0; same && i < log.size(); i++) {
+			const InputLog::Entry &a = log.get(i), &b = recorded.get(i);
+			same = (a.time == b.time && a.frame == b.frame && a.event.type == b.event.type && a.x == b.x && a.y == b.y);
+		}
+
+		printf("recorded %lu events over %lu frames in %.3f s; log of %lu bytes, %.1f per event, %s\n", (unsigned long) recorded.size(),
+			recordedFrames, recordSeconds, (unsigned long) bytes, (double) bytes / std::max((size_t) 1, recorded.size()),
+			same ? "read back intact" : "READ BACK DIFFERENT");
+		printf("%-14s %7s %9s %9s %9s %9s %9s\n", "replay", "frames", "seconds", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+		const char *names[] = { "fastest", "recorded pace" };
+		int result = same ? 0 : 1;
+		for (int paced = 0; paced < 2; paced++) {
+			driver.reset();
+			std::vector<double> times;
+			stopwatch.restart();
+			engine.replay(log, paced != 0, times);
+			double seconds = stopwatch.getSeconds();
+			printFrameTimes(names[paced], times, seconds);
+
+			bool matched = (driver.getPoses() == recordedPoses && driver.handled == recordedHandled);
+			printf("%-14s handled %lu of %lu events; cameras %s the recording; %lu unsound poses\n", "", driver.handled, recordedHandled,
+				matched ? "end as in" : "DIFFER FROM", driver.badPoses);
+			if (!matched || driver.badPoses) {
+				result = 1;
+			}
+		}
+
+		if (recordedBad) {
+			printf("%lu unsound poses while recording\n", recordedBad);
+			result = 1;
+		}
+		return result;
+	}
+
+}
+}
@@ -0,0 +1,478 @@
+/**
+* @file SceneBench.cpp
+*
+* Generates synthetic scenes from the library's own primitives and graph
+* nodes, flies scripted camera paths through each of them headless, and
+* reports frame time percentiles, draw calls, state changes and memory,
+* optionally as JSON to compare between builds.
+*
+* Every scene is generated from the random seed, so a run is reproducible
+* with the same options.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Engine.hpp"
+#include "Numerics.hpp"
+#include "PerspectiveCamera.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "QuadStrip.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include "Triangle.hpp"
+#include "TriangleFan.hpp"
+#include "TriangleStrip.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** A generated scene */
+		struct Scene {
+			std::string name;
+			std::string description;
+			SceneGraphNodeBase::handle root;
+			unsigned long triangles;
+		};
+
+		/**
+		* A camera path, as the pose of a camera circling the scene's centre at
+		* the start and end; the pose moves evenly between them over the frames.
+		* Distances are in multiples of the scene's radius.
+		*/
+		struct CameraPath {
+			const char *name;
+			double startLongitude, endLongitude;
+			double startLatitude, endLatitude;
+			double startDistance, endDistance;
+		};
+
+		/** The paths each scene is flown through: once around, in from afar, and down from overhead */
+		const CameraPath paths[] = {
+			{ "orbit", 0.0, 360.0, 35.0, 35.0, 1.5, 1.5 },
+			{ "zoom", 30.0, 60.0, 50.0, 20.0, 3.0, 0.3 },
+			{ "sweep", 0.0, 90.0, 85.0, 10.0, 1.0, 1.0 }
+		};
+
+		const size_t pathCount = sizeof(paths) / sizeof(paths[0]);
+
+		/** What flying a path through a scene measured */
+		struct Result {
+			std::string scene;
+			std::string path;
+			size_t frames;
+			double mean, p50, p90, p99, max;
+			double drawCalls, meshes, stateChanges, skipped, materialChanges;
+		};
+
+		/** Gets the process's resident memory, in bytes, or 0 if it can't be found */
+		unsigned long getResidentBytes() {
+#ifdef _WIN32
+			PROCESS_MEMORY_COUNTERS counters;
+			if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+				return (unsigned long) counters.WorkingSetSize;
+			}
+			return 0;
+#else
+			unsigned long size = 0, resident = 0;
+			FILE *statm = fopen("/proc/self/statm", "r");
+			if (!statm) {
+				return 0;
+			}
+			if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+				resident = 0;
+			}
+			fclose(statm);
+			return resident * (unsigned long) sysconf(_SC_PAGESIZE);
+#endif
+		}
+
+		/** Makes a random material */
+		Material randomMaterial() {
+			Color diffuse((float) uniformRand(0, 1), (float) uniformRand(0, 1), (float) uniformRand(0, 1));
+			return Material(Color(0.2f, 0.2f, 0.2f), diffuse, Color(1.0f, 1.0f, 1.0f), Color(0.0f, 0.0f, 0.0f), (float) uniformRand(8, 64));
+		}
+
+		/**
+		* Builds one mesh of a rolling height field with a side of the given
+		* number of cells.  The rows are built in turn as a triangle strip, a
+		* quad strip, a pair of triangles per cell and a fan per cell, so all
+		* four kinds of primitive are drawn.
+		*/
+		Scene terrain(int cells) {
+			Vertex3d::list verts;
+			for (int j = 0; j <= cells; j++) {
+				for (int i = 0; i <= cells; i++) {
+					double height = 4.0 * std::sin(i * 0.05) * std::cos(j * 0.07) + uniformRand(0, 0.25);
+					verts.push_back(Vertex3d((double) i, (double) j, height));
+				}
+			}
+
+			Primitive::list primitives;
+			int side = cells + 1;
+			for (int j = 0; j < cells; j++) {
+				int row = j * side, above = (j + 1) * side;
+
+				if (j % 4 == 0 || j % 4 == 1) {
+					// A strip along the row, each step an upper then a lower corner, which winds it anticlockwise from above
+					Primitive *strip;
+					if (j % 4 == 0) {
+						TriangleStrip *triangles = new TriangleStrip();
+						for (int i = 0; i <= cells; i++) {
+							triangles->addVertex(above + i);
+							triangles->addVertex(row + i);
+						}
+						strip = triangles;
+					}
+					else {
+						QuadStrip *quads = new QuadStrip();
+						for (int i = 0; i <= cells; i++) {
+							quads->addVertex(above + i);
+							quads->addVertex(row + i);
+						}
+						strip = quads;
+					}
+					primitives.push_back(Primitive::handle(strip));
+					continue;
+				}
+
+				for (int i = 0; i < cells; i++) {
+					if (j % 4 == 2) {
+						primitives.push_back(Primitive::handle(new Triangle(row + i, row + i + 1, above + i + 1)));
+						primitives.push_back(Primitive::handle(new Triangle(row + i, above + i + 1, above + i)));
+					}
+					else {
+						TriangleFan *fan = new TriangleFan();
+						fan->addVertex(row + i);
+						fan->addVertex(row + i + 1);
+						fan->addVertex(above + i + 1);
+						fan->addVertex(above + i);
+						primitives.push_back(Primitive::handle(fan));
+					}
+				}
+			}
+
+			Model::handle model(new Model());
+			model->addMesh(SmoothMesh::handle(new SmoothMesh(verts, primitives, randomMaterial())));
+
+			char description[128];
+			sprintf(description, "one mesh of %dx%d cells", cells, cells);
+			Scene scene = { "terrain", description, SceneGraphNodeBase::handle(new SceneGraphLeaf(model)), 2ul * cells * cells };
+			return scene;
+		}
+
+		/** Builds a binary assembly of the given depth, the two halves of each level spread along x, y and z in turn */
+		SceneGraphNodeBase::handle assembly(const Model::handle &model, int depth) {
+			if (depth == 0) {
+				return SceneGraphNodeBase::handle(new SceneGraphLeaf(model));
+			}
+
+			SceneGraphNode::handle node(new SceneGraphNode());
+			double spacing = 2.0 * std::pow(2.0, (depth - 1) / 3);
+			for (int i = 0; i < 2; i++) {
+				SceneGraphNodeBase::handle child = assembly(model, depth - 1);
+				double offset = spacing * i;
+				child->setOrigin(depth % 3 == 0 ? Vector3d(offset, 0.0, 0.0) : (depth % 3 == 1 ? Vector3d(0.0, offset, 0.0) : Vector3d(0.0, 0.0, offset)));
+				node->addChild(child);
+			}
+			return node;
+		}
+
+		/** Builds a deep binary tree of nodes with a cube at every leaf */
+		Scene deep(int depth) {
+			Model::handle model(new Model());
+			model->addMesh(makeCube(randomMaterial()));
+
+			char description[128];
+			sprintf(description, "%d levels of 2 nodes, %lu cubes", depth, 1ul << depth);
+			Scene scene = { "deep", description, assembly(model, depth), 12ul << depth };
+			return scene;
+		}
+
+		/** Builds one node with a great many cubes, each placed by a leaf of its own, directly beneath it */
+		Scene wide(int count) {
+			Model::handle model(new Model());
+			model->addMesh(makeCube(randomMaterial()));
+
+			SceneGraphNode::handle root(new SceneGraphNode());
+			double extent = 2.0 * std::sqrt((double) count);
+			for (int i = 0; i < count; i++) {
+				SceneGraphNodeBase::handle leaf(new SceneGraphLeaf(model));
+				leaf->setOrigin(Vector3d(uniformRand(0, extent), uniformRand(0, extent), uniformRand(0, 4)));
+				root->addChild(leaf);
+			}
+
+			char description[128];
+			sprintf(description, "%d cubes under one node", count);
+			Scene scene = { "wide", description, root, 12ul * count };
+			return scene;
+		}
+
+		/** Builds a field of cubes in rows of nodes, each cube in a material of its own */
+		Scene materials(int count) {
+			int side = (int) std::ceil(std::sqrt((double) count));
+
+			SceneGraphNode::handle root(new SceneGraphNode());
+			SceneGraphNode::handle row;
+			for (int i = 0; i < count; i++) {
+				if (i % side == 0) {
+					row.reset(new SceneGraphNode());
+					root->addChild(row);
+				}
+
+				Model::handle model(new Model());
+				model->addMesh(makeCube(randomMaterial()));
+				model->setOrigin(Vector3d(2.0 * (i % side), 2.0 * (i / side), uniformRand(0, 1)));
+				row->addChild(SceneGraphNodeBase::handle(new SceneGraphLeaf(model)));
+			}
+
+			char description[128];
+			sprintf(description, "%d cubes in %d materials", count, count);
+			Scene scene = { "materials", description, root, 12ul * count };
+			return scene;
+		}
+
+		/** Gets a percentile of some sorted times */
+		double percentile(const std::vector<double> &sorted, double fraction) {
+			size_t rank = (size_t) std::ceil(fraction * sorted.size());
+			return sorted[std::max(rank, (size_t) 1) - 1];
+		}
+
+		/** Flies a path through a scene centred on the origin, drawing it through the queue, and measures every frame */
+		Result fly(const Scene &scene, const CameraPath &path, double radius, size_t frames, double aspect, RenderQueue &queue) {
+			Camera::handle camera(new PerspectiveCamera(45.0, aspect, radius * 0.01, radius * 10.0));
+			FixedTargetCameraRigging rigging(camera, path.startLongitude, path.startLatitude, path.startDistance * radius);
+			double steps = (double) std::max(frames, (size_t) 2) - 1;
+
+			Result result;
+			result.scene = scene.name;
+			result.path = path.name;
+			result.frames = frames;
+			result.drawCalls = result.meshes = result.stateChanges = result.skipped = result.materialChanges = 0;
+
+			std::vector<double> times;
+			CullingStats stats;
+			for (size_t f = 0; f < frames; f++) {
+				Stopwatch stopwatch;
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glMatrixMode(GL_PROJECTION);
+				glLoadMatrixd(camera->getProjectionMatrix().getArray());
+				glMatrixMode(GL_MODELVIEW);
+				rigging.initModelviewMatrix();
+
+				queue.getStateCache().resetCounts();
+				queue.begin(rigging.getViewMatrix());
+				stats.reset();
+				scene.root->enqueue(queue, rigging.getFrustum(), stats);
+				queue.execute();
+				glFinish();
+				times.push_back(stopwatch.getSeconds() * 1000.0);
+
+				const GlStateCache &cache = queue.getStateCache();
+				const InstancingStats &instancing = queue.getInstancingStats();
+				result.drawCalls += instancing.drawCalls;
+				result.meshes += instancing.batches + instancing.singleDraws;
+				result.stateChanges += cache.getChangeCount();
+				result.skipped += cache.getSkippedCount();
+				result.materialChanges += cache.getMaterialChangeCount();
+
+				rigging.changeLongitude((path.endLongitude - path.startLongitude) / steps);
+				rigging.changeLatitude((path.endLatitude - path.startLatitude) / steps);
+				rigging.changeDistance((path.endDistance - path.startDistance) * radius / steps);
+			}
+
+			result.drawCalls /= frames;
+			result.meshes /= frames;
+			result.stateChanges /= frames;
+			result.skipped /= frames;
+			result.materialChanges /= frames;
+
+			result.mean = 0;
+			for (size_t i = 0; i < times.size(); i++) {
+				result.mean += times[i];
+			}
+			result.mean /= times.size();
+
+			std::sort(times.begin(), times.end());
+			result.p50 = percentile(times, 0.5);
+			result.p90 = percentile(times, 0.9);
+			result.p99 = percentile(times, 0.99);
+			result.max = times.back();
+			return result;
+		}
+
+		/** Writes a string as a JSON string */
+		void writeJsonString(std::ostream &out, const std::string &value) {
+			out << '"';
+			for (size_t i = 0; i < value.size(); i++) {
+				if (value[i] == '"' || value[i] == '\\') {
+					out << '\\';
+				}
+				out << value[i];
+			}
+			out << '"';
+		}
+
+	}
+
+	/*!
+	* Each scene is centred on the origin, and every path is scaled to its
+	* bounding radius.  Frames are timed to the end of glFinish(), so the
+	* times include the GPU's work.  The memory is the resident set, after
+	* the scene is built and after its paths are flown.
+	*
+	* Options: --width N, --height N (default 1280x720), --frames N (per
+	* path, default 120), --seed N (default 1), --scene NAME (one of
+	* terrain, deep, wide or materials; default all), --cells N (terrain
+	* side, default 512), --depth N (deep levels, default 14), --count N
+	* (wide cubes, default 20000), --materials N (default 2000),
+	* --instancing, --json FILE, --label TEXT (recorded in the JSON, e.g.
+	* a commit).
+	*/
+	int runSceneBench(const Arguments &args) {
+		unsigned int width = (unsigned int) getOption(args, "width", 1280L);
+		unsigned int height = (unsigned int) getOption(args, "height", 720L);
+		size_t frames = (size_t) std::max(1L, getOption(args, "frames", 120L));
+		unsigned int seed = (unsigned int) getOption(args, "seed", 1L);
+		std::string only = getOption(args, "scene", std::string());
+		std::string json = getOption(args, "json", std::string());
+		std::string label = getOption(args, "label", std::string());
+		bool instancing = hasFlag(args, "instancing");
+
+		Engine engine(RenderContext::handle(new HeadlessRenderContext(width, height)));
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_LIGHT0);
+
+		printf("renderer: %s, %ux%u, %lu frames per path, seed %u%s\n", (const char *) glGetString(GL_RENDERER),
+			width, height, (unsigned long) frames, seed, instancing ? ", instanced" : "");
+		printf("%-10s %-6s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "scene", "path", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms",
+			"meshes", "draws", "changes", "materials");
+
+		const char *names[] = { "terrain", "deep", "wide", "materials" };
+		std::vector<Result> results;
+		std::vector<Scene> built;
+		std::vector<unsigned long> sceneBytes, residentBytes;
+		for (size_t s = 0; s < sizeof(names) / sizeof(names[0]); s++) {
+			if (!only.empty() && only != names[s]) {
+				continue;
+			}
+
+			// Each scene has its own sequence, so it is the same whichever scenes are run
+			srand(seed + (unsigned int) s);
+			unsigned long before = getResidentBytes();
+			Scene scene;
+			switch (s) {
+				case 0: scene = terrain((int) getOption(args, "cells", 512L)); break;
+				case 1: scene = deep((int) getOption(args, "depth", 14L)); break;
+				case 2: scene = wide((int) getOption(args, "count", 20000L)); break;
+				default: scene = materials((int) getOption(args, "materials", 2000L)); break;
+			}
+
+			BoundingBox bounds = scene.root->getBoundingBox();
+			Point3d center = bounds.getCenter();
+			scene.root->setOrigin(Vector3d(-center.x, -center.y, -center.z));
+			double radius = bounds.getDimensions().magnitude() / 2.0;
+			unsigned long afterBuild = getResidentBytes();
+
+			RenderQueue queue;
+			queue.setInstancing(instancing);
+			for (size_t p = 0; p < pathCount; p++) {
+				Result result = fly(scene, paths[p], radius, frames, (double) width / height, queue);
+				results.push_back(result);
+				printf("%-10s %-6s %9.3f %9.3f %9.3f %9.3f %9.3f %9.0f %9.0f %9.0f %9.0f\n", result.scene.c_str(), result.path.c_str(),
+					result.mean, result.p50, result.p90, result.p99, result.max, result.meshes, result.drawCalls, result.stateChanges, result.materialChanges);
+			}
+			queue.release();
+
+			unsigned long after = getResidentBytes();
+			printf("%-10s %s, %lu triangles; %.1f MB built, %.1f MB resident\n", scene.name.c_str(), scene.description.c_str(),
+				scene.triangles, (afterBuild - before) / 1048576.0, after / 1048576.0);
+
+			built.push_back(scene);
+			sceneBytes.push_back(afterBuild > before ? afterBuild - before : 0);
+			residentBytes.push_back(after);
+
+			// Only the summary is kept, so the next scene's memory is its own
+			built.back().root.reset();
+		}
+
+		if (!json.empty()) {
+			std::ofstream out(json.c_str());
+			if (!out) {
+				throw std::runtime_error("SceneBench: could not open " + json);
+			}
+
+			char number[64];
+			out << "{\n  \"suite\": \"scenes\",\n  \"label\": ";
+			writeJsonString(out, label);
+			out << ",\n  \"renderer\": ";
+			writeJsonString(out, (const char *) glGetString(GL_RENDERER));
+			out << ",\n  \"width\": " << width << ", \"height\": " << height << ", \"seed\": " << seed << ", \"instancing\": "
+				<< (instancing ? "true" : "false") << ",\n  \"scenes\": [";
+			for (size_t s = 0; s < built.size(); s++) {
+				out << (s ? ",\n" : "\n") << "    {\"name\": ";
+				writeJsonString(out, built[s].name);
+				out << ", \"description\": ";
+				writeJsonString(out, built[s].description);
+				out << ", \"triangles\": " << built[s].triangles << ", \"sceneBytes\": " << sceneBytes[s]
+					<< ", \"residentBytes\": " << residentBytes[s] << ", \"paths\": [";
+
+				bool first = true;
+				for (size_t r = 0; r < results.size(); r++) {
+					const Result &result = results[r];
+					if (result.scene != built[s].name) {
+						continue;
+					}
+					out << (first ? "\n" : ",\n") << "      {\"name\": ";
+					writeJsonString(out, result.path);
+					out << ", \"frames\": " << (unsigned long) result.frames;
+					sprintf(number, "%.4f", result.mean);
+					out << ", \"frameMs\": {\"mean\": " << number;
+					sprintf(number, "%.4f", result.p50);
+					out << ", \"p50\": " << number;
+					sprintf(number, "%.4f", result.p90);
+					out << ", \"p90\": " << number;
+					sprintf(number, "%.4f", result.p99);
+					out << ", \"p99\": " << number;
+					sprintf(number, "%.4f", result.max);
+					out << ", \"max\": " << number << "}";
+					sprintf(number, "%.1f", result.meshes);
+					out << ", \"meshesPerFrame\": " << number;
+					sprintf(number, "%.1f", result.drawCalls);
+					out << ", \"drawCallsPerFrame\": " << number;
+					sprintf(number, "%.1f", result.stateChanges);
+					out << ", \"stateChangesPerFrame\": " << number;
+					sprintf(number, "%.1f", result.skipped);
+					out << ", \"stateChangesSkippedPerFrame\": " << number;
+					sprintf(number, "%.1f", result.materialChanges);
+					out << ", \"materialChangesPerFrame\": " << number << "}";
+					first = false;
+				}
+				out << "\n    ]}";
+			}
+			out << "\n  ]\n}\n";
+
+			printf("results written to %s\n", json.c_str());
+		}
+
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,229 @@
+/**
+* @file SetBench.cpp
+*
+* Compares the hashed Set against the linear-search set it replaced, for
+* building point sets, membership queries, and set algebra.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Geometry.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/**
+		* The previous Set: a vector searched from end to end by every
+		* membership test.
+		*/
+		template <class T>
+		class LegacySet {
+		public:
+			bool has(const T &t) const {
+				for (typename vector<T>::const_iterator i = this->elements.begin(); i != this->elements.end(); i++) {
+					if (t == *i) return true;
+				}
+				return false;
+			}
+
+			void add(const T &t) {
+				if (!has(t)) this->elements.push_back(t);
+			}
+
+			void addAll(const vector<T> &tList) {
+				for (typename vector<T>::const_iterator i = tList.begin(); i != tList.end(); i++) add(*i);
+			}
+
+			void retainAll(const LegacySet<T> &tSet) {
+				vector<T> resultingElements;
+				for (typename vector<T>::const_iterator i = this->elements.begin(); i != this->elements.end(); i++) {
+					if (tSet.has(*i)) resultingElements.push_back(*i);
+				}
+				this->elements = resultingElements;
+			}
+
+			size_t size() const { return this->elements.size(); }
+
+			vector<T> elements;
+		};
+
+		/** Builds a set from a list of points */
+		template <typename S>
+		struct Build {
+			const Point3d::list &points;
+			size_t size;
+
+			Build(const Point3d::list &points) : points(points), size(0) {}
+
+			void operator()() {
+				S set;
+				set.addAll(this->points);
+				this->size = set.size();
+			}
+		};
+
+		/** Builds a welding set from a list of points */
+		struct BuildWelded {
+			const Point3d::list &points;
+			double tolerance;
+			size_t size;
+
+			BuildWelded(const Point3d::list &points, double tolerance) : points(points), tolerance(tolerance), size(0) {}
+
+			void operator()() {
+				Point3dSet set(this->tolerance);
+				set.addAll(this->points);
+				this->size = set.size();
+			}
+		};
+
+		/** Tests a list of points for membership in a set */
+		template <typename S>
+		struct Query {
+			const S &set;
+			const Point3d::list &points;
+			size_t found;
+
+			Query(const S &set, const Point3d::list &points) : set(set), points(points), found(0) {}
+
+			void operator()() {
+				this->found = 0;
+				for (size_t i = 0; i < this->points.size(); i++) {
+					if (this->set.has(this->points[i])) this->found++;
+				}
+			}
+		};
+
+		/** Intersects two sets */
+		template <typename S>
+		struct Intersect {
+			const S &set1;
+			const S &set2;
+			size_t size;
+
+			Intersect(const S &set1, const S &set2) : set1(set1), set2(set2), size(0) {}
+
+			void operator()() {
+				S set = this->set1;
+				set.retainAll(this->set2);
+				this->size = set.size();
+			}
+		};
+
+		/** Unites two sets */
+		struct Unite {
+			const Point3dSet &set1;
+			const Point3dSet &set2;
+			size_t size;
+
+			Unite(const Point3dSet &set1, const Point3dSet &set2) : set1(set1), set2(set2), size(0) {}
+
+			void operator()() {
+				this->size = setUnion(this->set1, this->set2).size();
+			}
+		};
+
+		/**
+		* Makes points on a grid, so that roughly one in four is a repeat of
+		* an earlier one, as with the shared corners of a mesh's faces
+		*/
+		Point3d::list gridPoints(size_t count) {
+			Point3d::list points;
+			long side = 1;
+
+			while ((size_t) (side * side * side * 4) < count * 3) {
+				side++;
+			}
+
+			points.reserve(count);
+			for (size_t i = 0; i < count; i++) {
+				points.push_back(Point3d(rand() % side, rand() % side, rand() % side));
+			}
+
+			return points;
+		}
+
+		/** Prints a row of results, leaving out the speedup if there is no baseline */
+		void printRow(const char *operation, const char *path, size_t count, double seconds, double baseline) {
+			printf("%-12s  %-8s  %10lu  %10.1f", operation, path, (unsigned long) count, seconds * 1e9 / count);
+
+			if (baseline > 0) {
+				printf("  %10.1f\n", baseline / seconds);
+			}
+			else {
+				printf("  %10s\n", "-");
+			}
+		}
+
+	}
+
+	/*!
+	* The linear set is quadratic, so it is only timed up to --legacy-count
+	* points; the hashed set is then timed at that size and at --count.
+	*
+	* Options: --count N (default 1000000 points), --legacy-count N (default
+	* 20000 points), --repetitions N (default 3).
+	*/
+	int runSetBench(const Arguments &args) {
+		size_t count = (size_t) getOption(args, "count", 1000000L);
+		size_t legacyCount = (size_t) getOption(args, "legacy-count", 20000L);
+		int repetitions = (int) getOption(args, "repetitions", 3L);
+
+		printf("%-12s  %-8s  %10s  %10s  %10s\n", "operation", "set", "points", "ns each", "speedup");
+
+		size_t sizes[] = { legacyCount, count };
+
+		for (int s = 0; s < 2; s++) {
+			size_t n = sizes[s];
+			bool legacy = (n == legacyCount);
+			Point3d::list points = gridPoints(n), others = gridPoints(n);
+
+			Point3dSet set1(points), set2(others);
+			LegacySet<Point3d> legacySet1, legacySet2;
+
+			double baseline = 0;
+
+			Build<Point3dSet> build(points);
+			double seconds = timeBest(build, repetitions);
+			if (legacy) {
+				Build<LegacySet<Point3d> > legacyBuild(points);
+				baseline = timeBest(legacyBuild, repetitions);
+				printRow("build", "linear", n, baseline, baseline);
+				legacySet1.addAll(points);
+				legacySet2.addAll(others);
+			}
+			printRow("build", "hashed", n, seconds, baseline);
+
+			BuildWelded welded(points, 0.5);
+			printRow("build welded", "hashed", n, timeBest(welded, repetitions), 0);
+
+			Query<Point3dSet> query(set1, others);
+			seconds = timeBest(query, repetitions);
+			if (legacy) {
+				Query<LegacySet<Point3d> > legacyQuery(legacySet1, others);
+				baseline = timeBest(legacyQuery, repetitions);
+				printRow("has", "linear", n, baseline, baseline);
+			}
+			printRow("has", "hashed", n, seconds, baseline);
+
+			Intersect<Point3dSet> intersect(set1, set2);
+			seconds = timeBest(intersect, repetitions);
+			if (legacy) {
+				Intersect<LegacySet<Point3d> > legacyIntersect(legacySet1, legacySet2);
+				baseline = timeBest(legacyIntersect, repetitions);
+				printRow("retainAll", "linear", n, baseline, baseline);
+			}
+			printRow("retainAll", "hashed", n, seconds, baseline);
+
+			Unite unite(set1, set2);
+			printRow("setUnion", "hashed", n, timeBest(unite, repetitions), 0);
+		}
+
+		return 0;
+	}
+
+}
+}
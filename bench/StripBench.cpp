@@ -0,0 +1,163 @@
+/**
+* @file StripBench.cpp
+*
+* Strips triangle soups with Stripifier: a triangulated grid in row order,
+* the same grid shuffled with its triangles' corners rotated, a sphere
+* whose poles suit fans, the sphere with a back face on every triangle,
+* and a lone triangle with its back face.  Reports the strips and fans
+* made, their average length, the indices saved and how long stripping
+* took, and checks the stripped streams hold exactly the faces they were
+* made from, with the same winding.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "Meshes.hpp"
+#include "Stripifier.hpp"
+#include "Numerics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** A mesh to strip */
+		struct SoupMesh {
+			const char *name;
+			PrimitiveStreams streams;
+		};
+
+		/** A triangulated grid, two triangles to a cell, in row order */
+		void makeGrid(SoupMesh &mesh, size_t side) {
+			mesh.name = "grid";
+			addGridTriangles(mesh.streams, side);
+		}
+
+		/** The same triangles in a random order, each starting from a random corner */
+		void makeShuffled(SoupMesh &mesh, const SoupMesh &from) {
+			mesh.name = "shuffled";
+			PrimitiveStreams::indexList triangles = shuffled(from.streams.getTriangles(), 3);
+			for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+				const vertexIndex *v = &triangles[i];
+				int r = rand() % 3;
+				mesh.streams.addTriangle(v[r], v[(r + 1) % 3], v[(r + 2) % 3]);
+			}
+		}
+
+		/** A sphere of quads between its poles, split into triangles, with a ring of triangles at each pole */
+		void makeSphere(SoupMesh &mesh, size_t segments) {
+			mesh.name = "sphere";
+			size_t rings = segments / 2;
+			vertexIndex north = 0, south = (vertexIndex) ((rings - 1) * segments + 1);
+
+			// Vertex 1 + r * segments + s is on ring r (0 nearest the north pole) and segment s
+			for (size_t s = 0; s < segments; s++) {
+				vertexIndex a = (vertexIndex) (1 + s), b = (vertexIndex) (1 + (s + 1) % segments);
+				mesh.streams.addTriangle(north, a, b);
+			}
+			for (size_t r = 0; r + 1 < rings - 1; r++) {
+				for (size_t s = 0; s < segments; s++) {
+					vertexIndex a = (vertexIndex) (1 + r * segments + s);
+					vertexIndex b = (vertexIndex) (1 + r * segments + (s + 1) % segments);
+					vertexIndex c = (vertexIndex) (b + segments), d = (vertexIndex) (a + segments);
+					mesh.streams.addTriangle(a, d, c);
+					mesh.streams.addTriangle(a, c, b);
+				}
+			}
+			for (size_t s = 0; s < segments; s++) {
+				vertexIndex a = (vertexIndex) (1 + (rings - 2) * segments + s);
+				vertexIndex b = (vertexIndex) (1 + (rings - 2) * segments + (s + 1) % segments);
+				mesh.streams.addTriangle(south, b, a);
+			}
+		}
+
+		/** The same triangles, each with a back face: the same corners wound the other way */
+		void makeTwoSided(SoupMesh &mesh, const SoupMesh &from) {
+			mesh.name = "two-sided";
+			const PrimitiveStreams::indexList &triangles = from.streams.getTriangles();
+			for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+				mesh.streams.addTriangle(triangles[i], triangles[i + 1], triangles[i + 2]);
+				mesh.streams.addTriangle(triangles[i + 1], triangles[i], triangles[i + 2]);
+			}
+		}
+
+		/** A single triangle and its back face, which share all three edges */
+		void makePair(SoupMesh &mesh) {
+			mesh.name = "pair";
+			mesh.streams.addTriangle(0, 1, 2);
+			mesh.streams.addTriangle(1, 0, 2);
+		}
+
+		/** Strips a mesh with a configured Stripifier */
+		struct StripPath {
+			const Stripifier &stripifier;
+			const PrimitiveStreams &input;
+			PrimitiveStreams output;
+			StripStats stats;
+
+			StripPath(const Stripifier &stripifier, const PrimitiveStreams &input) : stripifier(stripifier), input(input) {}
+
+			void operator()() {
+				this->output = this->stripifier.stripify(this->input, &this->stats);
+			}
+		};
+
+	}
+
+	/*!
+	* Options: --side N (grid vertices along each side, default 400),
+	* --segments N (around the sphere, default 64), --repetitions N
+	* (default 3), --seed N (default 1).
+	*/
+	int runStripBench(const Arguments &args) {
+		size_t side = (size_t) getOption(args, "side", 400L);
+		size_t segments = std::max((size_t) getOption(args, "segments", 64L), (size_t) 6);
+		int repetitions = (int) getOption(args, "repetitions", 3L);
+		srand((unsigned int) getOption(args, "seed", 1L));
+
+		SoupMesh meshes[5];
+		makeGrid(meshes[0], side);
+		makeShuffled(meshes[1], meshes[0]);
+		makeSphere(meshes[2], segments);
+		makeTwoSided(meshes[3], meshes[2]);
+		makePair(meshes[4]);
+
+		const char *configNames[] = { "default", "no fans", "stitched" };
+		Stripifier configs[3];
+		configs[1].setMinFanLength(0);
+		configs[2].setStitching(true);
+
+		printf("%-9s  %-10s %9s  %7s  %7s  %5s  %7s  %7s  %10s  %10s  %6s  %9s  %s\n", "mesh", "stripifier", "triangles",
+			"strips", "avg len", "fans", "avg len", "singles", "idx before", "idx after", "saved", "ms", "faces");
+
+		int result = 0;
+		for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++) {
+			vector<Face> expected = sortedFaces(meshes[m].streams);
+
+			for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+				StripPath path(configs[c], meshes[m].streams);
+				double seconds = timeBest(path, repetitions);
+				const StripStats &stats = path.stats;
+
+				bool same = (sortedFaces(path.output) == expected);
+				if (!same) {
+					result = 1;
+				}
+
+				printf("%-9s  %-10s %9lu  %7lu  %7.2f  %5lu  %7.2f  %7lu  %10lu  %10lu  %5.1f%%  %9.2f  %s\n", meshes[m].name, configNames[c],
+					(unsigned long) stats.triangles, (unsigned long) stats.strips, stats.getAverageStripLength(),
+					(unsigned long) stats.fans, stats.getAverageFanLength(), (unsigned long) stats.singleTriangles,
+					(unsigned long) stats.indicesBefore, (unsigned long) stats.indicesAfter, stats.getIndexReduction() * 100,
+					seconds * 1000, same ? "same" : "DIFFERENT");
+			}
+		}
+
+		return result;
+	}
+
+}
+}
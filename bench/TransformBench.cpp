@@ -0,0 +1,102 @@
+/**
+* @file TransformBench.cpp
+*
+* Times bringing the world transformations and bounds of a large assembly
+* up to date after moving one part of it, for parts of every size from a
+* single leaf to the whole scene, to show the cost follows what moved.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include <cmath>
+#include <cstdio>
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/**
+		* Builds an assembly of the given depth, with the given number of
+		* children under each node, every leaf placing the same model.  Each
+		* node is offset within its parent, so every level has a transformation.
+		*/
+		SceneGraphNodeBase::handle assembly(const Model::handle &model, int depth, int fanout, std::vector<SceneGraphNodeBase *> &firstAtLevel) {
+			if (depth == 0) {
+				SceneGraphNodeBase::handle leaf(new SceneGraphLeaf(model));
+				if (firstAtLevel[0] == 0) {
+					firstAtLevel[0] = leaf.get();
+				}
+				return leaf;
+			}
+
+			SceneGraphNode::handle node(new SceneGraphNode());
+			for (int i = 0; i < fanout; i++) {
+				SceneGraphNodeBase::handle child = assembly(model, depth - 1, fanout, firstAtLevel);
+				child->setOrigin(Vector3d(2.0 * i * std::pow((double) fanout, depth - 1), 0.0, 0.0));
+				node->addChild(child);
+			}
+
+			if (firstAtLevel[depth] == 0) {
+				firstAtLevel[depth] = node.get();
+			}
+			return node;
+		}
+
+	}
+
+	/*!
+	* Each row moves the first leaf or node at one level of the assembly back
+	* and forth, and times bringing the root's bounds up to date afterwards.
+	*
+	* Options: --depth N (levels of nodes, default 5), --fanout N (children
+	* of each node, default 10, so 100000 leaves), --repetitions N (default
+	* 1000).
+	*/
+	int runTransformBench(const Arguments &args) {
+		int depth = (int) getOption(args, "depth", 5L);
+		int fanout = (int) getOption(args, "fanout", 10L);
+		int repetitions = (int) getOption(args, "repetitions", 1000L);
+
+		Model::handle model(new Model());
+		model->addMesh(makeCube());
+
+		std::vector<SceneGraphNodeBase *> firstAtLevel(depth + 1, (SceneGraphNodeBase *) 0);
+		SceneGraphNodeBase::handle root = assembly(model, depth, fanout, firstAtLevel);
+
+		Stopwatch stopwatch;
+		BoundingBox bounds = root->getBoundingBox();
+		double full = stopwatch.getSeconds();
+
+		printf("%u leaves under %d levels of %d; first full update %.3f ms\n", root->getLeafCount(), depth, fanout, full * 1000.0);
+		printf("%-10s  %10s  %12s  %10s\n", "moved", "leaves", "us each", "bounds");
+
+		for (int level = 0; level <= depth; level++) {
+			SceneGraphNodeBase *node = firstAtLevel[level];
+			Vector3d origin = node->getOrigin();
+
+			stopwatch.restart();
+			for (int r = 0; r < repetitions; r++) {
+				node->setOrigin(Vector3d(origin.x, origin.y, (r & 1) ? 1.0 : 0.0));
+				root->getBoundingBox();
+			}
+			double seconds = stopwatch.getSeconds() / repetitions;
+
+			// Raising the part by one must raise the top of the root's bounds by one, and putting it back must restore them
+			node->setOrigin(Vector3d(origin.x, origin.y, 1.0));
+			bool raised = (root->getBoundingBox().getHigh().z == bounds.getHigh().z + 1.0);
+			node->setOrigin(origin);
+			bool restored = (root->getBoundingBox().getHigh().z == bounds.getHigh().z);
+
+			char name[32];
+			sprintf(name, "level %d", level);
+			printf("%-10s  %10u  %12.3f  %10s\n", level == depth ? "root" : (level == 0 ? "leaf" : name), node->getLeafCount(), seconds * 1e6,
+				raised && restored ? "ok" : "WRONG");
+		}
+
+		return 0;
+	}
+
+}
+}
@@ -0,0 +1,183 @@
+/**
+* @file UpdateBench.cpp
+*
+* Feeds the engine a steady stream of key presses whose handler is slow,
+* while each frame is slow too, and compares handling them between frames
+* against handling them on the update thread, which publishes snapshots of
+* the camera and the scene for the frames to draw.
+*/
+#include "Peek_base.hpp"
+#include "Benchmark.hpp"
+#include "CompiledSceneGraph.hpp"
+#include "Engine.hpp"
+#include "FixedTargetCameraRigging.hpp"
+#include "FrameSnapshot.hpp"
+#include "PerspectiveCamera.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include "TripleBuffer.hpp"
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using boost::chrono::steady_clock;
+
+namespace peek {
+namespace bench {
+
+	namespace {
+
+		/** Sleeps for the given number of milliseconds */
+		void sleepFor(double milliseconds) {
+			boost::this_thread::sleep_for(boost::chrono::microseconds((long) (milliseconds * 1000.0)));
+		}
+
+		/** A headless context whose window receives a key press every so often */
+		class ScriptedContext : public HeadlessRenderContext {
+		public:
+
+			ScriptedContext(unsigned int width, unsigned int height, double intervalMs)
+				: HeadlessRenderContext(width, height) {
+				this->interval = boost::chrono::duration_cast<steady_clock::duration>(boost::chrono::duration<double, boost::milli>(intervalMs));
+				this->next = steady_clock::now() + this->interval;
+			}
+
+			virtual bool pollEvent(SDL_Event &evt) {
+				if (steady_clock::now() < this->next) {
+					return false;
+				}
+
+				memset(&evt, 0, sizeof(evt));
+				evt.type = SDL_KEYDOWN;
+				evt.key.keysym.sym = SDLK_RIGHT;
+
+				this->sent.push_back(this->next);
+				this->next += this->interval;
+				return true;
+			}
+
+			virtual bool hasPendingEvents() {
+				return steady_clock::now() >= this->next;
+			}
+
+			/** When each key press arrived */
+			std::vector<steady_clock::time_point> sent;
+
+		protected:
+			steady_clock::duration interval;
+			steady_clock::time_point next;
+		};
+
+		/** Turns the camera on each key press, after working for a while, and publishes snapshots for the frames */
+		class Scene : public KeyEventHandler, public StatePublisher, public Drawable {
+		public:
+
+			Scene(Camera::handle camera, SceneGraphNodeBase::handle root, double handlerMs, double frameMs)
+				: rigging(camera, 30.0, 50.0, 60.0), graph(root) {
+				this->handlerMs = handlerMs;
+				this->frameMs = frameMs;
+			}
+
+			virtual void handleKeyEvent(const SDL_KeyboardEvent &keyEvent, int x, int y) {
+				sleepFor(this->handlerMs);
+				this->rigging.changeLongitude(1.0);
+				this->handled.push_back(steady_clock::now());
+			}
+
+			virtual void publishState() {
+				this->snapshots.getBack().capture(this->rigging, this->graph);
+				this->snapshots.publish();
+			}
+
+			virtual void draw() {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				const FrameSnapshot &snapshot = this->snapshots.acquire();
+				snapshot.loadCamera();
+				snapshot.enqueue(this->queue);
+				this->queue.execute();
+
+				sleepFor(this->frameMs);
+			}
+
+			/** When each key press was handled */
+			std::vector<steady_clock::time_point> handled;
+
+			RenderQueue queue;
+
+		protected:
+			FixedTargetCameraRigging rigging;
+			CompiledSceneGraph graph;
+			TripleBuffer<FrameSnapshot> snapshots;
+			double handlerMs;
+			double frameMs;
+		};
+
+	}
+
+	/*!
+	* Options: --frames N (default 200), --frame-ms N (time each frame
+	* takes beyond drawing, default 15), --handler-ms N (time each key press
+	* takes to handle, default 4), --interval-ms N (between key presses,
+	* default 10), --side N (cubes along each side of the field, default 10).
+	*/
+	int runUpdateBench(const Arguments &args) {
+		int frames = (int) getOption(args, "frames", 200L);
+		double frameMs = (double) getOption(args, "frame-ms", 15L);
+		double handlerMs = (double) getOption(args, "handler-ms", 4L);
+		double intervalMs = (double) getOption(args, "interval-ms", 10L);
+		int side = (int) getOption(args, "side", 10L);
+
+		printf("%d frames taking %.1f ms more than drawing, a key press every %.1f ms taking %.1f ms to handle\n",
+			frames, frameMs, intervalMs, handlerMs);
+		printf("%-14s  %10s  %10s  %12s  %12s\n", "events", "fps", "handled", "mean lag ms", "max lag ms");
+
+		const char *names[] = { "between frames", "update thread" };
+		for (int threaded = 0; threaded < 2; threaded++) {
+			ScriptedContext *context = new ScriptedContext(640, 480, intervalMs);
+			Engine engine((RenderContext::handle(context)));
+
+			Model::handle model(new Model());
+			model->addMesh(makeCube());
+			SceneGraphNode::handle root(new SceneGraphNode());
+			for (int i = 0; i < side * side; i++) {
+				SceneGraphNodeBase::handle leaf(new SceneGraphLeaf(model));
+				leaf->setOrigin(Vector3d(2.0 * (i % side) - side, 2.0 * (i / side) - side, 0.0));
+				root->addChild(leaf);
+			}
+
+			Camera::handle camera(new PerspectiveCamera(45.0, 640.0 / 480.0, 1.0, 1000.0));
+			Scene scene(camera, root, handlerMs, frameMs);
+
+			glEnable(GL_LIGHT0);
+			engine.setDrawable(&scene);
+			engine.setKeyEventHandler(&scene);
+			engine.setStatePublisher(&scene);
+			engine.setUpdateThreaded(threaded != 0);
+
+			Stopwatch stopwatch;
+			engine.run(frames);
+			double seconds = stopwatch.getSeconds();
+
+			double total = 0, worst = 0;
+			size_t count = std::min(scene.handled.size(), context->sent.size());
+			for (size_t i = 0; i < count; i++) {
+				double lag = boost::chrono::duration<double, boost::milli>(scene.handled[i] - context->sent[i]).count();
+				total += lag;
+				worst = std::max(worst, lag);
+			}
+
+			printf("%-14s  %10.1f  %4lu of %3lu  %12.2f  %12.2f\n", names[threaded], frames / seconds, (unsigned long) count,
+				(unsigned long) context->sent.size(), count ? total / count : 0.0, worst);
+
+			scene.queue.release();
+		}
+
+		return 0;
+	}
+
+}
+}
@@ -35,8 +35,21 @@ namespace peek {
 
 	void BirdsEyeCameraRigging::initModelviewMatrix() {
 		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glTranslated(-this->location.x, -this->location.y, -this->location.z);
+		glLoadMatrixd(getViewMatrix().getArray());
+	}
+
+	/**
+	 * \return The view matrix, which moves the world opposite to the camera
+	 */
+	Matrix<double> BirdsEyeCameraRigging::getViewMatrix() {
+		return translationMatrix(-this->location.x, -this->location.y, -this->location.z);
+	}
+
+	/**
+	 * \return The inverse of the view matrix, recalculated only when the camera moves
+	 */
+	const Matrix<double> &BirdsEyeCameraRigging::getInverseViewMatrix() {
+		return this->viewInverse.getInverse(getViewMatrix());
 	}
 
 	/**
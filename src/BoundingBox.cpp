@@ -0,0 +1,202 @@
+/**
+* @file BoundingBox.cpp
+*/
+#include "BoundingBox.hpp"
+#include "Simd.hpp"
+#include <limits>
+
+#ifdef PEEK_X86_SIMD
+#  include <emmintrin.h>
+#  include <immintrin.h>
+#endif
+
+namespace peek {
+
+	namespace {
+
+		/** Finds the bounds of points [begin, end) one coordinate at a time */
+		void findBoundsScalar(const Vertex3d *points, size_t begin, size_t end, double low[3], double high[3]) {
+			for (size_t i = begin; i < end; i++) {
+				low[0] = std::min(low[0], points[i].x);
+				low[1] = std::min(low[1], points[i].y);
+				low[2] = std::min(low[2], points[i].z);
+				high[0] = std::max(high[0], points[i].x);
+				high[1] = std::max(high[1], points[i].y);
+				high[2] = std::max(high[2], points[i].z);
+			}
+		}
+
+#ifdef PEEK_X86_SIMD
+
+		/** Finds the bounds of a list of points, two coordinates per register */
+		void findBoundsSse2(const Vertex3d *points, size_t count, double low[3], double high[3]) {
+			__m128d lowXY = _mm_set_pd(low[1], low[0]), lowZ = _mm_set_sd(low[2]);
+			__m128d highXY = _mm_set_pd(high[1], high[0]), highZ = _mm_set_sd(high[2]);
+
+			for (size_t i = 0; i < count; i++) {
+				__m128d xy = _mm_loadu_pd(&points[i].x);
+				__m128d z = _mm_load_sd(&points[i].z);
+				lowXY = _mm_min_pd(lowXY, xy);
+				highXY = _mm_max_pd(highXY, xy);
+				lowZ = _mm_min_sd(lowZ, z);
+				highZ = _mm_max_sd(highZ, z);
+			}
+
+			_mm_storeu_pd(low, lowXY);
+			_mm_store_sd(low + 2, lowZ);
+			_mm_storeu_pd(high, highXY);
+			_mm_store_sd(high + 2, highZ);
+		}
+
+		/**
+		* Finds the bounds of a list of points, a whole point (x, y, z, h) per
+		* register.  Two sets of accumulators hide the latency of min and max.
+		*/
+		PEEK_TARGET_AVX2 void findBoundsAvx2(const Vertex3d *points, size_t count, double low[3], double high[3]) {
+			__m256d low0 = _mm256_set_pd(0, low[2], low[1], low[0]), low1 = low0;
+			__m256d high0 = _mm256_set_pd(0, high[2], high[1], high[0]), high1 = high0;
+			size_t i = 0;
+
+			for (; i + 2 <= count; i += 2) {
+				__m256d p0 = _mm256_loadu_pd(&points[i].x);
+				__m256d p1 = _mm256_loadu_pd(&points[i+1].x);
+				low0 = _mm256_min_pd(low0, p0);
+				high0 = _mm256_max_pd(high0, p0);
+				low1 = _mm256_min_pd(low1, p1);
+				high1 = _mm256_max_pd(high1, p1);
+			}
+
+			PEEK_ALIGN(32) double lows[4], highs[4];
+			_mm256_store_pd(lows, _mm256_min_pd(low0, low1));
+			_mm256_store_pd(highs, _mm256_max_pd(high0, high1));
+			for (int k = 0; k < 3; k++) {
+				low[k] = lows[k];
+				high[k] = highs[k];
+			}
+
+			findBoundsScalar(points, i, count, low, high);
+		}
+
+#endif
+
+	}
+
+	/*!
+	*/
+	BoundingBox::BoundingBox() {
+		double infinity = numeric_limits<double>::infinity();
+		this->low.set(infinity, infinity, infinity);
+		this->high.set(-infinity, -infinity, -infinity);
+	}
+
+	/*!
+	* @param low The low corner
+	* @param high The high corner
+	*/
+	BoundingBox::BoundingBox(const Point3d &low, const Point3d &high) {
+		this->low = low;
+		this->high = high;
+	}
+
+	/*!
+	* The reduction is branch-free and uses the best instruction set the CPU
+	* supports.
+	*
+	* @param points The points to bound
+	* @return The bounding box of the points, which is empty if there are none
+	*/
+	BoundingBox BoundingBox::fromPoints(const Vertex3d::list &points) {
+		BoundingBox box;
+		if (points.empty()) {
+			return box;
+		}
+
+		double low[3] = { box.low.x, box.low.y, box.low.z };
+		double high[3] = { box.high.x, box.high.y, box.high.z };
+
+#ifdef PEEK_X86_SIMD
+		// The vector paths load points as four packed doubles
+		if (sizeof(Vertex3d) == 4 * sizeof(double) && getSimdLevel() >= SIMD_AVX2) {
+			findBoundsAvx2(&points[0], points.size(), low, high);
+		}
+		else if (sizeof(Vertex3d) == 4 * sizeof(double) && getSimdLevel() >= SIMD_SSE2) {
+			findBoundsSse2(&points[0], points.size(), low, high);
+		}
+		else
+#endif
+		{
+			findBoundsScalar(&points[0], 0, points.size(), low, high);
+		}
+
+		box.low.set(low[0], low[1], low[2]);
+		box.high.set(high[0], high[1], high[2]);
+		return box;
+	}
+
+	/*!
+	*/
+	Vector3d BoundingBox::getDimensions() const {
+		if (isEmpty()) {
+			return Vector3d();
+		}
+		return Vector3d(this->high.x - this->low.x, this->high.y - this->low.y, this->high.z - this->low.z);
+	}
+
+	/*!
+	*/
+	Point3d BoundingBox::getCenter() const {
+		return Point3d((this->low.x + this->high.x) / 2, (this->low.y + this->high.y) / 2, (this->low.z + this->high.z) / 2);
+	}
+
+	/*!
+	* @param point The point to contain
+	*/
+	void BoundingBox::merge(const Point3d &point) {
+		this->low.set(std::min(this->low.x, point.x), std::min(this->low.y, point.y), std::min(this->low.z, point.z));
+		this->high.set(std::max(this->high.x, point.x), std::max(this->high.y, point.y), std::max(this->high.z, point.z));
+	}
+
+	/*!
+	* @param box The box to contain
+	*/
+	void BoundingBox::merge(const BoundingBox &box) {
+		if (box.isEmpty()) {
+			return;
+		}
+
+		merge(box.low);
+		merge(box.high);
+	}
+
+	/*!
+	* Rather than transforming all eight corners, each axis of the result is
+	* built from the smaller and larger products of the matrix with the low and
+	* high corners (Arvo's method).
+	*
+	* @param m The affine transformation
+	* @return The bounding box of the transformed box
+	*/
+	BoundingBox BoundingBox::transform(const Matrix<double> &m) const {
+		if (isEmpty()) {
+			return *this;
+		}
+
+		double low[3] = { this->low.x, this->low.y, this->low.z };
+		double high[3] = { this->high.x, this->high.y, this->high.z };
+		double newLow[3], newHigh[3];
+
+		for (unsigned int row = 0; row < 3; row++) {
+			newLow[row] = newHigh[row] = m.at(3, row);
+
+			for (unsigned int col = 0; col < 3; col++) {
+				double a = m.at(col, row) * low[col];
+				double b = m.at(col, row) * high[col];
+				newLow[row] += std::min(a, b);
+				newHigh[row] += std::max(a, b);
+			}
+		}
+
+		return BoundingBox(Point3d(newLow[0], newLow[1], newLow[2]), Point3d(newHigh[0], newHigh[1], newHigh[2]));
+	}
+
+}
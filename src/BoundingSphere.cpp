@@ -0,0 +1,65 @@
+/**
+* @file BoundingSphere.cpp
+*/
+#include "BoundingSphere.hpp"
+
+namespace peek {
+
+	/*!
+	*/
+	BoundingSphere::BoundingSphere() {
+		this->radius = -1;
+	}
+
+	/*!
+	* @param center The center of the sphere
+	* @param radius The radius of the sphere
+	*/
+	BoundingSphere::BoundingSphere(const Point3d &center, double radius) {
+		this->center = center;
+		this->radius = radius;
+	}
+
+	/*!
+	* @param box The box to enclose
+	* @return The sphere centered on the box that touches its corners, or an empty sphere if the box is empty
+	*/
+	BoundingSphere BoundingSphere::fromBox(const BoundingBox &box) {
+		if (box.isEmpty()) {
+			return BoundingSphere();
+		}
+		return BoundingSphere(box.getCenter(), box.getDimensions().magnitude() / 2);
+	}
+
+	/*!
+	* The result is the smallest sphere that contains both spheres.
+	*
+	* @param sphere The sphere to contain
+	*/
+	void BoundingSphere::merge(const BoundingSphere &sphere) {
+		if (sphere.isEmpty()) {
+			return;
+		}
+		if (isEmpty()) {
+			*this = sphere;
+			return;
+		}
+
+		Vector3d offset(sphere.center.x - this->center.x, sphere.center.y - this->center.y, sphere.center.z - this->center.z);
+		double distance = offset.magnitude();
+
+		if (distance + sphere.radius <= this->radius) {
+			return;
+		}
+		if (distance + this->radius <= sphere.radius) {
+			*this = sphere;
+			return;
+		}
+
+		double radius = (distance + this->radius + sphere.radius) / 2;
+		double shift = (radius - this->radius) / distance;
+		this->center.set(this->center.x + offset.x * shift, this->center.y + offset.y * shift, this->center.z + offset.z * shift);
+		this->radius = radius;
+	}
+
+}
@@ -0,0 +1,58 @@
+/**
+ * \file CameraRigging.cpp
+ * \author Douglas W. Paul
+ *
+ * Defines the behavior shared by all camera riggings.
+ */
+
+#include "Peek_base.hpp"
+#include "CameraRigging.hpp"
+
+namespace peek {
+
+	/**
+	 * \return The frustum of the camera's projection and the rigging's pose
+	 */
+	Frustum CameraRigging::getFrustum() {
+		return Frustum(getCamera()->getProjectionMatrix() * getViewMatrix());
+	}
+
+	/**
+	 * \param x The pixel's distance from the left of the viewport
+	 * \param y The pixel's distance from the top of the viewport
+	 * \return The ray from the near plane through the pixel, with a unit direction
+	 */
+	Ray CameraRigging::getPickingRay(int x, int y) {
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+
+		return getPickingRay(x, y, viewport);
+	}
+
+	/**
+	 * The pixel's centre is carried from the near plane to the far plane of the
+	 * camera's projection and back into world space, so the same code serves
+	 * perspective and orthographic cameras alike.
+	 *
+	 * \param x The pixel's distance from the left of the viewport
+	 * \param y The pixel's distance from the top of the viewport
+	 * \param viewport The viewport, as glGetIntegerv(GL_VIEWPORT) gives it
+	 * \return The ray from the near plane through the pixel, with a unit direction
+	 */
+	Ray CameraRigging::getPickingRay(int x, int y, const GLint viewport[4]) {
+		// Window coordinates run up from the bottom, as in Camera::setPickingMatrix()
+		double ndcX = 2.0 * (x + 0.5) / viewport[2] - 1.0;
+		double ndcY = 2.0 * (viewport[3] - y - 0.5) / viewport[3] - 1.0;
+
+		Matrix<double> unproject = getInverseViewMatrix() * getCamera()->getInverseProjectionMatrix();
+		Point3d nearPoint = unproject * Point3d(ndcX, ndcY, -1.0);
+		Point3d farPoint = unproject * Point3d(ndcX, ndcY, 1.0);
+		nearPoint.doPerspectiveDivision();
+		farPoint.doPerspectiveDivision();
+
+		Vector3d direction = farPoint - nearPoint;
+		direction.normalize();
+		return Ray(nearPoint, direction);
+	}
+
+}
@@ -0,0 +1,430 @@
+/**
+* @file CompiledSceneGraph.cpp
+*/
+
+#include "CompiledSceneGraph.hpp"
+#include "Profiler.hpp"
+#include <boost/bind.hpp>
+#include <algorithm>
+
+namespace peek {
+
+	namespace {
+
+		/** Where the corners of empty boxes are put, so that every plane finds them outside */
+		const double farAway = 1e300;
+
+		/** Replaces a run of a vector with the contents of another */
+		template <class T>
+		void splice(std::vector<T> &into, size_t at, size_t count, const std::vector<T> &from) {
+			if (from.size() >= count) {
+				into.insert(into.begin() + at + count, from.begin() + count, from.end());
+			}
+			else {
+				into.erase(into.begin() + at + from.size(), into.begin() + at + count);
+			}
+			std::copy(from.begin(), from.begin() + std::min(count, from.size()), into.begin() + at);
+		}
+
+	}
+
+	CompiledSceneGraph::CompiledSceneGraph() {
+	}
+
+	/*!
+	* @param root The root of the graph; it is kept alive as long as the compiled graph is
+	*/
+	CompiledSceneGraph::CompiledSceneGraph(SceneGraphNodeBase::handle root) {
+		this->root = root;
+		flatten(root.get(), -1, 0, *this);
+		this->masks.resize(this->nodes.size());
+		this->outside.resize(this->nodes.size());
+
+		for (size_t i = 0; i < this->nodes.size(); i++) {
+			refresh(i);
+		}
+	}
+
+	/*!
+	* Any entry whose node's bounds have been recalculated since it was last
+	* refreshed is refreshed again, and its children looked at; the subtree
+	* under an entry whose node's bounds have not is left alone, since any
+	* change beneath a node recalculates its bounds too.
+	*
+	* @return The number of entries refreshed or flattened again
+	*/
+	size_t CompiledSceneGraph::sync() {
+		PEEK_PROFILE_SCOPE("CompiledSceneGraph::sync");
+		size_t refreshed = 0;
+
+		for (size_t i = 0; i < this->nodes.size(); ) {
+			const SceneGraphNodeBase *node = this->nodes[i];
+
+			if (node->getStructureVersion() != this->structureVersions[i]) {
+				refreshed += rebuild(i);
+				i += this->subtreeSizes[i];
+				continue;
+			}
+
+			node->getBoundingBox();
+			if (node->getBoundsVersion() == this->boundsVersions[i]) {
+				i += this->subtreeSizes[i];
+				continue;
+			}
+
+			refresh(i);
+			refreshed++;
+			i++;
+		}
+
+		return refreshed;
+	}
+
+	/*!
+	* @param frustum The frustum
+	* @param visibleLeaves Where to add the indices of the leaves inside the frustum
+	* @param stats The counters to add to
+	*/
+	void CompiledSceneGraph::cull(const Frustum &frustum, std::vector<boost::uint32_t> &visibleLeaves, CullingStats &stats) {
+		PEEK_PROFILE_SCOPE("CompiledSceneGraph::cull");
+		cull(frustum, 0, this->nodes.size(), visibleLeaves, stats);
+	}
+
+	/*!
+	* An entry's parent is either in the run, and already culled, or an
+	* ancestor of the run's first entry, which is classified beforehand.  A
+	* subtree that is culled is counted by the run that holds its root.
+	*
+	* @param frustum The frustum
+	* @param first The index of the first entry of the run
+	* @param end The index after the last entry of the run
+	* @param visibleLeaves Where to add the indices of the leaves inside the frustum
+	* @param stats The counters to add to
+	*/
+	void CompiledSceneGraph::cull(const Frustum &frustum, size_t first, size_t end, std::vector<boost::uint32_t> &visibleLeaves, CullingStats &stats) {
+		std::vector<std::pair<size_t, unsigned int> > ancestors;
+		classifyAncestors(frustum, first, ancestors);
+
+		for (size_t i = first; i < end; ) {
+			boost::int32_t parent = this->parents[i];
+			unsigned int planeMask = Frustum::ALL_PLANES;
+
+			if (parent >= 0 && (size_t) parent >= first) {
+				planeMask = this->masks[parent];
+			}
+			else if (parent >= 0) {
+				for (size_t a = 0; a < ancestors.size(); a++) {
+					if (ancestors[a].first == (size_t) parent) {
+						planeMask = ancestors[a].second;
+						break;
+					}
+				}
+				if (planeMask == outsideMask) {
+					i += this->subtreeSizes[i];
+					continue;
+				}
+			}
+
+			stats.nodesVisited++;
+
+			if (planeMask != 0 && !classify(frustum, i, planeMask)) {
+				stats.nodesCulled++;
+				stats.leavesCulled += this->leafCounts[i];
+				i += this->subtreeSizes[i];
+				continue;
+			}
+
+			if (this->leaves[i]) {
+				visibleLeaves.push_back((boost::uint32_t) i);
+				stats.leavesDrawn++;
+				i++;
+				continue;
+			}
+
+			this->masks[i] = (boost::uint8_t) planeMask;
+
+			if (!this->leafParents[i] || planeMask == 0) {
+				i++;
+				continue;
+			}
+
+			// Test every child against every plane left, without branching on the results
+			size_t runFirst = i + 1, runEnd = std::min(end, i + this->subtreeSizes[i]);
+			std::fill(this->outside.begin() + runFirst, this->outside.begin() + runEnd, 0);
+			boost::uint8_t *out = &this->outside[0];
+
+			for (int p = 0; p < Frustum::planeCount; p++) {
+				if (!(planeMask & (1u << p))) {
+					continue;
+				}
+
+				const double *plane = frustum.getPlane(p);
+				const double a = plane[0], b = plane[1], c = plane[2], d = plane[3];
+				const double *x = (a >= 0 ? &this->highX[0] : &this->lowX[0]);
+				const double *y = (b >= 0 ? &this->highY[0] : &this->lowY[0]);
+				const double *z = (c >= 0 ? &this->highZ[0] : &this->lowZ[0]);
+
+				for (size_t j = runFirst; j < runEnd; j++) {
+					out[j] |= (boost::uint8_t) (a * x[j] + b * y[j] + c * z[j] + d < 0);
+				}
+			}
+
+			for (size_t j = runFirst; j < runEnd; j++) {
+				if (out[j]) {
+					stats.nodesCulled++;
+					stats.leavesCulled++;
+				}
+				else {
+					visibleLeaves.push_back((boost::uint32_t) j);
+					stats.leavesDrawn++;
+				}
+			}
+			stats.nodesVisited += (unsigned int) (runEnd - runFirst);
+
+			i = runEnd;
+		}
+	}
+
+	/*!
+	* @param queue The queue
+	* @param visibleLeaves The indices of the leaves to queue
+	*/
+	void CompiledSceneGraph::enqueue(RenderQueue &queue, const std::vector<boost::uint32_t> &visibleLeaves) const {
+		for (std::vector<boost::uint32_t>::const_iterator i = visibleLeaves.begin(); i != visibleLeaves.end(); ++i) {
+			this->leaves[*i]->getModel()->enqueue(queue, this->worldMatrices[*i], getCenter(*i));
+		}
+	}
+
+	/*!
+	* @param queue The queue
+	* @param frustum The frustum
+	* @param stats The counters to add to
+	*/
+	void CompiledSceneGraph::enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats) {
+		std::vector<boost::uint32_t> visibleLeaves;
+		cull(frustum, visibleLeaves, stats);
+		enqueue(queue, visibleLeaves);
+	}
+
+	/*!
+	* The calling thread culls and queues runs too, while it waits.  The runs'
+	* queues are appended in order, so the queue holds the same meshes in the
+	* same order as the unthreaded enqueue() would leave it with.
+	*
+	* @param queue The queue, already begun
+	* @param frustum The frustum
+	* @param stats The counters to add to
+	* @param jobs The job system
+	*/
+	void CompiledSceneGraph::enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, JobSystem &jobs) {
+		PEEK_PROFILE_SCOPE("CompiledSceneGraph::enqueue");
+		size_t count = std::max((size_t) 1, std::min(jobs.getThreadCount() * runsPerThread, this->nodes.size() / minRunSize));
+		this->runs.resize(count);
+
+		JobSystem::Group group;
+		for (size_t r = 0; r < count; r++) {
+			Run &run = this->runs[r];
+			run.first = this->nodes.size() * r / count;
+			run.end = this->nodes.size() * (r + 1) / count;
+			if (!run.queue) {
+				run.queue.reset(new RenderQueue());
+			}
+			run.queue->begin(queue.getView());
+
+			jobs.submit(group, boost::bind(&CompiledSceneGraph::enqueueRun, this, &frustum, &run));
+		}
+		jobs.wait(group);
+
+		for (size_t r = 0; r < count; r++) {
+			stats += this->runs[r].stats;
+			queue.append(*this->runs[r].queue);
+		}
+	}
+
+	/*!
+	* @param frustum The frustum
+	* @param run The run, its queue begun
+	*/
+	void CompiledSceneGraph::enqueueRun(const Frustum *frustum, Run *run) {
+		PEEK_PROFILE_SCOPE("CompiledSceneGraph::enqueueRun");
+		run->visibleLeaves.clear();
+		run->stats.reset();
+		cull(*frustum, run->first, run->end, run->visibleLeaves, run->stats);
+		enqueue(*run->queue, run->visibleLeaves);
+	}
+
+	/*!
+	* @param node The root of the subtree
+	* @param parent The index of the node's parent
+	* @param base The index the other graph's first entry will have
+	* @param into The graph to add the entries to; only the structure is filled in, not the bounds
+	*/
+	void CompiledSceneGraph::flatten(const SceneGraphNodeBase *node, boost::int32_t parent, size_t base, CompiledSceneGraph &into) {
+		size_t local = into.nodes.size();
+		boost::int32_t index = (boost::int32_t) (base + local);
+
+		into.nodes.push_back(node);
+		into.leaves.push_back(dynamic_cast<const SceneGraphLeaf *>(node));
+		into.parents.push_back(parent);
+		into.subtreeSizes.push_back(1);
+		into.leafParents.push_back(0);
+		into.leafCounts.push_back(0);
+		into.lowX.push_back(0.0);
+		into.lowY.push_back(0.0);
+		into.lowZ.push_back(0.0);
+		into.highX.push_back(0.0);
+		into.highY.push_back(0.0);
+		into.highZ.push_back(0.0);
+		into.worldMatrices.push_back(0);
+		into.boundsVersions.push_back(0);
+		into.structureVersions.push_back(node->getStructureVersion());
+
+		const SceneGraphNode *inner = dynamic_cast<const SceneGraphNode *>(node);
+		if (!inner) {
+			return;
+		}
+
+		bool allLeaves = !inner->getChildren().empty();
+		for (SceneGraphNodeBase::list::const_iterator i = inner->getChildren().begin(); i < inner->getChildren().end(); ++i) {
+			allLeaves = allLeaves && dynamic_cast<const SceneGraphLeaf *>(i->get()) != 0;
+			flatten(i->get(), index, base, into);
+		}
+
+		into.leafParents[local] = (allLeaves ? 1 : 0);
+		into.subtreeSizes[local] = (boost::uint32_t) (into.nodes.size() - local);
+	}
+
+	/*!
+	* The entries after the subtree move along, and the parent indices that
+	* pointed past it and the subtree sizes of its ancestors are corrected.
+	*
+	* @param i The index of the subtree's root
+	* @return The number of entries in the subtree
+	*/
+	size_t CompiledSceneGraph::rebuild(size_t i) {
+		size_t oldSize = this->subtreeSizes[i];
+
+		CompiledSceneGraph subtree;
+		flatten(this->nodes[i], this->parents[i], i, subtree);
+		size_t newSize = subtree.nodes.size();
+
+		splice(this->nodes, i, oldSize, subtree.nodes);
+		splice(this->leaves, i, oldSize, subtree.leaves);
+		splice(this->parents, i, oldSize, subtree.parents);
+		splice(this->subtreeSizes, i, oldSize, subtree.subtreeSizes);
+		splice(this->leafParents, i, oldSize, subtree.leafParents);
+		splice(this->leafCounts, i, oldSize, subtree.leafCounts);
+		splice(this->lowX, i, oldSize, subtree.lowX);
+		splice(this->lowY, i, oldSize, subtree.lowY);
+		splice(this->lowZ, i, oldSize, subtree.lowZ);
+		splice(this->highX, i, oldSize, subtree.highX);
+		splice(this->highY, i, oldSize, subtree.highY);
+		splice(this->highZ, i, oldSize, subtree.highZ);
+		splice(this->worldMatrices, i, oldSize, subtree.worldMatrices);
+		splice(this->boundsVersions, i, oldSize, subtree.boundsVersions);
+		splice(this->structureVersions, i, oldSize, subtree.structureVersions);
+
+		boost::int32_t delta = (boost::int32_t) newSize - (boost::int32_t) oldSize;
+		if (delta != 0) {
+			for (size_t j = i + newSize; j < this->nodes.size(); j++) {
+				if (this->parents[j] >= (boost::int32_t) (i + oldSize)) {
+					this->parents[j] += delta;
+				}
+			}
+			for (boost::int32_t a = this->parents[i]; a >= 0; a = this->parents[a]) {
+				this->subtreeSizes[a] += delta;
+			}
+		}
+
+		this->masks.resize(this->nodes.size());
+		this->outside.resize(this->nodes.size());
+
+		for (size_t j = i; j < i + newSize; j++) {
+			refresh(j);
+		}
+
+		return newSize;
+	}
+
+	/*!
+	* @param i The index of the entry
+	*/
+	void CompiledSceneGraph::refresh(size_t i) {
+		const SceneGraphNodeBase *node = this->nodes[i];
+		const BoundingBox &box = node->getBoundingBox();
+
+		if (box.isEmpty()) {
+			this->lowX[i] = this->lowY[i] = this->lowZ[i] = farAway;
+			this->highX[i] = this->highY[i] = this->highZ[i] = -farAway;
+		}
+		else {
+			this->lowX[i] = box.getLow().x;
+			this->lowY[i] = box.getLow().y;
+			this->lowZ[i] = box.getLow().z;
+			this->highX[i] = box.getHigh().x;
+			this->highY[i] = box.getHigh().y;
+			this->highZ[i] = box.getHigh().z;
+		}
+
+		this->leafCounts[i] = node->getLeafCount();
+		this->worldMatrices[i] = (this->leaves[i] ? &this->leaves[i]->getModelWorldMatrix() : &node->getWorldTransformMatrix());
+		this->boundsVersions[i] = node->getBoundsVersion();
+	}
+
+	/*!
+	* The box is tried against each plane's furthest corner along the plane
+	* normal, to see if it is outside, and the corner furthest against it, to
+	* see if it is wholly inside, as Frustum::classify() does.
+	*
+	* @param frustum The frustum
+	* @param i The index of the entry
+	* @param planeMask The planes to test; on return, only the planes the box straddles remain
+	* @return Whether the box is at least partly inside
+	*/
+	bool CompiledSceneGraph::classify(const Frustum &frustum, size_t i, unsigned int &planeMask) const {
+		for (int p = 0; p < Frustum::planeCount; p++) {
+			unsigned int bit = 1u << p;
+			if (!(planeMask & bit)) {
+				continue;
+			}
+
+			const double *plane = frustum.getPlane(p);
+			double outer = plane[0] * (plane[0] >= 0 ? this->highX[i] : this->lowX[i])
+				+ plane[1] * (plane[1] >= 0 ? this->highY[i] : this->lowY[i])
+				+ plane[2] * (plane[2] >= 0 ? this->highZ[i] : this->lowZ[i]) + plane[3];
+			if (outer < 0) {
+				return false;
+			}
+
+			double inner = plane[0] * (plane[0] >= 0 ? this->lowX[i] : this->highX[i])
+				+ plane[1] * (plane[1] >= 0 ? this->lowY[i] : this->highY[i])
+				+ plane[2] * (plane[2] >= 0 ? this->lowZ[i] : this->highZ[i]) + plane[3];
+			if (inner >= 0) {
+				planeMask &= ~bit;
+			}
+		}
+
+		return true;
+	}
+
+	/*!
+	* @param frustum The frustum
+	* @param first The index of the entry
+	* @param ancestors Where to put each ancestor's index and the planes it straddles, root first
+	*/
+	void CompiledSceneGraph::classifyAncestors(const Frustum &frustum, size_t first, std::vector<std::pair<size_t, unsigned int> > &ancestors) const {
+		for (boost::int32_t a = (first < this->parents.size() ? this->parents[first] : -1); a >= 0; a = this->parents[a]) {
+			ancestors.push_back(std::make_pair((size_t) a, 0u));
+		}
+		std::reverse(ancestors.begin(), ancestors.end());
+
+		unsigned int planeMask = Frustum::ALL_PLANES;
+		for (size_t a = 0; a < ancestors.size(); a++) {
+			if (planeMask != outsideMask && planeMask != 0 && !classify(frustum, ancestors[a].first, planeMask)) {
+				planeMask = outsideMask;
+			}
+			ancestors[a].second = planeMask;
+		}
+	}
+
+}
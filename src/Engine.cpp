@@ -3,10 +3,16 @@
 */
 
 #include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
 #include "Engine.hpp"
+#include "GlExtensions.hpp"
+#include "Profiler.hpp"
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 using boost::shared_ptr;
+using boost::chrono::steady_clock;
 
 namespace peek {
 
@@ -14,6 +20,7 @@ namespace peek {
 		this->screenWidth = 640;
 		this->screenHeight = 480;
 		this->fullscreen = false;
+		this->renderContext.reset(new WindowRenderContext(this->screenWidth, this->screenHeight, false, false));
 		init();
 	}
 
@@ -21,23 +28,43 @@ namespace peek {
 		this->screenWidth = screenWidth;
 		this->screenHeight = screenHeight;
 		this->fullscreen = fullscreen;
+		this->renderContext.reset(new WindowRenderContext(screenWidth, screenHeight, fullscreen, false));
 		init();
 	}
 
-	void Engine::init() {
-		int error = SDL_Init(SDL_INIT_VIDEO);
-
-		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
+	Engine::Engine(unsigned int screenWidth, unsigned int screenHeight, bool fullscreen, bool vsync) {
+		this->screenWidth = screenWidth;
+		this->screenHeight = screenHeight;
+		this->fullscreen = fullscreen;
+		this->renderContext.reset(new WindowRenderContext(screenWidth, screenHeight, fullscreen, vsync));
+		init();
+	}
 
-		/** @todo The next four lines may not be necessary... */
-		SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	Engine::Engine(RenderContext::handle renderContext) {
+		this->screenWidth = renderContext->getWidth();
+		this->screenHeight = renderContext->getHeight();
+		this->fullscreen = false;
+		this->renderContext = renderContext;
+		init();
+	}
 
-		Uint32 fullscreenFlag = (this->fullscreen ? SDL_FULLSCREEN : 0);
-		SDL_SetVideoMode(this->screenWidth, this->screenHeight, 0, SDL_OPENGL | fullscreenFlag);
+	void Engine::init() {
+		this->invalid = false;
+		this->stopped = false;
+		this->maxFrameRate = 0.0;
+		this->waitingWhenIdle = true;
+		this->eventPollInterval = boost::chrono::milliseconds(10);
+		this->frameCount = 0;
+		this->refreshPeriod = steady_clock::duration::zero();
+		this->framePaced = false;
+		this->updateThreaded = false;
+		this->updateThread = 0;
+		this->updatesStopping = false;
+		this->invalidPosted = false;
+		this->eventsPosted = false;
+		this->recordStartFrame = 0;
+
+		initGlExtensions(*this->renderContext);
 
 		glViewport(0, 0, this->screenWidth, this->screenHeight);
 		glEnable(GL_DEPTH_TEST);
@@ -51,56 +78,465 @@ namespace peek {
 		// Only for perspective camera
 		glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, GL_TRUE);
 
-		SDL_EnableKeyRepeat(1, SDL_DEFAULT_REPEAT_INTERVAL);
-
 		invalidate();
 	}
 
 	void Engine::run() {
-		SDL_Event evt;
-		bool done = false;
-	    
-		while(!done) {
+		PEEK_PROFILE_THREAD("engine");
+		startUpdates();
+
+		while(true) {
+			{
+				boost::mutex::scoped_lock lock(this->wakeMutex);
+				if (this->stopped) {
+					// Leave the engine ready to run again
+					this->stopped = false;
+					break;
+				}
+			}
 
 			// Display...
-			if (this->invalid) {
+			if (beginFrame()) {
 				draw();
+				endFrame();
+			}
+
+			// Handle the events that have arrived...
+			pollEvents();
+
+			// ...and sleep until there is something more to do
+			if (this->waitingWhenIdle) {
+				waitForWork();
+			}
+		}
+
+		stopUpdates();
+	}
+
+	/*!
+	* Every frame is drawn, whether or not the rendering is invalid, and
+	* without regard to the frame rate cap; events are still handled between
+	* frames.
+	*
+	* @param frames The number of frames to draw
+	*/
+	void Engine::run(unsigned long frames) {
+		PEEK_PROFILE_THREAD("engine");
+		startUpdates();
+
+		for (unsigned long i = 0; i < frames; i++) {
+			{
+				boost::mutex::scoped_lock lock(this->wakeMutex);
+				if (this->stopped) {
+					this->stopped = false;
+					break;
+				}
+
 				this->invalid = false;
-				SDL_GL_SwapBuffers(); // swap buffers for smooth animation
-			}
-
-			// Poll for events...
-			while(SDL_PollEvent(&evt)) {
-				switch(evt.type) {
-					case SDL_USEREVENT:
-						break;
-		                
-					//case SDL_KEYUP:
-					case SDL_KEYDOWN:
-						handleKeyEvent(evt.key);
-						break;
-
-					case SDL_MOUSEBUTTONDOWN:
-					case SDL_MOUSEBUTTONUP:
-						handleMouseButtonEvent(evt.button);
-						break;
-
-					case SDL_MOUSEMOTION:
-						handleMouseMotionEvent(evt.motion);
-						break;
-
-					case SDL_QUIT:
-						done = true;
-						break;
-		                
-					default:
-						break;
+				this->invalidPosted = false;
+				this->framePaced = false;
+			}
+
+			draw();
+			endFrame();
+
+			pollEvents();
+		}
+
+		stopUpdates();
+	}
+
+	/*!
+	* Each recorded event is handled before the frame it was taken before,
+	* on the calling thread even with an update thread, so the handlers see
+	* the same events between the same frames as when they were recorded.
+	* Every frame is drawn, as run(frames) draws them, up to the one after
+	* the last event.  The window's own events are taken, but only quitting
+	* is acted on.
+	*
+	* @param log The log
+	* @param recordedPace Whether each event waits for its recorded time, rather than being replayed as soon as its frame comes
+	* @param frameTimes Receives how long each frame took, from handling its events to swapping its buffers, less any waiting
+	*/
+	void Engine::replay(const InputLog &log, bool recordedPace, std::vector<double> &frameTimes) {
+		PEEK_PROFILE_THREAD("engine");
+		publishState();
+
+		steady_clock::time_point start = steady_clock::now();
+		size_t next = 0;
+		for (unsigned long frame = 0; frame <= log.getLastFrame(); frame++) {
+			{
+				boost::mutex::scoped_lock lock(this->wakeMutex);
+				if (this->stopped) {
+					this->stopped = false;
+					break;
 				}
+
+				this->invalid = false;
+				this->invalidPosted = false;
+				this->framePaced = false;
+			}
+
+			steady_clock::time_point frameStart = steady_clock::now();
+			steady_clock::duration waited = steady_clock::duration::zero();
+			bool handled = false;
+			for (; next < log.size() && log.get(next).frame <= frame; next++) {
+				const InputLog::Entry &entry = log.get(next);
+				if (recordedPace) {
+					steady_clock::time_point waitStart = steady_clock::now();
+					boost::this_thread::sleep_until(start + boost::chrono::microseconds(entry.time));
+					waited += steady_clock::now() - waitStart;
+				}
+
+				handleEvent(entry.event, entry.x, entry.y);
+				handled = true;
 			}
-	            
+
+			if (handled) {
+				publishState();
+			}
+
+			draw();
+			endFrame();
+			frameTimes.push_back(boost::chrono::duration<double, boost::milli>(steady_clock::now() - frameStart - waited).count());
+
+			SDL_Event evt;
+			while (this->renderContext->pollEvent(evt)) {
+				if (evt.type == SDL_QUIT) {
+					stop();
+				}
+			}
+		}
+	}
+
+	/*!
+	* The workers are started by the first call, so an engine whose drawable
+	* never splits its work runs no idle threads.
+	*/
+	JobSystem &Engine::getJobSystem() {
+		boost::mutex::scoped_lock lock(this->jobSystemMutex);
+		if (!this->jobSystem) {
+			this->jobSystem.reset(new JobSystem());
+		}
+		return *this->jobSystem;
+	}
+
+	void Engine::stop() {
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+		this->stopped = true;
+		this->wakeCondition.notify_all();
+	}
+
+	/*!
+	* With an update thread, quitting and exposure are still handled here,
+	* since they concern the window rather than what is drawn in it.
+	* Without one, the state is published once the events are handled.
+	*
+	* The pointer is read here, as each key press is taken, and goes with
+	* the event to the log and to the update thread, so a key press is
+	* handled with the same pointer live, threaded and replayed.
+	*/
+	void Engine::pollEvents() {
+		PEEK_PROFILE_SCOPE("Engine::pollEvents");
+		TakenEvent taken;
+		SDL_Event &evt = taken.event;
+		std::vector<TakenEvent> handOver;
+		bool handled = false;
+		bool posted = false;
+
+		while(this->renderContext->pollEvent(evt)) {
+			taken.x = taken.y = 0;
+			if (evt.type == SDL_KEYDOWN) {
+				SDL_GetMouseState(&taken.x, &taken.y);
+			}
+
+			recordEvent(evt, taken.x, taken.y);
+			if (this->updateThread && evt.type != SDL_QUIT && evt.type != SDL_VIDEOEXPOSE) {
+				handOver.push_back(taken);
+			}
+			else {
+				handleEvent(evt, taken.x, taken.y);
+				handled = true;
+			}
+		}
+
+		// Cleared first, so an event posted from here on either is taken below or wakes the engine again
+		int customEvent;
+		this->eventsPosted = false;
+		while (this->postedEvents.pop(customEvent)) {
+			memset(&evt, 0, sizeof(evt));
+			evt.type = SDL_USEREVENT;
+			evt.user.code = customEvent;
+			taken.x = taken.y = 0;
+			recordEvent(evt, 0, 0);
+
+			if (this->updateThread) {
+				handOver.push_back(taken);
+			}
+			else {
+				handleEvent(evt, 0, 0);
+				handled = posted = true;
+			}
+		}
+
+		if (!handOver.empty()) {
+			boost::mutex::scoped_lock lock(this->updateMutex);
+			this->updateEvents.insert(this->updateEvents.end(), handOver.begin(), handOver.end());
+			this->updateCondition.notify_one();
+		}
+
+		if (handled && !this->updateThread) {
+			publishState();
+		}
+
+		// The update thread redraws after each batch itself
+		if (posted) {
+			invalidate();
+		}
+	}
+
+	void Engine::startUpdates() {
+		publishState();
+
+		if (this->updateThreaded) {
+			this->updatesStopping = false;
+			this->updateThread = new boost::thread(boost::bind(&Engine::runUpdates, this));
 		}
 	}
 
+	void Engine::stopUpdates() {
+		if (!this->updateThread) {
+			return;
+		}
+
+		{
+			boost::mutex::scoped_lock lock(this->updateMutex);
+			this->updatesStopping = true;
+			this->updateCondition.notify_one();
+		}
+
+		this->updateThread->join();
+		delete this->updateThread;
+		this->updateThread = 0;
+	}
+
+	/*!
+	* The events that arrive while a batch is handled are handled together
+	* in the next, with one snapshot published for the lot.  The rendering
+	* is invalidated only after the snapshot is published, since a frame
+	* drawn between a handler's invalidate() and the publishing would show
+	* the old state, and none would follow it.
+	*/
+	void Engine::runUpdates() {
+		PEEK_PROFILE_THREAD("update");
+		std::deque<TakenEvent> events;
+
+		while (true) {
+			{
+				boost::mutex::scoped_lock lock(this->updateMutex);
+				while (this->updateEvents.empty() && !this->updatesStopping) {
+					this->updateCondition.wait(lock);
+				}
+				if (this->updateEvents.empty()) {
+					return;
+				}
+				events.swap(this->updateEvents);
+			}
+
+			{
+				PEEK_PROFILE_SCOPE("Engine::update");
+				for (std::deque<TakenEvent>::const_iterator i = events.begin(); i != events.end(); ++i) {
+					handleEvent(i->event, i->x, i->y);
+				}
+				events.clear();
+
+				publishState();
+			}
+			invalidate();
+		}
+	}
+
+	void Engine::publishState() {
+		if (this->statePublisher) {
+			(*this->statePublisher)->publishState();
+		}
+	}
+
+	/*!
+	* Called as events are taken, on the thread that calls run().
+	*
+	* @param evt The event
+	* @param x The pointer's x coordinate when the event was taken
+	* @param y The pointer's y coordinate when the event was taken
+	*/
+	void Engine::recordEvent(const SDL_Event &evt, int x, int y) {
+		if (!this->inputLog || !InputLog::isRecorded(evt)) {
+			return;
+		}
+
+		boost::uint64_t time = boost::chrono::duration_cast<boost::chrono::microseconds>(steady_clock::now() - this->recordStartTime).count();
+		(*this->inputLog)->add(evt, x, y, time, this->frameCount - this->recordStartFrame);
+	}
+
+	/*!
+	* @param evt The event
+	* @param x The pointer's x coordinate when the event was taken
+	* @param y The pointer's y coordinate when the event was taken
+	*/
+	void Engine::handleEvent(const SDL_Event &evt, int x, int y) {
+		switch(evt.type) {
+			case SDL_USEREVENT:
+				if (this->customEventHandler) {
+					(*this->customEventHandler)->handleCustomEvent(evt.user.code);
+				}
+				break;
+			    
+			//case SDL_KEYUP:
+			case SDL_KEYDOWN:
+				handleKeyEvent(evt.key, x, y);
+				break;
+
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				handleMouseButtonEvent(evt.button);
+				break;
+
+			case SDL_MOUSEMOTION:
+				handleMouseMotionEvent(evt.motion);
+				break;
+
+			case SDL_VIDEOEXPOSE:
+				// Nothing redraws an idle window otherwise
+				invalidate();
+				break;
+
+			case SDL_QUIT:
+				stop();
+				break;
+			    
+			default:
+				break;
+		}
+	}
+
+	bool Engine::beginFrame() {
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+
+		steady_clock::time_point nextFrameTime = getNextFrameTime();
+
+		if (!this->invalid || steady_clock::now() < nextFrameTime) {
+			return false;
+		}
+
+		// Invalidations from here on will need another frame
+		this->invalid = false;
+		this->invalidPosted = false;
+		this->framePaced = (this->frameCount > 0 && this->invalidTime < nextFrameTime);
+		return true;
+	}
+
+	void Engine::endFrame() {
+		PEEK_PROFILE_SCOPE("Engine::endFrame");
+
+		// The frame has to be read before the swap leaves the back buffer undefined
+		if (this->frameCapture) {
+			(*this->frameCapture)->capture(this->screenWidth, this->screenHeight);
+		}
+
+		this->renderContext->swapBuffers(); // swap buffers for smooth animation
+
+		steady_clock::time_point now = steady_clock::now();
+
+		// With vsync, swaps are at least a refresh period apart, so the
+		// shortest gap between them measures it; gaps that include idle
+		// time say nothing about the display
+		if (this->renderContext->isVsync() && this->framePaced) {
+			steady_clock::duration period = now - this->lastSwapTime;
+
+			if (this->refreshPeriod == steady_clock::duration::zero() || period < this->refreshPeriod) {
+				this->refreshPeriod = period;
+			}
+		}
+
+		this->lastSwapTime = now;
+		this->frameCount++;
+
+		PEEK_PROFILE_FRAME();
+	}
+
+	/*!
+	* With vsync, the frame interval is rounded to a whole number of refresh
+	* periods, and the frame is started half a period early: the swap waits
+	* for the refresh anyway, and starting late would miss it by a whole
+	* period.
+	*
+	* Must be called with the wake mutex held.
+	*/
+	steady_clock::time_point Engine::getNextFrameTime() const {
+		if (this->maxFrameRate <= 0.0 || this->frameCount == 0) {
+			return this->lastSwapTime;
+		}
+
+		steady_clock::duration interval = boost::chrono::duration_cast<steady_clock::duration>(
+			boost::chrono::duration<double>(1.0 / this->maxFrameRate));
+
+		if (this->renderContext->isVsync() && this->refreshPeriod > steady_clock::duration::zero()) {
+			steady_clock::rep periods = (interval + this->refreshPeriod / 2) / this->refreshPeriod;
+			if (periods < 1) {
+				periods = 1;
+			}
+
+			return this->lastSwapTime + this->refreshPeriod * periods - this->refreshPeriod / 2;
+		}
+
+		return this->lastSwapTime + interval;
+	}
+
+	/*!
+	* SDL 1.2 can only poll for window system events, so they are checked for
+	* every eventPollInterval; invalidate() and stop() wake the engine at
+	* once.
+	*/
+	void Engine::waitForWork() {
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+
+		while (!this->stopped) {
+			steady_clock::time_point now = steady_clock::now();
+			steady_clock::duration timeout = this->eventPollInterval;
+
+			if (this->invalid) {
+				steady_clock::time_point nextFrameTime = getNextFrameTime();
+
+				if (now >= nextFrameTime) {
+					return;
+				}
+
+				if (nextFrameTime - now < timeout) {
+					timeout = nextFrameTime - now;
+				}
+			}
+
+			if (this->renderContext->hasPendingEvents() || this->eventsPosted) {
+				return;
+			}
+
+			this->wakeCondition.wait_for(lock, timeout);
+		}
+	}
+
+	void Engine::setMaxFrameRate(double maxFrameRate) {
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+		this->maxFrameRate = maxFrameRate;
+	}
+
+	void Engine::setWaitingWhenIdle(bool waitingWhenIdle) {
+		this->waitingWhenIdle = waitingWhenIdle;
+	}
+
+	void Engine::setEventPollInterval(unsigned int eventPollInterval) {
+		this->eventPollInterval = boost::chrono::milliseconds(eventPollInterval);
+	}
+
 	void Engine::setDrawable(Drawable *drawable) {
 		this->drawable = drawable;
 	}
@@ -125,8 +561,76 @@ namespace peek {
 		this->resizeEventHandler = resizeEventHandler;
 	}
 
+	void Engine::setStatePublisher(StatePublisher *statePublisher) {
+		if (statePublisher) {
+			this->statePublisher = statePublisher;
+		}
+		else {
+			this->statePublisher.reset();
+		}
+	}
+
+	void Engine::setUpdateThreaded(bool updateThreaded) {
+		this->updateThreaded = updateThreaded;
+	}
+
+	void Engine::setFrameCapture(FrameCapture *frameCapture) {
+		if (frameCapture) {
+			this->frameCapture = frameCapture;
+		}
+		else {
+			this->frameCapture.reset();
+		}
+	}
+
+	/*!
+	* @param inputLog The log to add to, or NULL
+	*/
+	void Engine::setInputLog(InputLog *inputLog) {
+		if (inputLog) {
+			this->inputLog = inputLog;
+			this->recordStartTime = steady_clock::now();
+			this->recordStartFrame = this->frameCount;
+		}
+		else {
+			this->inputLog.reset();
+		}
+	}
+
+	/*!
+	* The rendering stays invalid until the next frame begins, so only the
+	* first call after a frame begins needs to take the lock and wake run();
+	* the rest are coalesced into the frame it will draw.
+	*/
 	void Engine::invalidate() {
-		this->invalid = true;
+		if (this->invalidPosted.exchange(true)) {
+			return;
+		}
+
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+
+		if (!this->invalid) {
+			this->invalid = true;
+			this->invalidTime = steady_clock::now();
+		}
+
+		this->wakeCondition.notify_all();
+	}
+
+	/*!
+	* @param customEvent The custom event
+	*/
+	void Engine::postEvent(int customEvent) {
+		this->postedEvents.push(customEvent);
+
+		if (!this->eventsPosted.exchange(true)) {
+			wake();
+		}
+	}
+
+	void Engine::wake() {
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+		this->wakeCondition.notify_all();
 	}
 
 	void Engine::bindKey(SDLKey key, int action) {
@@ -144,20 +648,24 @@ namespace peek {
 	}
 
 	void Engine::draw() {
+		PEEK_PROFILE_SCOPE("Engine::draw");
 		if (this->drawable) {
 			(*this->drawable)->draw();
 		}
 	}
 
-	void Engine::handleKeyEvent(const SDL_KeyboardEvent &keyEvent) {
+	/*!
+	* @param keyEvent The event
+	* @param x The pointer's x coordinate
+	* @param y The pointer's y coordinate
+	*/
+	void Engine::handleKeyEvent(const SDL_KeyboardEvent &keyEvent, int x, int y) {
 		if (this->customEventHandler) {
 			int action = getKeyAction(keyEvent.keysym.sym);
 			(*this->customEventHandler)->handleCustomEvent(action);
 		}
 
 		if (this->keyEventHandler) {
-			int x, y;
-			SDL_GetMouseState(&x, &y);
 			(*this->keyEventHandler)->handleKeyEvent(keyEvent, x, y);
 		}
 	}
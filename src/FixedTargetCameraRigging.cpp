@@ -27,10 +27,23 @@ namespace peek {
 
 	void FixedTargetCameraRigging::initModelviewMatrix() {
 		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glTranslated(0.0, 0.0, -this->distance);
-		glRotated(this->latitude-90.0, 1.0, 0.0, 0.0);
-		glRotated(-this->longitude-90.0, 0.0, 0.0, 1.0);
+		glLoadMatrixd(getViewMatrix().getArray());
+	}
+
+	/**
+	 * \return The view matrix, which turns the world to the camera's longitude and latitude and then backs away from the target
+	 */
+	Matrix<double> FixedTargetCameraRigging::getViewMatrix() {
+		return translationMatrix(0.0, 0.0, -this->distance)
+			* rotationMatrix(this->latitude-90.0, 1.0, 0.0, 0.0)
+			* rotationMatrix(-this->longitude-90.0, 0.0, 0.0, 1.0);
+	}
+
+	/**
+	 * \return The inverse of the view matrix, recalculated only when the camera moves
+	 */
+	const Matrix<double> &FixedTargetCameraRigging::getInverseViewMatrix() {
+		return this->viewInverse.getInverse(getViewMatrix());
 	}
 
 	/**
@@ -0,0 +1,422 @@
+/**
+* @file FrameCapture.cpp
+*/
+
+#include "FrameCapture.hpp"
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using std::string;
+using std::vector;
+
+namespace peek {
+
+	namespace {
+
+		/** The table for the CRC-32 that PNG chunks carry */
+		struct CrcTable {
+			boost::uint32_t entries[256];
+
+			CrcTable() {
+				for (boost::uint32_t n = 0; n < 256; n++) {
+					boost::uint32_t c = n;
+					for (int k = 0; k < 8; k++) {
+						c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+					}
+					this->entries[n] = c;
+				}
+			}
+		};
+
+		// Built during static initialization, before any worker thread can use it
+		const CrcTable crcTable;
+
+		/** Appends a 32-bit integer in network byte order */
+		void appendUint32(vector<unsigned char> &out, boost::uint32_t value) {
+			out.push_back((unsigned char) (value >> 24));
+			out.push_back((unsigned char) (value >> 16));
+			out.push_back((unsigned char) (value >> 8));
+			out.push_back((unsigned char) value);
+		}
+
+		/** Appends a PNG chunk: length, type, data and the CRC of the type and data */
+		void appendChunk(vector<unsigned char> &out, const char *type, const vector<unsigned char> &data) {
+			appendUint32(out, (boost::uint32_t) data.size());
+
+			size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+
+			boost::uint32_t crc = 0xffffffffUL;
+			for (size_t i = start; i < out.size(); i++) {
+				crc = crcTable.entries[(crc ^ out[i]) & 0xff] ^ (crc >> 8);
+			}
+
+			appendUint32(out, crc ^ 0xffffffffUL);
+		}
+
+		/**
+		* Encodes RGBA pixels as a PNG
+		*
+		* The image data is wrapped in stored (uncompressed) deflate blocks,
+		* which any PNG reader accepts, so no compression library is needed;
+		* the files are about as large as the raw pixels.
+		*/
+		void encodePng(unsigned int width, unsigned int height, const vector<unsigned char> &pixels, vector<unsigned char> &png) {
+			static const unsigned char signature[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+			png.assign(signature, signature + 8);
+
+			vector<unsigned char> header;
+			appendUint32(header, width);
+			appendUint32(header, height);
+			header.push_back(8); // bits per channel
+			header.push_back(6); // RGBA
+			header.push_back(0); // deflate
+			header.push_back(0); // adaptive filtering
+			header.push_back(0); // not interlaced
+			appendChunk(png, "IHDR", header);
+
+			// Each scanline is preceded by its filter type, which is always "none"
+			size_t rowSize = (size_t) width * 4;
+			vector<unsigned char> scanlines;
+			scanlines.reserve((rowSize + 1) * height);
+			for (unsigned int y = 0; y < height; y++) {
+				scanlines.push_back(0);
+				scanlines.insert(scanlines.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+			}
+
+			vector<unsigned char> zlib;
+			zlib.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+			zlib.push_back(0x78);
+			zlib.push_back(0x01);
+
+			size_t offset = 0;
+			do {
+				size_t length = std::min<size_t>(scanlines.size() - offset, 65535);
+				bool last = (offset + length == scanlines.size());
+
+				zlib.push_back(last ? 1 : 0);
+				zlib.push_back((unsigned char) length);
+				zlib.push_back((unsigned char) (length >> 8));
+				zlib.push_back((unsigned char) ~length);
+				zlib.push_back((unsigned char) (~length >> 8));
+				zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+
+				offset += length;
+			} while (offset < scanlines.size());
+
+			boost::uint32_t a = 1, b = 0;
+			for (size_t i = 0; i < scanlines.size(); i++) {
+				a = (a + scanlines[i]) % 65521;
+				b = (b + a) % 65521;
+			}
+			appendUint32(zlib, (b << 16) | a);
+
+			appendChunk(png, "IDAT", zlib);
+			appendChunk(png, "IEND", vector<unsigned char>());
+		}
+
+		/** Copies rows bottom-up, as OpenGL reads them, into top-down order */
+		void flipRows(const unsigned char *in, unsigned int width, unsigned int height, unsigned char *out) {
+			size_t rowSize = (size_t) width * 4;
+
+			for (unsigned int y = 0; y < height; y++) {
+				memcpy(out + (height - 1 - y) * rowSize, in + y * rowSize, rowSize);
+			}
+		}
+
+	}
+
+	/*!
+	* @param prefix What to start file names with, which may include a directory
+	* @param format The format to save frames in
+	* @param ringSize The number of frames that may be in flight, or 0 to read them synchronously
+	*/
+	FrameCapture::FrameCapture(const string &prefix, Format format, unsigned int ringSize) {
+		this->prefix = prefix;
+		this->format = format;
+		this->ringSize = ringSize;
+		this->slotsCreated = false;
+		this->nextSlot = 0;
+		this->nextFrameNumber = 0;
+		this->stallCount = 0;
+		this->maxQueued = 8;
+		this->finishing = false;
+		this->framesWritten = 0;
+	}
+
+	FrameCapture::~FrameCapture() {
+		finish();
+	}
+
+	/*!
+	* Call this after drawing a frame, before swapping buffers.
+	*
+	* @param width The width of the framebuffer, in pixels
+	* @param height The height of the framebuffer, in pixels
+	*/
+	void FrameCapture::capture(unsigned int width, unsigned int height) {
+		if (!this->slotsCreated) {
+			createSlots();
+		}
+
+		if (!this->worker.joinable()) {
+			this->finishing = false;
+			this->worker = boost::thread(boost::bind(&FrameCapture::writeFrames, this));
+		}
+
+		size_t size = (size_t) width * height * 4;
+
+		if (this->slots.empty()) {
+			Frame frame;
+			frame.frameNumber = this->nextFrameNumber++;
+			frame.width = width;
+			frame.height = height;
+
+			vector<unsigned char> pixels(size);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+			frame.pixels.resize(size);
+			flipRows(&pixels[0], width, height, &frame.pixels[0]);
+
+			enqueue(frame);
+			return;
+		}
+
+		// If the ring is full, the oldest frame has to come out first
+		Slot &slot = this->slots[this->nextSlot];
+		if (slot.pending) {
+			if (!isReady(slot)) {
+				this->stallCount++;
+			}
+			retire(slot);
+		}
+
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		if (slot.size != size) {
+			pkGlBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+			slot.size = size;
+		}
+
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot.fence = haveFenceSync() ? pkGlFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+		slot.pending = true;
+		slot.frameNumber = this->nextFrameNumber++;
+		slot.width = width;
+		slot.height = height;
+
+		this->nextSlot = (this->nextSlot + 1) % this->slots.size();
+
+		// Take out, oldest first, the frames whose reads have finished
+		for (size_t i = 0; i < this->slots.size(); i++) {
+			Slot &older = this->slots[(this->nextSlot + i) % this->slots.size()];
+
+			if (older.pending) {
+				if (!isReady(older)) {
+					break;
+				}
+				retire(older);
+			}
+		}
+	}
+
+	void FrameCapture::finish() {
+		for (size_t i = 0; i < this->slots.size(); i++) {
+			Slot &slot = this->slots[(this->nextSlot + i) % this->slots.size()];
+
+			if (slot.pending) {
+				retire(slot);
+			}
+		}
+
+		{
+			boost::mutex::scoped_lock lock(this->queueMutex);
+			this->finishing = true;
+			this->frameQueued.notify_all();
+		}
+
+		if (this->worker.joinable()) {
+			this->worker.join();
+		}
+
+		for (size_t i = 0; i < this->slots.size(); i++) {
+			pkGlDeleteBuffers(1, &this->slots[i].buffer);
+		}
+
+		this->slots.clear();
+		this->slotsCreated = false;
+	}
+
+	/*!
+	* @param frameNumber The number of the frame
+	* @return The name of the frame's file
+	*/
+	string FrameCapture::getFileName(unsigned long frameNumber) const {
+		char number[32];
+		sprintf(number, "%06lu", frameNumber);
+
+		return this->prefix + number + (this->format == FORMAT_PNG ? ".png" : ".rgba");
+	}
+
+	unsigned long FrameCapture::getFramesWritten() const {
+		boost::mutex::scoped_lock lock(this->queueMutex);
+		return this->framesWritten;
+	}
+
+	bool FrameCapture::isAsynchronous() const {
+		return this->ringSize > 0 && havePixelBufferObjects();
+	}
+
+	void FrameCapture::createSlots() {
+		this->slotsCreated = true;
+		this->nextSlot = 0;
+
+		if (!isAsynchronous()) {
+			return;
+		}
+
+		this->slots.resize(this->ringSize);
+
+		for (size_t i = 0; i < this->slots.size(); i++) {
+			pkGlGenBuffers(1, &this->slots[i].buffer);
+			this->slots[i].size = 0;
+			this->slots[i].fence = 0;
+			this->slots[i].pending = false;
+		}
+	}
+
+	/*!
+	* Without fences there's no way to tell, so a slot is only taken out
+	* when the ring comes back around to it.
+	*
+	* @param slot A slot with a frame pending
+	*/
+	bool FrameCapture::isReady(const Slot &slot) const {
+		if (!slot.fence) {
+			return false;
+		}
+
+		GLenum status = pkGlClientWaitSync(slot.fence, 0, 0);
+		return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+	}
+
+	/*!
+	* @param slot A slot with a frame pending
+	*/
+	void FrameCapture::retire(Slot &slot) {
+		if (slot.fence) {
+			GLenum status;
+			do {
+				status = pkGlClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+
+			pkGlDeleteSync(slot.fence);
+			slot.fence = 0;
+		}
+
+		Frame frame;
+		frame.frameNumber = slot.frameNumber;
+		frame.width = slot.width;
+		frame.height = slot.height;
+		frame.pixels.resize(slot.size);
+
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+
+		const unsigned char *pixels = (const unsigned char *) pkGlMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (pixels) {
+			flipRows(pixels, slot.width, slot.height, &frame.pixels[0]);
+			pkGlUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else {
+			std::cerr << "FrameCapture: could not map the pixels of frame " << slot.frameNumber << std::endl;
+		}
+
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.pending = false;
+
+		enqueue(frame);
+	}
+
+	/*!
+	* @param frame The frame to queue; its pixels are taken, leaving it empty
+	*/
+	void FrameCapture::enqueue(Frame &frame) {
+		boost::mutex::scoped_lock lock(this->queueMutex);
+
+		if (this->queue.size() >= this->maxQueued) {
+			this->stallCount++;
+
+			while (this->queue.size() >= this->maxQueued) {
+				this->frameTaken.wait(lock);
+			}
+		}
+
+		this->queue.push_back(Frame());
+		this->queue.back().frameNumber = frame.frameNumber;
+		this->queue.back().width = frame.width;
+		this->queue.back().height = frame.height;
+		this->queue.back().pixels.swap(frame.pixels);
+
+		this->frameQueued.notify_all();
+	}
+
+	void FrameCapture::writeFrames() {
+		while (true) {
+			Frame frame;
+
+			{
+				boost::mutex::scoped_lock lock(this->queueMutex);
+
+				while (this->queue.empty() && !this->finishing) {
+					this->frameQueued.wait(lock);
+				}
+
+				if (this->queue.empty()) {
+					return;
+				}
+
+				frame.frameNumber = this->queue.front().frameNumber;
+				frame.width = this->queue.front().width;
+				frame.height = this->queue.front().height;
+				frame.pixels.swap(this->queue.front().pixels);
+				this->queue.pop_front();
+
+				this->frameTaken.notify_all();
+			}
+
+			write(frame);
+
+			boost::mutex::scoped_lock lock(this->queueMutex);
+			this->framesWritten++;
+		}
+	}
+
+	/*!
+	* @param frame The frame to write
+	*/
+	void FrameCapture::write(const Frame &frame) const {
+		string fileName = getFileName(frame.frameNumber);
+		std::ofstream file(fileName.c_str(), std::ios::out | std::ios::binary);
+
+		if (this->format == FORMAT_PNG) {
+			vector<unsigned char> png;
+			encodePng(frame.width, frame.height, frame.pixels, png);
+			file.write((const char *) &png[0], png.size());
+		}
+		else if (!frame.pixels.empty()) {
+			file.write((const char *) &frame.pixels[0], frame.pixels.size());
+		}
+
+		if (!file) {
+			std::cerr << "FrameCapture: could not write " << fileName << std::endl;
+		}
+	}
+
+}
@@ -0,0 +1,74 @@
+/**
+* @file FrameSnapshot.cpp
+*/
+
+#include "FrameSnapshot.hpp"
+#include <algorithm>
+
+namespace peek {
+
+	FrameSnapshot::FrameSnapshot() {
+		this->capacity = 0;
+	}
+
+	/*!
+	* Must be called on the thread that changes the camera and the nodes.
+	*
+	* @param rigging The camera rigging
+	* @param graph The compiled scene graph, which is synced first
+	*/
+	void FrameSnapshot::capture(CameraRigging &rigging, CompiledSceneGraph &graph) {
+		this->projection = rigging.getCamera()->getProjectionMatrix();
+		this->view = rigging.getViewMatrix();
+		this->frustum = Frustum(this->projection * this->view);
+
+		graph.sync();
+		this->visibleLeaves.clear();
+		this->stats.reset();
+		graph.cull(this->frustum, this->visibleLeaves, this->stats);
+
+		size_t count = this->visibleLeaves.size();
+		if (count > this->capacity) {
+			this->capacity = std::max(count, 2 * this->capacity);
+			this->matrices.reset(new Matrix<double>[this->capacity]);
+		}
+
+		this->toggles.resize(count);
+		this->centers.resize(count);
+		this->meshes.clear();
+		this->meshStarts.resize(count + 1);
+		for (size_t i = 0; i < count; i++) {
+			boost::uint32_t leaf = this->visibleLeaves[i];
+			const Model &model = *graph.getLeaf(leaf)->getModel();
+			this->toggles[i] = model.getDisplayToggles();
+			this->meshStarts[i] = this->meshes.size();
+			this->meshes.insert(this->meshes.end(), model.getMeshes().begin(), model.getMeshes().end());
+			this->centers[i] = graph.getCenter(leaf);
+			this->matrices[i] = graph.getWorldMatrix(leaf);
+		}
+		this->meshStarts[count] = this->meshes.size();
+	}
+
+	void FrameSnapshot::loadCamera() const {
+		glMatrixMode(GL_PROJECTION);
+		glLoadMatrixd(this->projection.getArray());
+		glMatrixMode(GL_MODELVIEW);
+		glLoadMatrixd(this->view.getArray());
+	}
+
+	/*!
+	* The queue is given pointers into the snapshot, so the snapshot must not
+	* be captured into again until the queue has been drawn.  The models are
+	* not read, so they may be changed meanwhile.
+	*
+	* @param queue The queue
+	*/
+	void FrameSnapshot::enqueue(RenderQueue &queue) const {
+		queue.begin(this->view);
+		for (size_t i = 0; i < this->toggles.size(); i++) {
+			Model::enqueue(queue, this->toggles[i], this->meshes.begin() + this->meshStarts[i],
+				this->meshes.begin() + this->meshStarts[i + 1], &this->matrices[i], this->centers[i]);
+		}
+	}
+
+}
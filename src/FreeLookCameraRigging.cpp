@@ -21,10 +21,23 @@ namespace peek {
 
 	void FreeLookCameraRigging::initModelviewMatrix() {
 		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glRotated(-this->pitch, 1.0, 0.0, 0.0);
-		glRotated(90.0-this->yaw, 0.0, 0.0, 1.0);
-		glTranslated(-this->location.x, -this->location.y, -this->location.z);
+		glLoadMatrixd(getViewMatrix().getArray());
+	}
+
+	/**
+	 * \return The view matrix, which moves the world opposite to the camera and then turns it by the pitch and yaw
+	 */
+	Matrix<double> FreeLookCameraRigging::getViewMatrix() {
+		return rotationMatrix(-this->pitch, 1.0, 0.0, 0.0)
+			* rotationMatrix(90.0-this->yaw, 0.0, 0.0, 1.0)
+			* translationMatrix(-this->location.x, -this->location.y, -this->location.z);
+	}
+
+	/**
+	 * \return The inverse of the view matrix, recalculated only when the camera moves
+	 */
+	const Matrix<double> &FreeLookCameraRigging::getInverseViewMatrix() {
+		return this->viewInverse.getInverse(getViewMatrix());
 	}
 
 	/**
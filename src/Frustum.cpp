@@ -0,0 +1,107 @@
+/**
+* @file Frustum.cpp
+*/
+#include "Frustum.hpp"
+
+namespace peek {
+
+	/*!
+	* Every plane is degenerate (0x + 0y + 0z + 1 >= 0), so nothing is culled.
+	*/
+	Frustum::Frustum() {
+		for (int i = 0; i < planeCount; i++) {
+			this->planes[i][0] = this->planes[i][1] = this->planes[i][2] = 0;
+			this->planes[i][3] = 1;
+		}
+	}
+
+	/*!
+	* The planes are extracted from the rows of the matrix (Gribb and Hartmann),
+	* so they are in whatever space the matrix transforms from; pass the
+	* projection times the view matrix for world-space planes.
+	*
+	* @param viewProjection The combined projection and view matrix
+	*/
+	Frustum::Frustum(const Matrix<double> &viewProjection) {
+		for (int i = 0; i < planeCount; i++) {
+			unsigned int row = i / 2;
+			double sign = (i % 2 == 0 ? 1.0 : -1.0);
+
+			for (unsigned int col = 0; col < 4; col++) {
+				this->planes[i][col] = viewProjection.at(col, 3) + sign * viewProjection.at(col, row);
+			}
+
+			double length = sqrt(this->planes[i][0] * this->planes[i][0]
+				+ this->planes[i][1] * this->planes[i][1]
+				+ this->planes[i][2] * this->planes[i][2]);
+
+			if (length > 0) {
+				for (unsigned int col = 0; col < 4; col++) {
+					this->planes[i][col] /= length;
+				}
+			}
+		}
+	}
+
+	/*!
+	* Each plane in the mask is tried against the sphere first, since that is
+	* cheaper, and then against the box corner furthest along the plane normal
+	* (to see if the box is outside) and the corner furthest against it (to see
+	* if the box is wholly inside).
+	*
+	* @param box The bounding box of the volume
+	* @param sphere The bounding sphere of the volume
+	* @param planeMask The planes to test; on return, only the planes the volume straddles remain
+	* @return Whether the volume is outside, inside, or intersecting the frustum
+	*/
+	Frustum::Intersection Frustum::classify(const BoundingBox &box, const BoundingSphere &sphere, unsigned int &planeMask) const {
+		if (box.isEmpty()) {
+			return OUTSIDE;
+		}
+
+		const Point3d &low = box.getLow(), &high = box.getHigh();
+
+		for (int i = 0; i < planeCount; i++) {
+			unsigned int bit = 1u << i;
+			if (!(planeMask & bit)) {
+				continue;
+			}
+
+			if (!sphere.isEmpty()) {
+				const Point3d &center = sphere.getCenter();
+				double d = distance(i, center.x, center.y, center.z);
+
+				if (d < -sphere.getRadius()) {
+					return OUTSIDE;
+				}
+				if (d >= sphere.getRadius()) {
+					planeMask &= ~bit;
+					continue;
+				}
+			}
+
+			const double *plane = this->planes[i];
+			if (distance(i, plane[0] >= 0 ? high.x : low.x, plane[1] >= 0 ? high.y : low.y, plane[2] >= 0 ? high.z : low.z) < 0) {
+				return OUTSIDE;
+			}
+			if (distance(i, plane[0] >= 0 ? low.x : high.x, plane[1] >= 0 ? low.y : high.y, plane[2] >= 0 ? low.z : high.z) >= 0) {
+				planeMask &= ~bit;
+			}
+		}
+
+		return (planeMask == 0 ? INSIDE : INTERSECTING);
+	}
+
+	/*!
+	* @param point The point to test
+	*/
+	bool Frustum::contains(const Point3d &point) const {
+		for (int i = 0; i < planeCount; i++) {
+			if (distance(i, point.x, point.y, point.z) < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
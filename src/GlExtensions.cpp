@@ -0,0 +1,233 @@
+/**
+ * \file GlExtensions.cpp
+ * \author Douglas W. Paul
+ *
+ * Looks up the OpenGL entry points declared in GlExtensions.hpp.
+ */
+
+#include "Peek_base.hpp"
+#include "GlExtensions.hpp"
+#include <string>
+#include <cstdio>
+
+using std::string;
+
+namespace peek {
+
+	PFNGLGENBUFFERSPROC pkGlGenBuffers = 0;
+	PFNGLDELETEBUFFERSPROC pkGlDeleteBuffers = 0;
+	PFNGLBINDBUFFERPROC pkGlBindBuffer = 0;
+	PFNGLBUFFERDATAPROC pkGlBufferData = 0;
+	PFNGLBUFFERSUBDATAPROC pkGlBufferSubData = 0;
+	PFNGLMAPBUFFERPROC pkGlMapBuffer = 0;
+	PFNGLUNMAPBUFFERPROC pkGlUnmapBuffer = 0;
+
+	PFNGLDRAWRANGEELEMENTSPROC pkGlDrawRangeElements = 0;
+	PFNGLMULTIDRAWELEMENTSPROC pkGlMultiDrawElements = 0;
+
+	PFNGLFENCESYNCPROC pkGlFenceSync = 0;
+	PFNGLCLIENTWAITSYNCPROC pkGlClientWaitSync = 0;
+	PFNGLDELETESYNCPROC pkGlDeleteSync = 0;
+
+	PFNGLGENFRAMEBUFFERSPROC pkGlGenFramebuffers = 0;
+	PFNGLDELETEFRAMEBUFFERSPROC pkGlDeleteFramebuffers = 0;
+	PFNGLBINDFRAMEBUFFERPROC pkGlBindFramebuffer = 0;
+	PFNGLFRAMEBUFFERRENDERBUFFERPROC pkGlFramebufferRenderbuffer = 0;
+	PFNGLCHECKFRAMEBUFFERSTATUSPROC pkGlCheckFramebufferStatus = 0;
+	PFNGLGENRENDERBUFFERSPROC pkGlGenRenderbuffers = 0;
+	PFNGLDELETERENDERBUFFERSPROC pkGlDeleteRenderbuffers = 0;
+	PFNGLBINDRENDERBUFFERPROC pkGlBindRenderbuffer = 0;
+	PFNGLRENDERBUFFERSTORAGEPROC pkGlRenderbufferStorage = 0;
+
+	PFNGLCREATESHADERPROC pkGlCreateShader = 0;
+	PFNGLDELETESHADERPROC pkGlDeleteShader = 0;
+	PFNGLSHADERSOURCEPROC pkGlShaderSource = 0;
+	PFNGLCOMPILESHADERPROC pkGlCompileShader = 0;
+	PFNGLGETSHADERIVPROC pkGlGetShaderiv = 0;
+	PFNGLGETSHADERINFOLOGPROC pkGlGetShaderInfoLog = 0;
+	PFNGLCREATEPROGRAMPROC pkGlCreateProgram = 0;
+	PFNGLDELETEPROGRAMPROC pkGlDeleteProgram = 0;
+	PFNGLATTACHSHADERPROC pkGlAttachShader = 0;
+	PFNGLBINDATTRIBLOCATIONPROC pkGlBindAttribLocation = 0;
+	PFNGLLINKPROGRAMPROC pkGlLinkProgram = 0;
+	PFNGLGETPROGRAMIVPROC pkGlGetProgramiv = 0;
+	PFNGLGETPROGRAMINFOLOGPROC pkGlGetProgramInfoLog = 0;
+	PFNGLUSEPROGRAMPROC pkGlUseProgram = 0;
+	PFNGLGETUNIFORMLOCATIONPROC pkGlGetUniformLocation = 0;
+	PFNGLUNIFORM1IPROC pkGlUniform1i = 0;
+	PFNGLUNIFORM1IVPROC pkGlUniform1iv = 0;
+	PFNGLVERTEXATTRIBPOINTERPROC pkGlVertexAttribPointer = 0;
+	PFNGLENABLEVERTEXATTRIBARRAYPROC pkGlEnableVertexAttribArray = 0;
+	PFNGLDISABLEVERTEXATTRIBARRAYPROC pkGlDisableVertexAttribArray = 0;
+
+	PFNGLVERTEXATTRIBDIVISORPROC pkGlVertexAttribDivisor = 0;
+	PFNGLDRAWELEMENTSINSTANCEDPROC pkGlDrawElementsInstanced = 0;
+
+	PFNGLGENQUERIESPROC pkGlGenQueries = 0;
+	PFNGLDELETEQUERIESPROC pkGlDeleteQueries = 0;
+	PFNGLBEGINQUERYPROC pkGlBeginQuery = 0;
+	PFNGLENDQUERYPROC pkGlEndQuery = 0;
+	PFNGLGETQUERYOBJECTIVPROC pkGlGetQueryObjectiv = 0;
+	PFNGLGETQUERYOBJECTUI64VPROC pkGlGetQueryObjectui64v = 0;
+
+	/** Whether or not the driver supports pixel buffer objects */
+	static bool pixelBufferObjects = false;
+
+	/** Whether or not the driver supports GL_TIME_ELAPSED queries */
+	static bool timerQueries = false;
+
+	/**
+	 * Looks up an entry point by its core name, falling back to the ARB and
+	 * EXT suffixed names used by older drivers.
+	 *
+	 * \param renderContext The context to look up the entry point in
+	 * \param name The core name of the entry point
+	 * \return The entry point, or 0 if the driver does not provide it
+	 */
+	static void *lookupEntryPoint(RenderContext &renderContext, const char *name) {
+		static const char *suffixes[] = { "", "ARB", "EXT" };
+
+		for (int i = 0; i < 3; i++) {
+			string fullName = string(name) + suffixes[i];
+
+			void *entryPoint = renderContext.getProcAddress(fullName.c_str());
+			if (entryPoint) {
+				return entryPoint;
+			}
+		}
+
+		return 0;
+	}
+
+	/**
+	 * \param major The major version number
+	 * \param minor The minor version number
+	 * \return Whether the context's OpenGL version is at least the given one
+	 */
+	static bool haveVersion(int major, int minor) {
+		const char *version = (const char *) glGetString(GL_VERSION);
+		int haveMajor = 0, haveMinor = 0;
+
+		if (!version || sscanf(version, "%d.%d", &haveMajor, &haveMinor) != 2) {
+			return false;
+		}
+
+		return haveMajor > major || (haveMajor == major && haveMinor >= minor);
+	}
+
+	/**
+	 * \param name The name of the extension
+	 * \return Whether the context's extension string lists the extension
+	 */
+	static bool haveExtension(const char *name) {
+		const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+
+		if (!extensions) {
+			return false;
+		}
+
+		// Match whole names only, since some names are prefixes of others
+		string padded = string(" ") + extensions + " ";
+		return padded.find(string(" ") + name + " ") != string::npos;
+	}
+
+	void initGlExtensions(RenderContext &renderContext) {
+		pkGlGenBuffers = (PFNGLGENBUFFERSPROC) lookupEntryPoint(renderContext, "glGenBuffers");
+		pkGlDeleteBuffers = (PFNGLDELETEBUFFERSPROC) lookupEntryPoint(renderContext, "glDeleteBuffers");
+		pkGlBindBuffer = (PFNGLBINDBUFFERPROC) lookupEntryPoint(renderContext, "glBindBuffer");
+		pkGlBufferData = (PFNGLBUFFERDATAPROC) lookupEntryPoint(renderContext, "glBufferData");
+		pkGlBufferSubData = (PFNGLBUFFERSUBDATAPROC) lookupEntryPoint(renderContext, "glBufferSubData");
+		pkGlMapBuffer = (PFNGLMAPBUFFERPROC) lookupEntryPoint(renderContext, "glMapBuffer");
+		pkGlUnmapBuffer = (PFNGLUNMAPBUFFERPROC) lookupEntryPoint(renderContext, "glUnmapBuffer");
+
+		pkGlDrawRangeElements = (PFNGLDRAWRANGEELEMENTSPROC) lookupEntryPoint(renderContext, "glDrawRangeElements");
+		pkGlMultiDrawElements = (PFNGLMULTIDRAWELEMENTSPROC) lookupEntryPoint(renderContext, "glMultiDrawElements");
+
+		pkGlFenceSync = (PFNGLFENCESYNCPROC) lookupEntryPoint(renderContext, "glFenceSync");
+		pkGlClientWaitSync = (PFNGLCLIENTWAITSYNCPROC) lookupEntryPoint(renderContext, "glClientWaitSync");
+		pkGlDeleteSync = (PFNGLDELETESYNCPROC) lookupEntryPoint(renderContext, "glDeleteSync");
+
+		// The EXT entry points take the same arguments and enumerants as the core ones
+		pkGlGenFramebuffers = (PFNGLGENFRAMEBUFFERSPROC) lookupEntryPoint(renderContext, "glGenFramebuffers");
+		pkGlDeleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC) lookupEntryPoint(renderContext, "glDeleteFramebuffers");
+		pkGlBindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC) lookupEntryPoint(renderContext, "glBindFramebuffer");
+		pkGlFramebufferRenderbuffer = (PFNGLFRAMEBUFFERRENDERBUFFERPROC) lookupEntryPoint(renderContext, "glFramebufferRenderbuffer");
+		pkGlCheckFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC) lookupEntryPoint(renderContext, "glCheckFramebufferStatus");
+		pkGlGenRenderbuffers = (PFNGLGENRENDERBUFFERSPROC) lookupEntryPoint(renderContext, "glGenRenderbuffers");
+		pkGlDeleteRenderbuffers = (PFNGLDELETERENDERBUFFERSPROC) lookupEntryPoint(renderContext, "glDeleteRenderbuffers");
+		pkGlBindRenderbuffer = (PFNGLBINDRENDERBUFFERPROC) lookupEntryPoint(renderContext, "glBindRenderbuffer");
+		pkGlRenderbufferStorage = (PFNGLRENDERBUFFERSTORAGEPROC) lookupEntryPoint(renderContext, "glRenderbufferStorage");
+
+		// The ARB_shader_objects entry points have different names and handle types, so only the core ones are used
+		pkGlCreateShader = (PFNGLCREATESHADERPROC) renderContext.getProcAddress("glCreateShader");
+		pkGlDeleteShader = (PFNGLDELETESHADERPROC) renderContext.getProcAddress("glDeleteShader");
+		pkGlShaderSource = (PFNGLSHADERSOURCEPROC) renderContext.getProcAddress("glShaderSource");
+		pkGlCompileShader = (PFNGLCOMPILESHADERPROC) renderContext.getProcAddress("glCompileShader");
+		pkGlGetShaderiv = (PFNGLGETSHADERIVPROC) renderContext.getProcAddress("glGetShaderiv");
+		pkGlGetShaderInfoLog = (PFNGLGETSHADERINFOLOGPROC) renderContext.getProcAddress("glGetShaderInfoLog");
+		pkGlCreateProgram = (PFNGLCREATEPROGRAMPROC) renderContext.getProcAddress("glCreateProgram");
+		pkGlDeleteProgram = (PFNGLDELETEPROGRAMPROC) renderContext.getProcAddress("glDeleteProgram");
+		pkGlAttachShader = (PFNGLATTACHSHADERPROC) renderContext.getProcAddress("glAttachShader");
+		pkGlBindAttribLocation = (PFNGLBINDATTRIBLOCATIONPROC) renderContext.getProcAddress("glBindAttribLocation");
+		pkGlLinkProgram = (PFNGLLINKPROGRAMPROC) renderContext.getProcAddress("glLinkProgram");
+		pkGlGetProgramiv = (PFNGLGETPROGRAMIVPROC) renderContext.getProcAddress("glGetProgramiv");
+		pkGlGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC) renderContext.getProcAddress("glGetProgramInfoLog");
+		pkGlUseProgram = (PFNGLUSEPROGRAMPROC) renderContext.getProcAddress("glUseProgram");
+		pkGlGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC) renderContext.getProcAddress("glGetUniformLocation");
+		pkGlUniform1i = (PFNGLUNIFORM1IPROC) renderContext.getProcAddress("glUniform1i");
+		pkGlUniform1iv = (PFNGLUNIFORM1IVPROC) renderContext.getProcAddress("glUniform1iv");
+		pkGlVertexAttribPointer = (PFNGLVERTEXATTRIBPOINTERPROC) renderContext.getProcAddress("glVertexAttribPointer");
+		pkGlEnableVertexAttribArray = (PFNGLENABLEVERTEXATTRIBARRAYPROC) renderContext.getProcAddress("glEnableVertexAttribArray");
+		pkGlDisableVertexAttribArray = (PFNGLDISABLEVERTEXATTRIBARRAYPROC) renderContext.getProcAddress("glDisableVertexAttribArray");
+
+		pkGlVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC) lookupEntryPoint(renderContext, "glVertexAttribDivisor");
+		pkGlDrawElementsInstanced = (PFNGLDRAWELEMENTSINSTANCEDPROC) lookupEntryPoint(renderContext, "glDrawElementsInstanced");
+
+		pkGlGenQueries = (PFNGLGENQUERIESPROC) lookupEntryPoint(renderContext, "glGenQueries");
+		pkGlDeleteQueries = (PFNGLDELETEQUERIESPROC) lookupEntryPoint(renderContext, "glDeleteQueries");
+		pkGlBeginQuery = (PFNGLBEGINQUERYPROC) lookupEntryPoint(renderContext, "glBeginQuery");
+		pkGlEndQuery = (PFNGLENDQUERYPROC) lookupEntryPoint(renderContext, "glEndQuery");
+		pkGlGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC) lookupEntryPoint(renderContext, "glGetQueryObjectiv");
+		pkGlGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC) lookupEntryPoint(renderContext, "glGetQueryObjectui64v");
+
+		// Pixel buffer objects add no entry points, just new buffer targets
+		pixelBufferObjects = haveVersion(2, 1) || haveExtension("GL_ARB_pixel_buffer_object") || haveExtension("GL_EXT_pixel_buffer_object");
+
+		// Nor does the GL_TIME_ELAPSED target, besides the 64-bit result
+		timerQueries = haveVersion(3, 3) || haveExtension("GL_ARB_timer_query") || haveExtension("GL_EXT_timer_query");
+	}
+
+	bool haveBufferObjects() {
+		return pkGlGenBuffers && pkGlDeleteBuffers && pkGlBindBuffer && pkGlBufferData && pkGlBufferSubData;
+	}
+
+	bool havePixelBufferObjects() {
+		return pixelBufferObjects && haveBufferObjects() && pkGlMapBuffer && pkGlUnmapBuffer;
+	}
+
+	bool haveFenceSync() {
+		return pkGlFenceSync && pkGlClientWaitSync && pkGlDeleteSync;
+	}
+
+	bool haveFramebufferObjects() {
+		return pkGlGenFramebuffers && pkGlDeleteFramebuffers && pkGlBindFramebuffer && pkGlFramebufferRenderbuffer && pkGlCheckFramebufferStatus
+			&& pkGlGenRenderbuffers && pkGlDeleteRenderbuffers && pkGlBindRenderbuffer && pkGlRenderbufferStorage;
+	}
+
+	bool haveShaders() {
+		return pkGlCreateShader && pkGlDeleteShader && pkGlShaderSource && pkGlCompileShader && pkGlGetShaderiv && pkGlGetShaderInfoLog
+			&& pkGlCreateProgram && pkGlDeleteProgram && pkGlAttachShader && pkGlBindAttribLocation && pkGlLinkProgram && pkGlGetProgramiv
+			&& pkGlGetProgramInfoLog && pkGlUseProgram && pkGlGetUniformLocation && pkGlUniform1i && pkGlUniform1iv
+			&& pkGlVertexAttribPointer && pkGlEnableVertexAttribArray && pkGlDisableVertexAttribArray;
+	}
+
+	bool haveTimerQueries() {
+		return timerQueries && pkGlGenQueries && pkGlDeleteQueries && pkGlBeginQuery && pkGlEndQuery
+			&& pkGlGetQueryObjectiv && pkGlGetQueryObjectui64v;
+	}
+
+	bool haveInstancing() {
+		return haveShaders() && haveBufferObjects() && pkGlVertexAttribDivisor && pkGlDrawElementsInstanced;
+	}
+
+}
\ No newline at end of file
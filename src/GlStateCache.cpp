@@ -0,0 +1,140 @@
+/**
+* @file GlStateCache.cpp
+*/
+
+#include "GlStateCache.hpp"
+
+namespace peek {
+
+	namespace {
+
+		/** The OpenGL enumerant of each tracked capability */
+		const GLenum capabilityNames[GlStateCache::CAP_COUNT] = { GL_LIGHTING, GL_CULL_FACE, GL_POLYGON_OFFSET_FILL };
+
+	}
+
+	GlStateCache::GlStateCache() {
+		invalidate();
+		resetCounts();
+	}
+
+	void GlStateCache::invalidate() {
+		for (int i = 0; i < CAP_COUNT; i++) {
+			this->capabilities[i] = CAP_UNKNOWN;
+		}
+		this->polygonMode = 0;
+		this->cullFace = 0;
+		this->polygonOffsetKnown = false;
+		this->materialKnown = false;
+		this->colorKnown = false;
+	}
+
+	/*!
+	* @param capability The capability
+	* @param enabled Whether to enable or disable it
+	*/
+	void GlStateCache::setEnabled(Capability capability, bool enabled) {
+		CapabilityState state = enabled ? CAP_ENABLED : CAP_DISABLED;
+		if (this->capabilities[capability] == state) {
+			this->skippedCount++;
+			return;
+		}
+
+		if (enabled) {
+			glEnable(capabilityNames[capability]);
+		}
+		else {
+			glDisable(capabilityNames[capability]);
+		}
+		this->capabilities[capability] = state;
+		this->changeCount++;
+	}
+
+	/*!
+	* @param mode GL_FILL, GL_LINE or GL_POINT
+	*/
+	void GlStateCache::setPolygonMode(GLenum mode) {
+		if (this->polygonMode == mode) {
+			this->skippedCount++;
+			return;
+		}
+
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+		this->polygonMode = mode;
+		this->changeCount++;
+	}
+
+	/*!
+	* @param face GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+	*/
+	void GlStateCache::setCullFace(GLenum face) {
+		if (this->cullFace == face) {
+			this->skippedCount++;
+			return;
+		}
+
+		glCullFace(face);
+		this->cullFace = face;
+		this->changeCount++;
+	}
+
+	/*!
+	* @param factor The slope-scaled part of the offset
+	* @param units The constant part of the offset
+	*/
+	void GlStateCache::setPolygonOffset(GLfloat factor, GLfloat units) {
+		if (this->polygonOffsetKnown && this->polygonOffsetFactor == factor && this->polygonOffsetUnits == units) {
+			this->skippedCount++;
+			return;
+		}
+
+		glPolygonOffset(factor, units);
+		this->polygonOffsetKnown = true;
+		this->polygonOffsetFactor = factor;
+		this->polygonOffsetUnits = units;
+		this->changeCount++;
+	}
+
+	/*!
+	* @param material The material
+	* @param id The material's number; equal materials must have equal numbers
+	*/
+	void GlStateCache::setMaterial(const Material &material, unsigned int id) {
+		if (this->materialKnown && this->materialId == id) {
+			this->skippedCount++;
+			return;
+		}
+
+		useMaterial(GL_FRONT, material);
+		this->materialKnown = true;
+		this->materialId = id;
+		this->changeCount++;
+		this->materialChangeCount++;
+	}
+
+	/*!
+	* @param r The red component
+	* @param g The green component
+	* @param b The blue component
+	*/
+	void GlStateCache::setColor(GLfloat r, GLfloat g, GLfloat b) {
+		if (this->colorKnown && this->color[0] == r && this->color[1] == g && this->color[2] == b) {
+			this->skippedCount++;
+			return;
+		}
+
+		glColor3f(r, g, b);
+		this->colorKnown = true;
+		this->color[0] = r;
+		this->color[1] = g;
+		this->color[2] = b;
+		this->changeCount++;
+	}
+
+	void GlStateCache::resetCounts() {
+		this->changeCount = 0;
+		this->skippedCount = 0;
+		this->materialChangeCount = 0;
+	}
+
+}
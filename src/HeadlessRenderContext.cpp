@@ -0,0 +1,331 @@
+/**
+* @file HeadlessRenderContext.cpp
+*/
+
+#include "HeadlessRenderContext.hpp"
+#include <stdexcept>
+
+#ifdef PEEK_HAVE_EGL
+#  include <EGL/egl.h>
+#  include <EGL/eglext.h>
+#elif defined(_WIN32)
+#  include <gl/wglext.h>
+#endif
+
+namespace peek {
+
+#ifdef PEEK_HAVE_EGL
+
+	/*!
+	* @param width The width of the framebuffer, in pixels
+	* @param height The height of the framebuffer, in pixels
+	*/
+	HeadlessRenderContext::HeadlessRenderContext(unsigned int width, unsigned int height) {
+		this->width = width;
+		this->height = height;
+
+		EGLDisplay display = EGL_NO_DISPLAY;
+
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+		// Mesa's surfaceless platform needs neither a display server nor a GPU
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (getPlatformDisplay) {
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+		}
+#endif
+
+		if (display == EGL_NO_DISPLAY) {
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0)) {
+			throw std::runtime_error("HeadlessRenderContext: no EGL display is available");
+		}
+
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 16,
+			EGL_NONE
+		};
+
+		EGLConfig config;
+		EGLint configCount = 0;
+
+		if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+			eglTerminate(display);
+			throw std::runtime_error("HeadlessRenderContext: no EGL configuration supports desktop OpenGL in a pbuffer");
+		}
+
+		const EGLint surfaceAttributes[] = {
+			EGL_WIDTH, (EGLint) width,
+			EGL_HEIGHT, (EGLint) height,
+			EGL_NONE
+		};
+
+		EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, 0);
+
+		if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+			if (context != EGL_NO_CONTEXT) {
+				eglDestroyContext(display, context);
+			}
+			if (surface != EGL_NO_SURFACE) {
+				eglDestroySurface(display, surface);
+			}
+			eglTerminate(display);
+			throw std::runtime_error("HeadlessRenderContext: could not create the offscreen framebuffer");
+		}
+
+		this->display = display;
+		this->surface = surface;
+		this->context = context;
+		this->pbuffer = 0;
+	}
+
+	HeadlessRenderContext::~HeadlessRenderContext() {
+		EGLDisplay display = (EGLDisplay) this->display;
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, (EGLContext) this->context);
+		eglDestroySurface(display, (EGLSurface) this->surface);
+		eglTerminate(display);
+	}
+
+	void *HeadlessRenderContext::getProcAddress(const char *name) {
+		return (void *) eglGetProcAddress(name);
+	}
+
+	void HeadlessRenderContext::swapBuffers() {
+		eglSwapBuffers((EGLDisplay) this->display, (EGLSurface) this->surface);
+	}
+
+#elif defined(_WIN32)
+
+	/** The class of the hidden windows the contexts are made with */
+	static const char *hiddenWindowClass = "PeekHeadlessRenderContext";
+
+	/*!
+	* Creates a window that is never shown, with an OpenGL pixel format set on its device context
+	*
+	* @param width The width of the window, in pixels
+	* @param height The height of the window, in pixels
+	* @return The window, or NULL if it could not be made
+	*/
+	static HWND createHiddenWindow(unsigned int width, unsigned int height) {
+		HINSTANCE instance = GetModuleHandle(NULL);
+		WNDCLASSA windowClass;
+
+		if (!GetClassInfoA(instance, hiddenWindowClass, &windowClass)) {
+			ZeroMemory(&windowClass, sizeof(windowClass));
+			windowClass.style = CS_OWNDC;
+			windowClass.lpfnWndProc = DefWindowProcA;
+			windowClass.hInstance = instance;
+			windowClass.lpszClassName = hiddenWindowClass;
+
+			if (!RegisterClassA(&windowClass)) {
+				return NULL;
+			}
+		}
+
+		HWND window = CreateWindowA(hiddenWindowClass, "peek", WS_POPUP | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
+			0, 0, width, height, NULL, NULL, instance, NULL);
+
+		if (!window) {
+			return NULL;
+		}
+
+		PIXELFORMATDESCRIPTOR pixelFormat;
+		ZeroMemory(&pixelFormat, sizeof(pixelFormat));
+		pixelFormat.nSize = sizeof(pixelFormat);
+		pixelFormat.nVersion = 1;
+		pixelFormat.dwFlags = PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER;
+		pixelFormat.iPixelType = PFD_TYPE_RGBA;
+		pixelFormat.cColorBits = 24;
+		pixelFormat.cAlphaBits = 8;
+		pixelFormat.cDepthBits = 16;
+		pixelFormat.iLayerType = PFD_MAIN_PLANE;
+
+		HDC dc = GetDC(window);
+		int format = ChoosePixelFormat(dc, &pixelFormat);
+		bool formatSet = (format && SetPixelFormat(dc, format, &pixelFormat));
+		ReleaseDC(window, dc);
+
+		if (!formatSet) {
+			DestroyWindow(window);
+			return NULL;
+		}
+
+		return window;
+	}
+
+	/*!
+	* Makes a pbuffer and a context to draw into it, using the entry points of the context current on the given window
+	*
+	* @param windowDc The device context of the hidden window, whose context is current
+	* @param width The width of the pbuffer, in pixels
+	* @param height The height of the pbuffer, in pixels
+	* @param pbuffer Set to the pbuffer
+	* @param pbufferDc Set to the pbuffer's device context
+	* @param pbufferContext Set to the context made for the pbuffer
+	* @return Whether the pbuffer was made and its context made current
+	*/
+	static bool createPbuffer(HDC windowDc, unsigned int width, unsigned int height,
+		HPBUFFERARB &pbuffer, HDC &pbufferDc, HGLRC &pbufferContext) {
+
+		PFNWGLCHOOSEPIXELFORMATARBPROC choosePixelFormat =
+			(PFNWGLCHOOSEPIXELFORMATARBPROC) wglGetProcAddress("wglChoosePixelFormatARB");
+		PFNWGLCREATEPBUFFERARBPROC createPbuffer = (PFNWGLCREATEPBUFFERARBPROC) wglGetProcAddress("wglCreatePbufferARB");
+		PFNWGLGETPBUFFERDCARBPROC getPbufferDc = (PFNWGLGETPBUFFERDCARBPROC) wglGetProcAddress("wglGetPbufferDCARB");
+		PFNWGLRELEASEPBUFFERDCARBPROC releasePbufferDc = (PFNWGLRELEASEPBUFFERDCARBPROC) wglGetProcAddress("wglReleasePbufferDCARB");
+		PFNWGLDESTROYPBUFFERARBPROC destroyPbuffer = (PFNWGLDESTROYPBUFFERARBPROC) wglGetProcAddress("wglDestroyPbufferARB");
+
+		if (!choosePixelFormat || !createPbuffer || !getPbufferDc || !releasePbufferDc || !destroyPbuffer) {
+			return false;
+		}
+
+		const int formatAttributes[] = {
+			WGL_DRAW_TO_PBUFFER_ARB, TRUE,
+			WGL_SUPPORT_OPENGL_ARB, TRUE,
+			WGL_PIXEL_TYPE_ARB, WGL_TYPE_RGBA_ARB,
+			WGL_COLOR_BITS_ARB, 24,
+			WGL_ALPHA_BITS_ARB, 8,
+			WGL_DEPTH_BITS_ARB, 16,
+			0
+		};
+		const int pbufferAttributes[] = { 0 };
+
+		int format = 0;
+		UINT formatCount = 0;
+
+		if (!choosePixelFormat(windowDc, formatAttributes, NULL, 1, &format, &formatCount) || formatCount == 0) {
+			return false;
+		}
+
+		pbuffer = createPbuffer(windowDc, format, width, height, pbufferAttributes);
+		if (!pbuffer) {
+			return false;
+		}
+
+		pbufferDc = getPbufferDc(pbuffer);
+		pbufferContext = (pbufferDc ? wglCreateContext(pbufferDc) : NULL);
+
+		if (!pbufferContext || !wglMakeCurrent(pbufferDc, pbufferContext)) {
+			if (pbufferContext) {
+				wglDeleteContext(pbufferContext);
+			}
+			if (pbufferDc) {
+				releasePbufferDc(pbuffer, pbufferDc);
+			}
+			destroyPbuffer(pbuffer);
+			return false;
+		}
+
+		return true;
+	}
+
+	/*!
+	* @param width The width of the framebuffer, in pixels
+	* @param height The height of the framebuffer, in pixels
+	*/
+	HeadlessRenderContext::HeadlessRenderContext(unsigned int width, unsigned int height) {
+		this->width = width;
+		this->height = height;
+
+		HWND window = createHiddenWindow(width, height);
+		if (!window) {
+			throw std::runtime_error("HeadlessRenderContext: could not create a window with an OpenGL pixel format");
+		}
+
+		// WGL needs a current context before it will hand out the pbuffer entry points
+		HDC windowDc = GetDC(window);
+		HGLRC windowContext = wglCreateContext(windowDc);
+
+		if (!windowContext || !wglMakeCurrent(windowDc, windowContext)) {
+			if (windowContext) {
+				wglDeleteContext(windowContext);
+			}
+			ReleaseDC(window, windowDc);
+			DestroyWindow(window);
+			throw std::runtime_error("HeadlessRenderContext: could not create a WGL context");
+		}
+
+		HPBUFFERARB pbuffer = NULL;
+		HDC pbufferDc = NULL;
+		HGLRC pbufferContext = NULL;
+
+		// The hidden window's own pixels fail the pixel ownership test, so they can't stand in for the pbuffer
+		bool created = createPbuffer(windowDc, width, height, pbuffer, pbufferDc, pbufferContext);
+
+		if (!created) {
+			wglMakeCurrent(NULL, NULL);
+		}
+		wglDeleteContext(windowContext);
+		ReleaseDC(window, windowDc);
+
+		if (!created) {
+			DestroyWindow(window);
+			throw std::runtime_error("HeadlessRenderContext: no WGL pixel format supports OpenGL in a pbuffer");
+		}
+
+		this->display = window;
+		this->surface = pbufferDc;
+		this->context = pbufferContext;
+		this->pbuffer = pbuffer;
+	}
+
+	HeadlessRenderContext::~HeadlessRenderContext() {
+		// The pbuffer entry points can only be looked up while the context is current
+		PFNWGLRELEASEPBUFFERDCARBPROC releasePbufferDc = (PFNWGLRELEASEPBUFFERDCARBPROC) wglGetProcAddress("wglReleasePbufferDCARB");
+		PFNWGLDESTROYPBUFFERARBPROC destroyPbuffer = (PFNWGLDESTROYPBUFFERARBPROC) wglGetProcAddress("wglDestroyPbufferARB");
+
+		wglMakeCurrent(NULL, NULL);
+		wglDeleteContext((HGLRC) this->context);
+
+		if (releasePbufferDc && destroyPbuffer) {
+			releasePbufferDc((HPBUFFERARB) this->pbuffer, (HDC) this->surface);
+			destroyPbuffer((HPBUFFERARB) this->pbuffer);
+		}
+
+		DestroyWindow((HWND) this->display);
+	}
+
+	void *HeadlessRenderContext::getProcAddress(const char *name) {
+		PROC entryPoint = wglGetProcAddress(name);
+
+		// Some drivers return small sentinel values rather than NULL for names they don't know
+		if ((INT_PTR) entryPoint >= -1 && (INT_PTR) entryPoint <= 3) {
+			// OpenGL 1.1 comes straight from opengl32.dll; wglGetProcAddress only knows what is beyond it
+			entryPoint = GetProcAddress(GetModuleHandleA("opengl32.dll"), name);
+		}
+
+		return (void *) entryPoint;
+	}
+
+	void HeadlessRenderContext::swapBuffers() {
+		glFlush();
+	}
+
+#else
+
+	HeadlessRenderContext::HeadlessRenderContext(unsigned int width, unsigned int height) {
+		throw std::runtime_error("HeadlessRenderContext: this build has no EGL");
+	}
+
+	HeadlessRenderContext::~HeadlessRenderContext() {}
+
+	void *HeadlessRenderContext::getProcAddress(const char *name) {
+		return 0;
+	}
+
+	void HeadlessRenderContext::swapBuffers() {}
+
+#endif
+
+}
@@ -0,0 +1,399 @@
+/**
+* @file IdBuffer.cpp
+*/
+
+#include "IdBuffer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using std::vector;
+
+namespace peek {
+
+	const size_t IdBuffer::maxPointReads = 64;
+
+	IdBuffer::IdBuffer() {
+		this->framebuffer = 0;
+		this->colorBuffer = 0;
+		this->depthBuffer = 0;
+		this->targetWidth = 0;
+		this->targetHeight = 0;
+		this->packBuffer = 0;
+		this->packBufferSize = 0;
+		this->fence = 0;
+		this->pending = false;
+		this->haveRectangle = false;
+	}
+
+	IdBuffer::~IdBuffer() {
+		release();
+	}
+
+	/*!
+	* @return Whether or not framebuffer objects are available
+	*/
+	bool IdBuffer::isSupported() {
+		return haveFramebufferObjects();
+	}
+
+	/*!
+	* Any earlier pick is finished first.  The viewport is taken from the
+	* current OpenGL state, and the camera's projection and the rigging's pose
+	* are those the scene is drawn with.
+	*
+	* @param scene The scene to pick from
+	* @param rigging The rigging of the camera the scene is seen through
+	* @param x The left of the rectangle
+	* @param y The top of the rectangle, measured down from the top of the viewport
+	* @param width The width of the rectangle, or 0 for no rectangle
+	* @param height The height of the rectangle, or 0 for no rectangle
+	* @param points The points to find the leaves under
+	*/
+	void IdBuffer::pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, int x, int y, int width, int height, const vector<Pixel> &points) {
+		if (!isSupported()) {
+			throw std::runtime_error("ID buffer picking needs framebuffer objects");
+		}
+
+		if (this->pending) {
+			finish();
+		}
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+
+		// Clip the rectangle to the viewport, turning it the right way up
+		int left = std::max(x, 0), right = std::min(x + width, (int) viewport[2]);
+		int bottom = std::max(viewport[3] - (y + height), 0), top = std::min(viewport[3] - y, (int) viewport[3]);
+		this->haveRectangle = (width > 0 && height > 0);
+		bool rectangleVisible = (this->haveRectangle && left < right && bottom < top);
+
+		int boundsLeft = rectangleVisible ? left : viewport[2], boundsRight = rectangleVisible ? right : 0;
+		int boundsBottom = rectangleVisible ? bottom : viewport[3], boundsTop = rectangleVisible ? top : 0;
+
+		int pointsLeft = viewport[2], pointsRight = 0, pointsBottom = viewport[3], pointsTop = 0;
+		vector<Pixel> windowPoints;
+		for (vector<Pixel>::const_iterator i = points.begin(); i != points.end(); ++i) {
+			Pixel p(i->x, viewport[3] - 1 - i->y);
+			windowPoints.push_back(p);
+
+			if (p.x >= 0 && p.x < viewport[2] && p.y >= 0 && p.y < viewport[3]) {
+				pointsLeft = std::min(pointsLeft, p.x);
+				pointsRight = std::max(pointsRight, p.x + 1);
+				pointsBottom = std::min(pointsBottom, p.y);
+				pointsTop = std::max(pointsTop, p.y + 1);
+			}
+		}
+
+		boundsLeft = std::min(boundsLeft, pointsLeft);
+		boundsRight = std::max(boundsRight, pointsRight);
+		boundsBottom = std::min(boundsBottom, pointsBottom);
+		boundsTop = std::max(boundsTop, pointsTop);
+
+		this->regions.clear();
+		this->pointReads.clear();
+		this->ids.clear();
+		this->leavesInRectangle.clear();
+		this->leavesAtPoints.assign(points.size(), NULL);
+
+		if (boundsLeft >= boundsRight || boundsBottom >= boundsTop) {
+			// Nothing asked about is in the viewport
+			return;
+		}
+
+		// Lay out the regions to read, relative to the drawn bounds
+		size_t size = 0;
+		if (this->haveRectangle) {
+			Region region = { left - boundsLeft, bottom - boundsBottom, std::max(right - left, 0), std::max(top - bottom, 0), size };
+			this->regions.push_back(region);
+			size += (size_t) region.width * region.height * 4;
+		}
+
+		int pointsRegion = -1;
+		if (points.size() > maxPointReads && pointsLeft < pointsRight) {
+			Region region = { pointsLeft - boundsLeft, pointsBottom - boundsBottom, pointsRight - pointsLeft, pointsTop - pointsBottom, size };
+			pointsRegion = (int) this->regions.size();
+			this->regions.push_back(region);
+			size += (size_t) region.width * region.height * 4;
+		}
+
+		for (vector<Pixel>::const_iterator p = windowPoints.begin(); p != windowPoints.end(); ++p) {
+			PointRead read = { -1, 0, 0 };
+
+			if (p->x >= 0 && p->x < viewport[2] && p->y >= 0 && p->y < viewport[3]) {
+				if (pointsRegion >= 0) {
+					read.region = pointsRegion;
+					read.x = p->x - pointsLeft;
+					read.y = p->y - pointsBottom;
+				}
+				else {
+					Region region = { p->x - boundsLeft, p->y - boundsBottom, 1, 1, size };
+					read.region = (int) this->regions.size();
+					this->regions.push_back(region);
+					size += 4;
+				}
+			}
+
+			this->pointReads.push_back(read);
+		}
+
+		int boundsWidth = boundsRight - boundsLeft, boundsHeight = boundsTop - boundsBottom;
+		reserveTarget(boundsWidth, boundsHeight);
+
+		GLint previousFramebuffer;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+		glPushAttrib(GL_ALL_ATTRIB_BITS);
+		pkGlBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glViewport(0, 0, boundsWidth, boundsHeight);
+
+		// Anything that could change a colour on its way to the target must be off
+		glDisable(GL_LIGHTING);
+		glDisable(GL_TEXTURE_2D);
+		glDisable(GL_BLEND);
+		glDisable(GL_DITHER);
+		glDisable(GL_FOG);
+		glDisable(GL_ALPHA_TEST);
+		glDisable(GL_CULL_FACE);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glDisable(GL_SCISSOR_TEST);
+		glShadeModel(GL_FLAT);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClearDepth(1.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Narrow the projection to the drawn bounds, as Camera::setPickingMatrix() does to its window
+		Matrix<double> projection = pickingMatrix<double>(viewport[0] + boundsLeft + boundsWidth / 2.0, viewport[1] + boundsBottom + boundsHeight / 2.0,
+			boundsWidth, boundsHeight, viewport) * rigging.getCamera()->getProjectionMatrix();
+
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadMatrixd(projection.getArray());
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		rigging.initModelviewMatrix();
+
+		scene.pick(this->ids, Frustum(projection * rigging.getViewMatrix()));
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+
+		readRegions(size);
+
+		pkGlBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+		glPopAttrib();
+
+		this->pending = true;
+	}
+
+	/*!
+	* @param scene The scene to pick from
+	* @param rigging The rigging of the camera the scene is seen through
+	* @param points The points to find the leaves under
+	*/
+	void IdBuffer::pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, const vector<Pixel> &points) {
+		pick(scene, rigging, 0, 0, 0, 0, points);
+	}
+
+	/*!
+	* @param scene The scene to pick from
+	* @param rigging The rigging of the camera the scene is seen through
+	* @param x The left of the rectangle
+	* @param y The top of the rectangle, measured down from the top of the viewport
+	* @param width The width of the rectangle
+	* @param height The height of the rectangle
+	*/
+	void IdBuffer::pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, int x, int y, int width, int height) {
+		pick(scene, rigging, x, y, width, height, vector<Pixel>());
+	}
+
+	/*!
+	* @return Whether or not finish() would return without waiting
+	*/
+	bool IdBuffer::isReady() const {
+		if (!this->pending || !this->fence) {
+			return true;
+		}
+
+		GLenum status = pkGlClientWaitSync(this->fence, 0, 0);
+		return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+	}
+
+	void IdBuffer::finish() {
+		if (!this->pending) {
+			return;
+		}
+		this->pending = false;
+
+		if (!this->packBuffer) {
+			decode(this->clientPixels.empty() ? NULL : &this->clientPixels[0]);
+			return;
+		}
+
+		if (this->fence) {
+			pkGlClientWaitSync(this->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			pkGlDeleteSync(this->fence);
+			this->fence = 0;
+		}
+
+		// Mapping waits for the reads on its own when there is no fence
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, this->packBuffer);
+		const GLubyte *pixels = (const GLubyte *) pkGlMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (pixels) {
+			decode(pixels);
+			pkGlUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void IdBuffer::release() {
+		if (this->fence) {
+			pkGlDeleteSync(this->fence);
+			this->fence = 0;
+		}
+		if (this->packBuffer) {
+			pkGlDeleteBuffers(1, &this->packBuffer);
+			this->packBuffer = 0;
+			this->packBufferSize = 0;
+		}
+		if (this->framebuffer) {
+			pkGlDeleteFramebuffers(1, &this->framebuffer);
+			pkGlDeleteRenderbuffers(1, &this->colorBuffer);
+			pkGlDeleteRenderbuffers(1, &this->depthBuffer);
+			this->framebuffer = this->colorBuffer = this->depthBuffer = 0;
+			this->targetWidth = this->targetHeight = 0;
+		}
+		this->pending = false;
+	}
+
+	/*!
+	* The renderbuffers only ever grow, so picks of varying sizes don't
+	* reallocate them each time.
+	*
+	* @param width The width needed, in pixels
+	* @param height The height needed, in pixels
+	*/
+	void IdBuffer::reserveTarget(int width, int height) {
+		if (this->framebuffer && width <= this->targetWidth && height <= this->targetHeight) {
+			return;
+		}
+
+		if (!this->framebuffer) {
+			pkGlGenFramebuffers(1, &this->framebuffer);
+			pkGlGenRenderbuffers(1, &this->colorBuffer);
+			pkGlGenRenderbuffers(1, &this->depthBuffer);
+		}
+
+		this->targetWidth = std::max(width, this->targetWidth);
+		this->targetHeight = std::max(height, this->targetHeight);
+
+		pkGlBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+		pkGlRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->targetWidth, this->targetHeight);
+		pkGlBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
+		pkGlRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->targetWidth, this->targetHeight);
+		pkGlBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		GLint previousFramebuffer;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+		pkGlBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		pkGlFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+		pkGlFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+		GLenum status = pkGlCheckFramebufferStatus(GL_FRAMEBUFFER);
+		pkGlBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			release();
+			throw std::runtime_error("Unable to create the ID buffer's framebuffer");
+		}
+	}
+
+	/*!
+	* Called with the ID framebuffer bound.
+	*
+	* @param size The total size of the regions' pixels, in bytes
+	*/
+	void IdBuffer::readRegions(size_t size) {
+		glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+		if (!havePixelBufferObjects()) {
+			this->clientPixels.resize(size);
+			for (vector<Region>::const_iterator r = this->regions.begin(); r != this->regions.end(); ++r) {
+				if (r->width > 0 && r->height > 0) {
+					glReadPixels(r->x, r->y, r->width, r->height, GL_RGBA, GL_UNSIGNED_BYTE, &this->clientPixels[r->offset]);
+				}
+			}
+			glPopClientAttrib();
+			return;
+		}
+
+		if (!this->packBuffer) {
+			pkGlGenBuffers(1, &this->packBuffer);
+		}
+
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, this->packBuffer);
+		if (size > this->packBufferSize) {
+			pkGlBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+			this->packBufferSize = size;
+		}
+
+		for (vector<Region>::const_iterator r = this->regions.begin(); r != this->regions.end(); ++r) {
+			if (r->width > 0 && r->height > 0) {
+				glReadPixels(r->x, r->y, r->width, r->height, GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *) r->offset);
+			}
+		}
+		pkGlBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glPopClientAttrib();
+
+		this->fence = haveFenceSync() ? pkGlFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+	}
+
+	/*!
+	* @param pixels The read-back pixels, laid out as the regions say
+	*/
+	void IdBuffer::decode(const GLubyte *pixels) {
+		if (!pixels) {
+			return;
+		}
+
+		if (this->haveRectangle) {
+			const Region &region = this->regions[0];
+			vector<bool> seen(this->ids.size() + 1, false);
+
+			const GLubyte *p = pixels + region.offset;
+			for (size_t i = 0; i < (size_t) region.width * region.height; i++, p += 4) {
+				GLuint id = PickingIds::fromColor(p);
+				if (id <= this->ids.size()) {
+					seen[id] = true;
+				}
+			}
+
+			for (GLuint id = 1; id < seen.size(); id++) {
+				if (seen[id]) {
+					this->leavesInRectangle.push_back(this->ids.getLeaf(id));
+				}
+			}
+		}
+
+		for (size_t i = 0; i < this->pointReads.size(); i++) {
+			const PointRead &read = this->pointReads[i];
+			if (read.region < 0) {
+				continue;
+			}
+
+			const Region &region = this->regions[read.region];
+			size_t offset = region.offset + ((size_t) read.y * region.width + read.x) * 4;
+			this->leavesAtPoints[i] = this->ids.getLeaf(PickingIds::fromColor(pixels + offset));
+		}
+	}
+
+}
@@ -0,0 +1,245 @@
+/**
+* @file InputLog.cpp
+*/
+
+#include "InputLog.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace peek {
+
+	namespace {
+
+		/** The first bytes of a saved log */
+		const char magic[4] = { 'P', 'K', 'I', 'L' };
+
+		/** The version of the format written */
+		const unsigned char version = 1;
+
+		/** Writes an unsigned integer, seven bits to a byte, low bits first, the top bit set on all but the last byte */
+		void writeVarint(std::ostream &out, boost::uint64_t value) {
+			while (value >= 0x80) {
+				out.put((char) ((value & 0x7f) | 0x80));
+				value >>= 7;
+			}
+			out.put((char) value);
+		}
+
+		/** Writes a signed integer, folded so that small magnitudes of either sign take few bytes */
+		void writeSigned(std::ostream &out, boost::int64_t value) {
+			writeVarint(out, value < 0 ? ((boost::uint64_t) (-(value + 1)) << 1) | 1 : (boost::uint64_t) value << 1);
+		}
+
+		/** Reads an unsigned integer written by writeVarint() */
+		boost::uint64_t readVarint(std::istream &in) {
+			boost::uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				int byte = in.get();
+				if (byte == EOF) {
+					throw std::runtime_error("InputLog: the log is truncated");
+				}
+				value |= (boost::uint64_t) (byte & 0x7f) << shift;
+				if (!(byte & 0x80)) {
+					return value;
+				}
+			}
+			throw std::runtime_error("InputLog: the log is corrupt");
+		}
+
+		/** Reads a signed integer written by writeSigned() */
+		boost::int64_t readSigned(std::istream &in) {
+			boost::uint64_t value = readVarint(in);
+			return (value & 1) ? -(boost::int64_t) (value >> 1) - 1 : (boost::int64_t) (value >> 1);
+		}
+
+	}
+
+	InputLog::InputLog() {
+	}
+
+	/*!
+	* @param event The event
+	* @return Whether the engine dispatches events of its type to handlers
+	*/
+	bool InputLog::isRecorded(const SDL_Event &event) {
+		switch (event.type) {
+			case SDL_KEYDOWN:
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+			case SDL_MOUSEMOTION:
+			case SDL_USEREVENT:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	/*!
+	* @param event The event
+	* @param x The pointer's x coordinate, for a key press
+	* @param y The pointer's y coordinate, for a key press
+	* @param time When the event was taken, in microseconds since recording began
+	* @param frame The number of frames drawn before the event was taken
+	*/
+	void InputLog::add(const SDL_Event &event, int x, int y, boost::uint64_t time, unsigned long frame) {
+		Entry entry;
+		entry.time = time;
+		entry.frame = frame;
+		entry.event = event;
+		entry.x = x;
+		entry.y = y;
+		this->entries.push_back(entry);
+	}
+
+	void InputLog::clear() {
+		this->entries.clear();
+	}
+
+	/*!
+	* Only the fields handlers are given are kept; a user event keeps its
+	* code, but not its data pointers.
+	*
+	* @param out The stream to write to, opened in binary mode
+	*/
+	void InputLog::save(std::ostream &out) const {
+		out.write(magic, sizeof(magic));
+		out.put((char) version);
+
+		boost::uint64_t lastTime = 0;
+		unsigned long lastFrame = 0;
+		for (std::vector<Entry>::const_iterator i = this->entries.begin(); i != this->entries.end(); ++i) {
+			const SDL_Event &event = i->event;
+			out.put((char) event.type);
+			writeVarint(out, i->time - lastTime);
+			writeVarint(out, i->frame - lastFrame);
+			lastTime = i->time;
+			lastFrame = i->frame;
+
+			switch (event.type) {
+				case SDL_KEYDOWN:
+					writeVarint(out, (boost::uint64_t) event.key.keysym.sym);
+					writeVarint(out, (boost::uint64_t) event.key.keysym.mod);
+					writeVarint(out, event.key.keysym.unicode);
+					writeSigned(out, i->x);
+					writeSigned(out, i->y);
+					break;
+
+				case SDL_MOUSEBUTTONDOWN:
+				case SDL_MOUSEBUTTONUP:
+					out.put((char) event.button.button);
+					writeVarint(out, event.button.x);
+					writeVarint(out, event.button.y);
+					break;
+
+				case SDL_MOUSEMOTION:
+					out.put((char) event.motion.state);
+					writeVarint(out, event.motion.x);
+					writeVarint(out, event.motion.y);
+					writeSigned(out, event.motion.xrel);
+					writeSigned(out, event.motion.yrel);
+					break;
+
+				case SDL_USEREVENT:
+					writeSigned(out, event.user.code);
+					break;
+			}
+		}
+	}
+
+	/*!
+	* @param fileName The file to write
+	*/
+	void InputLog::save(const std::string &fileName) const {
+		std::ofstream out(fileName.c_str(), std::ios::out | std::ios::binary);
+		if (!out) {
+			throw std::runtime_error("InputLog: could not open " + fileName);
+		}
+		save(out);
+		if (!out) {
+			throw std::runtime_error("InputLog: could not write " + fileName);
+		}
+	}
+
+	/*!
+	* @param in The stream to read from, opened in binary mode
+	*/
+	void InputLog::load(std::istream &in) {
+		char header[sizeof(magic)];
+		in.read(header, sizeof(header));
+		if (!in || memcmp(header, magic, sizeof(magic)) != 0) {
+			throw std::runtime_error("InputLog: not an input log");
+		}
+		if (in.get() != version) {
+			throw std::runtime_error("InputLog: the log is from an unknown version");
+		}
+
+		std::vector<Entry> entries;
+		Entry entry;
+		entry.time = 0;
+		entry.frame = 0;
+		int type;
+		while ((type = in.get()) != EOF) {
+			memset(&entry.event, 0, sizeof(entry.event));
+			entry.event.type = (Uint8) type;
+			entry.time += readVarint(in);
+			entry.frame += (unsigned long) readVarint(in);
+			entry.x = entry.y = 0;
+
+			SDL_Event &event = entry.event;
+			switch (type) {
+				case SDL_KEYDOWN:
+					event.key.state = SDL_PRESSED;
+					event.key.keysym.sym = (SDLKey) readVarint(in);
+					event.key.keysym.mod = (SDLMod) readVarint(in);
+					event.key.keysym.unicode = (Uint16) readVarint(in);
+					entry.x = (int) readSigned(in);
+					entry.y = (int) readSigned(in);
+					break;
+
+				case SDL_MOUSEBUTTONDOWN:
+				case SDL_MOUSEBUTTONUP:
+					event.button.state = (type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED);
+					event.button.button = (Uint8) in.get();
+					event.button.x = (Uint16) readVarint(in);
+					event.button.y = (Uint16) readVarint(in);
+					break;
+
+				case SDL_MOUSEMOTION:
+					event.motion.state = (Uint8) in.get();
+					event.motion.x = (Uint16) readVarint(in);
+					event.motion.y = (Uint16) readVarint(in);
+					event.motion.xrel = (Sint16) readSigned(in);
+					event.motion.yrel = (Sint16) readSigned(in);
+					break;
+
+				case SDL_USEREVENT:
+					event.user.code = (int) readSigned(in);
+					break;
+
+				default:
+					throw std::runtime_error("InputLog: the log is corrupt");
+			}
+
+			if (!in) {
+				throw std::runtime_error("InputLog: the log is truncated");
+			}
+			entries.push_back(entry);
+		}
+
+		this->entries.swap(entries);
+	}
+
+	/*!
+	* @param fileName The file to read
+	*/
+	void InputLog::load(const std::string &fileName) {
+		std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+		if (!in) {
+			throw std::runtime_error("InputLog: could not open " + fileName);
+		}
+		load(in);
+	}
+
+}
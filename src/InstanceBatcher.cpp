@@ -0,0 +1,282 @@
+/**
+* @file InstanceBatcher.cpp
+*/
+
+#include "InstanceBatcher.hpp"
+#include "GlExtensions.hpp"
+#include "SmoothMesh.hpp"
+#include <iostream>
+
+namespace peek {
+
+	namespace {
+
+		/** The number of lights the program lights with */
+		const int lightCount = 8;
+
+		/**
+		* The first attribute location of the instance data.  The locations
+		* from here up alias the texture coordinates, which meshes never
+		* supply, rather than the vertex, normal or colour.
+		*/
+		const GLuint firstAttribute = 8;
+
+		/** The names of the instance attributes, in the order they lie in an instance */
+		const char *attributeNames[] = {
+			"instanceRow0", "instanceRow1", "instanceRow2",
+			"instanceAmbient", "instanceDiffuse", "instanceSpecular", "instanceEmission"
+		};
+
+		const GLuint attributeCount = sizeof(attributeNames) / sizeof(attributeNames[0]);
+
+		const char *vertexSource =
+			"#version 120\n"
+			"attribute vec4 instanceRow0, instanceRow1, instanceRow2;\n"
+			"attribute vec4 instanceAmbient, instanceDiffuse, instanceSpecular, instanceEmission;\n"
+			"uniform bool lighting;\n"
+			"uniform bool lightEnabled[8];\n"
+			"void main() {\n"
+			"	vec3 eye = vec3(dot(instanceRow0, gl_Vertex), dot(instanceRow1, gl_Vertex), dot(instanceRow2, gl_Vertex));\n"
+			"	gl_Position = gl_ProjectionMatrix * vec4(eye, 1.0);\n"
+			"	if (!lighting) {\n"
+			"		gl_FrontColor = instanceDiffuse;\n"
+			"		return;\n"
+			"	}\n"
+			// The rows' cross products are the inverse transpose times the determinant, whose sign must be kept
+			"	vec3 a = instanceRow0.xyz, b = instanceRow1.xyz, c = instanceRow2.xyz;\n"
+			"	vec3 normal = vec3(dot(cross(b, c), gl_Normal), dot(cross(c, a), gl_Normal), dot(cross(a, b), gl_Normal));\n"
+			"	normal = normalize(normal * sign(dot(a, cross(b, c))));\n"
+			"	vec3 toViewer = normalize(-eye);\n"
+			"	vec4 color = instanceEmission + gl_LightModel.ambient * instanceAmbient;\n"
+			"	for (int i = 0; i < 8; i++) {\n"
+			"		if (!lightEnabled[i]) {\n"
+			"			continue;\n"
+			"		}\n"
+			"		vec4 position = gl_LightSource[i].position;\n"
+			"		vec3 toLight = position.xyz;\n"
+			"		float attenuation = 1.0;\n"
+			"		if (position.w != 0.0) {\n"
+			"			toLight = position.xyz / position.w - eye;\n"
+			"			float d = length(toLight);\n"
+			"			attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * d\n"
+			"				+ gl_LightSource[i].quadraticAttenuation * d * d);\n"
+			"		}\n"
+			"		toLight = normalize(toLight);\n"
+			"		float diffuse = max(dot(normal, toLight), 0.0);\n"
+			"		vec4 term = gl_LightSource[i].ambient * instanceAmbient + diffuse * gl_LightSource[i].diffuse * instanceDiffuse;\n"
+			"		if (diffuse > 0.0) {\n"
+			"			float highlight = max(dot(normal, normalize(toLight + toViewer)), 0.0);\n"
+			"			highlight = (instanceSpecular.a == 0.0 ? 1.0 : pow(highlight, instanceSpecular.a));\n"
+			"			term.rgb += highlight * gl_LightSource[i].specular.rgb * instanceSpecular.rgb;\n"
+			"		}\n"
+			"		color.rgb += attenuation * term.rgb;\n"
+			"	}\n"
+			"	gl_FrontColor = vec4(clamp(color.rgb, 0.0, 1.0), instanceDiffuse.a);\n"
+			"}\n";
+
+		const char *fragmentSource =
+			"#version 120\n"
+			"void main() {\n"
+			"	gl_FragColor = gl_Color;\n"
+			"}\n";
+
+		/** Compiles a shader, returning 0 and reporting the log if it fails */
+		GLuint compile(GLenum type, const char *source) {
+			GLuint shader = pkGlCreateShader(type);
+			pkGlShaderSource(shader, 1, &source, NULL);
+			pkGlCompileShader(shader);
+
+			GLint compiled = GL_FALSE;
+			pkGlGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+			if (!compiled) {
+				char log[1024] = "";
+				pkGlGetShaderInfoLog(shader, sizeof(log), NULL, log);
+				std::cerr << "InstanceBatcher: could not compile a shader: " << log << std::endl;
+				pkGlDeleteShader(shader);
+				return 0;
+			}
+
+			return shader;
+		}
+
+		/** Copies a colour into four floats */
+		inline void copyColor(GLfloat *to, const Color &color) {
+			for (int i = 0; i < 4; i++) {
+				to[i] = color.c[i];
+			}
+		}
+
+	}
+
+	InstanceBatcher::InstanceBatcher() {
+		this->built = false;
+		this->program = 0;
+		this->lightingLocation = -1;
+		this->lightsLocation = -1;
+		this->buffer = 0;
+		for (int i = 0; i < lightCount; i++) {
+			this->lightsEnabled[i] = GL_FALSE;
+		}
+	}
+
+	InstanceBatcher::~InstanceBatcher() {
+		release();
+	}
+
+	/*!
+	* @return Whether instancing is supported and the program was built
+	*/
+	bool InstanceBatcher::isAvailable() {
+		if (!this->built) {
+			this->built = true;
+			if (haveInstancing() && !build()) {
+				release();
+				this->built = true;
+			}
+		}
+
+		return this->program != 0;
+	}
+
+	void InstanceBatcher::clear() {
+		this->instances.clear();
+	}
+
+	/*!
+	* @param modelView The modelview matrix of the instance
+	* @param material The material of the instance, or NULL for plain grey
+	* @return The instance's number, counting from 0 since the last clear()
+	*/
+	size_t InstanceBatcher::add(const Matrix<double> &modelView, const Material *material) {
+		Instance instance;
+		const double *m = modelView.getArray();
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 4; column++) {
+				instance.rows[row][column] = (GLfloat) m[column * 4 + row];
+			}
+		}
+
+		if (material) {
+			copyColor(instance.ambient, material->getAmbient());
+			copyColor(instance.diffuse, material->getDiffuse());
+			copyColor(instance.specular, material->getSpecular());
+			copyColor(instance.emission, material->getEmission());
+			instance.specular[3] = material->getShininess();
+		}
+		else {
+			Color grey(0.5f, 0.5f, 0.5f), black(0.0f, 0.0f, 0.0f);
+			copyColor(instance.ambient, grey);
+			copyColor(instance.diffuse, grey);
+			copyColor(instance.specular, black);
+			copyColor(instance.emission, black);
+			instance.specular[3] = 0.0f;
+		}
+
+		this->instances.push_back(instance);
+		return this->instances.size() - 1;
+	}
+
+	/*!
+	* The buffer is respecified each frame, so the driver can hand out fresh
+	* storage rather than wait for the last frame's draws to finish with it.
+	* Which lights are enabled is also taken now.
+	*/
+	void InstanceBatcher::upload() {
+		if (!this->program) {
+			return;
+		}
+
+		pkGlBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+		pkGlBufferData(GL_ARRAY_BUFFER, this->instances.size() * sizeof(Instance),
+			this->instances.empty() ? 0 : &this->instances[0], GL_STREAM_DRAW);
+		pkGlBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (int i = 0; i < lightCount; i++) {
+			this->lightsEnabled[i] = glIsEnabled(GL_LIGHT0 + i);
+		}
+	}
+
+	/*!
+	* @param mesh The mesh
+	* @param firstInstance The number of the first instance
+	* @param instanceCount The number of instances
+	* @param lighting Whether the instances are lit, or drawn in their diffuse colour
+	*/
+	void InstanceBatcher::draw(const SmoothMesh &mesh, size_t firstInstance, size_t instanceCount, bool lighting) {
+		pkGlUseProgram(this->program);
+		pkGlUniform1i(this->lightingLocation, lighting ? 1 : 0);
+		pkGlUniform1iv(this->lightsLocation, lightCount, this->lightsEnabled);
+
+		pkGlBindBuffer(GL_ARRAY_BUFFER, this->buffer);
+		const char *base = (const char *) 0 + firstInstance * sizeof(Instance);
+		for (GLuint a = 0; a < attributeCount; a++) {
+			pkGlEnableVertexAttribArray(firstAttribute + a);
+			pkGlVertexAttribPointer(firstAttribute + a, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), base + a * sizeof(GLfloat[4]));
+			pkGlVertexAttribDivisor(firstAttribute + a, 1);
+		}
+		pkGlBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		mesh.drawGeometryInstanced((GLsizei) instanceCount);
+
+		for (GLuint a = 0; a < attributeCount; a++) {
+			pkGlVertexAttribDivisor(firstAttribute + a, 0);
+			pkGlDisableVertexAttribArray(firstAttribute + a);
+		}
+		pkGlUseProgram(0);
+	}
+
+	void InstanceBatcher::release() {
+		if (this->program) {
+			pkGlDeleteProgram(this->program);
+			this->program = 0;
+		}
+
+		if (this->buffer) {
+			pkGlDeleteBuffers(1, &this->buffer);
+			this->buffer = 0;
+		}
+
+		this->built = false;
+	}
+
+	/*!
+	* @return Whether the program was compiled and linked
+	*/
+	bool InstanceBatcher::build() {
+		GLuint vertexShader = compile(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, fragmentSource);
+		if (!vertexShader || !fragmentShader) {
+			if (vertexShader) pkGlDeleteShader(vertexShader);
+			if (fragmentShader) pkGlDeleteShader(fragmentShader);
+			return false;
+		}
+
+		this->program = pkGlCreateProgram();
+		pkGlAttachShader(this->program, vertexShader);
+		pkGlAttachShader(this->program, fragmentShader);
+		for (GLuint a = 0; a < attributeCount; a++) {
+			pkGlBindAttribLocation(this->program, firstAttribute + a, attributeNames[a]);
+		}
+		pkGlLinkProgram(this->program);
+
+		// The program keeps the shaders it was linked from
+		pkGlDeleteShader(vertexShader);
+		pkGlDeleteShader(fragmentShader);
+
+		GLint linked = GL_FALSE;
+		pkGlGetProgramiv(this->program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			char log[1024] = "";
+			pkGlGetProgramInfoLog(this->program, sizeof(log), NULL, log);
+			std::cerr << "InstanceBatcher: could not link the program: " << log << std::endl;
+			return false;
+		}
+
+		this->lightingLocation = pkGlGetUniformLocation(this->program, "lighting");
+		this->lightsLocation = pkGlGetUniformLocation(this->program, "lightEnabled");
+
+		pkGlGenBuffers(1, &this->buffer);
+		return true;
+	}
+
+}
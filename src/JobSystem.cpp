@@ -0,0 +1,196 @@
+/**
+* @file JobSystem.cpp
+*/
+
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <boost/bind.hpp>
+
+namespace peek {
+
+	JobSystem::JobSystem() : queued(0), steals(0) {
+		unsigned int cores = boost::thread::hardware_concurrency();
+		start(cores > 1 ? cores - 1 : 0);
+	}
+
+	/*!
+	* @param workerCount The number of worker threads
+	*/
+	JobSystem::JobSystem(unsigned int workerCount) : queued(0), steals(0) {
+		start(workerCount);
+	}
+
+	JobSystem::~JobSystem() {
+		{
+			boost::mutex::scoped_lock lock(this->wakeMutex);
+			this->stopping = true;
+			this->wakeCondition.notify_all();
+		}
+
+		for (size_t i = 0; i < this->workers.size(); i++) {
+			this->workers[i]->join();
+			delete this->workers[i];
+		}
+		for (size_t i = 0; i < this->deques.size(); i++) {
+			delete this->deques[i];
+		}
+	}
+
+	/*!
+	* @param workerCount The number of worker threads
+	*/
+	void JobSystem::start(unsigned int workerCount) {
+		this->stopping = false;
+
+		for (unsigned int i = 0; i <= workerCount; i++) {
+			this->deques.push_back(new Deque());
+		}
+		for (unsigned int i = 1; i <= workerCount; i++) {
+			this->workers.push_back(new boost::thread(boost::bind(&JobSystem::work, this, (size_t) i)));
+		}
+	}
+
+	/*!
+	* @param group The group to count the job against; it must outlive the job
+	* @param job The job
+	*/
+	void JobSystem::submit(Group &group, const Job &job) {
+		Task task;
+		task.job = job;
+		task.group = &group;
+		++group.pending;
+
+		// Counted first, so the count is never below the number of tasks a thief can find
+		++this->queued;
+		Deque &deque = *this->deques[getDequeIndex()];
+		{
+			boost::mutex::scoped_lock lock(deque.mutex);
+			deque.tasks.push_back(task);
+		}
+
+		// Taking the lock means a worker that has just found nothing queued is already waiting
+		boost::mutex::scoped_lock lock(this->wakeMutex);
+		this->wakeCondition.notify_one();
+	}
+
+	/*!
+	* @param group The group
+	*/
+	void JobSystem::wait(Group &group) {
+		size_t self = getDequeIndex();
+		while (!group.isDone()) {
+			if (!runOne(self)) {
+				// The last jobs are running elsewhere
+				boost::this_thread::yield();
+			}
+		}
+
+		boost::exception_ptr error;
+		{
+			boost::mutex::scoped_lock lock(group.errorMutex);
+			error = group.error;
+			group.error = boost::exception_ptr();
+		}
+		if (error) {
+			boost::rethrow_exception(error);
+		}
+	}
+
+	unsigned long JobSystem::getStealCount() const {
+		return (unsigned long) (long) this->steals;
+	}
+
+	/*!
+	* @param self The index of the calling thread's deque
+	* @return Whether a task was run
+	*/
+	bool JobSystem::runOne(size_t self) {
+		Task task;
+		if (!pop(self, task)) {
+			bool stolen = false;
+			for (size_t i = 1; i < this->deques.size() && !stolen; i++) {
+				stolen = steal((self + i) % this->deques.size(), task);
+			}
+			if (!stolen) {
+				return false;
+			}
+			++this->steals;
+		}
+
+		// An exception let out would end a worker, and leave the group waited on forever
+		try {
+			task.job();
+		} catch (...) {
+			boost::mutex::scoped_lock lock(task.group->errorMutex);
+			if (!task.group->error) {
+				task.group->error = boost::current_exception();
+			}
+		}
+		--task.group->pending;
+		return true;
+	}
+
+	/*!
+	* @param index The index of the deque
+	* @param task Where to put the task
+	* @return Whether there was a task
+	*/
+	bool JobSystem::pop(size_t index, Task &task) {
+		Deque &deque = *this->deques[index];
+		boost::mutex::scoped_lock lock(deque.mutex);
+		if (deque.tasks.empty()) {
+			return false;
+		}
+
+		task = deque.tasks.back();
+		deque.tasks.pop_back();
+		--this->queued;
+		return true;
+	}
+
+	/*!
+	* @param index The index of the deque
+	* @param task Where to put the task
+	* @return Whether there was a task
+	*/
+	bool JobSystem::steal(size_t index, Task &task) {
+		Deque &deque = *this->deques[index];
+		boost::mutex::scoped_lock lock(deque.mutex);
+		if (deque.tasks.empty()) {
+			return false;
+		}
+
+		task = deque.tasks.front();
+		deque.tasks.pop_front();
+		--this->queued;
+		return true;
+	}
+
+	size_t JobSystem::getDequeIndex() const {
+		size_t *index = this->dequeIndex.get();
+		return index ? *index : 0;
+	}
+
+	/*!
+	* @param index The index of the worker's deque
+	*/
+	void JobSystem::work(size_t index) {
+		PEEK_PROFILE_THREAD("jobs");
+		this->dequeIndex.reset(new size_t(index));
+
+		while (true) {
+			if (runOne(index)) {
+				continue;
+			}
+
+			boost::mutex::scoped_lock lock(this->wakeMutex);
+			while (!this->stopping && this->queued == 0) {
+				this->wakeCondition.wait(lock);
+			}
+			if (this->stopping) {
+				return;
+			}
+		}
+	}
+
+}
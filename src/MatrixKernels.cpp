@@ -0,0 +1,204 @@
+/**
+* @file MatrixKernels.cpp
+*/
+#include "MatrixKernels.hpp"
+#include "Simd.hpp"
+#include <boost/thread/once.hpp>
+
+#ifdef PEEK_X86_SIMD
+#  include <emmintrin.h>
+#  include <immintrin.h>
+#endif
+
+namespace peek {
+
+	namespace {
+
+		template <typename T>
+		void multiplyScalar(const T *a, const T *b, T *out) {
+			for (int col = 0; col < 4; col++) {
+				for (int row = 0; row < 4; row++) {
+					T sum = 0;
+					for (int k = 0; k < 4; k++) {
+						sum += a[k*4 + row] * b[col*4 + k];
+					}
+					out[col*4 + row] = sum;
+				}
+			}
+		}
+
+		void transformScalar(const double *m, const double *in, double *out, size_t count) {
+			for (size_t i = 0; i < count; i++, in += 4, out += 4) {
+				double x = in[0], y = in[1], z = in[2], h = in[3];
+				out[0] = x * m[0] + y * m[4] + z * m[8] + h * m[12];
+				out[1] = x * m[1] + y * m[5] + z * m[9] + h * m[13];
+				out[2] = x * m[2] + y * m[6] + z * m[10] + h * m[14];
+				out[3] = x * m[3] + y * m[7] + z * m[11] + h * m[15];
+			}
+		}
+
+#ifdef PEEK_X86_SIMD
+
+		/*
+		* Column j of a * b is the sum of the columns of a weighted by the
+		* elements of column j of b, so each output column is four broadcasts,
+		* four multiplies and three adds with no shuffling.
+		*/
+
+		void multiplySse2(const double *a, const double *b, double *out) {
+			__m128d a0l = _mm_loadu_pd(a), a0h = _mm_loadu_pd(a + 2);
+			__m128d a1l = _mm_loadu_pd(a + 4), a1h = _mm_loadu_pd(a + 6);
+			__m128d a2l = _mm_loadu_pd(a + 8), a2h = _mm_loadu_pd(a + 10);
+			__m128d a3l = _mm_loadu_pd(a + 12), a3h = _mm_loadu_pd(a + 14);
+
+			for (int col = 0; col < 4; col++) {
+				const double *c = b + col*4;
+				__m128d b0 = _mm_set1_pd(c[0]), b1 = _mm_set1_pd(c[1]), b2 = _mm_set1_pd(c[2]), b3 = _mm_set1_pd(c[3]);
+
+				__m128d low = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a0l, b0), _mm_mul_pd(a1l, b1)),
+					_mm_add_pd(_mm_mul_pd(a2l, b2), _mm_mul_pd(a3l, b3)));
+				__m128d high = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a0h, b0), _mm_mul_pd(a1h, b1)),
+					_mm_add_pd(_mm_mul_pd(a2h, b2), _mm_mul_pd(a3h, b3)));
+
+				_mm_storeu_pd(out + col*4, low);
+				_mm_storeu_pd(out + col*4 + 2, high);
+			}
+		}
+
+		void multiplySse(const float *a, const float *b, float *out) {
+			__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+
+			for (int col = 0; col < 4; col++) {
+				const float *c = b + col*4;
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(c[0])), _mm_mul_ps(a1, _mm_set1_ps(c[1]))),
+					_mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(c[2])), _mm_mul_ps(a3, _mm_set1_ps(c[3]))));
+				_mm_storeu_ps(out + col*4, sum);
+			}
+		}
+
+		PEEK_TARGET_AVX2 void multiplyAvx2(const double *a, const double *b, double *out) {
+			__m256d a0 = _mm256_loadu_pd(a), a1 = _mm256_loadu_pd(a + 4), a2 = _mm256_loadu_pd(a + 8), a3 = _mm256_loadu_pd(a + 12);
+
+			for (int col = 0; col < 4; col++) {
+				const double *c = b + col*4;
+				__m256d sum = _mm256_add_pd(
+					_mm256_add_pd(_mm256_mul_pd(a0, _mm256_broadcast_sd(c)), _mm256_mul_pd(a1, _mm256_broadcast_sd(c + 1))),
+					_mm256_add_pd(_mm256_mul_pd(a2, _mm256_broadcast_sd(c + 2)), _mm256_mul_pd(a3, _mm256_broadcast_sd(c + 3))));
+				_mm256_storeu_pd(out + col*4, sum);
+			}
+		}
+
+		void transformSse2(const double *m, const double *in, double *out, size_t count) {
+			__m128d m0l = _mm_loadu_pd(m), m0h = _mm_loadu_pd(m + 2);
+			__m128d m1l = _mm_loadu_pd(m + 4), m1h = _mm_loadu_pd(m + 6);
+			__m128d m2l = _mm_loadu_pd(m + 8), m2h = _mm_loadu_pd(m + 10);
+			__m128d m3l = _mm_loadu_pd(m + 12), m3h = _mm_loadu_pd(m + 14);
+
+			for (size_t i = 0; i < count; i++, in += 4, out += 4) {
+				__m128d x = _mm_set1_pd(in[0]), y = _mm_set1_pd(in[1]), z = _mm_set1_pd(in[2]), h = _mm_set1_pd(in[3]);
+
+				__m128d low = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0l, x), _mm_mul_pd(m1l, y)),
+					_mm_add_pd(_mm_mul_pd(m2l, z), _mm_mul_pd(m3l, h)));
+				__m128d high = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m0h, x), _mm_mul_pd(m1h, y)),
+					_mm_add_pd(_mm_mul_pd(m2h, z), _mm_mul_pd(m3h, h)));
+
+				_mm_storeu_pd(out, low);
+				_mm_storeu_pd(out + 2, high);
+			}
+		}
+
+		PEEK_TARGET_AVX2 void transformAvx2(const double *m, const double *in, double *out, size_t count) {
+			__m256d m0 = _mm256_loadu_pd(m), m1 = _mm256_loadu_pd(m + 4), m2 = _mm256_loadu_pd(m + 8), m3 = _mm256_loadu_pd(m + 12);
+			size_t i = 0;
+
+			// Two records per iteration keeps both multiply ports busy
+			for (; i + 2 <= count; i += 2, in += 8, out += 8) {
+				__m256d p = _mm256_add_pd(
+					_mm256_add_pd(_mm256_mul_pd(m0, _mm256_broadcast_sd(in)), _mm256_mul_pd(m1, _mm256_broadcast_sd(in + 1))),
+					_mm256_add_pd(_mm256_mul_pd(m2, _mm256_broadcast_sd(in + 2)), _mm256_mul_pd(m3, _mm256_broadcast_sd(in + 3))));
+				__m256d q = _mm256_add_pd(
+					_mm256_add_pd(_mm256_mul_pd(m0, _mm256_broadcast_sd(in + 4)), _mm256_mul_pd(m1, _mm256_broadcast_sd(in + 5))),
+					_mm256_add_pd(_mm256_mul_pd(m2, _mm256_broadcast_sd(in + 6)), _mm256_mul_pd(m3, _mm256_broadcast_sd(in + 7))));
+				_mm256_storeu_pd(out, p);
+				_mm256_storeu_pd(out + 4, q);
+			}
+
+			if (i < count) {
+				__m256d p = _mm256_add_pd(
+					_mm256_add_pd(_mm256_mul_pd(m0, _mm256_broadcast_sd(in)), _mm256_mul_pd(m1, _mm256_broadcast_sd(in + 1))),
+					_mm256_add_pd(_mm256_mul_pd(m2, _mm256_broadcast_sd(in + 2)), _mm256_mul_pd(m3, _mm256_broadcast_sd(in + 3))));
+				_mm256_storeu_pd(out, p);
+			}
+		}
+
+#endif
+
+		typedef void (*MultiplyDoubleKernel)(const double *a, const double *b, double *out);
+		typedef void (*MultiplyFloatKernel)(const float *a, const float *b, float *out);
+		typedef void (*TransformKernel)(const double *m, const double *in, double *out, size_t count);
+
+		/*
+		* The kernels are picked once, by whichever thread first multiplies or
+		* transforms, and the others wait for it.  The flag is constant-initialized,
+		* so this works even for matrices used during static initialization.
+		*/
+
+		boost::once_flag kernelsSelected = BOOST_ONCE_INIT;
+
+		MultiplyDoubleKernel multiplyDouble;
+		MultiplyFloatKernel multiplyFloat;
+		TransformKernel transform;
+
+		void selectKernels() {
+			multiplyDouble = multiplyScalar<double>;
+			multiplyFloat = multiplyScalar<float>;
+			transform = transformScalar;
+#ifdef PEEK_X86_SIMD
+			if (getSimdLevel() >= SIMD_AVX2) {
+				multiplyDouble = multiplyAvx2;
+				transform = transformAvx2;
+			}
+			else if (getSimdLevel() >= SIMD_SSE2) {
+				multiplyDouble = multiplySse2;
+				transform = transformSse2;
+			}
+			if (getSimdLevel() >= SIMD_SSE2) {
+				multiplyFloat = multiplySse;
+			}
+#endif
+		}
+
+	}
+
+	/*!
+	* @param a The left-hand matrix
+	* @param b The right-hand matrix
+	* @param out Receives the product
+	*/
+	void multiplyMatrices(const double *a, const double *b, double *out) {
+		boost::call_once(kernelsSelected, selectKernels);
+		multiplyDouble(a, b, out);
+	}
+
+	/*!
+	* @param a The left-hand matrix
+	* @param b The right-hand matrix
+	* @param out Receives the product
+	*/
+	void multiplyMatrices(const float *a, const float *b, float *out) {
+		boost::call_once(kernelsSelected, selectKernels);
+		multiplyFloat(a, b, out);
+	}
+
+	/*!
+	* @param m The matrix
+	* @param in The records to transform, four doubles each
+	* @param out Receives the transformed records
+	* @param count The number of records
+	*/
+	void transformHomogeneous(const double *m, const double *in, double *out, size_t count) {
+		boost::call_once(kernelsSelected, selectKernels);
+		transform(m, in, out, count);
+	}
+
+}
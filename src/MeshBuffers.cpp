@@ -0,0 +1,294 @@
+/**
+* @file MeshBuffers.cpp
+*/
+#include "Peek_base.hpp"
+#include "MeshBuffers.hpp"
+#include "GlExtensions.hpp"
+#include <algorithm>
+
+namespace peek {
+
+	/**
+	 * Whether or not each primitive of the given type can be concatenated with
+	 * the next into a single draw call.
+	 */
+	static bool isIndependentMode(GLenum mode) {
+		return mode == GL_TRIANGLES || mode == GL_QUADS;
+	}
+
+	/*!
+	*/
+	MeshBuffers::MeshBuffers() {
+		this->uploaded = false;
+		this->vertexCount = 0;
+		this->vertexBuffer = 0;
+		this->indexBuffer = 0;
+	}
+
+	/*!
+	*/
+	MeshBuffers::MeshBuffers(const MeshBuffers &) {
+		this->uploaded = false;
+		this->vertexCount = 0;
+		this->vertexBuffer = 0;
+		this->indexBuffer = 0;
+	}
+
+	/*!
+	*/
+	MeshBuffers::~MeshBuffers() {
+		release();
+	}
+
+	/*!
+	*/
+	MeshBuffers &MeshBuffers::operator=(const MeshBuffers &other) {
+		if (this != &other) {
+			release();
+		}
+		return *this;
+	}
+
+	/*!
+	* @param verts The vertices of the mesh
+	* @param normals The vertex normals of the mesh
+	* @param primitives The primitives of the mesh
+	*/
+	void MeshBuffers::upload(const Vertex3d::list &verts, const Normal3d::list &normals, const PrimitiveStreams &primitives) {
+		// Interleave the vertex attributes
+		vector<InterleavedVertex> vertices(verts.size());
+		for (Vertex3d::listIndex i = 0; i < verts.size(); i++) {
+			vertices[i].position[0] = (GLfloat) verts[i].x;
+			vertices[i].position[1] = (GLfloat) verts[i].y;
+			vertices[i].position[2] = (GLfloat) verts[i].z;
+			vertices[i].normal[0] = (GLfloat) normals[i].x;
+			vertices[i].normal[1] = (GLfloat) normals[i].y;
+			vertices[i].normal[2] = (GLfloat) normals[i].z;
+		}
+
+		// The streams are already grouped by type, so they are simply concatenated
+		const PrimitiveStreams::indexList *streams[] = {
+			&primitives.getTriangles(), &primitives.getQuads(),
+			&primitives.getTriangleStrips(), &primitives.getTriangleFans(), &primitives.getQuadStrips()
+		};
+		const PrimitiveStreams::indexList *starts[] = {
+			0, 0, &primitives.getTriangleStripStarts(), &primitives.getTriangleFanStarts(), &primitives.getQuadStripStarts()
+		};
+		const GLenum modes[] = { GL_TRIANGLES, GL_QUADS, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_QUAD_STRIP };
+		const size_t streamCount = sizeof(modes) / sizeof(modes[0]);
+
+		vector<GLuint> indices;
+		indices.reserve(primitives.getIndexCount());
+		size_t rangeStarts[streamCount];
+		for (size_t m = 0; m < streamCount; m++) {
+			rangeStarts[m] = indices.size();
+			indices.insert(indices.end(), streams[m]->begin(), streams[m]->end());
+		}
+
+		release();
+
+		const char *indexBase = 0;
+		if (haveBufferObjects()) {
+			pkGlGenBuffers(1, &this->vertexBuffer);
+			pkGlBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+			pkGlBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(InterleavedVertex),
+				vertices.empty() ? 0 : &vertices[0], GL_STATIC_DRAW);
+			pkGlBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			pkGlGenBuffers(1, &this->indexBuffer);
+			pkGlBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+			pkGlBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+				indices.empty() ? 0 : &indices[0], GL_STATIC_DRAW);
+			pkGlBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+		else {
+			this->clientVertices.swap(vertices);
+			this->clientIndices.swap(indices);
+			indexBase = this->clientIndices.empty() ? 0 : (const char *) &this->clientIndices[0];
+		}
+
+		// Record where each strip/fan lives in the index buffer
+		for (size_t m = 0; m < streamCount; m++) {
+			const PrimitiveStreams::indexList &stream = *streams[m];
+			if (stream.empty()) {
+				continue;
+			}
+
+			DrawRange range;
+			range.mode = modes[m];
+			range.minIndex = *std::min_element(stream.begin(), stream.end());
+			range.maxIndex = *std::max_element(stream.begin(), stream.end());
+
+			if (isIndependentMode(range.mode)) {
+				range.counts.push_back((GLsizei) stream.size());
+				range.offsets.push_back(indexBase + rangeStarts[m] * sizeof(GLuint));
+			}
+			else {
+				const PrimitiveStreams::indexList &runStarts = *starts[m];
+				for (size_t i = 0; i + 1 < runStarts.size(); i++) {
+					if (runStarts[i+1] > runStarts[i]) {
+						range.counts.push_back((GLsizei) (runStarts[i+1] - runStarts[i]));
+						range.offsets.push_back(indexBase + (rangeStarts[m] + runStarts[i]) * sizeof(GLuint));
+					}
+				}
+			}
+
+			this->ranges.push_back(range);
+		}
+
+		this->vertexCount = (GLsizei) verts.size();
+		this->uploaded = true;
+	}
+
+	/*!
+	*/
+	void MeshBuffers::release() {
+		if (this->vertexBuffer) {
+			pkGlDeleteBuffers(1, &this->vertexBuffer);
+			this->vertexBuffer = 0;
+		}
+
+		if (this->indexBuffer) {
+			pkGlDeleteBuffers(1, &this->indexBuffer);
+			this->indexBuffer = 0;
+		}
+
+		vector<InterleavedVertex>().swap(this->clientVertices);
+		vector<GLuint>().swap(this->clientIndices);
+		this->ranges.clear();
+		this->vertexCount = 0;
+		this->uploaded = false;
+	}
+
+	/*!
+	* @param withNormals Whether or not to supply the vertex normals
+	*/
+	void MeshBuffers::draw(bool withNormals) const {
+		if (!this->uploaded) {
+			return;
+		}
+
+		bind(withNormals);
+
+		for (vector<DrawRange>::const_iterator i = this->ranges.begin(); i != this->ranges.end(); ++i) {
+			drawRange(*i);
+		}
+
+		unbind();
+	}
+
+	/*!
+	* There is no instanced multi-draw, so each strip or fan is a call of its
+	* own; the instanced arrays must already be set up.
+	*
+	* @param instanceCount The number of instances to draw
+	*/
+	void MeshBuffers::drawInstanced(GLsizei instanceCount) const {
+		if (!this->uploaded || instanceCount <= 0) {
+			return;
+		}
+
+		bind(true);
+
+		for (vector<DrawRange>::const_iterator i = this->ranges.begin(); i != this->ranges.end(); ++i) {
+			for (size_t j = 0; j < i->counts.size(); j++) {
+				pkGlDrawElementsInstanced(i->mode, i->counts[j], GL_UNSIGNED_INT, i->offsets[j], instanceCount);
+			}
+		}
+
+		unbind();
+	}
+
+	/*!
+	*/
+	void MeshBuffers::drawPoints() const {
+		if (!this->uploaded) {
+			return;
+		}
+
+		bind(false);
+		glDrawArrays(GL_POINTS, 0, this->vertexCount);
+		unbind();
+	}
+
+	/*!
+	* @return The number of draw calls issued by draw()
+	*/
+	unsigned int MeshBuffers::getDrawCallCount() const {
+		unsigned int drawCalls = 0;
+
+		for (vector<DrawRange>::const_iterator i = this->ranges.begin(); i != this->ranges.end(); ++i) {
+			drawCalls += (pkGlMultiDrawElements || i->counts.size() == 1) ? 1 : (unsigned int) i->counts.size();
+		}
+
+		return drawCalls;
+	}
+
+	/*!
+	* @return The number of draw calls issued by drawInstanced()
+	*/
+	unsigned int MeshBuffers::getInstancedDrawCallCount() const {
+		unsigned int drawCalls = 0;
+
+		for (vector<DrawRange>::const_iterator i = this->ranges.begin(); i != this->ranges.end(); ++i) {
+			drawCalls += (unsigned int) i->counts.size();
+		}
+
+		return drawCalls;
+	}
+
+	/*!
+	* @param withNormals Whether or not to enable the normal array
+	*/
+	void MeshBuffers::bind(bool withNormals) const {
+		const char *vertexBase = 0;
+
+		if (this->vertexBuffer) {
+			pkGlBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+			pkGlBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+		}
+		else if (!this->clientVertices.empty()) {
+			vertexBase = (const char *) &this->clientVertices[0];
+		}
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, sizeof(InterleavedVertex), vertexBase);
+
+		if (withNormals) {
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glNormalPointer(GL_FLOAT, sizeof(InterleavedVertex), vertexBase + sizeof(GLfloat[3]));
+		}
+	}
+
+	/*!
+	*/
+	void MeshBuffers::unbind() const {
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		if (this->vertexBuffer) {
+			pkGlBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			pkGlBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+	/*!
+	* @param range The range to draw
+	*/
+	void MeshBuffers::drawRange(const DrawRange &range) const {
+		if (range.counts.size() > 1 && pkGlMultiDrawElements) {
+			pkGlMultiDrawElements(range.mode, &range.counts[0], GL_UNSIGNED_INT, &range.offsets[0], (GLsizei) range.counts.size());
+			return;
+		}
+
+		for (size_t i = 0; i < range.counts.size(); i++) {
+			if (pkGlDrawRangeElements) {
+				pkGlDrawRangeElements(range.mode, range.minIndex, range.maxIndex, range.counts[i], GL_UNSIGNED_INT, range.offsets[i]);
+			}
+			else {
+				glDrawElements(range.mode, range.counts[i], GL_UNSIGNED_INT, range.offsets[i]);
+			}
+		}
+	}
+
+}
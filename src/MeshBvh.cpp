@@ -0,0 +1,431 @@
+/**
+* @file MeshBvh.cpp
+*/
+#include "Peek_base.hpp"
+#include "MeshBvh.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace peek {
+
+	namespace {
+
+		/** The number of bins the heuristic evaluates along each axis */
+		const unsigned int binCount = 16;
+
+		/** The most triangles a leaf may have when a split would be cheaper */
+		const unsigned int maxLeafSize = 8;
+
+		/** The most levels the hierarchy may have, which bounds the traversal stack */
+		const unsigned int maxDepth = 64;
+
+		/** The cost of visiting a node, relative to testing a triangle */
+		const double traversalCost = 1.0;
+
+		/** An axis-aligned box as plain arrays, which the build works with a great deal */
+		struct Bounds {
+			double low[3];
+			double high[3];
+
+			Bounds() {
+				for (int axis = 0; axis < 3; axis++) {
+					this->low[axis] = std::numeric_limits<double>::infinity();
+					this->high[axis] = -std::numeric_limits<double>::infinity();
+				}
+			}
+
+			inline void grow(const Point3d &p) {
+				const double c[3] = { p.x, p.y, p.z };
+				for (int axis = 0; axis < 3; axis++) {
+					this->low[axis] = std::min(this->low[axis], c[axis]);
+					this->high[axis] = std::max(this->high[axis], c[axis]);
+				}
+			}
+
+			inline void grow(const Bounds &b) {
+				for (int axis = 0; axis < 3; axis++) {
+					this->low[axis] = std::min(this->low[axis], b.low[axis]);
+					this->high[axis] = std::max(this->high[axis], b.high[axis]);
+				}
+			}
+
+			/** Half the surface area, which is all the heuristic needs; zero if empty */
+			inline double area() const {
+				double dx = this->high[0] - this->low[0], dy = this->high[1] - this->low[1], dz = this->high[2] - this->low[2];
+				if (dx < 0.0 || dy < 0.0 || dz < 0.0) {
+					return 0.0;
+				}
+				return dx*dy + dy*dz + dz*dx;
+			}
+		};
+
+		/** A range of triangles waiting to be split, and the node they belong to */
+		struct BuildTask {
+			size_t node;
+			size_t begin;
+			size_t end;
+			unsigned int depth;
+		};
+
+		/** Tells whether a triangle's centroid falls in the bins left of a split */
+		struct LeftOfSplit {
+			const std::vector<double> &centroids;
+			int axis;
+			double low;
+			double scale;
+			unsigned int split;
+
+			LeftOfSplit(const std::vector<double> &centroids, int axis, double low, double scale, unsigned int split)
+				: centroids(centroids), axis(axis), low(low), scale(scale), split(split) {}
+
+			inline bool operator()(boost::uint32_t t) const {
+				return binOf(this->centroids[3*t + this->axis], this->low, this->scale) <= this->split;
+			}
+
+			static inline unsigned int binOf(double c, double low, double scale) {
+				unsigned int bin = (unsigned int) ((c - low) * scale);
+				return std::min(bin, binCount - 1);
+			}
+		};
+
+		/** Finds the range of ray parameters inside a box, given the reciprocal of the direction */
+		inline bool enterBox(const double *low, const double *high, const double *origin, const double *direction, const double *inverse, double tMax, double &tEnter) {
+			double tNear = 0.0, tFar = tMax;
+			for (int axis = 0; axis < 3; axis++) {
+				if (direction[axis] == 0.0) {
+					if (origin[axis] < low[axis] || origin[axis] > high[axis]) {
+						return false;
+					}
+					continue;
+				}
+
+				double t0 = (low[axis] - origin[axis]) * inverse[axis];
+				double t1 = (high[axis] - origin[axis]) * inverse[axis];
+				if (t0 > t1) {
+					std::swap(t0, t1);
+				}
+				tNear = std::max(tNear, t0);
+				tFar = std::min(tFar, t1);
+				if (tNear > tFar) {
+					return false;
+				}
+			}
+
+			tEnter = tNear;
+			return true;
+		}
+
+	}
+
+	struct MeshBvh::TriangleCollector {
+		std::vector<Triangle> &triangles;
+		boost::uint32_t face;
+
+		TriangleCollector(std::vector<Triangle> &triangles) : triangles(triangles), face(0) {}
+
+		inline void add(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2) {
+			Triangle t;
+			t.v[0] = v0;
+			t.v[1] = v1;
+			t.v[2] = v2;
+			t.face = this->face;
+			this->triangles.push_back(t);
+		}
+
+		inline void triangle(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2) {
+			add(v0, v1, v2);
+			this->face++;
+		}
+
+		inline void quad(PrimitiveStreams::index v0, PrimitiveStreams::index v1, PrimitiveStreams::index v2, PrimitiveStreams::index v3) {
+			add(v0, v1, v2);
+			add(v0, v2, v3);
+			this->face++;
+		}
+	};
+
+	/*!
+	* @param verts The vertices of the mesh
+	* @param primitives The faces of the mesh
+	*/
+	MeshBvh::MeshBvh(const Vertex3d::list &verts, const PrimitiveStreams &primitives) : depth(0) {
+		this->triangles.reserve(primitives.getFaceCount());
+		TriangleCollector collector(this->triangles);
+		primitives.visitFaces(collector);
+
+		build(verts);
+	}
+
+	/*!
+	* The triangles' bounds and centroids are found once, up front; the build
+	* then only shuffles a list of triangle indices, and puts the triangles
+	* themselves in that order at the end.
+	*
+	* @param verts The vertices of the mesh
+	*/
+	void MeshBvh::build(const Vertex3d::list &verts) {
+		size_t count = this->triangles.size();
+		if (count == 0) {
+			return;
+		}
+
+		std::vector<Bounds> triangleBounds(count);
+		std::vector<double> centroids(3 * count);
+		std::vector<boost::uint32_t> order(count);
+		for (size_t t = 0; t < count; t++) {
+			Bounds &b = triangleBounds[t];
+			for (int k = 0; k < 3; k++) {
+				b.grow(verts[this->triangles[t].v[k]]);
+			}
+			for (int axis = 0; axis < 3; axis++) {
+				centroids[3*t + axis] = 0.5 * (b.low[axis] + b.high[axis]);
+			}
+			order[t] = (boost::uint32_t) t;
+		}
+
+		this->nodes.reserve(2 * count);
+		this->nodes.push_back(Node());
+		this->depth = 1;
+
+		std::vector<BuildTask> tasks;
+		BuildTask root = { 0, 0, count, 1 };
+		tasks.push_back(root);
+
+		while (!tasks.empty()) {
+			BuildTask task = tasks.back();
+			tasks.pop_back();
+
+			size_t n = task.end - task.begin;
+			this->depth = std::max(this->depth, task.depth);
+
+			Bounds bounds, centroidBounds;
+			for (size_t i = task.begin; i < task.end; i++) {
+				boost::uint32_t t = order[i];
+				bounds.grow(triangleBounds[t]);
+				centroidBounds.grow(Point3d(centroids[3*t], centroids[3*t + 1], centroids[3*t + 2]));
+			}
+
+			Node &node = this->nodes[task.node];
+			std::copy(bounds.low, bounds.low + 3, node.low);
+			std::copy(bounds.high, bounds.high + 3, node.high);
+			node.first = (boost::uint32_t) task.begin;
+			node.count = (boost::uint32_t) n;
+
+			if (n <= 2 || task.depth >= maxDepth) {
+				continue;
+			}
+
+			// Evaluate a split after each bin along each axis
+			double bestCost = std::numeric_limits<double>::infinity();
+			int bestAxis = -1;
+			unsigned int bestSplit = 0;
+			for (int axis = 0; axis < 3; axis++) {
+				double extent = centroidBounds.high[axis] - centroidBounds.low[axis];
+				if (extent <= 0.0) {
+					continue;
+				}
+				double scale = binCount / extent;
+
+				Bounds binBounds[binCount];
+				size_t binCounts[binCount] = { 0 };
+				for (size_t i = task.begin; i < task.end; i++) {
+					boost::uint32_t t = order[i];
+					unsigned int bin = LeftOfSplit::binOf(centroids[3*t + axis], centroidBounds.low[axis], scale);
+					binBounds[bin].grow(triangleBounds[t]);
+					binCounts[bin]++;
+				}
+
+				// Sweep from the right to get the cost of everything after each split...
+				double rightCosts[binCount];
+				Bounds right;
+				size_t rightCount = 0;
+				for (unsigned int bin = binCount - 1; bin > 0; bin--) {
+					right.grow(binBounds[bin]);
+					rightCount += binCounts[bin];
+					rightCosts[bin - 1] = (rightCount ? right.area() * rightCount : -1.0);
+				}
+
+				// ...then from the left, adding the cost of everything before it
+				Bounds left;
+				size_t leftCount = 0;
+				for (unsigned int split = 0; split + 1 < binCount; split++) {
+					left.grow(binBounds[split]);
+					leftCount += binCounts[split];
+					if (leftCount == 0 || rightCosts[split] < 0.0) {
+						continue;
+					}
+
+					double cost = left.area() * leftCount + rightCosts[split];
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = split;
+					}
+				}
+			}
+
+			size_t middle;
+			if (bestAxis >= 0) {
+				double area = bounds.area();
+				bestCost = traversalCost + (area > 0.0 ? bestCost / area : 0.0);
+				if (bestCost >= n && n <= maxLeafSize) {
+					continue;
+				}
+
+				double low = centroidBounds.low[bestAxis];
+				double scale = binCount / (centroidBounds.high[bestAxis] - low);
+				middle = std::partition(order.begin() + task.begin, order.begin() + task.end,
+					LeftOfSplit(centroids, bestAxis, low, scale, bestSplit)) - order.begin();
+			}
+			else if (n > maxLeafSize) {
+				// Every centroid is in the same place, so any split is as good as another
+				middle = task.begin + n / 2;
+			}
+			else {
+				continue;
+			}
+
+			size_t first = this->nodes.size();
+			this->nodes.push_back(Node());
+			this->nodes.push_back(Node());
+
+			// Adding the children may have moved the nodes, so look the parent up again
+			Node &parent = this->nodes[task.node];
+			parent.first = (boost::uint32_t) first;
+			parent.count = 0;
+
+			BuildTask leftTask = { first, task.begin, middle, task.depth + 1 };
+			BuildTask rightTask = { first + 1, middle, task.end, task.depth + 1 };
+			tasks.push_back(rightTask);
+			tasks.push_back(leftTask);
+		}
+
+		std::vector<Triangle> ordered(count);
+		for (size_t i = 0; i < count; i++) {
+			ordered[i] = this->triangles[order[i]];
+		}
+		this->triangles.swap(ordered);
+	}
+
+	/*!
+	* Nodes are visited nearest first, and a node is skipped if the ray only
+	* reaches it beyond the nearest hit so far.  Triangles are hit from
+	* either side.
+	*
+	* @param verts The vertices the hierarchy was built from
+	* @param ray The ray, in the mesh's own space
+	* @param hit The nearest hit so far, which is replaced if a nearer face is hit
+	* @return Whether or not a nearer face was hit
+	*/
+	bool MeshBvh::intersect(const Vertex3d::list &verts, const Ray &ray, RayHit &hit) const {
+		if (this->nodes.empty()) {
+			return false;
+		}
+
+		const double origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+		const double direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+		double inverse[3];
+		for (int axis = 0; axis < 3; axis++) {
+			inverse[axis] = (direction[axis] != 0.0 ? 1.0 / direction[axis] : 0.0);
+		}
+
+		boost::uint32_t stack[maxDepth];
+		unsigned int top = 0;
+		bool found = false;
+
+		double tEnter;
+		const Node *node = &this->nodes[0];
+		if (!enterBox(node->low, node->high, origin, direction, inverse, hit.distance, tEnter)) {
+			return false;
+		}
+
+		for (;;) {
+			if (node->count) {
+				for (size_t i = node->first; i < node->first + node->count; i++) {
+					const Triangle &tri = this->triangles[i];
+					const Point3d &p0 = verts[tri.v[0]], &p1 = verts[tri.v[1]], &p2 = verts[tri.v[2]];
+
+					// Möller-Trumbore
+					double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+					double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+					double p[3] = {
+						direction[1]*e2[2] - direction[2]*e2[1],
+						direction[2]*e2[0] - direction[0]*e2[2],
+						direction[0]*e2[1] - direction[1]*e2[0]
+					};
+					double det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+					if (det == 0.0) {
+						continue;
+					}
+					double invDet = 1.0 / det;
+
+					double s[3] = { origin[0] - p0.x, origin[1] - p0.y, origin[2] - p0.z };
+					double u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * invDet;
+					if (u < 0.0 || u > 1.0) {
+						continue;
+					}
+
+					double q[3] = {
+						s[1]*e1[2] - s[2]*e1[1],
+						s[2]*e1[0] - s[0]*e1[2],
+						s[0]*e1[1] - s[1]*e1[0]
+					};
+					double v = (direction[0]*q[0] + direction[1]*q[1] + direction[2]*q[2]) * invDet;
+					if (v < 0.0 || u + v > 1.0) {
+						continue;
+					}
+
+					double t = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * invDet;
+					if (t < 0.0 || t >= hit.distance) {
+						continue;
+					}
+
+					hit.distance = t;
+					hit.primitive = tri.face;
+					std::copy(tri.v, tri.v + 3, hit.vertices);
+					hit.barycentrics[0] = 1.0 - u - v;
+					hit.barycentrics[1] = u;
+					hit.barycentrics[2] = v;
+					found = true;
+				}
+			}
+			else {
+				const Node *a = &this->nodes[node->first], *b = a + 1;
+				double ta, tb;
+				bool hitA = enterBox(a->low, a->high, origin, direction, inverse, hit.distance, ta);
+				bool hitB = enterBox(b->low, b->high, origin, direction, inverse, hit.distance, tb);
+
+				if (hitA && hitB) {
+					if (tb < ta) {
+						std::swap(a, b);
+					}
+					stack[top++] = (boost::uint32_t) (b - &this->nodes[0]);
+					node = a;
+					continue;
+				}
+				else if (hitA) {
+					node = a;
+					continue;
+				}
+				else if (hitB) {
+					node = b;
+					continue;
+				}
+			}
+
+			// Take the next node off the stack, skipping any that are now beyond the nearest hit
+			for (node = NULL; top > 0 && !node; ) {
+				const Node *next = &this->nodes[stack[--top]];
+				if (enterBox(next->low, next->high, origin, direction, inverse, hit.distance, tEnter)) {
+					node = next;
+				}
+			}
+			if (!node) {
+				break;
+			}
+		}
+
+		return found;
+	}
+
+}
@@ -0,0 +1,445 @@
+/**
+* @file MeshOptimizer.cpp
+*/
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace peek {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** Marks a vertex that has not been given a place yet */
+		const vertexIndex none = 0xffffffff;
+
+		/**
+		* A first-in, first-out post-transform cache.  Each vertex remembers
+		* when it was last transformed; it is still in the cache if fewer than
+		* size vertices have been transformed since.
+		*/
+		struct FifoCache {
+			vector<unsigned int> times;
+			unsigned int size;
+			unsigned int now;
+
+			FifoCache(size_t vertexCount, unsigned int size) : times(vertexCount, 0), size(size), now(size + 1) {}
+
+			/** Uses a vertex, returning whether it had to be transformed */
+			inline bool access(vertexIndex v) {
+				if (this->now - this->times[v] > this->size) {
+					this->times[v] = this->now++;
+					return true;
+				}
+				return false;
+			}
+
+			/** Empties the cache */
+			inline void flush() {
+				this->now += this->size + 1;
+			}
+		};
+
+		/** Gets the index streams in the order MeshBuffers draws them */
+		void getDrawOrder(const PrimitiveStreams &primitives, const PrimitiveStreams::indexList *streams[5]) {
+			streams[0] = &primitives.getTriangles();
+			streams[1] = &primitives.getQuads();
+			streams[2] = &primitives.getTriangleStrips();
+			streams[3] = &primitives.getTriangleFans();
+			streams[4] = &primitives.getQuadStrips();
+		}
+
+		/** Counts the triangles of a set of streams, two to each quadrilateral */
+		struct TriangleCounter {
+			size_t triangles;
+
+			TriangleCounter() : triangles(0) {}
+
+			inline void triangle(vertexIndex, vertexIndex, vertexIndex) {
+				this->triangles++;
+			}
+
+			inline void quad(vertexIndex, vertexIndex, vertexIndex, vertexIndex) {
+				this->triangles += 2;
+			}
+		};
+
+		/**
+		* Puts faces of the given number of corners in vertex cache order with
+		* Tipsy.  The faces' new order goes in order, and the start of each
+		* run between jumps, plus a final end, in boundaries.
+		*/
+		void cacheOrder(const vertexIndex *v, size_t faceCount, int corners, size_t vertexCount, unsigned int cacheSize,
+			vector<vertexIndex> &order, vector<size_t> &boundaries) {
+			// List the faces around each vertex
+			vector<vertexIndex> starts(vertexCount + 1, 0), adjacency(faceCount * corners);
+			for (size_t i = 0; i < faceCount * corners; i++) {
+				starts[v[i] + 1]++;
+			}
+			for (size_t i = 0; i < vertexCount; i++) {
+				starts[i + 1] += starts[i];
+			}
+			vector<vertexIndex> fill(starts.begin(), starts.end() - 1);
+			for (size_t i = 0; i < faceCount * corners; i++) {
+				adjacency[fill[v[i]]++] = (vertexIndex) (i / corners);
+			}
+
+			// The number of faces still to be drawn around each vertex
+			vector<vertexIndex> live(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++) {
+				live[i] = starts[i + 1] - starts[i];
+			}
+
+			vector<unsigned int> cacheTimes(vertexCount, 0);
+			unsigned int timestamp = cacheSize + 1;
+			vector<char> emitted(faceCount, 0);
+			vector<vertexIndex> deadEnd, candidates;
+			size_t cursor = 0;
+
+			order.clear();
+			order.reserve(faceCount);
+			boundaries.assign(1, 0);
+
+			vertexIndex fanning = none;
+			while (cursor < vertexCount && live[cursor] == 0) {
+				cursor++;
+			}
+			if (cursor < vertexCount) {
+				fanning = (vertexIndex) cursor;
+			}
+
+			while (fanning != none) {
+				// Draw every face left around the fanning vertex
+				candidates.clear();
+				for (vertexIndex a = starts[fanning]; a < starts[fanning + 1]; a++) {
+					vertexIndex face = adjacency[a];
+					if (emitted[face]) {
+						continue;
+					}
+					emitted[face] = 1;
+					order.push_back(face);
+
+					for (int c = 0; c < corners; c++) {
+						vertexIndex w = v[face * corners + c];
+						deadEnd.push_back(w);
+						candidates.push_back(w);
+						live[w]--;
+						if (timestamp - cacheTimes[w] > cacheSize) {
+							cacheTimes[w] = timestamp++;
+						}
+					}
+				}
+
+				// Move to the neighbour that will be in the cache longest, if its faces can be drawn before it leaves;
+				// one whose faces cannot be is no better than a jump
+				fanning = none;
+				long best = 0;
+				for (size_t i = 0; i < candidates.size(); i++) {
+					vertexIndex w = candidates[i];
+					if (live[w] == 0) {
+						continue;
+					}
+					long priority = 0;
+					unsigned int age = timestamp - cacheTimes[w];
+					if (age + 2 * live[w] <= cacheSize) {
+						priority = age;
+					}
+					if (priority > best) {
+						best = priority;
+						fanning = w;
+					}
+				}
+
+				// Otherwise jump to the most recently used vertex with faces left, or failing that the next one
+				if (fanning == none) {
+					while (!deadEnd.empty()) {
+						vertexIndex w = deadEnd.back();
+						deadEnd.pop_back();
+						if (live[w] > 0) {
+							fanning = w;
+							break;
+						}
+					}
+					if (fanning == none) {
+						while (cursor < vertexCount && live[cursor] == 0) {
+							cursor++;
+						}
+						if (cursor < vertexCount) {
+							fanning = (vertexIndex) cursor;
+						}
+					}
+					if (fanning != none) {
+						boundaries.push_back(order.size());
+					}
+				}
+			}
+
+			boundaries.push_back(order.size());
+		}
+
+		/** Gets a face's centroid, and its normal scaled by twice its area */
+		void faceGeometry(const Vertex3d::list &verts, const vertexIndex *v, int corners, double centroid[3], double normal[3]) {
+			centroid[0] = centroid[1] = centroid[2] = 0;
+			for (int c = 0; c < corners; c++) {
+				const Vertex3d &p = verts[v[c]];
+				centroid[0] += p.x / corners;
+				centroid[1] += p.y / corners;
+				centroid[2] += p.z / corners;
+			}
+
+			// Edges of a triangle, diagonals of a quadrilateral
+			const Vertex3d &a = verts[v[0]], &b = verts[v[1]], &c = verts[v[2]];
+			double ux, uy, uz, wx, wy, wz;
+			if (corners == 4) {
+				const Vertex3d &d = verts[v[3]];
+				ux = c.x - a.x; uy = c.y - a.y; uz = c.z - a.z;
+				wx = d.x - b.x; wy = d.y - b.y; wz = d.z - b.z;
+			}
+			else {
+				ux = b.x - a.x; uy = b.y - a.y; uz = b.z - a.z;
+				wx = c.x - a.x; wy = c.y - a.y; wz = c.z - a.z;
+			}
+			normal[0] = uy * wz - uz * wy;
+			normal[1] = uz * wx - ux * wz;
+			normal[2] = ux * wy - uy * wx;
+		}
+
+		/** A run of faces drawn together, and how far it faces out from the mesh's centre */
+		struct Cluster {
+			size_t begin, end;
+			double outwardness;
+
+			inline bool operator<(const Cluster &other) const {
+				return this->outwardness > other.outwardness;
+			}
+		};
+
+		/**
+		* Cuts faces in cache order into clusters, and sorts the clusters so
+		* those facing furthest out are drawn first.
+		*/
+		void overdrawOrder(const Vertex3d::list &verts, const vertexIndex *v, int corners, unsigned int cacheSize, double threshold,
+			const vector<size_t> &boundaries, vector<vertexIndex> &order) {
+			size_t faceCount = order.size();
+			double trianglesPerFace = corners - 2;
+
+			FifoCache cache(verts.size(), cacheSize);
+			size_t misses = 0;
+			for (size_t i = 0; i < faceCount; i++) {
+				for (int c = 0; c < corners; c++) {
+					misses += cache.access(v[order[i] * corners + c]);
+				}
+			}
+			double limit = threshold * misses / (faceCount * trianglesPerFace);
+
+			// Cut each run between jumps wherever its own miss ratio has come down far enough
+			vector<Cluster> clusters;
+			for (size_t b = 0; b + 1 < boundaries.size(); b++) {
+				size_t begin = boundaries[b], end = boundaries[b + 1];
+				if (begin == end) {
+					continue;
+				}
+
+				cache.flush();
+				size_t clusterMisses = 0;
+				Cluster cluster = { begin, end, 0 };
+				for (size_t i = begin; i < end; i++) {
+					for (int c = 0; c < corners; c++) {
+						clusterMisses += cache.access(v[order[i] * corners + c]);
+					}
+					if (i + 1 < end && clusterMisses <= limit * (i + 1 - cluster.begin) * trianglesPerFace) {
+						cluster.end = i + 1;
+						clusters.push_back(cluster);
+						cluster.begin = i + 1;
+						cache.flush();
+						clusterMisses = 0;
+					}
+				}
+				cluster.end = end;
+				clusters.push_back(cluster);
+			}
+
+			// Find the centre of the mesh, weighting each face by its area
+			vector<double> centroids(3 * faceCount), normals(3 * faceCount);
+			double centre[3] = { 0, 0, 0 }, totalArea = 0;
+			for (size_t f = 0; f < faceCount; f++) {
+				double *centroid = &centroids[3 * f], *normal = &normals[3 * f];
+				faceGeometry(verts, v + f * corners, corners, centroid, normal);
+				double area = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				for (int k = 0; k < 3; k++) {
+					centre[k] += centroid[k] * area;
+				}
+				totalArea += area;
+			}
+			for (int k = 0; k < 3; k++) {
+				centre[k] = (totalArea > 0 ? centre[k] / totalArea : 0);
+			}
+
+			for (size_t k = 0; k < clusters.size(); k++) {
+				Cluster &cluster = clusters[k];
+				double centroid[3] = { 0, 0, 0 }, normal[3] = { 0, 0, 0 }, area = 0;
+				for (size_t i = cluster.begin; i < cluster.end; i++) {
+					const double *faceCentroid = &centroids[3 * order[i]], *faceNormal = &normals[3 * order[i]];
+					double faceArea = sqrt(faceNormal[0] * faceNormal[0] + faceNormal[1] * faceNormal[1] + faceNormal[2] * faceNormal[2]);
+					for (int j = 0; j < 3; j++) {
+						centroid[j] += faceCentroid[j] * faceArea;
+						normal[j] += faceNormal[j];
+					}
+					area += faceArea;
+				}
+
+				double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				cluster.outwardness = 0;
+				if (area > 0 && length > 0) {
+					for (int j = 0; j < 3; j++) {
+						cluster.outwardness += (centroid[j] / area - centre[j]) * normal[j] / length;
+					}
+				}
+			}
+
+			std::stable_sort(clusters.begin(), clusters.end());
+
+			vector<vertexIndex> sorted;
+			sorted.reserve(faceCount);
+			for (size_t k = 0; k < clusters.size(); k++) {
+				sorted.insert(sorted.end(), order.begin() + clusters[k].begin, order.begin() + clusters[k].end);
+			}
+			order.swap(sorted);
+		}
+
+	}
+
+	MeshOptimizer::MeshOptimizer() {
+		this->cacheSize = 16;
+		this->overdrawThreshold = 1.05;
+		this->fetchReordering = true;
+	}
+
+	/*!
+	* @param verts The mesh's vertices, which are reordered
+	* @param normals The mesh's vertex normals, which are reordered with the vertices
+	* @param primitives The mesh's faces, whose triangles and quadrilaterals are reordered and whose indices are remapped
+	* @param before The cache before optimizing, if not NULL
+	* @param after The cache after optimizing, if not NULL
+	*/
+	void MeshOptimizer::optimize(Vertex3d::list &verts, Normal3d::list &normals, PrimitiveStreams &primitives,
+		VertexCacheStats *before, VertexCacheStats *after) const {
+		if (before) {
+			*before = measure(primitives);
+		}
+
+		// Reorder the faces of each independent stream
+		for (int corners = 3; corners <= 4; corners++) {
+			const PrimitiveStreams::indexList &stream = (corners == 3 ? primitives.getTriangles() : primitives.getQuads());
+			size_t faceCount = stream.size() / corners;
+			if (faceCount == 0) {
+				continue;
+			}
+
+			vector<vertexIndex> order;
+			vector<size_t> boundaries;
+			cacheOrder(&stream[0], faceCount, corners, verts.size(), this->cacheSize, order, boundaries);
+			if (this->overdrawThreshold > 0) {
+				overdrawOrder(verts, &stream[0], corners, this->cacheSize, this->overdrawThreshold, boundaries, order);
+			}
+
+			PrimitiveStreams::indexList reordered;
+			reordered.reserve(faceCount * corners);
+			for (size_t i = 0; i < faceCount; i++) {
+				reordered.insert(reordered.end(), stream.begin() + order[i] * corners, stream.begin() + (order[i] + 1) * corners);
+			}
+
+			if (corners == 3) {
+				primitives.swapTriangles(reordered);
+			}
+			else {
+				primitives.swapQuads(reordered);
+			}
+		}
+
+		// Number the vertices in the order they are first drawn
+		if (this->fetchReordering) {
+			const PrimitiveStreams::indexList *streams[5];
+			getDrawOrder(primitives, streams);
+
+			PrimitiveStreams::indexList map(verts.size(), none);
+			vertexIndex next = 0;
+			for (int s = 0; s < 5; s++) {
+				for (size_t i = 0; i < streams[s]->size(); i++) {
+					vertexIndex v = (*streams[s])[i];
+					if (map[v] == none) {
+						map[v] = next++;
+					}
+				}
+			}
+			for (size_t i = 0; i < map.size(); i++) {
+				if (map[i] == none) {
+					map[i] = next++;
+				}
+			}
+
+			Vertex3d::list reorderedVerts(verts.size());
+			for (size_t i = 0; i < verts.size(); i++) {
+				reorderedVerts[map[i]] = verts[i];
+			}
+			verts.swap(reorderedVerts);
+
+			if (normals.size() == map.size()) {
+				Normal3d::list reorderedNormals(normals.size());
+				for (size_t i = 0; i < normals.size(); i++) {
+					reorderedNormals[map[i]] = normals[i];
+				}
+				normals.swap(reorderedNormals);
+			}
+
+			primitives.remap(map);
+		}
+
+		if (after) {
+			*after = measure(primitives);
+		}
+	}
+
+	/*!
+	* The streams are taken in the order MeshBuffers draws them, each index
+	* once, as the GPU would see them.
+	*
+	* @param primitives The streams to draw
+	* @return The counts of triangles, vertices and transforms
+	*/
+	VertexCacheStats MeshOptimizer::measure(const PrimitiveStreams &primitives) const {
+		VertexCacheStats stats;
+		stats.cacheSize = this->cacheSize;
+
+		TriangleCounter counter;
+		primitives.visitFaces(counter);
+		stats.triangles = counter.triangles;
+
+		const PrimitiveStreams::indexList *streams[5];
+		getDrawOrder(primitives, streams);
+
+		size_t vertexCount = 0;
+		for (int s = 0; s < 5; s++) {
+			for (size_t i = 0; i < streams[s]->size(); i++) {
+				vertexCount = std::max(vertexCount, (size_t) (*streams[s])[i] + 1);
+			}
+		}
+
+		FifoCache cache(vertexCount, this->cacheSize);
+		vector<char> used(vertexCount, 0);
+		for (int s = 0; s < 5; s++) {
+			for (size_t i = 0; i < streams[s]->size(); i++) {
+				vertexIndex v = (*streams[s])[i];
+				stats.transforms += cache.access(v);
+				if (!used[v]) {
+					used[v] = 1;
+					stats.vertices++;
+				}
+			}
+		}
+
+		return stats;
+	}
+
+}
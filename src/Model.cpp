@@ -3,9 +3,11 @@
 */
 #include "Peek_base.hpp"
 #include "Model.hpp"
+#include "Profiler.hpp"
 
 /* Implementation dependencies */
 #include <iostream>
+#include <algorithm>
 
 namespace peek {
 
@@ -16,10 +18,12 @@ namespace peek {
 		this->showNormals = false;
 
 		this->normalScale = 0.25;
+		this->worldBoundingBoxDirty = true;
 	}
 
 	/** Draws the model */
 	void Model::draw() const {
+		PEEK_PROFILE_SCOPE("Model::draw");
 		glPushMatrix();
 		transformModelviewMatrix();
 
@@ -71,6 +75,38 @@ namespace peek {
 		glPopMatrix();
 	}
 
+	/** Queues the meshes to be drawn in each pass the display toggles call for, as draw() would draw them */
+	void Model::enqueue(RenderQueue &queue) const {
+		enqueue(queue, &getTransformMatrix(), getWorldBoundingBox().getCenter());
+	}
+
+	/** Queues the meshes as enqueue(queue) does, placed by a matrix that outlives the frame in place of the model's own transformation */
+	void Model::enqueue(RenderQueue &queue, const Matrix<double> *modelWorldMatrix, const Point3d &worldCenter) const {
+		enqueue(queue, getDisplayToggles(), meshes.begin(), meshes.end(), modelWorldMatrix, worldCenter);
+	}
+
+	/** Queues meshes in each pass a set of display toggles calls for, so a copy of a model can be queued without the model */
+	void Model::enqueue(RenderQueue &queue, const DisplayToggles &toggles, SmoothMesh::list::const_iterator first,
+		SmoothMesh::list::const_iterator last, const Matrix<double> *modelWorldMatrix, const Point3d &worldCenter) {
+		// Outlines drawn over solid geometry are unlit and plain, and push the solid geometry back
+		unsigned int solidState = RenderQueue::STATE_LIGHTING | RenderQueue::STATE_CULL_FACE | RenderQueue::STATE_MATERIAL
+			| (toggles.showWireframe ? RenderQueue::STATE_POLYGON_OFFSET : 0);
+		unsigned int wireframeState = RenderQueue::STATE_CULL_FACE
+			| (toggles.showSolid ? 0 : RenderQueue::STATE_LIGHTING | RenderQueue::STATE_MATERIAL);
+
+		for(SmoothMesh::list::const_iterator i = first; i != last; ++i) {
+			if(toggles.showSolid) {
+				queue.add(RenderQueue::PASS_SOLID, solidState, i->get(), modelWorldMatrix, worldCenter);
+			}
+			if(toggles.showWireframe) {
+				queue.add(RenderQueue::PASS_WIREFRAME, wireframeState, i->get(), modelWorldMatrix, worldCenter);
+			}
+			if(toggles.showNormals) {
+				queue.add(RenderQueue::PASS_NORMALS, 0, i->get(), modelWorldMatrix, worldCenter, toggles.normalScale);
+			}
+		}
+	}
+
 	/** Draws the model for picking */
 	void Model::pick() const {
 		glPushMatrix();
@@ -83,6 +119,21 @@ namespace peek {
 		glPopMatrix();
 	}
 
+	/** Finds the nearest face of the meshes the world-space ray hits, bringing the ray into model space first */
+	bool Model::intersect(const Ray &ray, RayHit &hit) const {
+		Ray local = ray.transform(this->transformInverse.getInverse(getTransformMatrix()));
+
+		bool found = false;
+		for(SmoothMesh::list::const_iterator i = meshes.begin(); i != meshes.end(); ++i) {
+			found |= (*i)->intersect(local, hit);
+		}
+
+		if(found) {
+			hit.model = this;
+		}
+		return found;
+	}
+
 	/** Draws the vertices */
 	void Model::drawVerts() const {
 		glPushMatrix();
@@ -99,33 +150,55 @@ namespace peek {
 	void Model::addMesh(SmoothMesh::handle mesh) {
 		meshes.push_back(mesh);
 
-		// Update the bounding box
-		for(SmoothMesh::list::const_iterator i = meshes.begin(); i != meshes.end(); ++i) {
-			Point3d curMeshBoundingBoxLow = (*i)->getBoundingBoxLow();
-			if(curMeshBoundingBoxLow.x < this->boundingBoxLow.x) {
-				this->boundingBoxLow.x = curMeshBoundingBoxLow.x;
-			}
-			if(curMeshBoundingBoxLow.y < this->boundingBoxLow.y) {
-				this->boundingBoxLow.y = curMeshBoundingBoxLow.y;
-			}
-			if(curMeshBoundingBoxLow.z < this->boundingBoxLow.z) {
-				this->boundingBoxLow.z = curMeshBoundingBoxLow.z;
-			}
+		// Grow the bounding box to take in the new mesh
+		this->boundingBox.merge(mesh->getBoundingBox());
+		this->worldBoundingBoxDirty = true;
+		notifyObservers();
 
-			Point3d curMeshBoundingBoxHigh = (*i)->getBoundingBoxHigh();
-			if(curMeshBoundingBoxHigh.x < this->boundingBoxHigh.x) {
-				this->boundingBoxHigh.x = curMeshBoundingBoxHigh.x;
-			}
-			if(curMeshBoundingBoxHigh.y < this->boundingBoxHigh.y) {
-				this->boundingBoxHigh.y = curMeshBoundingBoxHigh.y;
-			}
-			if(curMeshBoundingBoxHigh.z < this->boundingBoxHigh.z) {
-				this->boundingBoxHigh.z = curMeshBoundingBoxHigh.z;
-			}
+		// Update normal size based on bounding box size
+		this->normalScale = this->boundingBox.getDimensions().magnitude()/50.0;
+	}
+
+	/** Gets the display toggles, copied so they can be kept past later changes to the model */
+	Model::DisplayToggles Model::getDisplayToggles() const {
+		DisplayToggles toggles;
+		toggles.showSolid = this->showSolid;
+		toggles.showWireframe = this->showWireframe;
+		toggles.showNormals = this->showNormals;
+		toggles.normalScale = this->normalScale;
+		return toggles;
+	}
+
+	/** Gets the bounding box after the model's transformation, recalculating it only if the model has changed */
+	const BoundingBox &Model::getWorldBoundingBox() const {
+		if(this->worldBoundingBoxDirty) {
+			this->worldBoundingBox = this->boundingBox.transform(getTransformMatrix());
+			this->worldBoundingBoxDirty = false;
 		}
+		return this->worldBoundingBox;
+	}
 
-		// Update normal size based on bounding box size
-		this->normalScale = (this->boundingBoxHigh - this->boundingBoxLow).magnitude()/50.0;
+	/** Registers an observer to be told when the world bounding box changes */
+	void Model::addObserver(ModelObserver *observer) {
+		this->observers.push_back(observer);
+	}
+
+	/** Unregisters an observer */
+	void Model::removeObserver(ModelObserver *observer) {
+		this->observers.erase(std::remove(this->observers.begin(), this->observers.end(), observer), this->observers.end());
+	}
+
+	/** Marks the world bounding box as out of date and tells the observers */
+	void Model::transformChanged() {
+		this->worldBoundingBoxDirty = true;
+		notifyObservers();
+	}
+
+	/** Tells the observers that the world bounding box has changed */
+	void Model::notifyObservers() {
+		for(list_traits<ModelObserver *>::list_type::const_iterator i = this->observers.begin(); i != this->observers.end(); ++i) {
+			(*i)->modelBoundsChanged();
+		}
 	}
 
 }
@@ -0,0 +1,471 @@
+/**
+* @file NormalGenerator.cpp
+*/
+#include "NormalGenerator.hpp"
+#include <boost/thread.hpp>
+#include <cmath>
+
+#ifdef PEEK_X86_SIMD
+#  include <emmintrin.h>
+#  include <immintrin.h>
+#endif
+
+namespace peek {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** The fewest faces or vertices worth handing to a thread of its own */
+		const size_t minimumItemsPerThread = 16384;
+
+		/**
+		* Collects the faces of a set of streams as flat triangle and quad lists.
+		*/
+		struct FaceCollector {
+			PrimitiveStreams::indexList &triangles;
+			PrimitiveStreams::indexList &quads;
+
+			FaceCollector(PrimitiveStreams::indexList &triangles, PrimitiveStreams::indexList &quads)
+				: triangles(triangles), quads(quads) {}
+
+			inline void triangle(vertexIndex v0, vertexIndex v1, vertexIndex v2) {
+				this->triangles.push_back(v0);
+				this->triangles.push_back(v1);
+				this->triangles.push_back(v2);
+			}
+
+			inline void quad(vertexIndex v0, vertexIndex v1, vertexIndex v2, vertexIndex v3) {
+				this->quads.push_back(v0);
+				this->quads.push_back(v1);
+				this->quads.push_back(v2);
+				this->quads.push_back(v3);
+			}
+		};
+
+		/**
+		* Normalizes a face normal and stores it, leaving degenerate faces with a
+		* zero normal so they do not disturb their neighbours.
+		*/
+		inline void storeNormal(double x, double y, double z, double *nx, double *ny, double *nz, size_t f) {
+			double length = sqrt(x*x + y*y + z*z);
+			double scale = (length > 0.0 ? 1.0 / length : 0.0);
+			nx[f] = x * scale;
+			ny[f] = y * scale;
+			nz[f] = z * scale;
+		}
+
+		/*
+		* The kernels below compute the normals of faces [begin, end).  For a
+		* triangle, Newell's method reduces to the cross product of two edges; for
+		* a quadrilateral, it reduces to the cross product of the diagonals.
+		*/
+
+		void triangleNormalsScalar(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			for (size_t f = begin; f < end; f++) {
+				const Vertex3d &a = verts[v[3*f]], &b = verts[v[3*f+1]], &c = verts[v[3*f+2]];
+				double e1x = b.x - a.x, e1y = b.y - a.y, e1z = b.z - a.z;
+				double e2x = c.x - a.x, e2y = c.y - a.y, e2z = c.z - a.z;
+				storeNormal(e1y*e2z - e1z*e2y, e1z*e2x - e1x*e2z, e1x*e2y - e1y*e2x, nx, ny, nz, f);
+			}
+		}
+
+		void quadNormalsScalar(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			for (size_t f = begin; f < end; f++) {
+				const Vertex3d &a = verts[v[4*f]], &b = verts[v[4*f+1]], &c = verts[v[4*f+2]], &d = verts[v[4*f+3]];
+				double d1x = c.x - a.x, d1y = c.y - a.y, d1z = c.z - a.z;
+				double d2x = d.x - b.x, d2y = d.y - b.y, d2z = d.z - b.z;
+				storeNormal(d1y*d2z - d1z*d2y, d1z*d2x - d1x*d2z, d1x*d2y - d1y*d2x, nx, ny, nz, f);
+			}
+		}
+
+#ifdef PEEK_X86_SIMD
+
+		/** Normalizes and stores two face normals */
+		inline void storeNormalsSse2(__m128d x, __m128d y, __m128d z, double *nx, double *ny, double *nz, size_t f) {
+			__m128d length = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), _mm_mul_pd(z, z)));
+			__m128d nonzero = _mm_cmpgt_pd(length, _mm_setzero_pd());
+			__m128d scale = _mm_and_pd(nonzero, _mm_div_pd(_mm_set1_pd(1.0), length));
+			_mm_storeu_pd(nx + f, _mm_mul_pd(x, scale));
+			_mm_storeu_pd(ny + f, _mm_mul_pd(y, scale));
+			_mm_storeu_pd(nz + f, _mm_mul_pd(z, scale));
+		}
+
+		/** Computes the cross product of two vectors held two-wide */
+		inline void crossSse2(__m128d ux, __m128d uy, __m128d uz, __m128d vx, __m128d vy, __m128d vz,
+			__m128d &x, __m128d &y, __m128d &z) {
+			x = _mm_sub_pd(_mm_mul_pd(uy, vz), _mm_mul_pd(uz, vy));
+			y = _mm_sub_pd(_mm_mul_pd(uz, vx), _mm_mul_pd(ux, vz));
+			z = _mm_sub_pd(_mm_mul_pd(ux, vy), _mm_mul_pd(uy, vx));
+		}
+
+		void triangleNormalsSse2(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			size_t f = begin;
+
+			for (; f + 2 <= end; f += 2) {
+				const Vertex3d &a0 = verts[v[3*f]], &b0 = verts[v[3*f+1]], &c0 = verts[v[3*f+2]];
+				const Vertex3d &a1 = verts[v[3*f+3]], &b1 = verts[v[3*f+4]], &c1 = verts[v[3*f+5]];
+
+				__m128d ax = _mm_set_pd(a1.x, a0.x), ay = _mm_set_pd(a1.y, a0.y), az = _mm_set_pd(a1.z, a0.z);
+				__m128d e1x = _mm_sub_pd(_mm_set_pd(b1.x, b0.x), ax);
+				__m128d e1y = _mm_sub_pd(_mm_set_pd(b1.y, b0.y), ay);
+				__m128d e1z = _mm_sub_pd(_mm_set_pd(b1.z, b0.z), az);
+				__m128d e2x = _mm_sub_pd(_mm_set_pd(c1.x, c0.x), ax);
+				__m128d e2y = _mm_sub_pd(_mm_set_pd(c1.y, c0.y), ay);
+				__m128d e2z = _mm_sub_pd(_mm_set_pd(c1.z, c0.z), az);
+
+				__m128d x, y, z;
+				crossSse2(e1x, e1y, e1z, e2x, e2y, e2z, x, y, z);
+				storeNormalsSse2(x, y, z, nx, ny, nz, f);
+			}
+
+			triangleNormalsScalar(verts, v, f, end, nx, ny, nz);
+		}
+
+		void quadNormalsSse2(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			size_t f = begin;
+
+			for (; f + 2 <= end; f += 2) {
+				const Vertex3d &a0 = verts[v[4*f]], &b0 = verts[v[4*f+1]], &c0 = verts[v[4*f+2]], &d0 = verts[v[4*f+3]];
+				const Vertex3d &a1 = verts[v[4*f+4]], &b1 = verts[v[4*f+5]], &c1 = verts[v[4*f+6]], &d1 = verts[v[4*f+7]];
+
+				__m128d d1x = _mm_sub_pd(_mm_set_pd(c1.x, c0.x), _mm_set_pd(a1.x, a0.x));
+				__m128d d1y = _mm_sub_pd(_mm_set_pd(c1.y, c0.y), _mm_set_pd(a1.y, a0.y));
+				__m128d d1z = _mm_sub_pd(_mm_set_pd(c1.z, c0.z), _mm_set_pd(a1.z, a0.z));
+				__m128d d2x = _mm_sub_pd(_mm_set_pd(d1.x, d0.x), _mm_set_pd(b1.x, b0.x));
+				__m128d d2y = _mm_sub_pd(_mm_set_pd(d1.y, d0.y), _mm_set_pd(b1.y, b0.y));
+				__m128d d2z = _mm_sub_pd(_mm_set_pd(d1.z, d0.z), _mm_set_pd(b1.z, b0.z));
+
+				__m128d x, y, z;
+				crossSse2(d1x, d1y, d1z, d2x, d2y, d2z, x, y, z);
+				storeNormalsSse2(x, y, z, nx, ny, nz, f);
+			}
+
+			quadNormalsScalar(verts, v, f, end, nx, ny, nz);
+		}
+
+		/** Normalizes and stores four face normals */
+		PEEK_TARGET_AVX2 inline void storeNormalsAvx2(__m256d x, __m256d y, __m256d z, double *nx, double *ny, double *nz, size_t f) {
+			__m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y)), _mm256_mul_pd(z, z)));
+			__m256d nonzero = _mm256_cmp_pd(length, _mm256_setzero_pd(), _CMP_GT_OQ);
+			__m256d scale = _mm256_and_pd(nonzero, _mm256_div_pd(_mm256_set1_pd(1.0), length));
+			_mm256_storeu_pd(nx + f, _mm256_mul_pd(x, scale));
+			_mm256_storeu_pd(ny + f, _mm256_mul_pd(y, scale));
+			_mm256_storeu_pd(nz + f, _mm256_mul_pd(z, scale));
+		}
+
+		/** Computes the cross product of two vectors held four-wide */
+		PEEK_TARGET_AVX2 inline void crossAvx2(__m256d ux, __m256d uy, __m256d uz, __m256d vx, __m256d vy, __m256d vz,
+			__m256d &x, __m256d &y, __m256d &z) {
+			x = _mm256_sub_pd(_mm256_mul_pd(uy, vz), _mm256_mul_pd(uz, vy));
+			y = _mm256_sub_pd(_mm256_mul_pd(uz, vx), _mm256_mul_pd(ux, vz));
+			z = _mm256_sub_pd(_mm256_mul_pd(ux, vy), _mm256_mul_pd(uy, vx));
+		}
+
+		/**
+		* Gathers one corner of four faces.  Vertices are four doubles apart (x,
+		* y, z, h), so each vertex index is scaled by four and the gathers are
+		* offset to pick out the coordinate.
+		*/
+		PEEK_TARGET_AVX2 inline void gatherCornerAvx2(const double *base, const vertexIndex *v, size_t stride, size_t corner,
+			__m256d &x, __m256d &y, __m256d &z) {
+			__m128i offsets = _mm_slli_epi32(_mm_set_epi32((int) v[3*stride + corner], (int) v[2*stride + corner],
+				(int) v[stride + corner], (int) v[corner]), 2);
+			x = _mm256_i32gather_pd(base, offsets, 8);
+			y = _mm256_i32gather_pd(base + 1, offsets, 8);
+			z = _mm256_i32gather_pd(base + 2, offsets, 8);
+		}
+
+		PEEK_TARGET_AVX2 void triangleNormalsAvx2(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			const double *base = &verts[0].x;
+			size_t f = begin;
+
+			for (; f + 4 <= end; f += 4) {
+				__m256d ax, ay, az, bx, by, bz, cx, cy, cz;
+				gatherCornerAvx2(base, v + 3*f, 3, 0, ax, ay, az);
+				gatherCornerAvx2(base, v + 3*f, 3, 1, bx, by, bz);
+				gatherCornerAvx2(base, v + 3*f, 3, 2, cx, cy, cz);
+
+				__m256d x, y, z;
+				crossAvx2(_mm256_sub_pd(bx, ax), _mm256_sub_pd(by, ay), _mm256_sub_pd(bz, az),
+					_mm256_sub_pd(cx, ax), _mm256_sub_pd(cy, ay), _mm256_sub_pd(cz, az), x, y, z);
+				storeNormalsAvx2(x, y, z, nx, ny, nz, f);
+			}
+
+			triangleNormalsSse2(verts, v, f, end, nx, ny, nz);
+		}
+
+		PEEK_TARGET_AVX2 void quadNormalsAvx2(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz) {
+			const double *base = &verts[0].x;
+			size_t f = begin;
+
+			for (; f + 4 <= end; f += 4) {
+				__m256d ax, ay, az, bx, by, bz, cx, cy, cz, dx, dy, dz;
+				gatherCornerAvx2(base, v + 4*f, 4, 0, ax, ay, az);
+				gatherCornerAvx2(base, v + 4*f, 4, 1, bx, by, bz);
+				gatherCornerAvx2(base, v + 4*f, 4, 2, cx, cy, cz);
+				gatherCornerAvx2(base, v + 4*f, 4, 3, dx, dy, dz);
+
+				__m256d x, y, z;
+				crossAvx2(_mm256_sub_pd(cx, ax), _mm256_sub_pd(cy, ay), _mm256_sub_pd(cz, az),
+					_mm256_sub_pd(dx, bx), _mm256_sub_pd(dy, by), _mm256_sub_pd(dz, bz), x, y, z);
+				storeNormalsAvx2(x, y, z, nx, ny, nz, f);
+			}
+
+			quadNormalsSse2(verts, v, f, end, nx, ny, nz);
+		}
+
+#endif
+
+		typedef void (*FaceNormalKernel)(const Vertex3d *verts, const vertexIndex *v, size_t begin, size_t end,
+			double *nx, double *ny, double *nz);
+
+		/**
+		* Computes the normals of a range of faces with a kernel.
+		*/
+		struct FaceNormalTask {
+			FaceNormalKernel kernel;
+			const Vertex3d *verts;
+			const vertexIndex *v;
+			double *nx, *ny, *nz;
+
+			inline void operator()(size_t begin, size_t end) const {
+				this->kernel(this->verts, this->v, begin, end, this->nx, this->ny, this->nz);
+			}
+		};
+
+		/** Normalizes a summed vertex normal and stores it, leaving unused vertices with a zero normal */
+		inline void storeVertexNormal(double x, double y, double z, Normal3d &normal) {
+			double length = sqrt(x*x + y*y + z*z);
+			double scale = (length > 0.0 ? 1.0 / length : 0.0);
+			normal.x = x * scale;
+			normal.y = y * scale;
+			normal.z = z * scale;
+		}
+
+		/**
+		* Adds the normals of a list of faces to their vertices, one block of faces
+		* at a time so the face normals stay in cache.  Since each vertex receives
+		* its faces in face order, this matches the adjacency gather bit for bit.
+		*/
+		void scatterFaceNormals(FaceNormalKernel kernel, const Vertex3d *verts, const vertexIndex *v, size_t faceCount,
+			size_t cornerCount, Normal3d *normals) {
+			const size_t blockSize = 1024;
+			double nx[blockSize], ny[blockSize], nz[blockSize];
+
+			for (size_t begin = 0; begin < faceCount; begin += blockSize) {
+				size_t count = std::min(blockSize, faceCount - begin);
+				const vertexIndex *block = v + begin * cornerCount;
+				kernel(verts, block, 0, count, nx, ny, nz);
+
+				for (size_t f = 0; f < count; f++) {
+					for (size_t k = 0; k < cornerCount; k++) {
+						Normal3d &normal = normals[block[f * cornerCount + k]];
+						normal.x += nx[f];
+						normal.y += ny[f];
+						normal.z += nz[f];
+					}
+				}
+			}
+		}
+
+		/**
+		* Sums and normalizes the face normals around a range of vertices.
+		*/
+		struct VertexGatherTask {
+			const vertexIndex *adjacencyStarts;
+			const vertexIndex *adjacency;
+			const double *fx, *fy, *fz;
+			Normal3d *normals;
+
+			inline void operator()(size_t begin, size_t end) const {
+				for (size_t i = begin; i < end; i++) {
+					double x = 0, y = 0, z = 0;
+
+					for (vertexIndex k = this->adjacencyStarts[i]; k < this->adjacencyStarts[i+1]; k++) {
+						vertexIndex f = this->adjacency[k];
+						x += this->fx[f];
+						y += this->fy[f];
+						z += this->fz[f];
+					}
+
+					storeVertexNormal(x, y, z, this->normals[i]);
+				}
+			}
+		};
+
+		/**
+		* Binds a task to one contiguous range so it can run on a thread.
+		*/
+		template <typename Task>
+		struct RangeRunner {
+			Task task;
+			size_t begin, end;
+
+			RangeRunner(const Task &task, size_t begin, size_t end) : task(task), begin(begin), end(end) {}
+
+			inline void operator()() const {
+				this->task(this->begin, this->end);
+			}
+		};
+
+		/**
+		* Splits [0, count) into contiguous ranges and runs the task on each, one
+		* range per thread.  The calling thread takes the last range.
+		*/
+		template <typename Task>
+		void runParallel(unsigned int threadCount, size_t count, const Task &task) {
+			size_t threads = std::min((size_t) threadCount, std::max((size_t) 1, count / minimumItemsPerThread));
+			size_t chunk = (count + threads - 1) / threads;
+			boost::thread_group group;
+
+			for (size_t t = 0; t + 1 < threads; t++) {
+				group.create_thread(RangeRunner<Task>(task, t * chunk, std::min(count, (t + 1) * chunk)));
+			}
+
+			task(std::min(count, (threads - 1) * chunk), count);
+			group.join_all();
+		}
+
+	}
+
+	/*!
+	*/
+	NormalGenerator::NormalGenerator() {
+		this->threadCount = 0;
+		this->simdLevel = peek::getSimdLevel();
+	}
+
+	/*!
+	* @return The number of threads generate() will use
+	*/
+	unsigned int NormalGenerator::getThreadCount() const {
+		if (this->threadCount > 0) {
+			return this->threadCount;
+		}
+
+		unsigned int cores = boost::thread::hardware_concurrency();
+		return (cores > 0 ? cores : 1);
+	}
+
+	/*!
+	* @param simdLevel The instruction set to use
+	*/
+	void NormalGenerator::setSimdLevel(SimdLevel simdLevel) {
+		this->simdLevel = std::min(simdLevel, peek::getSimdLevel());
+	}
+
+	/*!
+	* @param verts The vertices of the mesh
+	* @param primitives The faces of the mesh
+	* @param normals Receives the vertex normals, one per vertex
+	*/
+	void NormalGenerator::generate(const Vertex3d::list &verts, const PrimitiveStreams &primitives, Normal3d::list &normals) const {
+		normals.assign(verts.size(), Normal3d());
+		if (verts.empty()) {
+			return;
+		}
+
+		// Use the triangle and quad streams in place when nothing needs decomposing
+		PrimitiveStreams::indexList collectedTriangles, collectedQuads;
+		const PrimitiveStreams::indexList *triangles = &primitives.getTriangles();
+		const PrimitiveStreams::indexList *quads = &primitives.getQuads();
+
+		if (!primitives.getTriangleStrips().empty() || !primitives.getTriangleFans().empty() || !primitives.getQuadStrips().empty()) {
+			collectedTriangles.reserve(primitives.getTriangles().size() + 3 * (primitives.getTriangleStrips().size() + primitives.getTriangleFans().size()));
+			collectedQuads.reserve(primitives.getQuads().size() + 2 * primitives.getQuadStrips().size());
+
+			FaceCollector collector(collectedTriangles, collectedQuads);
+			primitives.visitFaces(collector);
+
+			triangles = &collectedTriangles;
+			quads = &collectedQuads;
+		}
+
+		size_t triangleCount = triangles->size() / 3;
+		size_t quadCount = quads->size() / 4;
+		size_t faceCount = triangleCount + quadCount;
+		if (faceCount == 0) {
+			return;
+		}
+
+		// Pick the kernels
+		FaceNormalKernel triangleKernel = triangleNormalsScalar;
+		FaceNormalKernel quadKernel = quadNormalsScalar;
+
+#ifdef PEEK_X86_SIMD
+		// The AVX2 gathers use 32-bit offsets of four doubles per vertex
+		bool gatherable = (sizeof(Vertex3d) == 4 * sizeof(double)) && verts.size() < (1u << 29);
+
+		if (this->simdLevel >= SIMD_AVX2 && gatherable) {
+			triangleKernel = triangleNormalsAvx2;
+			quadKernel = quadNormalsAvx2;
+		}
+		else if (this->simdLevel >= SIMD_SSE2) {
+			triangleKernel = triangleNormalsSse2;
+			quadKernel = quadNormalsSse2;
+		}
+#endif
+
+		// With a single thread, skip the adjacency table and add each block of face normals to its vertices
+		unsigned int threads = (unsigned int) std::min((size_t) getThreadCount(), std::max((size_t) 1, faceCount / minimumItemsPerThread));
+
+		if (threads == 1) {
+			scatterFaceNormals(triangleKernel, &verts[0], triangles->empty() ? 0 : &(*triangles)[0], triangleCount, 3, &normals[0]);
+			scatterFaceNormals(quadKernel, &verts[0], quads->empty() ? 0 : &(*quads)[0], quadCount, 4, &normals[0]);
+
+			for (Normal3d::listIndex i = 0; i < normals.size(); i++) {
+				storeVertexNormal(normals[i].x, normals[i].y, normals[i].z, normals[i]);
+			}
+			return;
+		}
+
+		// Compute the face normals; triangles first, then quads
+		vector<double> fx(faceCount), fy(faceCount), fz(faceCount);
+
+		if (triangleCount > 0) {
+			FaceNormalTask task = { triangleKernel, &verts[0], &(*triangles)[0], &fx[0], &fy[0], &fz[0] };
+			runParallel(threads, triangleCount, task);
+		}
+
+		if (quadCount > 0) {
+			FaceNormalTask task = { quadKernel, &verts[0], &(*quads)[0],
+				&fx[triangleCount], &fy[triangleCount], &fz[triangleCount] };
+			runParallel(threads, quadCount, task);
+		}
+
+		// Build the vertex-to-face adjacency table, listing each vertex's faces in order
+		vector<vertexIndex> adjacencyStarts(verts.size() + 1, 0);
+		for (size_t i = 0; i < triangles->size(); i++) {
+			adjacencyStarts[(*triangles)[i] + 1]++;
+		}
+		for (size_t i = 0; i < quads->size(); i++) {
+			adjacencyStarts[(*quads)[i] + 1]++;
+		}
+		for (size_t i = 0; i < verts.size(); i++) {
+			adjacencyStarts[i+1] += adjacencyStarts[i];
+		}
+
+		vector<vertexIndex> adjacency(adjacencyStarts.back());
+		vector<vertexIndex> cursors(adjacencyStarts.begin(), adjacencyStarts.end() - 1);
+		for (size_t i = 0; i < triangles->size(); i++) {
+			adjacency[cursors[(*triangles)[i]]++] = (vertexIndex) (i / 3);
+		}
+		for (size_t i = 0; i < quads->size(); i++) {
+			adjacency[cursors[(*quads)[i]]++] = (vertexIndex) (triangleCount + i / 4);
+		}
+		vector<vertexIndex>().swap(cursors);
+
+		// Gather the vertex normals
+		VertexGatherTask task = { &adjacencyStarts[0], adjacency.empty() ? 0 : &adjacency[0],
+			&fx[0], &fy[0], &fz[0], &normals[0] };
+		runParallel(threads, verts.size(), task);
+	}
+
+}
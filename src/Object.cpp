@@ -10,17 +10,31 @@ namespace peek {
  */
 Object::Object() {
 	this->scale = 1.0;
+	this->transformDirty = true;
 }
 
 /*!
  */
 void Object::transformModelviewMatrix() const {
   glMatrixMode(GL_MODELVIEW);
-  glScaled(this->scale, this->scale, this->scale);
-  glRotated(this->rotation.z, 0, 0, 1);
-  glRotated(this->rotation.y, 0, 1, 0);
-  glRotated(this->rotation.x, 1, 0, 0);
-  glTranslated(this->origin.x, this->origin.y, this->origin.z);
+  glMultMatrixd(getTransformMatrix().getArray());
+}
+
+/*!
+ * @return The object's scale, then rotation about z, y and x, then
+ *         translation, composed as glScale, glRotate and glTranslate would;
+ *         the matrix is only rebuilt after the object has changed
+ */
+const Matrix<double> &Object::getTransformMatrix() const {
+  if (this->transformDirty) {
+    this->transform = scalingMatrix(this->scale, this->scale, this->scale)
+      * rotationMatrix(this->rotation.z, 0.0, 0.0, 1.0)
+      * rotationMatrix(this->rotation.y, 0.0, 1.0, 0.0)
+      * rotationMatrix(this->rotation.x, 1.0, 0.0, 0.0)
+      * translationMatrix(this->origin.x, this->origin.y, this->origin.z);
+    this->transformDirty = false;
+  }
+  return this->transform;
 }
 
 }
\ No newline at end of file
@@ -40,6 +40,18 @@ namespace peek {
 		BirdsEyeCameraRigging::initModelviewMatrix();
 	}
 
+	Matrix<double> OrthoBirdsEyeCameraRigging::getViewMatrix() {
+		return BirdsEyeCameraRigging::getViewMatrix();
+	}
+
+	const Matrix<double> &OrthoBirdsEyeCameraRigging::getInverseViewMatrix() {
+		return BirdsEyeCameraRigging::getInverseViewMatrix();
+	}
+
+	Frustum OrthoBirdsEyeCameraRigging::getFrustum() {
+		return BirdsEyeCameraRigging::getFrustum();
+	}
+
 	Camera *OrthoBirdsEyeCameraRigging::getCamera() {
 		return BirdsEyeCameraRigging::getCamera();
 	}
@@ -32,7 +32,7 @@ namespace peek {
 	 */
 	OrthographicCamera::OrthographicCamera(double width, double aspectRatio,
 										   double nearVal, double farVal) {
-		this->width = defaultWidth;
+		this->width = width;
 		this->aspectRatio = aspectRatio;
 		this->nearVal = nearVal;
 		this->farVal = farVal;
@@ -44,8 +44,7 @@ namespace peek {
 	 */
 	void OrthographicCamera::setProjectionMatrix() {
 		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		glOrtho(this->left, this->right, this->bottom, this->top, this->nearVal, this->farVal);
+		glLoadMatrixd(getProjectionMatrix().getArray());
 	}
 
 	/**
@@ -53,11 +52,33 @@ namespace peek {
 	void OrthographicCamera::setPickingMatrix(int x, int y) {
 		GLint viewport[4];
 		glGetIntegerv(GL_VIEWPORT, viewport);
-	  
+
+		double size = this->pickingWindowSize;
+		Matrix<double> picking = pickingMatrix<double>(x, viewport[3]-y, size, size, viewport);
+
 		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		gluPickMatrix(x, viewport[3]-y, this->pickingWindowSize, this->pickingWindowSize, viewport);
-		glOrtho(this->left, this->right, this->bottom, this->top, this->nearVal, this->farVal);
+		glLoadMatrixd((picking * getProjectionMatrix()).getArray());
+	}
+
+	/**
+	 * \return The same matrix glOrtho builds from the camera's parameters
+	 */
+	Matrix<double> OrthographicCamera::getProjectionMatrix() {
+		Matrix<double> m;
+		m(0, 0) = 2.0 / (this->right - this->left);
+		m(1, 1) = 2.0 / (this->top - this->bottom);
+		m(2, 2) = -2.0 / (this->farVal - this->nearVal);
+		m(3, 0) = -(this->right + this->left) / (this->right - this->left);
+		m(3, 1) = -(this->top + this->bottom) / (this->top - this->bottom);
+		m(3, 2) = -(this->farVal + this->nearVal) / (this->farVal - this->nearVal);
+		return m;
+	}
+
+	/**
+	 * \return The inverse of the projection matrix, recalculated only when the camera's parameters change
+	 */
+	const Matrix<double> &OrthographicCamera::getInverseProjectionMatrix() {
+		return this->projectionInverse.getInverse(getProjectionMatrix());
 	}
 
 	/**
@@ -31,7 +31,7 @@ namespace peek {
 	 */
 	PerspectiveCamera::PerspectiveCamera(double fov, double aspectRatio,
 										 double nearVal, double farVal) {
-		this->fov = defaultFov;
+		this->fov = fov;
 		this->aspectRatio = aspectRatio;
 		this->nearVal = nearVal;
 		this->farVal = farVal;
@@ -42,8 +42,7 @@ namespace peek {
 	 */
 	void PerspectiveCamera::setProjectionMatrix() {
 		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		gluPerspective(this->fov, this->aspectRatio, this->nearVal, this->farVal);
+		glLoadMatrixd(getProjectionMatrix().getArray());
 	}
 
 	/**
@@ -51,11 +50,36 @@ namespace peek {
 	void PerspectiveCamera::setPickingMatrix(int x, int y) {
 		GLint viewport[4];
 		glGetIntegerv(GL_VIEWPORT, viewport);
-	  
+
+		double size = this->pickingWindowSize;
+		Matrix<double> picking = pickingMatrix<double>(x, viewport[3]-y, size, size, viewport);
+
 		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		gluPickMatrix(x, viewport[3]-y, this->pickingWindowSize, this->pickingWindowSize, viewport);
-		gluPerspective(this->fov, this->aspectRatio, this->nearVal, this->farVal);
+		glLoadMatrixd((picking * getProjectionMatrix()).getArray());
+	}
+
+	/**
+	 * \return The same matrix gluPerspective builds from the camera's parameters
+	 */
+	Matrix<double> PerspectiveCamera::getProjectionMatrix() {
+		double f = 1.0 / tan(this->fov * PI / 360.0);
+		double depth = this->nearVal - this->farVal;
+
+		Matrix<double> m;
+		m(0, 0) = f / this->aspectRatio;
+		m(1, 1) = f;
+		m(2, 2) = (this->farVal + this->nearVal) / depth;
+		m(2, 3) = -1.0;
+		m(3, 2) = 2.0 * this->farVal * this->nearVal / depth;
+		m(3, 3) = 0.0;
+		return m;
+	}
+
+	/**
+	 * \return The inverse of the projection matrix, recalculated only when the camera's parameters change
+	 */
+	const Matrix<double> &PerspectiveCamera::getInverseProjectionMatrix() {
+		return this->projectionInverse.getInverse(getProjectionMatrix());
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+* @file PrimitiveStreams.cpp
+*/
+#include "PrimitiveStreams.hpp"
+
+namespace peek {
+
+	/**
+	 * Appends one strip/fan table to another, rebasing its offsets.
+	 */
+	static void appendRuns(PrimitiveStreams::indexList &indices, PrimitiveStreams::indexList &starts,
+		const PrimitiveStreams::indexList &otherIndices, const PrimitiveStreams::indexList &otherStarts) {
+		PrimitiveStreams::index base = (PrimitiveStreams::index) indices.size();
+
+		indices.insert(indices.end(), otherIndices.begin(), otherIndices.end());
+		for (size_t i = 1; i < otherStarts.size(); i++) {
+			starts.push_back(base + otherStarts[i]);
+		}
+	}
+
+	/**
+	 * Releases the unused capacity of an index list.
+	 */
+	static void shrink(PrimitiveStreams::indexList &indices) {
+		PrimitiveStreams::indexList(indices).swap(indices);
+	}
+
+	/*!
+	*/
+	PrimitiveStreams::PrimitiveStreams() {
+		clear();
+	}
+
+	/*!
+	* @param other The streams whose primitives to append
+	*/
+	void PrimitiveStreams::append(const PrimitiveStreams &other) {
+		this->triangles.insert(this->triangles.end(), other.triangles.begin(), other.triangles.end());
+		this->quads.insert(this->quads.end(), other.quads.begin(), other.quads.end());
+		appendRuns(this->triangleStrips, this->triangleStripStarts, other.triangleStrips, other.triangleStripStarts);
+		appendRuns(this->triangleFans, this->triangleFanStarts, other.triangleFans, other.triangleFanStarts);
+		appendRuns(this->quadStrips, this->quadStripStarts, other.quadStrips, other.quadStripStarts);
+	}
+
+	/*!
+	*/
+	void PrimitiveStreams::clear() {
+		this->triangles.clear();
+		this->quads.clear();
+		this->triangleStrips.clear();
+		this->triangleFans.clear();
+		this->quadStrips.clear();
+
+		// Each start table always holds the end offset of the last strip/fan
+		this->triangleStripStarts.assign(1, 0);
+		this->triangleFanStarts.assign(1, 0);
+		this->quadStripStarts.assign(1, 0);
+	}
+
+	/*!
+	* @param map The new index of each vertex, indexed by its old index
+	*/
+	void PrimitiveStreams::remap(const indexList &map) {
+		indexList *streams[] = { &this->triangles, &this->quads, &this->triangleStrips, &this->triangleFans, &this->quadStrips };
+
+		for (size_t s = 0; s < sizeof(streams) / sizeof(streams[0]); s++) {
+			indexList &indices = *streams[s];
+			for (size_t i = 0; i < indices.size(); i++) {
+				indices[i] = map[indices[i]];
+			}
+		}
+	}
+
+	/*!
+	*/
+	void PrimitiveStreams::shrinkToFit() {
+		shrink(this->triangles);
+		shrink(this->quads);
+		shrink(this->triangleStrips);
+		shrink(this->triangleStripStarts);
+		shrink(this->triangleFans);
+		shrink(this->triangleFanStarts);
+		shrink(this->quadStrips);
+		shrink(this->quadStripStarts);
+	}
+
+	/*!
+	* @return The number of faces visitFaces() will report
+	*/
+	size_t PrimitiveStreams::getFaceCount() const {
+		size_t faces = this->triangles.size() / 3 + this->quads.size() / 4;
+
+		for (size_t s = 0; s + 1 < this->triangleStripStarts.size(); s++) {
+			index length = this->triangleStripStarts[s+1] - this->triangleStripStarts[s];
+			faces += (length > 2 ? length - 2 : 0);
+		}
+
+		for (size_t f = 0; f + 1 < this->triangleFanStarts.size(); f++) {
+			index length = this->triangleFanStarts[f+1] - this->triangleFanStarts[f];
+			faces += (length > 2 ? length - 2 : 0);
+		}
+
+		for (size_t s = 0; s + 1 < this->quadStripStarts.size(); s++) {
+			index length = this->quadStripStarts[s+1] - this->quadStripStarts[s];
+			faces += (length > 3 ? (length - 2) / 2 : 0);
+		}
+
+		return faces;
+	}
+
+	/*!
+	*/
+	size_t PrimitiveStreams::getIndexCount() const {
+		return this->triangles.size() + this->quads.size()
+			+ this->triangleStrips.size() + this->triangleFans.size() + this->quadStrips.size();
+	}
+
+	/*!
+	*/
+	size_t PrimitiveStreams::getMemoryUsage() const {
+		size_t capacity = this->triangles.capacity() + this->quads.capacity()
+			+ this->triangleStrips.capacity() + this->triangleStripStarts.capacity()
+			+ this->triangleFans.capacity() + this->triangleFanStarts.capacity()
+			+ this->quadStrips.capacity() + this->quadStripStarts.capacity();
+
+		return sizeof(PrimitiveStreams) + capacity * sizeof(index);
+	}
+
+}
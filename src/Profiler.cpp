@@ -0,0 +1,404 @@
+/**
+* @file Profiler.cpp
+*/
+
+#include "Profiler.hpp"
+#include "GlExtensions.hpp"
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace peek {
+
+	boost::atomic<bool> Profiler::enabled(false);
+
+	namespace {
+
+		/** A scope recorded */
+		struct Event {
+			const char *name;
+			boost::uint64_t start;
+			boost::uint64_t end;
+		};
+
+		/**
+		* The events one thread (or the GPU) has recorded.  Only the owner writes
+		* the events, and publishes each by advancing the count with a release
+		* store; readers copy what they can see, then drop whatever the owner
+		* may have overwritten while they copied.
+		*/
+		struct Ring {
+			Ring(unsigned int id, const std::string &name, bool gpu) : events(Profiler::ringSize), written(0), first(0) {
+				this->id = id;
+				this->name = name;
+				this->gpu = gpu;
+			}
+
+			std::vector<Event> events;
+			boost::atomic<boost::uint64_t> written;
+			boost::atomic<boost::uint64_t> first;
+			unsigned int id;
+			std::string name;
+			bool gpu;
+		};
+
+		/** Every ring made; rings are never freed, so events outlive the threads that recorded them */
+		std::vector<Ring *> rings;
+
+		/** Guards the list of rings, and the rings' names */
+		boost::mutex ringsMutex;
+
+		/** Leaves a thread's ring in the list when the thread exits */
+		void keepRing(Ring *) {
+		}
+
+		/** The calling thread's ring */
+		boost::thread_specific_ptr<Ring> threadRing(keepRing);
+
+		/** The ring GPU times are recorded into, once there are any */
+		Ring *gpuRing = 0;
+
+		/** When profiling began */
+		const boost::chrono::steady_clock::time_point epoch = boost::chrono::steady_clock::now();
+
+		/** The number of frames ended */
+		boost::atomic<unsigned long> frames(0);
+
+		/** A GPU pass whose time has not yet been read back */
+		struct PendingQuery {
+			GLuint query;
+			const char *name;
+			boost::uint64_t start;
+		};
+
+		/** The passes measured, oldest first; only the context's thread touches the GPU state */
+		std::deque<PendingQuery> pendingQueries;
+
+		/** Query objects whose results have been read, for reuse */
+		std::vector<GLuint> freeQueries;
+
+		/** How deeply GPU passes are nested; only the outermost is measured */
+		int gpuDepth = 0;
+
+		/** The pass being measured, if its query was begun */
+		PendingQuery activeQuery = { 0, 0, 0 };
+
+		/** Makes a ring, and adds it to the list */
+		Ring *addRing(const std::string &name, bool gpu) {
+			boost::mutex::scoped_lock lock(ringsMutex);
+			Ring *ring = new Ring((unsigned int) rings.size(), name, gpu);
+			if (ring->name.empty()) {
+				std::ostringstream out;
+				out << "thread " << ring->id;
+				ring->name = out.str();
+			}
+			rings.push_back(ring);
+			return ring;
+		}
+
+		/** Gets the calling thread's ring, making it on first use */
+		Ring *getThreadRing() {
+			Ring *ring = threadRing.get();
+			if (!ring) {
+				ring = addRing("", false);
+				threadRing.reset(ring);
+			}
+			return ring;
+		}
+
+		/** Appends an event to a ring; only the ring's owner may call this */
+		inline void append(Ring *ring, const char *name, boost::uint64_t start, boost::uint64_t end) {
+			boost::uint64_t written = ring->written.load(boost::memory_order_relaxed);
+			Event &event = ring->events[(size_t) (written & (Profiler::ringSize - 1))];
+			event.name = name;
+			event.start = start;
+			event.end = end;
+			ring->written.store(written + 1, boost::memory_order_release);
+		}
+
+		/** Copies the events a ring holds, oldest first */
+		void snapshot(const Ring &ring, std::vector<Event> &events) {
+			boost::uint64_t written = ring.written.load(boost::memory_order_acquire);
+			boost::uint64_t first = std::max(ring.first.load(boost::memory_order_relaxed),
+				written > Profiler::ringSize ? written - Profiler::ringSize : 0);
+
+			size_t copied = events.size();
+			for (boost::uint64_t i = first; i < written; i++) {
+				events.push_back(ring.events[(size_t) (i & (Profiler::ringSize - 1))]);
+			}
+
+			// Whatever the owner has written since, and the event it may be writing now, may have replaced the oldest events copied
+			boost::uint64_t now = ring.written.load(boost::memory_order_acquire);
+			if (now >= Profiler::ringSize && now + 1 - Profiler::ringSize > first) {
+				size_t stale = (size_t) std::min(now + 1 - Profiler::ringSize - first, written - first);
+				events.erase(events.begin() + copied, events.begin() + copied + stale);
+			}
+		}
+
+		/** Writes a string as a JSON string */
+		void writeJsonString(std::ostream &out, const std::string &value) {
+			out << '"';
+			for (size_t i = 0; i < value.size(); i++) {
+				char c = value[i];
+				if (c == '"' || c == '\\') {
+					out << '\\' << c;
+				} else if ((unsigned char) c < 0x20) {
+					char escaped[8];
+					sprintf(escaped, "\\u%04x", (unsigned int) c);
+					out << escaped;
+				} else {
+					out << c;
+				}
+			}
+			out << '"';
+		}
+
+	}
+
+	/*!
+	* @param enabled Whether to record
+	*/
+	void Profiler::setEnabled(bool enabled) {
+		Profiler::enabled.store(enabled, boost::memory_order_relaxed);
+	}
+
+	/*!
+	* @param name The thread's name
+	*/
+	void Profiler::setThreadName(const std::string &name) {
+		Ring *ring = getThreadRing();
+		boost::mutex::scoped_lock lock(ringsMutex);
+		ring->name = name;
+	}
+
+	/*!
+	* @param name The scope's name; a string literal
+	* @param start When the scope began
+	* @param end When the scope ended
+	*/
+	void Profiler::record(const char *name, boost::uint64_t start, boost::uint64_t end) {
+		append(getThreadRing(), name, start, end);
+	}
+
+	/*!
+	* @param name The pass's name; a string literal
+	*/
+	void Profiler::beginGpu(const char *name) {
+		if (!isEnabled() || !haveTimerQueries()) {
+			return;
+		}
+		if (gpuDepth++ > 0) {
+			return;
+		}
+
+		GLuint query;
+		if (freeQueries.empty()) {
+			pkGlGenQueries(1, &query);
+		} else {
+			query = freeQueries.back();
+			freeQueries.pop_back();
+		}
+
+		pkGlBeginQuery(GL_TIME_ELAPSED, query);
+		activeQuery.query = query;
+		activeQuery.name = name;
+		activeQuery.start = getTicks();
+	}
+
+	void Profiler::endGpu() {
+		// A pass begun while recording was off, or without timer queries, was not counted
+		if (gpuDepth == 0 || --gpuDepth > 0) {
+			return;
+		}
+
+		pkGlEndQuery(GL_TIME_ELAPSED);
+		pendingQueries.push_back(activeQuery);
+		activeQuery.query = 0;
+	}
+
+	void Profiler::endFrame() {
+		frames++;
+
+		while (!pendingQueries.empty()) {
+			const PendingQuery &pending = pendingQueries.front();
+			GLint available = 0;
+			pkGlGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				break;
+			}
+
+			GLuint64 elapsed = 0;
+			pkGlGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+			if (!gpuRing) {
+				gpuRing = addRing("GPU", true);
+			}
+			append(gpuRing, pending.name, pending.start, pending.start + elapsed);
+
+			freeQueries.push_back(pending.query);
+			pendingQueries.pop_front();
+		}
+	}
+
+	/*!
+	* @return The number of frames ended
+	*/
+	unsigned long Profiler::getFrameCount() {
+		return frames;
+	}
+
+	/*!
+	* @return The time since profiling began, in nanoseconds
+	*/
+	boost::uint64_t Profiler::getTicks() {
+		return (boost::uint64_t) boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::steady_clock::now() - epoch).count();
+	}
+
+	/*!
+	* The 99th percentile is the time 99% of the scope's events took no
+	* longer than.
+	*
+	* @param summaries Receives a summary per scope
+	*/
+	void Profiler::getSummaries(std::vector<Summary> &summaries) {
+		std::vector<Ring *> all;
+		{
+			boost::mutex::scoped_lock lock(ringsMutex);
+			all = rings;
+		}
+
+		// Scopes are told apart by name, since the same literal may have several addresses
+		std::map<std::pair<std::string, bool>, std::vector<double> > durations;
+		std::vector<Event> events;
+		for (size_t r = 0; r < all.size(); r++) {
+			events.clear();
+			snapshot(*all[r], events);
+			for (size_t i = 0; i < events.size(); i++) {
+				durations[std::make_pair(std::string(events[i].name), all[r]->gpu)].push_back((events[i].end - events[i].start) / 1e6);
+			}
+		}
+
+		summaries.clear();
+		for (std::map<std::pair<std::string, bool>, std::vector<double> >::iterator i = durations.begin(); i != durations.end(); ++i) {
+			std::vector<double> &times = i->second;
+			std::sort(times.begin(), times.end());
+
+			Summary summary;
+			summary.name = i->first.first;
+			summary.gpu = i->first.second;
+			summary.count = (unsigned long) times.size();
+			summary.min = times.front();
+			summary.total = 0;
+			for (size_t t = 0; t < times.size(); t++) {
+				summary.total += times[t];
+			}
+			summary.average = summary.total / times.size();
+			summary.p99 = times[(times.size() * 99 + 99) / 100 - 1];
+			summaries.push_back(summary);
+		}
+	}
+
+	/*!
+	* @param out The stream to write to
+	*/
+	void Profiler::printSummary(std::ostream &out) {
+		std::vector<Summary> summaries;
+		getSummaries(summaries);
+
+		char line[256];
+		sprintf(line, "%-36s %-4s %8s %10s %10s %10s %12s\n", "scope", "", "count", "min ms", "avg ms", "p99 ms", "total ms");
+		out << line;
+		for (size_t i = 0; i < summaries.size(); i++) {
+			const Summary &summary = summaries[i];
+			sprintf(line, "%-36.36s %-4s %8lu %10.3f %10.3f %10.3f %12.3f\n", summary.name.c_str(), summary.gpu ? "gpu" : "cpu",
+				summary.count, summary.min, summary.average, summary.p99, summary.total);
+			out << line;
+		}
+		sprintf(line, "over %lu frames\n", getFrameCount());
+		out << line;
+	}
+
+	/*!
+	* Each ring is a thread of the trace, named by a metadata event; scopes
+	* are complete ("X") events in microseconds.
+	*
+	* @param out The stream to write to
+	*/
+	void Profiler::writeChromeTrace(std::ostream &out) {
+		std::vector<Ring *> all;
+		std::vector<std::string> names;
+		{
+			boost::mutex::scoped_lock lock(ringsMutex);
+			all = rings;
+			for (size_t r = 0; r < all.size(); r++) {
+				names.push_back(all[r]->name);
+			}
+		}
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		std::vector<Event> events;
+		char number[64];
+		for (size_t r = 0; r < all.size(); r++) {
+			out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << all[r]->id << ",\"args\":{\"name\":";
+			writeJsonString(out, names[r]);
+			out << "}}";
+			first = false;
+
+			events.clear();
+			snapshot(*all[r], events);
+			for (size_t i = 0; i < events.size(); i++) {
+				out << ",\n{\"name\":";
+				writeJsonString(out, events[i].name);
+				sprintf(number, "%.3f,\"dur\":%.3f", events[i].start / 1e3, (events[i].end - events[i].start) / 1e3);
+				out << ",\"cat\":\"" << (all[r]->gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << number
+					<< ",\"pid\":1,\"tid\":" << all[r]->id << "}";
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	/*!
+	* @param fileName The file to write
+	*/
+	void Profiler::writeChromeTrace(const std::string &fileName) {
+		std::ofstream out(fileName.c_str());
+		if (!out) {
+			throw std::runtime_error("Profiler: could not open " + fileName);
+		}
+		writeChromeTrace(out);
+		if (!out) {
+			throw std::runtime_error("Profiler: could not write " + fileName);
+		}
+	}
+
+	/*!
+	* Events being recorded as this is called may survive it.
+	*/
+	void Profiler::clear() {
+		boost::mutex::scoped_lock lock(ringsMutex);
+		for (size_t r = 0; r < rings.size(); r++) {
+			rings[r]->first.store(rings[r]->written.load(boost::memory_order_acquire), boost::memory_order_relaxed);
+		}
+	}
+
+	void Profiler::release() {
+		if (!haveTimerQueries()) {
+			return;
+		}
+		for (size_t i = 0; i < pendingQueries.size(); i++) {
+			freeQueries.push_back(pendingQueries[i].query);
+		}
+		pendingQueries.clear();
+		if (!freeQueries.empty()) {
+			pkGlDeleteQueries((GLsizei) freeQueries.size(), &freeQueries[0]);
+			freeQueries.clear();
+		}
+	}
+
+}
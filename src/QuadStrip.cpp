@@ -69,6 +69,12 @@ namespace peek {
 		}
 	}
 
+	/**
+	*/
+	void QuadStrip::appendTo(PrimitiveStreams &streams) const {
+		streams.addQuadStrip(this->v.begin(), this->v.end());
+	}
+
 	void QuadStrip::addVertex(const Vertex3d::listIndex &v) {
 		this->v.push_back(v);
 	}
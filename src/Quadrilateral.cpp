@@ -84,4 +84,10 @@ namespace peek {
 		normals[v3] += normal;
 	}
 
+	/*!
+	*/
+	void Quadrilateral::appendTo(PrimitiveStreams &streams) const {
+		streams.addQuad((PrimitiveStreams::index) v0, (PrimitiveStreams::index) v1, (PrimitiveStreams::index) v2, (PrimitiveStreams::index) v3);
+	}
+
 }
@@ -0,0 +1,390 @@
+/**
+* @file RenderQueue.cpp
+*/
+
+#include "RenderQueue.hpp"
+#include "Profiler.hpp"
+#include "SmoothMesh.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace peek {
+
+	namespace {
+
+		/** Where each field of a sort key starts */
+		const int passShift = 62;
+		const int stateShift = 56;
+		const int materialShift = 40;
+		const int meshShift = 24;
+		const int depthShift = 0;
+
+		/** The largest material number a key can hold; later materials share it, and are only grouped, not told apart */
+		const unsigned int maxKeyMaterial = 0xffff;
+
+		/** The largest mesh number a key can hold; later meshes share it, and are only grouped, not told apart */
+		const unsigned int maxKeyMesh = 0xffff;
+
+#ifdef PEEK_PROFILING
+		/** The names the passes' GPU times are recorded under */
+		const char *const passNames[] = { "RenderQueue solid pass", "RenderQueue wireframe pass", "RenderQueue normals pass" };
+#endif
+
+		/**
+		* Turns a distance into 24 bits that sort in the same order.  The bits
+		* of a non-negative float already sort as the float does, so the top
+		* 24 of its 31 non-sign bits will do.
+		*/
+		inline boost::uint64_t depthBits(double distance) {
+			float f = (float) std::max(distance, 0.0);
+			boost::uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			return bits >> 7;
+		}
+
+		/** Compares the components of two colours in turn */
+		inline int compareColors(const Color &a, const Color &b) {
+			for (int i = 0; i < 4; i++) {
+				if (a.c[i] != b.c[i]) {
+					return a.c[i] < b.c[i] ? -1 : 1;
+				}
+			}
+			return 0;
+		}
+
+	}
+
+	bool RenderQueue::MaterialLess::operator()(const Material &a, const Material &b) const {
+		int c;
+		if ((c = compareColors(a.getAmbient(), b.getAmbient())) != 0) return c < 0;
+		if ((c = compareColors(a.getDiffuse(), b.getDiffuse())) != 0) return c < 0;
+		if ((c = compareColors(a.getSpecular(), b.getSpecular())) != 0) return c < 0;
+		if ((c = compareColors(a.getEmission(), b.getEmission())) != 0) return c < 0;
+		return a.getShininess() < b.getShininess();
+	}
+
+	RenderQueue::RenderQueue() {
+		this->instancing = true;
+	}
+
+	/*!
+	* @param view The view matrix the frame is drawn with
+	*/
+	void RenderQueue::begin(const Matrix<double> &view) {
+		this->view = view;
+		this->items.clear();
+		this->entries.clear();
+		this->meshIds.clear();
+	}
+
+	/*!
+	* @param pass The pass to draw the mesh in
+	* @param state The State bits to draw the mesh with
+	* @param mesh The mesh, which must outlive the frame
+	* @param modelMatrix The transformation of the mesh's model, which must outlive the frame
+	* @param worldCenter The center of the model, in world space
+	* @param normalScale The length of the normals, for the normals pass
+	*/
+	void RenderQueue::add(Pass pass, unsigned int state, const SmoothMesh *mesh, const Matrix<double> *modelMatrix, const Point3d &worldCenter, double normalScale) {
+		Item item;
+		item.mesh = mesh;
+		item.modelMatrix = modelMatrix;
+		item.normalScale = normalScale;
+		item.materialId = 0;
+
+		if (state & STATE_MATERIAL) {
+			optional<Material> material = mesh->getMaterial();
+			if (material) {
+				item.materialId = getMaterialId(*material);
+			}
+		}
+
+		Point3d eye = this->view * worldCenter;
+
+		SortEntry entry;
+		entry.key = ((boost::uint64_t) pass << passShift)
+			| ((boost::uint64_t) (state & 0x3f) << stateShift)
+			| ((boost::uint64_t) std::min(item.materialId, maxKeyMaterial) << materialShift)
+			| ((boost::uint64_t) std::min(getMeshId(mesh), maxKeyMesh) << meshShift)
+			| (depthBits(-eye.z) << depthShift);
+		entry.index = (boost::uint32_t) this->items.size();
+
+		this->items.push_back(item);
+		this->entries.push_back(entry);
+	}
+
+	/*!
+	* The other queue's keys were made with its own material and mesh
+	* numbers, so only those fields are made again, by looking up each of
+	* its materials and meshes once rather than each mesh it queued.
+	*
+	* @param list The other queue
+	*/
+	void RenderQueue::append(const RenderQueue &list) {
+		std::vector<unsigned int> materials(list.materialIds.size() + 1, 0);
+		for (std::map<Material, unsigned int, MaterialLess>::const_iterator i = list.materialIds.begin(); i != list.materialIds.end(); ++i) {
+			materials[i->second] = getMaterialId(i->first);
+		}
+
+		std::vector<unsigned int> meshes(list.meshIds.size(), 0);
+		for (std::map<const SmoothMesh *, unsigned int>::const_iterator i = list.meshIds.begin(); i != list.meshIds.end(); ++i) {
+			meshes[i->second] = getMeshId(i->first);
+		}
+
+		const boost::uint64_t fields = ((boost::uint64_t) maxKeyMaterial << materialShift) | ((boost::uint64_t) maxKeyMesh << meshShift);
+		boost::uint32_t offset = (boost::uint32_t) this->items.size();
+
+		for (std::vector<SortEntry>::const_iterator e = list.entries.begin(); e != list.entries.end(); ++e) {
+			const Item &item = list.items[e->index];
+
+			// Meshes past the last number a key holds share it, so theirs is looked up
+			unsigned int listMesh = (unsigned int) (e->key >> meshShift) & maxKeyMesh;
+			unsigned int mesh = (listMesh < maxKeyMesh ? meshes[listMesh] : getMeshId(item.mesh));
+
+			SortEntry entry;
+			entry.key = (e->key & ~fields)
+				| ((boost::uint64_t) std::min(materials[item.materialId], maxKeyMaterial) << materialShift)
+				| ((boost::uint64_t) std::min(mesh, maxKeyMesh) << meshShift);
+			entry.index = offset + e->index;
+
+			this->entries.push_back(entry);
+		}
+
+		this->items.insert(this->items.end(), list.items.begin(), list.items.end());
+		for (std::vector<Item>::iterator i = this->items.begin() + offset; i != this->items.end(); ++i) {
+			i->materialId = materials[i->materialId];
+		}
+	}
+
+	/*!
+	* The OpenGL state the queue sets is forgotten first, since anything may
+	* have changed it since the last frame.
+	*/
+	void RenderQueue::execute() {
+		PEEK_PROFILE_SCOPE("RenderQueue::execute");
+		sort();
+		findBatches();
+
+		this->stateCache.invalidate();
+		this->instancingStats.reset();
+
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+
+#ifdef PEEK_PROFILING
+		// The entries are sorted by pass, so each pass's GPU time is one query
+		int profiledPass = -1;
+#endif
+
+		std::vector<Batch>::const_iterator batch = this->batches.begin();
+		for (size_t e = 0; e < this->entries.size(); e++) {
+			const Item &item = this->items[this->entries[e].index];
+			boost::uint64_t key = this->entries[e].key;
+			Pass pass = (Pass) (key >> passShift);
+			unsigned int state = (unsigned int) (key >> stateShift) & 0x3f;
+
+#ifdef PEEK_PROFILING
+			if ((int) pass != profiledPass) {
+				if (profiledPass >= 0) {
+					PEEK_PROFILE_GPU_END();
+				}
+				PEEK_PROFILE_GPU_BEGIN(passNames[pass]);
+				profiledPass = (int) pass;
+			}
+#endif
+
+			this->stateCache.setEnabled(GlStateCache::CAP_LIGHTING, (state & STATE_LIGHTING) != 0);
+			this->stateCache.setEnabled(GlStateCache::CAP_CULL_FACE, (state & STATE_CULL_FACE) != 0);
+			if (state & STATE_CULL_FACE) {
+				this->stateCache.setCullFace(GL_BACK);
+			}
+			this->stateCache.setEnabled(GlStateCache::CAP_POLYGON_OFFSET_FILL, (state & STATE_POLYGON_OFFSET) != 0);
+			if (state & STATE_POLYGON_OFFSET) {
+				this->stateCache.setPolygonOffset(1.0f, 1.0f);
+			}
+			this->stateCache.setPolygonMode(pass == PASS_WIREFRAME ? GL_LINE : GL_FILL);
+
+			if (batch != this->batches.end() && batch->first == e) {
+				// The program does its own lighting and colouring, and leaves the cached state alone
+				size_t count = batch->end - batch->first;
+				this->batcher.draw(*item.mesh, batch->firstInstance, count, (state & STATE_LIGHTING) != 0);
+				this->instancingStats.drawCalls += item.mesh->getDrawCallCount(true);
+
+				this->instancingStats.batches++;
+				this->instancingStats.batchedInstances += (unsigned int) count;
+				this->instancingStats.largestBatch = std::max(this->instancingStats.largestBatch, (unsigned int) count);
+
+				e = batch->end - 1;
+				++batch;
+				continue;
+			}
+
+			this->instancingStats.singleDraws++;
+
+			if (pass == PASS_NORMALS) {
+				// drawNormals() applies the mesh's own transformation, and sets its own colour
+				glLoadMatrixd((this->view * *item.modelMatrix).getArray());
+				item.mesh->drawNormals(item.normalScale);
+				this->stateCache.forgetColor();
+				this->instancingStats.drawCalls++;
+				continue;
+			}
+
+			glLoadMatrixd((this->view * *item.modelMatrix * item.mesh->getTransformMatrix()).getArray());
+
+			if (item.materialId) {
+				this->stateCache.setMaterial(*item.mesh->getMaterial(), item.materialId);
+			}
+			else {
+				this->stateCache.setColor(0.5f, 0.5f, 0.5f);
+			}
+
+			item.mesh->drawGeometry();
+			this->instancingStats.drawCalls += item.mesh->getDrawCallCount(false);
+		}
+
+#ifdef PEEK_PROFILING
+		if (profiledPass >= 0) {
+			PEEK_PROFILE_GPU_END();
+		}
+#endif
+
+		glPopMatrix();
+	}
+
+	void RenderQueue::release() {
+		this->batcher.release();
+	}
+
+	/*!
+	* @param material The material
+	* @return The material's number, from 1; 0 means no material
+	*/
+	unsigned int RenderQueue::getMaterialId(const Material &material) {
+		std::map<Material, unsigned int, MaterialLess>::const_iterator i = this->materialIds.find(material);
+		if (i != this->materialIds.end()) {
+			return i->second;
+		}
+
+		unsigned int id = (unsigned int) this->materialIds.size() + 1;
+		this->materialIds.insert(std::make_pair(material, id));
+		return id;
+	}
+
+	/*!
+	* @param mesh The mesh
+	* @return The mesh's number, from 0
+	*/
+	unsigned int RenderQueue::getMeshId(const SmoothMesh *mesh) {
+		std::map<const SmoothMesh *, unsigned int>::const_iterator i = this->meshIds.find(mesh);
+		if (i != this->meshIds.end()) {
+			return i->second;
+		}
+
+		unsigned int id = (unsigned int) this->meshIds.size();
+		this->meshIds.insert(std::make_pair(mesh, id));
+		return id;
+	}
+
+	/*!
+	* The histograms of all eight bytes are taken in one sweep.  A byte that
+	* every key shares (the unused low bits, or the pass when there is only
+	* one) would leave the order unchanged, so its pass is skipped.  The sort
+	* is stable, so equal keys are drawn in the order they were queued.
+	*/
+	void RenderQueue::sort() {
+		PEEK_PROFILE_SCOPE("RenderQueue::sort");
+		size_t count = this->entries.size();
+		if (count < 2) {
+			return;
+		}
+
+		std::vector<size_t> histograms(8 * 256, 0);
+		for (size_t i = 0; i < count; i++) {
+			boost::uint64_t key = this->entries[i].key;
+			for (int b = 0; b < 8; b++) {
+				histograms[b * 256 + ((key >> (8 * b)) & 0xff)]++;
+			}
+		}
+
+		this->scratch.resize(count);
+		SortEntry *in = &this->entries[0], *out = &this->scratch[0];
+
+		for (int b = 0; b < 8; b++) {
+			size_t *histogram = &histograms[b * 256];
+			if (histogram[(in[0].key >> (8 * b)) & 0xff] == count) {
+				continue;
+			}
+
+			size_t offset = 0;
+			for (int d = 0; d < 256; d++) {
+				size_t n = histogram[d];
+				histogram[d] = offset;
+				offset += n;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				out[histogram[(in[i].key >> (8 * b)) & 0xff]++] = in[i];
+			}
+			std::swap(in, out);
+		}
+
+		if (in != &this->entries[0]) {
+			this->entries.swap(this->scratch);
+		}
+	}
+
+	/*!
+	* A batch is a run of entries with the same key above the depth, and the
+	* same mesh, since meshes past the last number a key can hold share it.
+	* The normals pass is drawn by the meshes themselves, so is never batched.
+	*/
+	void RenderQueue::findBatches() {
+		this->batches.clear();
+		this->batcher.clear();
+
+		if (!this->instancing || this->entries.size() < minBatchSize || !this->batcher.isAvailable()) {
+			return;
+		}
+
+		size_t count = this->entries.size();
+		for (size_t first = 0, end; first < count; first = end) {
+			const Item &item = this->items[this->entries[first].index];
+			boost::uint64_t group = this->entries[first].key >> meshShift;
+
+			for (end = first + 1; end < count; end++) {
+				if ((this->entries[end].key >> meshShift) != group || this->items[this->entries[end].index].mesh != item.mesh) {
+					break;
+				}
+			}
+
+			if (end - first < minBatchSize || (Pass) (group >> (passShift - meshShift)) == PASS_NORMALS) {
+				continue;
+			}
+
+			Batch batch;
+			batch.first = first;
+			batch.end = end;
+			batch.firstInstance = 0;
+
+			optional<Material> material;
+			if (item.materialId) {
+				material = item.mesh->getMaterial();
+			}
+
+			const Matrix<double> &meshTransform = item.mesh->getTransformMatrix();
+			for (size_t e = first; e < end; e++) {
+				size_t instance = this->batcher.add(this->view * *this->items[this->entries[e].index].modelMatrix * meshTransform,
+					material ? &*material : NULL);
+				if (e == first) {
+					batch.firstInstance = instance;
+				}
+			}
+
+			this->batches.push_back(batch);
+		}
+
+		this->batcher.upload();
+	}
+
+}
\ No newline at end of file
@@ -8,14 +8,133 @@ namespace peek {
 
 	SceneGraphLeaf::SceneGraphLeaf(Model::handle model) {
 		this->model = model;
+		this->model->addObserver(this);
+		this->modelWorldDirty = true;
+	}
+
+	SceneGraphLeaf::~SceneGraphLeaf() {
+		this->model->removeObserver(this);
 	}
 
 	void SceneGraphLeaf::draw() const {
+		bool pushed = pushWorldTransform();
+		this->model->draw();
+		if (pushed) {
+			glPopMatrix();
+		}
+	}
+
+	void SceneGraphLeaf::draw(const Frustum &frustum, CullingStats &stats, unsigned int planeMask) const {
+		stats.nodesVisited++;
+
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			stats.nodesCulled++;
+			stats.leavesCulled++;
+			return;
+		}
+
+		bool pushed = pushWorldTransform();
 		this->model->draw();
+		if (pushed) {
+			glPopMatrix();
+		}
+		stats.leavesDrawn++;
+	}
+
+	void SceneGraphLeaf::enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, unsigned int planeMask) const {
+		stats.nodesVisited++;
+
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			stats.nodesCulled++;
+			stats.leavesCulled++;
+			return;
+		}
+
+		this->model->enqueue(queue, &getModelWorldMatrix(), getBoundingBox().getCenter());
+		stats.leavesDrawn++;
 	}
 
 	void SceneGraphLeaf::pick() const {
+		bool pushed = pushWorldTransform();
+		this->model->pick();
+		if (pushed) {
+			glPopMatrix();
+		}
+	}
+
+	void SceneGraphLeaf::pick(PickingIds &ids, const Frustum &frustum, unsigned int planeMask) const {
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			return;
+		}
+
+		PickingIds::setColor(ids.add(this));
+		bool pushed = pushWorldTransform();
 		this->model->pick();
+		if (pushed) {
+			glPopMatrix();
+		}
+	}
+
+	bool SceneGraphLeaf::intersect(const Ray &ray, RayHit &hit) const {
+		double tEnter;
+		if (!ray.intersect(getBoundingBox(), hit.distance, tEnter)) {
+			return false;
+		}
+
+		// An affine transformation leaves the ray's parameter alone, so the distance needs no conversion
+		bool found = (hasIdentityWorldTransform() ? this->model->intersect(ray, hit)
+			: this->model->intersect(ray.transform(this->worldInverse.getInverse(getWorldTransformMatrix())), hit));
+		if (!found) {
+			return false;
+		}
+
+		hit.leaf = this;
+		return true;
+	}
+
+	void SceneGraphLeaf::modelBoundsChanged() {
+		this->modelWorldDirty = true;
+		invalidateBounds();
+	}
+
+	/*!
+	* @return The matrix taking the model's own space to world space
+	*/
+	const Matrix<double> &SceneGraphLeaf::getModelWorldMatrix() const {
+		if (this->modelWorldDirty) {
+			this->modelWorldMatrix = (hasIdentityWorldTransform() ? this->model->getTransformMatrix()
+				: getWorldTransformMatrix() * this->model->getTransformMatrix());
+			this->modelWorldDirty = false;
+		}
+		return this->modelWorldMatrix;
+	}
+
+	/*!
+	* The model's own bounds are transformed straight to world space, rather
+	* than its world box being transformed again, which would loosen it.
+	*/
+	void SceneGraphLeaf::findBounds(BoundingBox &box, BoundingSphere &sphere, unsigned int &leafCount) const {
+		box = (hasIdentityWorldTransform() ? this->model->getWorldBoundingBox() : this->model->getBoundingBox().transform(getModelWorldMatrix()));
+		sphere = BoundingSphere::fromBox(box);
+		leafCount = 1;
+	}
+
+	void SceneGraphLeaf::worldTransformChanged() {
+		this->modelWorldDirty = true;
+	}
+
+	/*!
+	* @return Whether the matrix was pushed, and must be popped
+	*/
+	bool SceneGraphLeaf::pushWorldTransform() const {
+		if (hasIdentityWorldTransform()) {
+			return false;
+		}
+
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glMultMatrixd(getWorldTransformMatrix().getArray());
+		return true;
 	}
 
 }
\ No newline at end of file
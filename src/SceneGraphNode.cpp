@@ -3,6 +3,9 @@
 */
 
 #include "SceneGraphNode.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace peek {
 
@@ -11,6 +14,10 @@ namespace peek {
 
 	void SceneGraphNode::addChild(SceneGraphNodeBase::handle child) {
 		this->children.push_back(child);
+		child->parent = this;
+		child->invalidateWorldTransform();
+		this->structureVersion++;
+		invalidateBounds();
 	}
 
 	void SceneGraphNode::draw() const {
@@ -19,10 +26,94 @@ namespace peek {
 		}
 	}
 
+	/*!
+	* Children are only tested against the planes this node straddles; once the
+	* node is wholly inside the frustum, its children are drawn without tests.
+	*/
+	void SceneGraphNode::draw(const Frustum &frustum, CullingStats &stats, unsigned int planeMask) const {
+		stats.nodesVisited++;
+
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			stats.nodesCulled++;
+			stats.leavesCulled += getLeafCount();
+			return;
+		}
+
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			(*i)->draw(frustum, stats, planeMask);
+		}
+	}
+
+	void SceneGraphNode::enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, unsigned int planeMask) const {
+		stats.nodesVisited++;
+
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			stats.nodesCulled++;
+			stats.leavesCulled += getLeafCount();
+			return;
+		}
+
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			(*i)->enqueue(queue, frustum, stats, planeMask);
+		}
+	}
+
 	void SceneGraphNode::pick() const {
 		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
 			(*i)->pick();
 		}
 	}
 
+	void SceneGraphNode::pick(PickingIds &ids, const Frustum &frustum, unsigned int planeMask) const {
+		if (frustum.classify(getBoundingBox(), getBoundingSphere(), planeMask) == Frustum::OUTSIDE) {
+			return;
+		}
+
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			(*i)->pick(ids, frustum, planeMask);
+		}
+	}
+
+	/*!
+	* Once a hit is found, children the ray only reaches beyond it are skipped.
+	*/
+	bool SceneGraphNode::intersect(const Ray &ray, RayHit &hit) const {
+		double tEnter;
+		if (!ray.intersect(getBoundingBox(), hit.distance, tEnter)) {
+			return false;
+		}
+
+		std::vector<std::pair<double, const SceneGraphNodeBase *> > reached;
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			if (ray.intersect((*i)->getBoundingBox(), hit.distance, tEnter)) {
+				reached.push_back(std::make_pair(tEnter, (*i).get()));
+			}
+		}
+		std::sort(reached.begin(), reached.end());
+
+		bool found = false;
+		for (size_t i = 0; i < reached.size() && reached[i].first <= hit.distance; i++) {
+			found |= reached[i].second->intersect(ray, hit);
+		}
+		return found;
+	}
+
+	void SceneGraphNode::findBounds(BoundingBox &box, BoundingSphere &sphere, unsigned int &leafCount) const {
+		box = BoundingBox();
+		sphere = BoundingSphere();
+		leafCount = 0;
+
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			box.merge((*i)->getBoundingBox());
+			sphere.merge((*i)->getBoundingSphere());
+			leafCount += (*i)->getLeafCount();
+		}
+	}
+
+	void SceneGraphNode::worldTransformChanged() {
+		for (SceneGraphNodeBase::list::const_iterator i = this->children.begin(); i < this->children.end(); ++i) {
+			(*i)->invalidateWorldTransform();
+		}
+	}
+
 }
\ No newline at end of file
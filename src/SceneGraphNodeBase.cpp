@@ -0,0 +1,134 @@
+/**
+* @file SceneGraphNodeBase.cpp
+*/
+
+#include "SceneGraphNodeBase.hpp"
+
+namespace peek {
+
+	SceneGraphNodeBase::SceneGraphNodeBase() {
+		this->parent = 0;
+		this->leafCount = 0;
+		this->boundsDirty = true;
+		this->boundsVersion = 0;
+		this->structureVersion = 0;
+		this->worldIdentity = true;
+		this->worldTransformDirty = true;
+	}
+
+	const BoundingBox &SceneGraphNodeBase::getBoundingBox() const {
+		updateBounds();
+		return this->boundingBox;
+	}
+
+	const BoundingSphere &SceneGraphNodeBase::getBoundingSphere() const {
+		updateBounds();
+		return this->boundingSphere;
+	}
+
+	unsigned int SceneGraphNodeBase::getLeafCount() const {
+		updateBounds();
+		return this->leafCount;
+	}
+
+	/*!
+	* @param ray The ray, in world space
+	* @return The nearest hit, which is a miss if nothing was hit
+	*/
+	RayHit SceneGraphNodeBase::castRay(const Ray &ray) const {
+		RayHit hit;
+		if (intersect(ray, hit)) {
+			hit.point = ray.getPoint(hit.distance);
+		}
+		return hit;
+	}
+
+	/*!
+	* The hit's distance is measured from the near plane, in world units.
+	*
+	* @param rigging The rigging of the camera the scene is seen through
+	* @param x The pixel's distance from the left of the viewport
+	* @param y The pixel's distance from the top of the viewport
+	* @return The nearest hit, which is a miss if nothing was hit
+	*/
+	RayHit SceneGraphNodeBase::castRay(CameraRigging &rigging, int x, int y) const {
+		return castRay(rigging.getPickingRay(x, y));
+	}
+
+	/*!
+	* A node's ancestors are always out of date when it is, so the walk stops at
+	* the first node that is already marked.
+	*/
+	void SceneGraphNodeBase::invalidateBounds() {
+		for (SceneGraphNodeBase *node = this; node != 0 && !node->boundsDirty; node = node->parent) {
+			node->boundsDirty = true;
+		}
+	}
+
+	/*!
+	* The parent's world transformation is brought up to date first, so a
+	* node that is up to date always has ancestors that are too.
+	*
+	* @return The node's transformation followed by those of its ancestors
+	*/
+	const Matrix<double> &SceneGraphNodeBase::getWorldTransformMatrix() const {
+		if (this->worldTransformDirty) {
+			bool ownIdentity = (this->origin.x == 0.0 && this->origin.y == 0.0 && this->origin.z == 0.0
+				&& this->rotation.x == 0.0 && this->rotation.y == 0.0 && this->rotation.z == 0.0 && this->scale == 1.0);
+
+			if (this->parent == 0 || this->parent->hasIdentityWorldTransform()) {
+				this->worldTransform = getTransformMatrix();
+				this->worldIdentity = ownIdentity;
+			}
+			else if (ownIdentity) {
+				this->worldTransform = this->parent->getWorldTransformMatrix();
+				this->worldIdentity = false;
+			}
+			else {
+				this->worldTransform = this->parent->getWorldTransformMatrix() * getTransformMatrix();
+				this->worldIdentity = false;
+			}
+
+			this->worldTransformDirty = false;
+		}
+		return this->worldTransform;
+	}
+
+	/*!
+	* Scenes built without transformations on their nodes are drawn exactly as
+	* they were, without touching the modelview matrix.
+	*/
+	bool SceneGraphNodeBase::hasIdentityWorldTransform() const {
+		getWorldTransformMatrix();
+		return this->worldIdentity;
+	}
+
+	void SceneGraphNodeBase::transformChanged() {
+		invalidateBounds();
+		invalidateWorldTransform();
+	}
+
+	/*!
+	* A node that is already out of date has nothing under it that is up to
+	* date, so the walk stops there, and a node that has not moved since the
+	* last frame costs nothing.
+	*/
+	void SceneGraphNodeBase::invalidateWorldTransform() {
+		if (this->worldTransformDirty) {
+			return;
+		}
+
+		this->worldTransformDirty = true;
+		this->boundsDirty = true;
+		worldTransformChanged();
+	}
+
+	void SceneGraphNodeBase::updateBounds() const {
+		if (this->boundsDirty) {
+			findBounds(this->boundingBox, this->boundingSphere, this->leafCount);
+			this->boundsDirty = false;
+			this->boundsVersion++;
+		}
+	}
+
+}
@@ -0,0 +1,113 @@
+/**
+ * \file Simd.cpp
+ * \author Douglas W. Paul
+ *
+ * Detects the SIMD instruction sets supported at runtime.
+ */
+
+#include "Simd.hpp"
+
+#ifdef PEEK_X86_SIMD
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+
+namespace peek {
+
+#ifdef PEEK_X86_SIMD
+
+	/**
+	 * Executes the cpuid instruction.
+	 */
+	static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4]) {
+#ifdef _MSC_VER
+		int values[4];
+		__cpuidex(values, (int) leaf, (int) subleaf);
+		for (int i = 0; i < 4; i++) {
+			registers[i] = (unsigned int) values[i];
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	/**
+	 * Reads the extended control register that says which register states the
+	 * operating system saves.
+	 */
+	static unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ __volatile__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long) edx << 32) | eax;
+#endif
+	}
+
+	/**
+	 * Queries the CPU and operating system for the best supported instruction set.
+	 */
+	static SimdLevel detectSimdLevel() {
+		unsigned int registers[4];
+
+		cpuid(0, 0, registers);
+		unsigned int maxLeaf = registers[0];
+		if (maxLeaf < 1) {
+			return SIMD_SCALAR;
+		}
+
+		cpuid(1, 0, registers);
+		bool sse2 = (registers[3] & (1u << 26)) != 0;
+		bool osxsave = (registers[2] & (1u << 27)) != 0;
+		bool avx = (registers[2] & (1u << 28)) != 0;
+		if (!sse2) {
+			return SIMD_SCALAR;
+		}
+
+		// AVX2 needs the operating system to preserve the YMM registers
+		if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 0x6) == 0x6) {
+			cpuid(7, 0, registers);
+			if (registers[1] & (1u << 5)) {
+				return SIMD_AVX2;
+			}
+		}
+
+		return SIMD_SSE2;
+	}
+
+#else
+
+	static SimdLevel detectSimdLevel() {
+		return SIMD_SCALAR;
+	}
+
+#endif
+
+	/*!
+	 * The result is detected once and then cached.
+	 */
+	SimdLevel getSimdLevel() {
+		static SimdLevel level = detectSimdLevel();
+		return level;
+	}
+
+	/*!
+	 * \param level The instruction set
+	 * \return The name of the instruction set
+	 */
+	const char *getSimdLevelName(SimdLevel level) {
+		switch (level) {
+			case SIMD_AVX2:
+				return "avx2";
+			case SIMD_SSE2:
+				return "sse2";
+			default:
+				return "scalar";
+		}
+	}
+
+}
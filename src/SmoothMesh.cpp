@@ -3,6 +3,7 @@
 */
 #include "Peek_base.hpp"
 #include "SmoothMesh.hpp"
+#include "NormalGenerator.hpp"
 #include <limits>
 
 namespace peek {
@@ -13,7 +14,7 @@ namespace peek {
 	* @param material The material to render the model with
 	*/
 	SmoothMesh::SmoothMesh(Vertex3d::list verts, Primitive::list primitives, const Material &material) {
-		construct(verts, primitives, material);
+		construct(verts, toStreams(primitives), material);
 	}
 
 	/*!
@@ -21,21 +22,55 @@ namespace peek {
 	* @param primitives The list of primitives that compose the model
 	*/
 	SmoothMesh::SmoothMesh(Vertex3d::list verts, Primitive::list primitives) {
+		construct(verts, toStreams(primitives), Material::DEFAULT);
+	}
+
+	/*!
+	* @param verts The list of vertices that compose the model
+	* @param primitives The index streams of the primitives that compose the model
+	* @param material The material to render the model with
+	*/
+	SmoothMesh::SmoothMesh(const Vertex3d::list &verts, const PrimitiveStreams &primitives, const Material &material) {
+		construct(verts, primitives, material);
+	}
+
+	/*!
+	* @param verts The list of vertices that compose the model
+	* @param primitives The index streams of the primitives that compose the model
+	*/
+	SmoothMesh::SmoothMesh(const Vertex3d::list &verts, const PrimitiveStreams &primitives) {
 		construct(verts, primitives, Material::DEFAULT);
 	}
 
 	/*!
 	* @param verts The list of vertices that compose the model
-	* @param primitives The list of primitives that compose the model
+	* @param primitives The index streams of the primitives that compose the model
 	* @param material The material to render the model with
 	*/
-	void SmoothMesh::construct(Vertex3d::list verts, Primitive::list primitives, const Material &material) {
+	void SmoothMesh::construct(const Vertex3d::list &verts, const PrimitiveStreams &primitives, const Material &material) {
 		this->verts = verts;
 		this->primitives = primitives;
+		this->primitives.shrinkToFit();
 		this->material = material;
 
 		generateNormals();
 		findBoundingBox();
+		invalidateBuffers();
+		this->bvh.reset();
+	}
+
+	/*!
+	* @param primitives The primitives to convert
+	* @return The primitives' index streams
+	*/
+	PrimitiveStreams SmoothMesh::toStreams(const Primitive::list &primitives) {
+		PrimitiveStreams streams;
+
+		for(Primitive::list::const_iterator i = primitives.begin(); i != primitives.end(); ++i) {
+			(*i)->appendTo(streams);
+		}
+
+		return streams;
 	}
 
 	/*!
@@ -63,10 +98,8 @@ namespace peek {
 			glColor3f(0.5, 0.5, 0.5);
 		}
 
-
-		for(Primitive::list::const_iterator i = this->primitives.begin(); i < this->primitives.end(); ++i) {
-			(*i)->draw(this->verts, this->vertNormals);
-		}
+		updateBuffers();
+		this->buffers.draw(true);
 
 		glPopMatrix();
 	}
@@ -79,13 +112,77 @@ namespace peek {
 
 		// \todo Do we need to worry about lighting mode, etc, here?
 
-		for(Primitive::list::const_iterator i = this->primitives.begin(); i < this->primitives.end(); ++i) {
-			(*i)->pick(this->verts);
-		}
+		updateBuffers();
+		this->buffers.draw(false);
 
 		glPopMatrix();
 	}
 
+	/*!
+	*/
+	void SmoothMesh::drawGeometry() const {
+		updateBuffers();
+		this->buffers.draw(true);
+	}
+
+	/*!
+	* @param instanceCount The number of instances to draw
+	*/
+	void SmoothMesh::drawGeometryInstanced(GLsizei instanceCount) const {
+		updateBuffers();
+		this->buffers.drawInstanced(instanceCount);
+	}
+
+	/*!
+	* @param instanced Whether to count the calls of an instanced draw
+	* @return The number of draw calls
+	*/
+	unsigned int SmoothMesh::getDrawCallCount(bool instanced) const {
+		updateBuffers();
+		return instanced ? this->buffers.getInstancedDrawCallCount() : this->buffers.getDrawCallCount();
+	}
+
+	/*!
+	* @param ray The ray, in the space of whatever the mesh belongs to
+	* @param hit The nearest hit so far, which is replaced if a nearer face is hit
+	* @return Whether or not a nearer face was hit
+	*/
+	bool SmoothMesh::intersect(const Ray &ray, RayHit &hit) const {
+		Ray local = ray.transform(this->transformInverse.getInverse(getTransformMatrix()));
+		if(!getBvh().intersect(this->verts, local, hit)) {
+			return false;
+		}
+
+		hit.mesh = this;
+		return true;
+	}
+
+	/*!
+	* The hierarchy is built on the calling thread, so the first call should
+	* not race with others.
+	*/
+	const MeshBvh &SmoothMesh::getBvh() const {
+		if(!this->bvh) {
+			this->bvh.reset(new MeshBvh(this->verts, this->primitives));
+		}
+		return *this->bvh;
+	}
+
+	/*!
+	* The vertex normals are reordered with the vertices rather than
+	* generated again, and the face hierarchy is rebuilt when next needed,
+	* since the faces are numbered afresh.
+	*
+	* @param optimizer The optimizer to reorder with
+	* @param before The vertex cache before reordering, if not NULL
+	* @param after The vertex cache after reordering, if not NULL
+	*/
+	void SmoothMesh::optimize(const MeshOptimizer &optimizer, VertexCacheStats *before, VertexCacheStats *after) {
+		optimizer.optimize(this->verts, this->vertNormals, this->primitives, before, after);
+		invalidateBuffers();
+		this->bvh.reset();
+	}
+
 	/*!
 	*/
 	void SmoothMesh::drawNormals(double normalScale) const {
@@ -118,11 +215,9 @@ namespace peek {
 		// Disable lighting for drawing vertices
 		glDisable(GL_LIGHTING);
 		glColor3f(0.0, 0.0, 1.0);
-		glBegin(GL_POINTS);
-		for(Vertex3d::listIndex i=0; i < this->verts.size(); i++) {
-			glVertex3d(this->verts[i].x, this->verts[i].y, this->verts[i].z);
-		}
-		glEnd();
+
+		updateBuffers();
+		this->buffers.drawPoints();
 
 		glPopMatrix();
 	}
@@ -130,42 +225,29 @@ namespace peek {
 	/*!
 	*/
 	void SmoothMesh::generateNormals() {
-		this->vertNormals.resize(this->verts.size());
-
-		for(Primitive::list::const_iterator i = this->primitives.begin(); i < this->primitives.end(); ++i) {
-			(*i)->addVertexNormals(this->verts, this->vertNormals);
-		}
-
-		for(Normal3d::listIndex i=0; i < this->vertNormals.size(); i++) {
-			this->vertNormals[i].normalize();
-		}
+		NormalGenerator generator;
+		generator.generate(this->verts, this->primitives, this->vertNormals);
 	}
 
 	/*!
 	*/
 	void SmoothMesh::findBoundingBox() {
-		double lowX, lowY, lowZ, highX, highY, highZ;
+		this->boundingBox = BoundingBox::fromPoints(this->verts);
+	}
 
-		lowX = lowY = lowZ = numeric_limits<double>::infinity();
-		highX = highY = highZ = -numeric_limits<double>::infinity();
+	/*!
+	*/
+	void SmoothMesh::invalidateBuffers() {
+		this->buffersDirty = true;
+	}
 
-		for(Vertex3d::listIndex i=0; i < this->verts.size(); i++) {
-			if(this->verts[i].x < lowX)
-				lowX = this->verts[i].x;
-			if(this->verts[i].x > highX)
-				highX = this->verts[i].x;
-			if(this->verts[i].y < lowY)
-				lowY = this->verts[i].y;
-			if(this->verts[i].y > highY)
-				highY = this->verts[i].y;
-			if(this->verts[i].z < lowZ)
-				lowZ = this->verts[i].z;
-			if(this->verts[i].z > highZ)
-				highZ = this->verts[i].z;
+	/*!
+	*/
+	void SmoothMesh::updateBuffers() const {
+		if(this->buffersDirty || !this->buffers.isUploaded()) {
+			this->buffers.upload(this->verts, this->vertNormals, this->primitives);
+			this->buffersDirty = false;
 		}
-
-		this->boundingBoxLow.set(lowX, lowY, lowZ);
-		this->boundingBoxHigh.set(highX, highY, highZ);
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,427 @@
+/**
+* @file Stripifier.cpp
+*/
+#include "Stripifier.hpp"
+#include <algorithm>
+
+namespace peek {
+
+	namespace {
+
+		typedef PrimitiveStreams::index vertexIndex;
+
+		/** Marks an edge with no triangle on its other side */
+		const vertexIndex none = 0xffffffff;
+
+		/** An edge of a triangle, from one corner to the next */
+		struct Edge {
+			vertexIndex from, to, triangle;
+
+			inline bool operator<(const Edge &other) const {
+				return this->from < other.from || (this->from == other.from && this->to < other.to);
+			}
+		};
+
+		/**
+		* The triangles being stripped, which of them are used, and which share
+		* their edges.  Edge i of triangle t runs from corner i to corner i+1,
+		* and neighbours[3*t + i] is a triangle that has the same edge running
+		* the other way, so winds the same way as t.
+		*/
+		struct TriangleGraph {
+			const vertexIndex *v;
+			size_t count;
+			vector<vertexIndex> neighbours;
+			vector<unsigned char> degrees;
+			vector<char> used;
+			vector<unsigned int> stamps;
+			unsigned int stamp;
+
+			TriangleGraph(const PrimitiveStreams::indexList &triangles)
+				: v(triangles.empty() ? NULL : &triangles[0]), count(triangles.size() / 3),
+				neighbours(3 * count, none), degrees(count, 0), used(count, 0), stamps(count, 0), stamp(0) {
+				vector<Edge> edges;
+				edges.reserve(3 * this->count);
+				for (vertexIndex t = 0; t < this->count; t++) {
+					if (isDegenerate(t)) {
+						continue;
+					}
+					for (int i = 0; i < 3; i++) {
+						Edge edge = { corner(t, i), corner(t, i + 1), t };
+						edges.push_back(edge);
+					}
+				}
+				std::sort(edges.begin(), edges.end());
+
+				for (vector<Edge>::const_iterator e = edges.begin(); e != edges.end(); ++e) {
+					Edge reverse = { e->to, e->from, 0 };
+					vector<Edge>::const_iterator match = std::lower_bound(edges.begin(), edges.end(), reverse);
+					if (match != edges.end() && match->from == e->to && match->to == e->from && match->triangle != e->triangle) {
+						vertexIndex t = e->triangle;
+						neighbours[3 * t + edgeOf(t, e->from, e->to)] = match->triangle;
+						degrees[t]++;
+					}
+				}
+			}
+
+			/** Gets a corner of a triangle, counting around from corner 0 */
+			inline vertexIndex corner(vertexIndex t, int i) const {
+				return this->v[3 * t + i % 3];
+			}
+
+			/** Whether a triangle has a repeated vertex, so no area and no neighbours */
+			inline bool isDegenerate(vertexIndex t) const {
+				return corner(t, 0) == corner(t, 1) || corner(t, 1) == corner(t, 2) || corner(t, 2) == corner(t, 0);
+			}
+
+			/** Gets which edge of a triangle joins two of its vertices, in either direction */
+			inline int edgeOf(vertexIndex t, vertexIndex a, vertexIndex b) const {
+				for (int i = 0; i < 3; i++) {
+					vertexIndex from = corner(t, i), to = corner(t, i + 1);
+					if ((from == a && to == b) || (from == b && to == a)) {
+						return i;
+					}
+				}
+				return -1;
+			}
+
+			/** Gets which corner of a triangle a vertex is at */
+			inline int cornerOf(vertexIndex t, vertexIndex a) const {
+				return corner(t, 0) == a ? 0 : (corner(t, 1) == a ? 1 : 2);
+			}
+
+			/** Gets the neighbour across an edge if it can still be taken in the current trial */
+			inline vertexIndex available(vertexIndex t, int edge) const {
+				vertexIndex n = this->neighbours[3 * t + edge];
+				return (n != none && !this->used[n] && this->stamps[n] != this->stamp) ? n : none;
+			}
+
+			/** Starts a new trial, in which no triangle has been taken yet */
+			inline void beginTrial() {
+				this->stamp++;
+			}
+
+			/** Takes a triangle in the current trial */
+			inline void take(vertexIndex t) {
+				this->stamps[t] = this->stamp;
+			}
+
+			/** Marks a triangle used, and takes it off the unused neighbours of each of its neighbours */
+			void use(vertexIndex t, vector<vertexIndex> *buckets) {
+				this->used[t] = 1;
+				for (int i = 0; i < 3; i++) {
+					vertexIndex n = this->neighbours[3 * t + i];
+					if (n == none || this->used[n]) {
+						continue;
+					}
+
+					// A triangle and its back face share every edge, so visit each neighbour once
+					bool seen = false;
+					for (int k = 0; k < i; k++) {
+						seen = seen || this->neighbours[3 * t + k] == n;
+					}
+					if (seen) {
+						continue;
+					}
+
+					for (int j = 0; j < 3; j++) {
+						if (this->neighbours[3 * n + j] == t) {
+							this->degrees[n]--;
+						}
+					}
+					if (buckets) {
+						buckets[this->degrees[n]].push_back(n);
+					}
+				}
+			}
+		};
+
+		/**
+		* Finds the fan around a vertex through the given triangle: walks back
+		* around the vertex as far as it can go, then forward, taking
+		* triangles in the current trial.  The fan's vertices, the shared vertex
+		* first, go in fan, and the triangles it took in triangles.
+		*/
+		void growFan(TriangleGraph &graph, vertexIndex start, vertexIndex centre, vector<vertexIndex> &fan,
+			vector<vertexIndex> &triangles) {
+			fan.clear();
+			triangles.clear();
+
+			// Walk back across the edge into the centre until the fan's first triangle
+			graph.beginTrial();
+			graph.take(start);
+			vertexIndex first = start;
+			for (;;) {
+				vertexIndex previous = graph.available(first, graph.cornerOf(first, centre));
+				if (previous == none) {
+					break;
+				}
+				graph.take(previous);
+				first = previous;
+			}
+
+			graph.beginTrial();
+			vertexIndex t = first;
+			int c = graph.cornerOf(t, centre);
+			fan.push_back(centre);
+			fan.push_back(graph.corner(t, c + 1));
+			for (;;) {
+				graph.take(t);
+				triangles.push_back(t);
+				fan.push_back(graph.corner(t, c + 2));
+
+				// Cross the edge out of the centre's far side
+				vertexIndex next = graph.available(t, (c + 2) % 3);
+				if (next == none) {
+					break;
+				}
+				t = next;
+				c = graph.cornerOf(t, centre);
+			}
+		}
+
+		/**
+		* Grows a strip from a triangle, beginning with the given corner, taking
+		* triangles in the current trial.  The strip's first triangle has the
+		* starting triangle's winding, and each triangle after it is the
+		* neighbour across the strip's last two vertices.  The strip's vertices
+		* go in strip, and the triangles it took in triangles.
+		*/
+		void growStrip(TriangleGraph &graph, vertexIndex start, int rotation, vector<vertexIndex> &strip,
+			vector<vertexIndex> &triangles) {
+			strip.clear();
+			triangles.clear();
+
+			graph.beginTrial();
+			graph.take(start);
+			triangles.push_back(start);
+			strip.push_back(graph.corner(start, rotation));
+			strip.push_back(graph.corner(start, rotation + 1));
+			strip.push_back(graph.corner(start, rotation + 2));
+
+			vertexIndex t = start;
+			for (;;) {
+				vertexIndex p = strip[strip.size() - 2], q = strip[strip.size() - 1];
+				vertexIndex next = graph.available(t, graph.edgeOf(t, p, q));
+				if (next == none) {
+					break;
+				}
+
+				graph.take(next);
+				triangles.push_back(next);
+				for (int i = 0; i < 3; i++) {
+					vertexIndex x = graph.corner(next, i);
+					if (x != p && x != q) {
+						strip.push_back(x);
+						break;
+					}
+				}
+				t = next;
+			}
+		}
+
+		/** Appends a strip to the stitched strip, with degenerate triangles joining them that keep its winding */
+		void stitch(PrimitiveStreams::indexList &stitched, const vector<vertexIndex> &strip) {
+			if (!stitched.empty()) {
+				stitched.push_back(stitched.back());
+				stitched.push_back(strip.front());
+
+				// The strip's first triangle must start at an even position to keep its winding
+				if (stitched.size() % 2 == 1) {
+					stitched.push_back(strip.front());
+				}
+			}
+			stitched.insert(stitched.end(), strip.begin(), strip.end());
+		}
+
+		/** Copies each strip or fan of a concatenated index array */
+		template <typename Adder>
+		void copyRuns(const PrimitiveStreams::indexList &indices, const PrimitiveStreams::indexList &starts, Adder add) {
+			for (size_t i = 0; i + 1 < starts.size(); i++) {
+				add(indices.begin() + starts[i], indices.begin() + starts[i+1]);
+			}
+		}
+
+		struct StripAdder {
+			PrimitiveStreams &streams;
+			StripAdder(PrimitiveStreams &streams) : streams(streams) {}
+			inline void operator()(PrimitiveStreams::indexList::const_iterator begin, PrimitiveStreams::indexList::const_iterator end) {
+				this->streams.addTriangleStrip(begin, end);
+			}
+		};
+
+		struct FanAdder {
+			PrimitiveStreams &streams;
+			FanAdder(PrimitiveStreams &streams) : streams(streams) {}
+			inline void operator()(PrimitiveStreams::indexList::const_iterator begin, PrimitiveStreams::indexList::const_iterator end) {
+				this->streams.addTriangleFan(begin, end);
+			}
+		};
+
+		struct QuadStripAdder {
+			PrimitiveStreams &streams;
+			QuadStripAdder(PrimitiveStreams &streams) : streams(streams) {}
+			inline void operator()(PrimitiveStreams::indexList::const_iterator begin, PrimitiveStreams::indexList::const_iterator end) {
+				this->streams.addQuadStrip(begin, end);
+			}
+		};
+
+	}
+
+	Stripifier::Stripifier() {
+		this->minFanLength = 8;
+		this->minStripLength = 2;
+		this->stitching = false;
+	}
+
+	/*!
+	* @param primitives The streams whose triangles to strip
+	* @param stats Counters to fill in, if not NULL
+	* @return Streams with the same faces, the triangles now mostly in strips and fans
+	*/
+	PrimitiveStreams Stripifier::stripify(const PrimitiveStreams &primitives, StripStats *stats) const {
+		const PrimitiveStreams::indexList &input = primitives.getTriangles();
+		TriangleGraph graph(input);
+		PrimitiveStreams output;
+		StripStats counts;
+		counts.triangles = graph.count;
+		counts.indicesBefore = primitives.getIndexCount();
+
+		vector<vertexIndex> run, triangles;
+
+		if (this->minFanLength > 0) {
+			// List the usable triangles around each vertex
+			vertexIndex vertexCount = 0;
+			for (size_t i = 0; i < input.size(); i++) {
+				vertexCount = std::max(vertexCount, input[i] + 1);
+			}
+			vector<vertexIndex> starts(vertexCount + 1, 0), around;
+			for (vertexIndex t = 0; t < graph.count; t++) {
+				if (!graph.isDegenerate(t)) {
+					for (int i = 0; i < 3; i++) {
+						starts[graph.corner(t, i) + 1]++;
+					}
+				}
+			}
+			for (vertexIndex i = 0; i < vertexCount; i++) {
+				starts[i + 1] += starts[i];
+			}
+			around.resize(starts[vertexCount]);
+			vector<vertexIndex> fill(starts.begin(), starts.end() - 1);
+			for (vertexIndex t = 0; t < graph.count; t++) {
+				if (!graph.isDegenerate(t)) {
+					for (int i = 0; i < 3; i++) {
+						around[fill[graph.corner(t, i)]++] = t;
+					}
+				}
+			}
+
+			// Busiest vertices first, since their fans save the most
+			vector<std::pair<vertexIndex, vertexIndex> > centres;
+			for (vertexIndex i = 0; i < vertexCount; i++) {
+				if (starts[i + 1] - starts[i] >= this->minFanLength) {
+					centres.push_back(std::make_pair(starts[i + 1] - starts[i], i));
+				}
+			}
+			std::sort(centres.rbegin(), centres.rend());
+
+			for (size_t k = 0; k < centres.size(); k++) {
+				vertexIndex centre = centres[k].second;
+				for (vertexIndex a = starts[centre]; a < starts[centre + 1]; a++) {
+					if (graph.used[around[a]]) {
+						continue;
+					}
+					growFan(graph, around[a], centre, run, triangles);
+					if (triangles.size() >= this->minFanLength) {
+						for (size_t i = 0; i < triangles.size(); i++) {
+							graph.use(triangles[i], NULL);
+						}
+						output.addTriangleFan(run.begin(), run.end());
+						counts.fans++;
+						counts.fanTriangles += triangles.size();
+					}
+				}
+			}
+		}
+
+		// Sort what is left by how many unused neighbours each has
+		vector<vertexIndex> buckets[4];
+		for (vertexIndex t = 0; t < graph.count; t++) {
+			if (!graph.used[t]) {
+				buckets[graph.degrees[t]].push_back(t);
+			}
+		}
+
+		PrimitiveStreams::indexList stitched;
+		vector<vertexIndex> best;
+		for (;;) {
+			// Start at the loneliest triangle; entries are stale if it has been used or has lost neighbours since
+			vertexIndex start = none;
+			for (int d = 0; d < 4 && start == none; d++) {
+				while (!buckets[d].empty()) {
+					vertexIndex t = buckets[d].back();
+					buckets[d].pop_back();
+					if (!graph.used[t] && graph.degrees[t] == d) {
+						start = t;
+						break;
+					}
+				}
+			}
+			if (start == none) {
+				break;
+			}
+
+			// Start from whichever edge grows the longest strip
+			int bestRotation = 0;
+			size_t bestLength = 0;
+			for (int rotation = 0; rotation < 3; rotation++) {
+				growStrip(graph, start, rotation, run, triangles);
+				if (triangles.size() > bestLength) {
+					bestLength = triangles.size();
+					bestRotation = rotation;
+				}
+			}
+
+			if (bestLength < std::max(this->minStripLength, 2u)) {
+				graph.use(start, buckets);
+				output.addTriangle(graph.corner(start, 0), graph.corner(start, 1), graph.corner(start, 2));
+				counts.singleTriangles++;
+				continue;
+			}
+
+			growStrip(graph, start, bestRotation, run, triangles);
+			for (size_t i = 0; i < triangles.size(); i++) {
+				graph.use(triangles[i], buckets);
+			}
+			if (this->stitching) {
+				stitch(stitched, run);
+			}
+			else {
+				output.addTriangleStrip(run.begin(), run.end());
+			}
+			counts.strips++;
+			counts.stripTriangles += triangles.size();
+		}
+
+		if (!stitched.empty()) {
+			output.addTriangleStrip(stitched.begin(), stitched.end());
+		}
+
+		// Pass everything else through
+		const PrimitiveStreams::indexList &quads = primitives.getQuads();
+		for (size_t i = 0; i + 3 < quads.size(); i += 4) {
+			output.addQuad(quads[i], quads[i+1], quads[i+2], quads[i+3]);
+		}
+		copyRuns(primitives.getTriangleStrips(), primitives.getTriangleStripStarts(), StripAdder(output));
+		copyRuns(primitives.getTriangleFans(), primitives.getTriangleFanStarts(), FanAdder(output));
+		copyRuns(primitives.getQuadStrips(), primitives.getQuadStripStarts(), QuadStripAdder(output));
+
+		output.shrinkToFit();
+		counts.indicesAfter = output.getIndexCount();
+		if (stats) {
+			*stats = counts;
+		}
+		return output;
+	}
+
+}
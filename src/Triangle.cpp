@@ -73,4 +73,10 @@ namespace peek {
 		normals[v2] += normal;
 	}
 
+	/*!
+	*/
+	void Triangle::appendTo(PrimitiveStreams &streams) const {
+		streams.addTriangle((PrimitiveStreams::index) v0, (PrimitiveStreams::index) v1, (PrimitiveStreams::index) v2);
+	}
+
 }
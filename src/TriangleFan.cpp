@@ -64,6 +64,12 @@ namespace peek {
 		}
 	}
 
+	/**
+	*/
+	void TriangleFan::appendTo(PrimitiveStreams &streams) const {
+		streams.addTriangleFan(this->v.begin(), this->v.end());
+	}
+
 	void TriangleFan::addVertex(const Vertex3d::listIndex &v) {
 		this->v.push_back(v);
 	}
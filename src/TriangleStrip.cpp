@@ -68,6 +68,12 @@ namespace peek {
 		}
 	}
 
+	/**
+	*/
+	void TriangleStrip::appendTo(PrimitiveStreams &streams) const {
+		streams.addTriangleStrip(this->v.begin(), this->v.end());
+	}
+
 	void TriangleStrip::addVertex(const Vertex3d::listIndex &v) {
 		this->v.push_back(v);
 	}
@@ -0,0 +1,57 @@
+/**
+* @file WindowRenderContext.cpp
+*/
+
+#include "WindowRenderContext.hpp"
+
+namespace peek {
+
+	WindowRenderContext::WindowRenderContext(unsigned int width, unsigned int height, bool fullscreen, bool vsync) {
+		this->width = width;
+		this->height = height;
+
+		SDL_Init(SDL_INIT_VIDEO);
+
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 16);
+
+		/** @todo The next four lines may not be necessary... */
+		SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+
+		SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, vsync ? 1 : 0);
+
+		Uint32 fullscreenFlag = (fullscreen ? SDL_FULLSCREEN : 0);
+		SDL_SetVideoMode(this->width, this->height, 0, SDL_OPENGL | fullscreenFlag);
+
+		// The driver may not honor the request for vsync
+		int swapControl = 0;
+		this->vsync = vsync && SDL_GL_GetAttribute(SDL_GL_SWAP_CONTROL, &swapControl) == 0 && swapControl > 0;
+
+		SDL_EnableKeyRepeat(1, SDL_DEFAULT_REPEAT_INTERVAL);
+	}
+
+	WindowRenderContext::~WindowRenderContext() {}
+
+	void *WindowRenderContext::getProcAddress(const char *name) {
+		return SDL_GL_GetProcAddress(name);
+	}
+
+	void WindowRenderContext::swapBuffers() {
+		SDL_GL_SwapBuffers();
+	}
+
+	bool WindowRenderContext::pollEvent(SDL_Event &evt) {
+		return SDL_PollEvent(&evt) != 0;
+	}
+
+	bool WindowRenderContext::hasPendingEvents() {
+		SDL_Event evt;
+
+		SDL_PumpEvents();
+		return SDL_PeepEvents(&evt, 1, SDL_PEEKEVENT, SDL_ALLEVENTS) > 0;
+	}
+
+}
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "CameraRigging.hpp"
+#include "InverseMatrixCache.hpp"
 
 namespace peek {
 
@@ -31,6 +32,12 @@ namespace peek {
 		/** Initializes the modelview matrix based on the camera's pose */
 		virtual void initModelviewMatrix();
 
+		/** Gets the view matrix for the camera's pose */
+		virtual Matrix<double> getViewMatrix();
+
+		/** Gets the inverse of the view matrix */
+		virtual const Matrix<double> &getInverseViewMatrix();
+
 		/** Provides access to the camera being rigged */
 		virtual Camera *getCamera() { return this->camera.get(); }
 
@@ -80,6 +87,9 @@ namespace peek {
 		/** The location of the camera in worldspace */
 		Point3d location;
 
+		/** The inverse of the last view matrix */
+		InverseMatrixCache viewInverse;
+
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+* @file BoundingBox.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+
+namespace peek {
+
+	/**
+	* @brief An axis-aligned bounding box
+	*
+	* A default-constructed box is empty; merging a point or another box into it
+	* makes it the bounds of that point or box.
+	*/
+	class BoundingBox {
+	public:
+
+		/** Constructs an empty bounding box */
+		BoundingBox();
+
+		/** Constructs a bounding box from its corners */
+		BoundingBox(const Point3d &low, const Point3d &high);
+
+		/** Constructs the bounding box of a list of points */
+		static BoundingBox fromPoints(const Vertex3d::list &points);
+
+		/** Checks whether the box contains nothing at all */
+		inline bool isEmpty() const { return this->low.x > this->high.x || this->low.y > this->high.y || this->low.z > this->high.z; }
+
+		/** Gets the low corner of the box */
+		inline const Point3d &getLow() const { return this->low; }
+
+		/** Gets the high corner of the box */
+		inline const Point3d &getHigh() const { return this->high; }
+
+		/** Gets the dimensions of the box (zero if it is empty) */
+		Vector3d getDimensions() const;
+
+		/** Gets the center of the box */
+		Point3d getCenter() const;
+
+		/** Grows the box to contain a point */
+		void merge(const Point3d &point);
+
+		/** Grows the box to contain another box */
+		void merge(const BoundingBox &box);
+
+		/** Gets the bounding box of this box after it is transformed by an affine matrix */
+		BoundingBox transform(const Matrix<double> &m) const;
+
+		/** Equality */
+		inline bool operator==(const BoundingBox &rhs) const { return this->low == rhs.low && this->high == rhs.high; }
+
+		/** Inequality */
+		inline bool operator!=(const BoundingBox &rhs) const { return !(*this == rhs); }
+
+	protected:
+
+		/** The low corner of the box */
+		Point3d low;
+
+		/** The high corner of the box */
+		Point3d high;
+
+	};
+
+}
@@ -0,0 +1,50 @@
+/**
+* @file BoundingSphere.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "BoundingBox.hpp"
+
+namespace peek {
+
+	/**
+	* @brief A bounding sphere
+	*
+	* A default-constructed sphere is empty, which is marked by a negative radius.
+	*/
+	class BoundingSphere {
+	public:
+
+		/** Constructs an empty bounding sphere */
+		BoundingSphere();
+
+		/** Constructs a bounding sphere from its center and radius */
+		BoundingSphere(const Point3d &center, double radius);
+
+		/** Constructs the sphere that passes through the corners of a box */
+		static BoundingSphere fromBox(const BoundingBox &box);
+
+		/** Checks whether the sphere contains nothing at all */
+		inline bool isEmpty() const { return this->radius < 0; }
+
+		/** Gets the center of the sphere */
+		inline const Point3d &getCenter() const { return this->center; }
+
+		/** Gets the radius of the sphere */
+		inline double getRadius() const { return this->radius; }
+
+		/** Grows the sphere to contain another sphere */
+		void merge(const BoundingSphere &sphere);
+
+	protected:
+
+		/** The center of the sphere */
+		Point3d center;
+
+		/** The radius of the sphere, or negative if the sphere is empty */
+		double radius;
+
+	};
+
+}
@@ -26,6 +26,12 @@ namespace peek {
 		/** (Re)sets the picking matrix with the camera's parameters and the given window coordinates */
 		virtual void setPickingMatrix(int x, int y) = 0;
 
+		/** Gets the projection matrix that setProjectionMatrix() loads */
+		virtual Matrix<double> getProjectionMatrix() = 0;
+
+		/** Gets the inverse of the projection matrix */
+		virtual const Matrix<double> &getInverseProjectionMatrix() = 0;
+
 		/** Get the distance of the near-plane */
 		virtual double getNear() = 0;
 
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include "Peek_base.hpp"
 #include "Camera.hpp"
+#include "Frustum.hpp"
+#include "Ray.hpp"
 
 namespace peek {
 
@@ -23,9 +26,24 @@ namespace peek {
 	  /** Initializes the modelview matrix based on the camera's pose */
 	  virtual void initModelviewMatrix() = 0;
 
+	  /** Gets the view matrix for the camera's pose, which initModelviewMatrix() loads */
+	  virtual Matrix<double> getViewMatrix() = 0;
+
+	  /** Gets the inverse of the view matrix, which maps from eye space to world space */
+	  virtual const Matrix<double> &getInverseViewMatrix() = 0;
+
 	  /** Provides access to the camera being rigged */
 	  virtual Camera *getCamera() = 0;
 
+	  /** Gets the world-space frustum of the rigged camera in its current pose */
+	  virtual Frustum getFrustum();
+
+	  /** Gets the world-space ray through the centre of a pixel of the current viewport, with y measured down from the top */
+	  Ray getPickingRay(int x, int y);
+
+	  /** Gets the world-space ray through the centre of a pixel of the given viewport, with y measured down from the top */
+	  Ray getPickingRay(int x, int y, const GLint viewport[4]);
+
 	};
 
 }
\ No newline at end of file
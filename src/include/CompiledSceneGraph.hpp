@@ -0,0 +1,185 @@
+/**
+* @file CompiledSceneGraph.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "SceneGraphNode.hpp"
+#include "SceneGraphLeaf.hpp"
+#include "RenderQueue.hpp"
+#include "JobSystem.hpp"
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief A scene graph flattened into arrays, for culling and queueing by linear scans
+	*
+	* The nodes are laid out in depth-first order, so a node's subtree is the
+	* run of entries that follows it, and is skipped by adding its size to
+	* the index.  Each field is an array of its own: the parent indices, the
+	* subtree sizes, the six bounds of each box, and pointers to the world
+	* matrices the nodes cache.  The culling scan reads nothing else, and a
+	* node whose children are all leaves has them tested together by a
+	* branch-free loop over the bounds arrays, which compilers vectorize.
+	*
+	* The graph is kept in step with the nodes it was compiled from by
+	* sync(), which compares the bounds and structure versions the nodes
+	* keep: unchanged subtrees are skipped, moved ones have their entries
+	* refreshed, and nodes that have gained children have their subtrees
+	* flattened again in place.
+	*
+	* Culling a run of entries only reads the entries before it, so a frame
+	* can be split between threads by dividing the entries into runs.  Given
+	* a JobSystem, enqueue() does so, and each run's leaves are queued into a
+	* render queue of the run's own, which are appended in order at the end.
+	*/
+	class CompiledSceneGraph {
+	public:
+
+		/** Compiles the graph under a root */
+		explicit CompiledSceneGraph(SceneGraphNodeBase::handle root);
+
+		/** Brings the arrays up to date with the nodes, and returns the number of entries refreshed */
+		size_t sync();
+
+		/** Gets the number of entries */
+		inline size_t size() const { return this->nodes.size(); }
+
+		/** Gets the node of an entry */
+		inline const SceneGraphNodeBase *getNode(size_t i) const { return this->nodes[i]; }
+
+		/** Gets the leaf of an entry, or NULL if it is not a leaf */
+		inline const SceneGraphLeaf *getLeaf(size_t i) const { return this->leaves[i]; }
+
+		/** Gets the index of an entry's parent, or -1 for the root */
+		inline boost::int32_t getParent(size_t i) const { return this->parents[i]; }
+
+		/** Gets the number of entries in an entry's subtree, including itself */
+		inline boost::uint32_t getSubtreeSize(size_t i) const { return this->subtreeSizes[i]; }
+
+		/** Gets an entry's world matrix: the model-to-world matrix of a leaf, or the world transformation of a node */
+		inline const Matrix<double> &getWorldMatrix(size_t i) const { return *this->worldMatrices[i]; }
+
+		/** Gets the center of an entry's bounds, in world space */
+		inline Point3d getCenter(size_t i) const {
+			return Point3d((this->lowX[i] + this->highX[i]) * 0.5, (this->lowY[i] + this->highY[i]) * 0.5, (this->lowZ[i] + this->highZ[i]) * 0.5);
+		}
+
+		/** Finds the leaves inside the frustum, in depth-first order */
+		void cull(const Frustum &frustum, std::vector<boost::uint32_t> &visibleLeaves, CullingStats &stats);
+
+		/** Finds the leaves inside the frustum among a run of entries; runs that do not overlap may be culled at once on different threads */
+		void cull(const Frustum &frustum, size_t first, size_t end, std::vector<boost::uint32_t> &visibleLeaves, CullingStats &stats);
+
+		/** Queues the models of the given leaves */
+		void enqueue(RenderQueue &queue, const std::vector<boost::uint32_t> &visibleLeaves) const;
+
+		/** Queues the models of the leaves inside the frustum, as SceneGraphNodeBase::enqueue() would */
+		void enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats);
+
+		/** Queues the models of the leaves inside the frustum, culling and queueing runs of entries on the job system's threads */
+		void enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, JobSystem &jobs);
+
+		/** The fewest entries given to a job by the threaded enqueue() */
+		static const size_t minRunSize = 2048;
+
+		/** The number of runs the threaded enqueue() makes for each thread, so that threads that finish early can steal more */
+		static const size_t runsPerThread = 4;
+
+	protected:
+
+		/** Flattens the subtree under a node onto the end of another graph's arrays, as if they began at the given index */
+		static void flatten(const SceneGraphNodeBase *node, boost::int32_t parent, size_t base, CompiledSceneGraph &into);
+
+		/** Flattens the subtree at an entry again, replacing its entries, and returns the number of entries it now has */
+		size_t rebuild(size_t i);
+
+		/** Copies an entry's bounds, world matrix and versions from its node */
+		void refresh(size_t i);
+
+		/** Classifies an entry's bounds against the planes in the mask, removing those it lies inside of; returns false if it is outside */
+		bool classify(const Frustum &frustum, size_t i, unsigned int &planeMask) const;
+
+		/** Classifies the ancestors of an entry, root first, for a run starting there; an ancestor outside the frustum has the mask outsideMask */
+		void classifyAncestors(const Frustum &frustum, size_t first, std::vector<std::pair<size_t, unsigned int> > &ancestors) const;
+
+		/** A run of entries culled and queued by one job */
+		struct Run {
+
+			/** The first entry */
+			size_t first;
+
+			/** The entry after the last */
+			size_t end;
+
+			/** The leaves found inside the frustum */
+			std::vector<boost::uint32_t> visibleLeaves;
+
+			/** The run's counters */
+			CullingStats stats;
+
+			/** The queue the run's leaves are queued into; kept from frame to frame, as are its material numbers */
+			boost::shared_ptr<RenderQueue> queue;
+
+		};
+
+		/** Culls and queues a run; the job the threaded enqueue() submits */
+		void enqueueRun(const Frustum *frustum, Run *run);
+
+		/** The mask of a node outside the frustum, in classifyAncestors() */
+		static const unsigned int outsideMask = ~0u;
+
+		/** Constructs an empty set of arrays, for flattening into */
+		CompiledSceneGraph();
+
+		/** The root the graph was compiled from */
+		SceneGraphNodeBase::handle root;
+
+		/** The node of each entry */
+		std::vector<const SceneGraphNodeBase *> nodes;
+
+		/** The leaf of each entry, or NULL */
+		std::vector<const SceneGraphLeaf *> leaves;
+
+		/** The index of each entry's parent, or -1 */
+		std::vector<boost::int32_t> parents;
+
+		/** The size of each entry's subtree */
+		std::vector<boost::uint32_t> subtreeSizes;
+
+		/** Whether each entry is a node whose children are all leaves */
+		std::vector<boost::uint8_t> leafParents;
+
+		/** The number of leaves in each entry's subtree */
+		std::vector<boost::uint32_t> leafCounts;
+
+		/** The lower corners of the boxes, by axis; empty boxes have their corners swapped far apart */
+		std::vector<double> lowX, lowY, lowZ;
+
+		/** The upper corners of the boxes, by axis */
+		std::vector<double> highX, highY, highZ;
+
+		/** The matrices the nodes cache, which getWorldMatrix() gets */
+		std::vector<const Matrix<double> *> worldMatrices;
+
+		/** The bounds version of each entry's node when it was last refreshed */
+		std::vector<unsigned long> boundsVersions;
+
+		/** The structure version of each entry's node when it was flattened */
+		std::vector<unsigned long> structureVersions;
+
+		/** The planes each entry straddles, for its children; written only for the entries being culled */
+		std::vector<boost::uint8_t> masks;
+
+		/** Whether each leaf is outside, for the leaf-run test; written only for the entries being culled */
+		std::vector<boost::uint8_t> outside;
+
+		/** The runs of the threaded enqueue() */
+		std::vector<Run> runs;
+
+	};
+
+}
@@ -0,0 +1,47 @@
+/**
+* @file CullingStats.hpp
+*/
+#pragma once
+
+namespace peek {
+
+	/**
+	* @brief Counts what a culled traversal of the scene graph visited, drew and skipped
+	*/
+	struct CullingStats {
+
+		/** Constructs a set of zeroed counters */
+		CullingStats() { reset(); }
+
+		/** Zeroes the counters */
+		inline void reset() {
+			this->nodesVisited = 0;
+			this->nodesCulled = 0;
+			this->leavesDrawn = 0;
+			this->leavesCulled = 0;
+		}
+
+		/** Adds another set of counters to these, as when a traversal is split between threads */
+		inline CullingStats &operator+=(const CullingStats &other) {
+			this->nodesVisited += other.nodesVisited;
+			this->nodesCulled += other.nodesCulled;
+			this->leavesDrawn += other.leavesDrawn;
+			this->leavesCulled += other.leavesCulled;
+			return *this;
+		}
+
+		/** The number of nodes and leaves tested against the frustum */
+		unsigned int nodesVisited;
+
+		/** The number of nodes and leaves that were outside of the frustum */
+		unsigned int nodesCulled;
+
+		/** The number of leaves that were drawn */
+		unsigned int leavesDrawn;
+
+		/** The number of leaves that were skipped, including those under culled nodes */
+		unsigned int leavesCulled;
+
+	};
+
+}
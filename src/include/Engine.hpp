@@ -5,12 +5,27 @@
 
 #include "Peek_base.hpp"
 #include <boost/optional.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include "Drawable.hpp"
 #include "KeyEventHandler.hpp"
 #include "CustomEventHandler.hpp"
+#include "StatePublisher.hpp"
 #include "MouseButtonEventHandler.hpp"
 #include "MouseMotionEventHandler.hpp"
 #include "ResizeEventHandler.hpp"
+#include "RenderContext.hpp"
+#include "WindowRenderContext.hpp"
+#include "HeadlessRenderContext.hpp"
+#include "FrameCapture.hpp"
+#include "InputLog.hpp"
+#include "JobSystem.hpp"
+#include "MpscQueue.hpp"
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
 #include <hash_map>
 
 using boost::optional;
@@ -20,6 +35,27 @@ namespace peek {
 
 	/**
 	* @brief The Peek engine
+	*
+	* By default, events are handled between frames, on the thread that
+	* calls run().  With setUpdateThreaded(), they are instead handed to an
+	* update thread, which runs the handlers and then has the StatePublisher
+	* publish a snapshot of what they changed, such as a FrameSnapshot passed
+	* through a TripleBuffer, for the drawable to draw.  A slow handler then
+	* no longer holds up drawing, nor a slow frame the handling of events
+	* that have been taken off the window's queue.  The window's events are
+	* still taken off its queue between frames, by the thread that calls
+	* run(), which is the only one SDL allows to.
+	*
+	* Other threads can feed the engine through postEvent(), which queues a
+	* custom event without locking, and invalidate().  Posted events are
+	* handled with the window's events, as SDL user events carrying the
+	* custom event as their code, and a burst of them is handled as one
+	* batch, with one redraw after it.
+	*
+	* The input events taken can be recorded to an InputLog with
+	* setInputLog(), and the log replayed with replay(), which hands the
+	* handlers the same events before the same frames, for comparing frame
+	* times between builds or for driving the handlers unattended.
 	*/
 	class Engine {
 	public:
@@ -30,9 +66,24 @@ namespace peek {
 		/** Constructor */
 		Engine(unsigned int screenWidth, unsigned int screenHeight, bool fullscreen);
 
+		/** Constructor */
+		Engine(unsigned int screenWidth, unsigned int screenHeight, bool fullscreen, bool vsync);
+
+		/** Constructor, for rendering somewhere other than a window of its own (such as a HeadlessRenderContext) */
+		Engine(RenderContext::handle renderContext);
+
 		/** Runs the given application */
 		void run();
 
+		/** Draws the given number of frames, then returns */
+		void run(unsigned long frames);
+
+		/** Replays a recorded log, at the recorded pace or as fast as possible, recording how long each frame took, in milliseconds */
+		void replay(const InputLog &log, bool recordedPace, std::vector<double> &frameTimes);
+
+		/** Makes run() return; may be called from any thread */
+		void stop();
+
 		/** Gets the screen width */
 		unsigned int getScreenWidth() const { return this->screenWidth; }
 
@@ -42,6 +93,33 @@ namespace peek {
 		/** Gets whether or not the engine is fullscreen */
 		bool isFullscreen() const { return this->fullscreen; }
 
+		/** Gets whether or not buffer swaps are synchronized with the display's refresh */
+		bool isVsync() const { return this->renderContext->isVsync(); }
+
+		/** Gets the most frames drawn per second, or 0 if there is no limit */
+		double getMaxFrameRate() const { return this->maxFrameRate; }
+
+		/** Sets the most frames drawn per second, or 0 for no limit */
+		void setMaxFrameRate(double maxFrameRate);
+
+		/** Gets whether or not run() sleeps while there is nothing to draw */
+		bool isWaitingWhenIdle() const { return this->waitingWhenIdle; }
+
+		/** Sets whether or not run() sleeps while there is nothing to draw, rather than polling for events */
+		void setWaitingWhenIdle(bool waitingWhenIdle);
+
+		/** Sets how often, in milliseconds, a sleeping run() checks for window system events */
+		void setEventPollInterval(unsigned int eventPollInterval);
+
+		/** Gets where the engine renders */
+		RenderContext *getRenderContext() const { return this->renderContext.get(); }
+
+		/** Gets the job system that drawables can split a frame's work across, such as CompiledSceneGraph::enqueue(), starting it on first use */
+		JobSystem &getJobSystem();
+
+		/** Gets the number of frames drawn so far */
+		unsigned long getFrameCount() const { return this->frameCount; }
+
 		/** Set the thing to draw */
 		void setDrawable(Drawable *drawable);
 
@@ -60,9 +138,27 @@ namespace peek {
 		/** Set the resize event handler */
 		void setResizeEventHandler(ResizeEventHandler *resizeEventHandler);
 
-		/** Invalidates the current rendering, indicating that it needs to be redrawn */
+		/** Set what publishes the drawn state after events are handled, or NULL for nothing */
+		void setStatePublisher(StatePublisher *statePublisher);
+
+		/** Sets whether events are handled on an update thread of their own, rather than between frames; takes effect when run() is next called */
+		void setUpdateThreaded(bool updateThreaded);
+
+		/** Gets whether events are handled on an update thread of their own */
+		bool isUpdateThreaded() const { return this->updateThreaded; }
+
+		/** Set the capture that every frame is saved to, or NULL to stop capturing */
+		void setFrameCapture(FrameCapture *frameCapture);
+
+		/** Set the log that the input events taken are recorded to, timed from now, or NULL to stop recording */
+		void setInputLog(InputLog *inputLog);
+
+		/** Invalidates the current rendering, indicating that it needs to be redrawn; may be called from any thread, and only the first call after a frame begins locks */
 		void invalidate();
 
+		/** Posts a custom event, to be handed to the custom event handler on the thread that handles events; may be called from any thread, and does not lock */
+		void postEvent(int customEvent);
+
 		/** Bind a key to an action */
 		void bindKey(SDLKey key, int action);
 
@@ -80,20 +176,131 @@ namespace peek {
 		/** Whether or not the engine is fullscreen */
 		bool fullscreen;
 
+		/** Where the engine renders, and where its events come from */
+		RenderContext::handle renderContext;
+
 		/** Whether or not the current rendering is invalid (out of date) */
 		bool invalid;
 
+		/** When the current rendering became invalid */
+		boost::chrono::steady_clock::time_point invalidTime;
+
+		/** Whether or not run() has been asked to return */
+		bool stopped;
+
+		/** The most frames drawn per second, or 0 if there is no limit */
+		double maxFrameRate;
+
+		/** Whether or not run() sleeps while there is nothing to draw */
+		bool waitingWhenIdle;
+
+		/** How often a sleeping run() checks for window system events */
+		boost::chrono::milliseconds eventPollInterval;
+
+		/** The number of frames drawn so far */
+		unsigned long frameCount;
+
+		/** When the last frame's buffers were swapped */
+		boost::chrono::steady_clock::time_point lastSwapTime;
+
+		/** The shortest time seen between paced swaps, which with vsync is the refresh period */
+		boost::chrono::steady_clock::duration refreshPeriod;
+
+		/** Whether or not the frame being drawn was held back by the frame rate cap, rather than by idling */
+		bool framePaced;
+
+		/** Guards the state shared with other threads: invalid, invalidTime and stopped */
+		boost::mutex wakeMutex;
+
+		/** Whether or not invalidate() has been called since the last frame began, so that later calls need not lock */
+		boost::atomic<bool> invalidPosted;
+
+		/** The custom events posted from other threads */
+		MpscQueue<int> postedEvents;
+
+		/** Whether or not events have been posted since they were last taken, so that only the first of a burst wakes run() */
+		boost::atomic<bool> eventsPosted;
+
+		/** Signalled when the engine is invalidated or stopped */
+		boost::condition_variable wakeCondition;
+
+		/** The worker threads a frame's work is split across, one fewer than there are cores, once getJobSystem() has been called */
+		boost::scoped_ptr<JobSystem> jobSystem;
+
+		/** Guards the starting of the job system */
+		boost::mutex jobSystemMutex;
+
 		/** Initialize the engine */
 		void init();
 
 		/** Draw */
 		void draw();
 
+		/** Determines whether a frame should be drawn now, and if so, marks the rendering valid */
+		bool beginFrame();
+
+		/** Swaps buffers and records the frame's timing */
+		void endFrame();
+
+		/** Gets the earliest time the next frame may be drawn */
+		boost::chrono::steady_clock::time_point getNextFrameTime() const;
+
+		/** Sleeps until there is an event to handle or a frame to draw */
+		void waitForWork();
+
+		/** Takes the window's pending events and the posted ones, and handles them or hands them to the update thread */
+		void pollEvents();
+
+		/** Wakes run() if it is waiting for work; for the first of a burst of posted events */
+		void wake();
+
+		/** Starts the update thread, if events are handled on one, and publishes the state to draw first */
+		void startUpdates();
+
+		/** Handles the events handed over, and stops the update thread */
+		void stopUpdates();
+
+		/** Handles the events handed over, and publishes the state, until stopUpdates() is called; runs on the update thread */
+		void runUpdates();
+
+		/** Has the state publisher publish the state */
+		void publishState();
+
+		/** Dispatch an event to its handler, with the pointer where it was when the event was taken */
+		void handleEvent(const SDL_Event &evt, int x, int y);
+
+		/** Adds an event taken to the input log, with the pointer where it was, if a log is being recorded */
+		void recordEvent(const SDL_Event &evt, int x, int y);
+
+		/** An event as it was taken, with the pointer where it was then; read only for key presses, the one kind handled with it */
+		struct TakenEvent {
+			SDL_Event event;
+			int x, y;
+		};
+
+		/** Whether or not events are handled on the update thread */
+		bool updateThreaded;
+
+		/** The update thread, while run() runs, if there is one */
+		boost::thread *updateThread;
+
+		/** The events handed to the update thread, oldest first */
+		std::deque<TakenEvent> updateEvents;
+
+		/** Whether or not the update thread should exit once it has handled its events */
+		bool updatesStopping;
+
+		/** Guards updateEvents and updatesStopping */
+		boost::mutex updateMutex;
+
+		/** Signalled when events are handed over, or the update thread should stop */
+		boost::condition_variable updateCondition;
+
 		/** Key bindings; maps from key to event */
 		hash_map<SDLKey, int> keyBindings;
 
-		/** Handle a keypress */
-		void handleKeyEvent(const SDL_KeyboardEvent &keyEvent);
+		/** Handle a keypress, with the pointer where it was at the time */
+		void handleKeyEvent(const SDL_KeyboardEvent &keyEvent, int x, int y);
 
 		/** Handle a mouse button press/release */
 		void handleMouseButtonEvent(const SDL_MouseButtonEvent &mouseButtonEvent);
@@ -121,6 +328,21 @@ namespace peek {
 
 		/** The resize event handler */
 		optional<ResizeEventHandler*> resizeEventHandler;
+
+		/** The capture that every frame is saved to */
+		optional<FrameCapture*> frameCapture;
+
+		/** What publishes the drawn state */
+		optional<StatePublisher*> statePublisher;
+
+		/** The log the input events taken are recorded to */
+		optional<InputLog*> inputLog;
+
+		/** When recording to the input log began */
+		boost::chrono::steady_clock::time_point recordStartTime;
+
+		/** The number of frames drawn when recording to the input log began */
+		unsigned long recordStartFrame;
 	};
 
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "CameraRigging.hpp"
+#include "InverseMatrixCache.hpp"
 
 namespace peek {
 
@@ -31,6 +32,12 @@ namespace peek {
 		/** Initializes the modelview matrix based on the camera's pose */
 		void initModelviewMatrix();
 
+		/** Gets the view matrix for the camera's pose */
+		Matrix<double> getViewMatrix();
+
+		/** Gets the inverse of the view matrix */
+		const Matrix<double> &getInverseViewMatrix();
+
 		/** Provides access to the camera being rigged */
 		inline Camera *getCamera() { return this->camera.get(); }
 
@@ -62,6 +69,9 @@ namespace peek {
 		/** The distance from the camera to its target */
 		double distance;
 
+		/** The inverse of the last view matrix */
+		InverseMatrixCache viewInverse;
+
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+/**
+* @file FrameCapture.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "GlExtensions.hpp"
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief Saves rendered frames as a numbered image sequence
+	*
+	* Each captured frame is read into one of a ring of pixel-pack buffers,
+	* and a fence is placed after the read.  The pixels are only mapped once
+	* the fence has passed (or, at the latest, when the buffer comes around
+	* again), so the read doesn't stall drawing; a worker thread then writes
+	* the image file.  Files are numbered by the order in which frames were
+	* captured, starting from zero, whatever order they finish in.
+	*
+	* Without pixel buffer objects, or with a ring size of zero, frames are
+	* read synchronously, though they are still written by the worker.
+	*
+	* All the methods except the statistics must be called on the thread
+	* whose OpenGL context is being captured, with that context current;
+	* that includes destroying the capture, unless finish() was called.
+	*/
+	class FrameCapture {
+	public:
+
+		/** The formats frames can be saved in */
+		enum Format {
+
+			/** PNG, 8-bit RGBA */
+			FORMAT_PNG,
+
+			/** Bare 8-bit RGBA pixels, top row first, with no header */
+			FORMAT_RAW
+
+		};
+
+		/** Constructor; files are named with the prefix, then the frame number, then the format's extension */
+		FrameCapture(const std::string &prefix, Format format, unsigned int ringSize = 3);
+
+		/** Destructor; finishes any frames still in flight */
+		~FrameCapture();
+
+		/** Captures the current frame's framebuffer, of the given size */
+		void capture(unsigned int width, unsigned int height);
+
+		/** Reads back every frame in flight, and waits for all of them to be written */
+		void finish();
+
+		/** Gets the name of the file a frame is written to */
+		std::string getFileName(unsigned long frameNumber) const;
+
+		/** Gets the number the next captured frame will be given */
+		unsigned long getNextFrameNumber() const { return this->nextFrameNumber; }
+
+		/** Gets the number of frames written so far */
+		unsigned long getFramesWritten() const;
+
+		/** Gets the number of times capture() had to wait for the GPU or the worker */
+		unsigned long getStallCount() const { return this->stallCount; }
+
+		/** Gets whether or not frames are being read back asynchronously */
+		bool isAsynchronous() const;
+
+	protected:
+
+		/** A pixel-pack buffer that a frame is read into */
+		struct Slot {
+
+			/** The buffer object */
+			GLuint buffer;
+
+			/** The size of the buffer's storage, in bytes */
+			size_t size;
+
+			/** The fence after the read, or 0 if fences aren't available */
+			GLsync fence;
+
+			/** Whether or not a frame is waiting in the buffer */
+			bool pending;
+
+			/** The number of the frame in the buffer */
+			unsigned long frameNumber;
+
+			/** The width of the frame in the buffer */
+			unsigned int width;
+
+			/** The height of the frame in the buffer */
+			unsigned int height;
+
+		};
+
+		/** A frame waiting to be written */
+		struct Frame {
+
+			/** The number of the frame */
+			unsigned long frameNumber;
+
+			/** The width of the frame */
+			unsigned int width;
+
+			/** The height of the frame */
+			unsigned int height;
+
+			/** The frame's RGBA pixels, top row first */
+			std::vector<unsigned char> pixels;
+
+		};
+
+		/** Creates the pixel-pack buffers, if they can be used */
+		void createSlots();
+
+		/** Checks, without blocking, whether the read into a slot has finished */
+		bool isReady(const Slot &slot) const;
+
+		/** Maps a slot's buffer and queues its frame to be written, waiting for the read if need be */
+		void retire(Slot &slot);
+
+		/** Queues a frame to be written, and takes its pixels */
+		void enqueue(Frame &frame);
+
+		/** Writes queued frames until finish() is called; runs on the worker thread */
+		void writeFrames();
+
+		/** Writes a frame to its file */
+		void write(const Frame &frame) const;
+
+		/** The file name prefix */
+		std::string prefix;
+
+		/** The format of the files */
+		Format format;
+
+		/** The number of pixel-pack buffers to use */
+		unsigned int ringSize;
+
+		/** The pixel-pack buffers, empty if frames are read synchronously */
+		std::vector<Slot> slots;
+
+		/** Whether or not the pixel-pack buffers have been created */
+		bool slotsCreated;
+
+		/** The slot the next frame is read into; the slots after it are older */
+		unsigned int nextSlot;
+
+		/** The number the next captured frame will be given */
+		unsigned long nextFrameNumber;
+
+		/** The number of times capture() had to wait */
+		unsigned long stallCount;
+
+		/** The frames waiting to be written */
+		std::deque<Frame> queue;
+
+		/** The most frames that may wait to be written before capture() waits for the worker */
+		size_t maxQueued;
+
+		/** Whether or not the worker should exit once the queue is empty */
+		bool finishing;
+
+		/** The number of frames written so far */
+		unsigned long framesWritten;
+
+		/** Guards the queue, finishing and framesWritten */
+		mutable boost::mutex queueMutex;
+
+		/** Signalled when a frame is queued, or finish() is called */
+		boost::condition_variable frameQueued;
+
+		/** Signalled when a frame is taken off the queue */
+		boost::condition_variable frameTaken;
+
+		/** The thread that writes the files */
+		boost::thread worker;
+
+	};
+
+}
@@ -0,0 +1,98 @@
+/**
+* @file FrameSnapshot.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "CameraRigging.hpp"
+#include "CompiledSceneGraph.hpp"
+#include "Frustum.hpp"
+#include "RenderQueue.hpp"
+#include <boost/scoped_array.hpp>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief A copy of what a frame needs from the camera and the scene graph, taken on one thread and drawn on another
+	*
+	* capture() brings a compiled scene graph up to date, culls it with the
+	* rigging's frustum, and copies the camera's matrices and, for every
+	* leaf inside the frustum, its model's display toggles, its model's list
+	* of meshes and its model-to-world matrix.  Drawing reads only the copy,
+	* so the thread that handles events can go on moving the camera and the
+	* nodes, toggling the models' passes and adding meshes while the frame is
+	* drawn.  The meshes themselves are not copied, so they must not be
+	* changed while a snapshot that uses them may be drawn.
+	*
+	* Snapshots are meant to be passed through a TripleBuffer; each reuses
+	* its storage from one capture to the next.
+	*/
+	class FrameSnapshot {
+	public:
+
+		/** Constructs an empty snapshot */
+		FrameSnapshot();
+
+		/** Copies the camera's state, and the leaves of the graph inside its frustum */
+		void capture(CameraRigging &rigging, CompiledSceneGraph &graph);
+
+		/** Loads the projection and view matrices, as the rigging would */
+		void loadCamera() const;
+
+		/** Begins the queue with the view matrix and queues the leaves' meshes, as their models were when captured */
+		void enqueue(RenderQueue &queue) const;
+
+		/** Gets the projection matrix */
+		inline const Matrix<double> &getProjectionMatrix() const { return this->projection; }
+
+		/** Gets the view matrix */
+		inline const Matrix<double> &getViewMatrix() const { return this->view; }
+
+		/** Gets the frustum */
+		inline const Frustum &getFrustum() const { return this->frustum; }
+
+		/** Gets the number of leaves copied */
+		inline size_t size() const { return this->toggles.size(); }
+
+		/** Gets the counters of the culling */
+		inline const CullingStats &getStats() const { return this->stats; }
+
+	protected:
+
+		/** The projection matrix */
+		Matrix<double> projection;
+
+		/** The view matrix */
+		Matrix<double> view;
+
+		/** The frustum */
+		Frustum frustum;
+
+		/** The display toggles of the leaves' models */
+		std::vector<Model::DisplayToggles> toggles;
+
+		/** The meshes of the leaves' models, leaf after leaf */
+		SmoothMesh::list meshes;
+
+		/** Where each leaf's meshes start, with the end of the last leaf's after them */
+		std::vector<size_t> meshStarts;
+
+		/** The world-space centers of the leaves' bounds */
+		std::vector<Point3d> centers;
+
+		/** The leaves' model-to-world matrices */
+		boost::scoped_array<Matrix<double> > matrices;
+
+		/** The number of matrices there is room for */
+		size_t capacity;
+
+		/** The counters of the culling */
+		CullingStats stats;
+
+		/** The leaves inside the frustum, as the graph numbers them */
+		std::vector<boost::uint32_t> visibleLeaves;
+
+	};
+
+}
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "CameraRigging.hpp"
+#include "InverseMatrixCache.hpp"
 
 namespace peek {
 
@@ -26,6 +27,12 @@ namespace peek {
 		/** Initializes the modelview matrix based on the camera's pose */
 		void initModelviewMatrix();
 
+		/** Gets the view matrix for the camera's pose */
+		Matrix<double> getViewMatrix();
+
+		/** Gets the inverse of the view matrix */
+		const Matrix<double> &getInverseViewMatrix();
+
 		/** Provides access to the camera being rigged */
 		inline Camera *getCamera() { return this->camera.get(); }
 
@@ -66,6 +73,9 @@ namespace peek {
 		/** Pitch */
 		double pitch;
 
+		/** The inverse of the last view matrix */
+		InverseMatrixCache viewInverse;
+
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+/**
+* @file Frustum.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "BoundingBox.hpp"
+#include "BoundingSphere.hpp"
+
+namespace peek {
+
+	/**
+	* @brief A view frustum, as six planes facing inward
+	*
+	* Bounding volumes are tested against the planes selected by a plane mask.
+	* A plane the volume lies wholly inside of is removed from the mask, so the
+	* volume's children need not be tested against it again.
+	*/
+	class Frustum {
+	public:
+
+		/** The planes of the frustum, as bits of a plane mask */
+		enum Plane {
+			PLANE_LEFT = 1 << 0,
+			PLANE_RIGHT = 1 << 1,
+			PLANE_BOTTOM = 1 << 2,
+			PLANE_TOP = 1 << 3,
+			PLANE_NEAR = 1 << 4,
+			PLANE_FAR = 1 << 5,
+			ALL_PLANES = (1 << 6) - 1
+		};
+
+		/** Where a bounding volume lies with respect to the frustum */
+		enum Intersection {
+			OUTSIDE,
+			INTERSECTING,
+			INSIDE
+		};
+
+		/** Constructs a frustum that contains everything */
+		Frustum();
+
+		/** Constructs the frustum of a combined projection and view matrix */
+		explicit Frustum(const Matrix<double> &viewProjection);
+
+		/** Classifies a bounding volume, removing the planes it lies inside of from the mask */
+		Intersection classify(const BoundingBox &box, const BoundingSphere &sphere, unsigned int &planeMask) const;
+
+		/** Checks whether a point lies inside the frustum */
+		bool contains(const Point3d &point) const;
+
+		/** Gets a plane, as a, b, c and d of ax + by + cz + d >= 0 with a unit normal, numbered as the bits of a plane mask */
+		inline const double *getPlane(int plane) const { return this->planes[plane]; }
+
+		/** The number of planes */
+		static const int planeCount = 6;
+
+	protected:
+
+		/** The planes, as a, b, c and d of ax + by + cz + d >= 0 with a unit normal */
+		double planes[planeCount][4];
+
+		/** Gets the distance from a plane to a point */
+		inline double distance(int plane, double x, double y, double z) const {
+			return this->planes[plane][0] * x + this->planes[plane][1] * y + this->planes[plane][2] * z + this->planes[plane][3];
+		}
+
+	};
+
+}
@@ -6,9 +6,12 @@
 #include <cmath>
 #include <vector>
 #include <iostream>
+#include <stdexcept>
 #include "list_traits.hpp"
 #include "Numerics.hpp"
 #include "Set.hpp"
+#include "MatrixKernels.hpp"
+#include <boost/static_assert.hpp>
 
 namespace peek {
 
@@ -630,7 +633,14 @@ namespace peek {
 
 	using namespace std;
 
-	/** A 4x4 matrix */
+	/**
+	 * @brief A 4x4 matrix
+	 *
+	 * The elements are stored inline in column-major order, as OpenGL expects,
+	 * so matrices can be passed around and multiplied without touching the
+	 * heap.  Products and batch transforms of double and float matrices run
+	 * through the SIMD kernels in MatrixKernels.hpp.
+	 */
 	template <typename T>
 	class Matrix {
 
@@ -639,37 +649,35 @@ namespace peek {
 	public:
 
 		/** Constructs an identity matrix */
-		inline Matrix() : m(16) {
+		inline Matrix() {
 			setIdentity();
 		}
 
 		/** Constructs a matrix from another matrix */
-		inline Matrix(const Matrix<T_type> &a) : m(16) {
+		inline Matrix(const Matrix<T_type> &a) {
 			copy(a);
 		}
 
 		/** Constructs a matrix from a single-dimensional array */
-		inline Matrix(const T_type a[16]) : m(16) {
+		inline Matrix(const T_type a[16]) {
 			loadFromArray(a);
 		}
 
 		/** Sets the matrix to the identity matrix */
 		inline void setIdentity() {
-			for(int i=0; i < 4; i++)
-				for(int j=0; j < 4; j++)
-					this->m[i*4+j] = (i==j ? 1.0:0.0);
+			for(int i=0; i < 16; i++)
+				this->m[i] = (i % 5 == 0 ? 1 : 0);
 		}
 
 		/** Sets the matrix from values in a single-dimensional array */
 		inline void loadFromArray(const T_type a[16]) {
-			for(int i=0; i < 4; i++)
-				for(int j=0; j < 4; j++)
-					this->m[i*4+j] = a[i*4+j];
+			for(int i=0; i < 16; i++)
+				this->m[i] = a[i];
 		}
 
 		/** Copies values from another matrix */
 		inline void copy(const Matrix<T_type> &a) {
-			this->m = a.m;
+			loadFromArray(a.m);
 		}
 
 		/** Assigns the values in one matrix to another */
@@ -678,66 +686,306 @@ namespace peek {
 			return *this;
 		}
 
-		/** Gets the value of a particular matrix element */
-		inline double &operator()(unsigned int i, unsigned int j) {
-			/** @todo Throw a proper exception */
-			if(i < 0 || i >= 4 || j < 0 || j >= 4)
-				throw -1;
+		/** Gets the value of a particular matrix element (column i, row j) */
+		inline T_type &operator()(unsigned int i, unsigned int j) {
+			if(i >= 4 || j >= 4)
+				throw std::out_of_range("Matrix element out of range");
 			return this->m[i*4+j];
 		}
 
-		/** Gets the value of a particular matrix element */
-		inline double at(unsigned int i, unsigned int j) const {
-			/** @todo Throw a proper exception */
-			if(i < 0 || i >= 4 || j < 0 || j >= 4)
-				throw -1;
-			return this->m.at(i*4+j);
+		/** Gets the value of a particular matrix element (column i, row j) */
+		inline T_type at(unsigned int i, unsigned int j) const {
+			if(i >= 4 || j >= 4)
+				throw std::out_of_range("Matrix element out of range");
+			return this->m[i*4+j];
+		}
+
+		/** Gets the values as a column-major array, as glLoadMatrix expects */
+		inline const T_type *getArray() const {
+			return this->m;
+		}
+
+		/** Gets the values as a column-major array, for writing */
+		inline T_type *getArray() {
+			return this->m;
+		}
+
+		/** Checks whether the bottom row is (0, 0, 0, 1), so the matrix is an affine transformation */
+		inline bool isAffine() const {
+			return this->m[3] == 0 && this->m[7] == 0 && this->m[11] == 0 && this->m[15] == 1;
+		}
+
+		/** Equality */
+		inline bool operator==(const Matrix<T_type> &rhs) const {
+			for(int i=0; i < 16; i++)
+				if(this->m[i] != rhs.m[i])
+					return false;
+			return true;
+		}
+
+		/** Inequality */
+		inline bool operator!=(const Matrix<T_type> &rhs) const {
+			return !(*this == rhs);
 		}
 
 	protected:
 
-		/** The matrix */
-		vector<T_type> m;
+		/** The matrix, column by column */
+		T_type m[16];
 	};
 
 	/** Multiplies two matrices */
 	template <typename T>
 	inline Matrix<T> operator*(const Matrix<T> &a, const Matrix<T> &b) {
 		Matrix<T> m;
-		/** @todo Find a faster way to do matrix multiplication */
+		const T *x = a.getArray(), *y = b.getArray();
+		T *z = m.getArray();
 		for(int i=0; i < 4; i++) {
 			for(int j=0; j < 4; j++) {
-				m(i, j) = 0.0;
+				T sum = 0;
 				for(int k=0; k < 4; k++) {
-					m(i, j) += a.at(k, j) * b.at(i, k);
+					sum += x[k*4+j] * y[i*4+k];
 				}
+				z[i*4+j] = sum;
 			}
 		}
 		return m;
 	}
 
+	/** Multiplies two matrices of doubles with the fastest available kernel */
+	inline Matrix<double> operator*(const Matrix<double> &a, const Matrix<double> &b) {
+		Matrix<double> m;
+		multiplyMatrices(a.getArray(), b.getArray(), m.getArray());
+		return m;
+	}
+
+	/** Multiplies two matrices of floats with the fastest available kernel */
+	inline Matrix<float> operator*(const Matrix<float> &a, const Matrix<float> &b) {
+		Matrix<float> m;
+		multiplyMatrices(a.getArray(), b.getArray(), m.getArray());
+		return m;
+	}
+
 	/** Transforms a vector by a matrix to get a new vector */
 	template <typename T>
 	inline Vector3<T> operator*(const Matrix<T> &a, const Vector3<T> &b) {
+		const T *m = a.getArray();
 		Vector3<T> v;
-		v.x = (b.x * a.at(0, 0)) + (b.y * a.at(1, 0)) + (b.z * a.at(2, 0)) + (b.h * a.at(3, 0));
-		v.y = (b.x * a.at(0, 1)) + (b.y * a.at(1, 1)) + (b.z * a.at(2, 1)) + (b.h * a.at(3, 1));
-		v.z = (b.x * a.at(0, 2)) + (b.y * a.at(1, 2)) + (b.z * a.at(2, 2)) + (b.h * a.at(3, 2));
-		v.h = (b.x * a.at(0, 3)) + (b.y * a.at(1, 3)) + (b.z * a.at(2, 3)) + (b.h * a.at(3, 3));
+		v.x = (b.x * m[0]) + (b.y * m[4]) + (b.z * m[8]) + (b.h * m[12]);
+		v.y = (b.x * m[1]) + (b.y * m[5]) + (b.z * m[9]) + (b.h * m[13]);
+		v.z = (b.x * m[2]) + (b.y * m[6]) + (b.z * m[10]) + (b.h * m[14]);
+		v.h = (b.x * m[3]) + (b.y * m[7]) + (b.z * m[11]) + (b.h * m[15]);
 		return v;
 	}
 
 	/** Transforms a point by a matrix to get a new point */
 	template <typename T>
 	inline Point3<T> operator*(const Matrix<T> &a, const Point3<T> &b) {
+		const T *m = a.getArray();
 		Point3<T> p;
-		p.x = (b.x * a.at(0, 0)) + (b.y * a.at(1, 0)) + (b.z * a.at(2, 0)) + (b.h * a.at(3, 0));
-		p.y = (b.x * a.at(0, 1)) + (b.y * a.at(1, 1)) + (b.z * a.at(2, 1)) + (b.h * a.at(3, 1));
-		p.z = (b.x * a.at(0, 2)) + (b.y * a.at(1, 2)) + (b.z * a.at(2, 2)) + (b.h * a.at(3, 2));
-		p.h = (b.x * a.at(0, 3)) + (b.y * a.at(1, 3)) + (b.z * a.at(2, 3)) + (b.h * a.at(3, 3));
+		p.x = (b.x * m[0]) + (b.y * m[4]) + (b.z * m[8]) + (b.h * m[12]);
+		p.y = (b.x * m[1]) + (b.y * m[5]) + (b.z * m[9]) + (b.h * m[13]);
+		p.z = (b.x * m[2]) + (b.y * m[6]) + (b.z * m[10]) + (b.h * m[14]);
+		p.h = (b.x * m[3]) + (b.y * m[7]) + (b.z * m[11]) + (b.h * m[15]);
 		return p;
 	}
 
+	// transformPoints() and transformVectors() hand the kernels arrays of points and vectors as packed (x, y, z, h) records
+	BOOST_STATIC_ASSERT(sizeof(Point3<double>) == 4 * sizeof(double));
+	BOOST_STATIC_ASSERT(sizeof(Vector3<double>) == 4 * sizeof(double));
+
+	/** Transforms a list of points by a matrix, a whole point per SIMD operation where possible */
+	inline void transformPoints(const Matrix<double> &a, const Point3<double> *in, Point3<double> *out, size_t count) {
+		transformHomogeneous(a.getArray(), &in->x, &out->x, count);
+	}
+
+	/** Transforms a list of points by a matrix */
+	inline void transformPoints(const Matrix<double> &a, const vector<Point3<double> > &in, vector<Point3<double> > &out) {
+		out.resize(in.size());
+		if(!in.empty())
+			transformPoints(a, &in[0], &out[0], in.size());
+	}
+
+	/** Transforms a list of vectors by a matrix, a whole vector per SIMD operation where possible */
+	inline void transformVectors(const Matrix<double> &a, const Vector3<double> *in, Vector3<double> *out, size_t count) {
+		transformHomogeneous(a.getArray(), &in->x, &out->x, count);
+	}
+
+	/** Transforms a list of vectors by a matrix */
+	inline void transformVectors(const Matrix<double> &a, const vector<Vector3<double> > &in, vector<Vector3<double> > &out) {
+		out.resize(in.size());
+		if(!in.empty())
+			transformVectors(a, &in[0], &out[0], in.size());
+	}
+
+	/*!
+	* @brief Calculates the inverse of a matrix by cofactor expansion
+	* @param a The matrix to invert
+	* @param result Receives the inverse, or is left alone if the matrix is singular
+	* @return Whether or not the matrix could be inverted
+	*/
+	template <typename T>
+	inline bool invert(const Matrix<T> &a, Matrix<T> &result) {
+		const T *m = a.getArray();
+		T inv[16];
+
+		inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+		inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+		inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+		inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+		inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+		inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+		inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+		inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+		inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+		inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+		inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+		inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+		inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+		inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+		inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+		inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+		T det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+		if(det == 0)
+			return false;
+
+		for(int i=0; i < 16; i++)
+			inv[i] /= det;
+
+		result.loadFromArray(inv);
+		return true;
+	}
+
+	/*!
+	* @brief Calculates the inverse of an affine matrix
+	* @param a The matrix to invert, whose bottom row must be (0, 0, 0, 1)
+	* @param result Receives the inverse, or is left alone if the matrix is singular
+	* @return Whether or not the matrix could be inverted
+	*
+	* Only the upper 3x3 block needs a real inverse; the translation of the
+	* inverse is that inverse applied to the negated translation.  This is
+	* several times cheaper than invert() and works with scaling and shearing,
+	* not just rotations.
+	*/
+	template <typename T>
+	inline bool invertAffine(const Matrix<T> &a, Matrix<T> &result) {
+		const T *m = a.getArray();
+
+		// Cofactors of the upper 3x3 block, already transposed into the inverse's layout
+		T c00 = m[5]*m[10] - m[9]*m[6], c01 = m[9]*m[2] - m[1]*m[10], c02 = m[1]*m[6] - m[5]*m[2];
+		T c10 = m[8]*m[6] - m[4]*m[10], c11 = m[0]*m[10] - m[8]*m[2], c12 = m[4]*m[2] - m[0]*m[6];
+		T c20 = m[4]*m[9] - m[8]*m[5], c21 = m[8]*m[1] - m[0]*m[9], c22 = m[0]*m[5] - m[4]*m[1];
+
+		T det = m[0]*c00 + m[4]*c01 + m[8]*c02;
+		if(det == 0)
+			return false;
+
+		T s = 1 / det;
+		T *r = result.getArray();
+		r[0] = c00*s; r[4] = c10*s; r[8] = c20*s;
+		r[1] = c01*s; r[5] = c11*s; r[9] = c21*s;
+		r[2] = c02*s; r[6] = c12*s; r[10] = c22*s;
+		r[3] = 0; r[7] = 0; r[11] = 0; r[15] = 1;
+
+		r[12] = -(r[0]*m[12] + r[4]*m[13] + r[8]*m[14]);
+		r[13] = -(r[1]*m[12] + r[5]*m[13] + r[9]*m[14]);
+		r[14] = -(r[2]*m[12] + r[6]*m[13] + r[10]*m[14]);
+		return true;
+	}
+
+	/*!
+	* @brief Calculates the matrix that transforms normals along with a matrix
+	* @param a The matrix that transforms points
+	* @return The inverse transpose of the upper 3x3 block, with no translation
+	*         (the identity if that block is singular)
+	*/
+	template <typename T>
+	inline Matrix<T> normalMatrix(const Matrix<T> &a) {
+		Matrix<T> linear(a), inverse, normal;
+		T *l = linear.getArray();
+		l[3] = l[7] = l[11] = l[12] = l[13] = l[14] = 0;
+		l[15] = 1;
+
+		if(!invertAffine(linear, inverse))
+			return normal;
+
+		const T *i = inverse.getArray();
+		T *n = normal.getArray();
+		for(int col=0; col < 3; col++)
+			for(int row=0; row < 3; row++)
+				n[col*4+row] = i[row*4+col];
+		return normal;
+	}
+
+	/** Constructs a matrix that translates by the given amounts, like glTranslate */
+	template <typename T>
+	inline Matrix<T> translationMatrix(T x, T y, T z) {
+		Matrix<T> m;
+		m(3, 0) = x;
+		m(3, 1) = y;
+		m(3, 2) = z;
+		return m;
+	}
+
+	/** Constructs a matrix that scales by the given factors, like glScale */
+	template <typename T>
+	inline Matrix<T> scalingMatrix(T x, T y, T z) {
+		Matrix<T> m;
+		m(0, 0) = x;
+		m(1, 1) = y;
+		m(2, 2) = z;
+		return m;
+	}
+
+	/** Constructs a matrix that rotates by the given angle (in degrees) about the given axis, like glRotate */
+	template <typename T>
+	inline Matrix<T> rotationMatrix(T angle, T x, T y, T z) {
+		Matrix<T> m;
+		T length = sqrt(x*x + y*y + z*z);
+		if(length == 0)
+			return m;
+
+		x /= length;
+		y /= length;
+		z /= length;
+
+		T radians = angle * PI / 180.0;
+		T c = cos(radians), s = sin(radians), t = 1 - c;
+
+		m(0, 0) = x*x*t + c;
+		m(0, 1) = y*x*t + z*s;
+		m(0, 2) = x*z*t - y*s;
+		m(1, 0) = x*y*t - z*s;
+		m(1, 1) = y*y*t + c;
+		m(1, 2) = y*z*t + x*s;
+		m(2, 0) = x*z*t + y*s;
+		m(2, 1) = y*z*t - x*s;
+		m(2, 2) = z*z*t + c;
+		return m;
+	}
+
+	/*!
+	* @brief Constructs a matrix that restricts drawing to a small region of the viewport, like gluPickMatrix
+	* @param x The center of the region, in window coordinates
+	* @param y The center of the region, in window coordinates
+	* @param width The width of the region, in pixels
+	* @param height The height of the region, in pixels
+	* @param viewport The viewport, as returned by glGetIntegerv(GL_VIEWPORT)
+	*/
+	template <typename T>
+	inline Matrix<T> pickingMatrix(T x, T y, T width, T height, const int viewport[4]) {
+		Matrix<T> m;
+		if(width <= 0 || height <= 0)
+			return m;
+
+		m(0, 0) = viewport[2] / width;
+		m(1, 1) = viewport[3] / height;
+		m(3, 0) = (viewport[2] - 2 * (x - viewport[0])) / width;
+		m(3, 1) = (viewport[3] - 2 * (y - viewport[1])) / height;
+		return m;
+	}
+
 	/*!
 	* @brief Prints a matrix to the given stream
 	* @param os The stream to print the matrix to
@@ -838,6 +1086,89 @@ namespace peek {
 		return determinant;
 	}
 
+	/**
+	 * Hashes points for a Set
+	 *
+	 * With no tolerance, points are hashed by their exact coordinates and
+	 * compared with operator==.  With a tolerance, space is divided into cubic
+	 * cells as wide as the tolerance and points are hashed by their cell;
+	 * points are then equal if they are no farther apart than the tolerance,
+	 * which can only be the case if they're in the same or adjacent cells.
+	 */
+	template <typename T>
+	struct SetTraits<Point3<T> > {
+
+		/** The most hashes candidateHashes() may produce: a cell and its neighbours */
+		static const int maxCandidates = 27;
+
+		/** Gets the hash under which a point is stored */
+		static inline size_t hash(const Point3<T> &p, double tolerance) {
+			if (tolerance > 0.0) {
+				return cellHash(cell(p.x, tolerance), cell(p.y, tolerance), cell(p.z, tolerance));
+			}
+
+			// Adding zero turns -0 into 0, which operator== considers equal
+			size_t seed = 0;
+			boost::hash_combine(seed, p.x + T(0));
+			boost::hash_combine(seed, p.y + T(0));
+			boost::hash_combine(seed, p.z + T(0));
+			return seed;
+		}
+
+		/** Gets the hashes under which a point equal to the given one could be stored */
+		static inline int candidateHashes(const Point3<T> &p, double tolerance, size_t *hashes) {
+			if (tolerance <= 0.0) {
+				hashes[0] = hash(p, tolerance);
+				return 1;
+			}
+
+			boost::int64_t x = cell(p.x, tolerance), y = cell(p.y, tolerance), z = cell(p.z, tolerance);
+			int count = 0;
+
+			// The point's own cell comes first, since that's where a match is most likely
+			hashes[count++] = cellHash(x, y, z);
+
+			for (int i = -1; i <= 1; i++) {
+				for (int j = -1; j <= 1; j++) {
+					for (int k = -1; k <= 1; k++) {
+						if (i != 0 || j != 0 || k != 0) {
+							hashes[count++] = cellHash(x + i, y + j, z + k);
+						}
+					}
+				}
+			}
+
+			return count;
+		}
+
+		/** Determines if two points are equal, or within the tolerance of each other */
+		static inline bool equal(const Point3<T> &a, const Point3<T> &b, double tolerance) {
+			if (tolerance <= 0.0) {
+				return a == b;
+			}
+
+			double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+			return a.h == b.h && dx*dx + dy*dy + dz*dz <= tolerance*tolerance;
+		}
+
+	private:
+
+		/** Gets the index of the cell containing a coordinate */
+		static inline boost::int64_t cell(T coordinate, double tolerance) {
+			return (boost::int64_t) floor(coordinate / tolerance);
+		}
+
+		/** Hashes a cell's indices */
+		static inline size_t cellHash(boost::int64_t x, boost::int64_t y, boost::int64_t z) {
+			size_t seed = 0;
+			boost::hash_combine(seed, x);
+			boost::hash_combine(seed, y);
+			boost::hash_combine(seed, z);
+			return seed;
+		}
+
+	};
+
 	typedef Point3<double> Point3d;
 	typedef Point3<float> Point3f;
 
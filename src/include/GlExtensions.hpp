@@ -0,0 +1,103 @@
+/**
+ * \file GlExtensions.hpp
+ * \author Douglas W. Paul
+ *
+ * Declares the OpenGL entry points beyond version 1.1 that peek uses.  On
+ * some platforms (notably Windows) these must be looked up at runtime once a
+ * context exists, so they are accessed through function pointers.
+ */
+
+#pragma once
+
+#include "Peek_base.hpp"
+#include "RenderContext.hpp"
+
+#ifdef _WIN32
+#  include <gl/glext.h>
+#else
+#  include <GL/glext.h>
+#endif
+
+namespace peek {
+
+	/** Looks up the extension entry points; must be called with the given context current */
+	void initGlExtensions(RenderContext &renderContext);
+
+	/** Whether or not buffer objects (OpenGL 1.5 or ARB_vertex_buffer_object) are available */
+	bool haveBufferObjects();
+
+	/** Whether or not pixels can be read into mapped buffer objects (OpenGL 2.1 or ARB_pixel_buffer_object) */
+	bool havePixelBufferObjects();
+
+	/** Whether or not fence syncs (OpenGL 3.2 or ARB_sync) are available */
+	bool haveFenceSync();
+
+	/** Whether or not framebuffer objects (OpenGL 3.0, ARB_framebuffer_object or EXT_framebuffer_object) are available */
+	bool haveFramebufferObjects();
+
+	/** Whether or not GLSL programs (OpenGL 2.0) are available */
+	bool haveShaders();
+
+	/** Whether or not per-instance vertex attributes can be drawn instanced (OpenGL 3.3, or ARB_instanced_arrays and ARB_draw_instanced) */
+	bool haveInstancing();
+
+	/** Whether or not GPU time can be measured with GL_TIME_ELAPSED queries (OpenGL 3.3, ARB_timer_query or EXT_timer_query) */
+	bool haveTimerQueries();
+
+	extern PFNGLGENBUFFERSPROC pkGlGenBuffers;
+	extern PFNGLDELETEBUFFERSPROC pkGlDeleteBuffers;
+	extern PFNGLBINDBUFFERPROC pkGlBindBuffer;
+	extern PFNGLBUFFERDATAPROC pkGlBufferData;
+	extern PFNGLBUFFERSUBDATAPROC pkGlBufferSubData;
+	extern PFNGLMAPBUFFERPROC pkGlMapBuffer;
+	extern PFNGLUNMAPBUFFERPROC pkGlUnmapBuffer;
+
+	extern PFNGLDRAWRANGEELEMENTSPROC pkGlDrawRangeElements;
+	extern PFNGLMULTIDRAWELEMENTSPROC pkGlMultiDrawElements;
+
+	extern PFNGLFENCESYNCPROC pkGlFenceSync;
+	extern PFNGLCLIENTWAITSYNCPROC pkGlClientWaitSync;
+	extern PFNGLDELETESYNCPROC pkGlDeleteSync;
+
+	extern PFNGLGENFRAMEBUFFERSPROC pkGlGenFramebuffers;
+	extern PFNGLDELETEFRAMEBUFFERSPROC pkGlDeleteFramebuffers;
+	extern PFNGLBINDFRAMEBUFFERPROC pkGlBindFramebuffer;
+	extern PFNGLFRAMEBUFFERRENDERBUFFERPROC pkGlFramebufferRenderbuffer;
+	extern PFNGLCHECKFRAMEBUFFERSTATUSPROC pkGlCheckFramebufferStatus;
+	extern PFNGLGENRENDERBUFFERSPROC pkGlGenRenderbuffers;
+	extern PFNGLDELETERENDERBUFFERSPROC pkGlDeleteRenderbuffers;
+	extern PFNGLBINDRENDERBUFFERPROC pkGlBindRenderbuffer;
+	extern PFNGLRENDERBUFFERSTORAGEPROC pkGlRenderbufferStorage;
+
+	extern PFNGLCREATESHADERPROC pkGlCreateShader;
+	extern PFNGLDELETESHADERPROC pkGlDeleteShader;
+	extern PFNGLSHADERSOURCEPROC pkGlShaderSource;
+	extern PFNGLCOMPILESHADERPROC pkGlCompileShader;
+	extern PFNGLGETSHADERIVPROC pkGlGetShaderiv;
+	extern PFNGLGETSHADERINFOLOGPROC pkGlGetShaderInfoLog;
+	extern PFNGLCREATEPROGRAMPROC pkGlCreateProgram;
+	extern PFNGLDELETEPROGRAMPROC pkGlDeleteProgram;
+	extern PFNGLATTACHSHADERPROC pkGlAttachShader;
+	extern PFNGLBINDATTRIBLOCATIONPROC pkGlBindAttribLocation;
+	extern PFNGLLINKPROGRAMPROC pkGlLinkProgram;
+	extern PFNGLGETPROGRAMIVPROC pkGlGetProgramiv;
+	extern PFNGLGETPROGRAMINFOLOGPROC pkGlGetProgramInfoLog;
+	extern PFNGLUSEPROGRAMPROC pkGlUseProgram;
+	extern PFNGLGETUNIFORMLOCATIONPROC pkGlGetUniformLocation;
+	extern PFNGLUNIFORM1IPROC pkGlUniform1i;
+	extern PFNGLUNIFORM1IVPROC pkGlUniform1iv;
+	extern PFNGLVERTEXATTRIBPOINTERPROC pkGlVertexAttribPointer;
+	extern PFNGLENABLEVERTEXATTRIBARRAYPROC pkGlEnableVertexAttribArray;
+	extern PFNGLDISABLEVERTEXATTRIBARRAYPROC pkGlDisableVertexAttribArray;
+
+	extern PFNGLVERTEXATTRIBDIVISORPROC pkGlVertexAttribDivisor;
+	extern PFNGLDRAWELEMENTSINSTANCEDPROC pkGlDrawElementsInstanced;
+
+	extern PFNGLGENQUERIESPROC pkGlGenQueries;
+	extern PFNGLDELETEQUERIESPROC pkGlDeleteQueries;
+	extern PFNGLBEGINQUERYPROC pkGlBeginQuery;
+	extern PFNGLENDQUERYPROC pkGlEndQuery;
+	extern PFNGLGETQUERYOBJECTIVPROC pkGlGetQueryObjectiv;
+	extern PFNGLGETQUERYOBJECTUI64VPROC pkGlGetQueryObjectui64v;
+
+}
@@ -0,0 +1,118 @@
+/**
+* @file GlStateCache.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "Material.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Remembers the OpenGL state it has set, and skips calls that would not change it
+	*
+	* The cache only knows about state set through it.  After anything else
+	* may have changed that state, such as at the start of a frame, call
+	* invalidate() so that the next call of each kind is made unconditionally.
+	*/
+	class GlStateCache {
+	public:
+
+		/** The capabilities the cache tracks */
+		enum Capability {
+			CAP_LIGHTING,
+			CAP_CULL_FACE,
+			CAP_POLYGON_OFFSET_FILL,
+			CAP_COUNT
+		};
+
+		/** Constructs a cache that knows nothing of the current state */
+		GlStateCache();
+
+		/** Forgets the state, so the next call of each kind is made */
+		void invalidate();
+
+		/** Enables or disables a capability */
+		void setEnabled(Capability capability, bool enabled);
+
+		/** Sets the polygon mode of both faces */
+		void setPolygonMode(GLenum mode);
+
+		/** Sets which faces are culled */
+		void setCullFace(GLenum face);
+
+		/** Sets the polygon offset */
+		void setPolygonOffset(GLfloat factor, GLfloat units);
+
+		/** Sets the front material, identified by a number that is the same for equal materials */
+		void setMaterial(const Material &material, unsigned int id);
+
+		/** Sets the current colour */
+		void setColor(GLfloat r, GLfloat g, GLfloat b);
+
+		/** Forgets the current colour, after something else has set it */
+		inline void forgetColor() { this->colorKnown = false; }
+
+		/** Gets the number of state changes made */
+		inline unsigned long getChangeCount() const { return this->changeCount; }
+
+		/** Gets the number of state changes skipped because they would have changed nothing */
+		inline unsigned long getSkippedCount() const { return this->skippedCount; }
+
+		/** Gets the number of material changes made */
+		inline unsigned long getMaterialChangeCount() const { return this->materialChangeCount; }
+
+		/** Zeroes the counters */
+		void resetCounts();
+
+	protected:
+
+		/** The state a capability is in */
+		enum CapabilityState {
+			CAP_UNKNOWN,
+			CAP_ENABLED,
+			CAP_DISABLED
+		};
+
+		/** The state of each capability */
+		CapabilityState capabilities[CAP_COUNT];
+
+		/** The polygon mode, or 0 if unknown */
+		GLenum polygonMode;
+
+		/** The culled faces, or 0 if unknown */
+		GLenum cullFace;
+
+		/** Whether or not the polygon offset is known */
+		bool polygonOffsetKnown;
+
+		/** The polygon offset factor */
+		GLfloat polygonOffsetFactor;
+
+		/** The polygon offset units */
+		GLfloat polygonOffsetUnits;
+
+		/** Whether or not the material is known */
+		bool materialKnown;
+
+		/** The number of the material */
+		unsigned int materialId;
+
+		/** Whether or not the colour is known */
+		bool colorKnown;
+
+		/** The colour */
+		GLfloat color[3];
+
+		/** The number of state changes made */
+		unsigned long changeCount;
+
+		/** The number of state changes skipped */
+		unsigned long skippedCount;
+
+		/** The number of material changes made */
+		unsigned long materialChangeCount;
+
+	};
+
+}
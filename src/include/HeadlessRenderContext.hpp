@@ -0,0 +1,71 @@
+/**
+* @file HeadlessRenderContext.hpp
+*/
+#pragma once
+
+#include "RenderContext.hpp"
+
+// EGL is how Mesa renders without a display; define PEEK_NO_EGL to build without it.  Windows uses WGL instead
+#if !defined(PEEK_NO_EGL) && !defined(_WIN32)
+#  define PEEK_HAVE_EGL
+#endif
+
+namespace peek {
+
+	/**
+	* @brief Renders to an offscreen framebuffer, with no window or display
+	*
+	* The context is an EGL pbuffer.  Mesa's surfaceless platform is used
+	* where available, so with llvmpipe this works on machines with neither
+	* a GPU nor a display server.  On Windows the context is a WGL pbuffer,
+	* made with the help of a hidden window, and drivers without
+	* WGL_ARB_pbuffer are not supported.  There are never any events.
+	*/
+	class HeadlessRenderContext : public RenderContext {
+	public:
+
+		/** Creates a context with a framebuffer of the given size; throws std::runtime_error if it can't */
+		HeadlessRenderContext(unsigned int width, unsigned int height);
+
+		/** Destructor */
+		virtual ~HeadlessRenderContext();
+
+		virtual unsigned int getWidth() const { return this->width; }
+
+		virtual unsigned int getHeight() const { return this->height; }
+
+		virtual bool isVsync() const { return false; }
+
+		virtual void *getProcAddress(const char *name);
+
+		virtual void swapBuffers();
+
+		virtual bool pollEvent(SDL_Event &) { return false; }
+
+		virtual bool hasPendingEvents() { return false; }
+
+		typedef handle_traits<HeadlessRenderContext>::handle_type handle;
+
+	protected:
+
+		/** The width of the framebuffer, in pixels */
+		unsigned int width;
+
+		/** The height of the framebuffer, in pixels */
+		unsigned int height;
+
+		/** The EGLDisplay, or the hidden window's HWND, kept opaque so that EGL's headers stay out of this one */
+		void *display;
+
+		/** The EGLSurface, or the pbuffer's HDC */
+		void *surface;
+
+		/** The EGLContext, or the HGLRC */
+		void *context;
+
+		/** The HPBUFFERARB (WGL only) */
+		void *pbuffer;
+
+	};
+
+}
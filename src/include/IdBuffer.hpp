@@ -0,0 +1,189 @@
+/**
+* @file IdBuffer.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "GlExtensions.hpp"
+#include "PickingIds.hpp"
+#include "SceneGraphNodeBase.hpp"
+#include "CameraRigging.hpp"
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief Picks leaves by drawing their IDs offscreen and reading back the pixels asked about
+	*
+	* One pass answers both which leaves show in a rectangle and which leaf
+	* is under each of a list of points.  The scene is drawn through the
+	* picking traversal into a framebuffer object covering just the bounds of
+	* the rectangle and points, with the projection narrowed to match, so
+	* leaves outside it are culled.  Only the rectangle and the points' pixels
+	* are read back, into a pixel-pack buffer behind a fence, so pick() does
+	* not wait for the GPU; the results are decoded by finish().  Without
+	* pixel buffer objects, the pixels are read synchronously.
+	*
+	* The results name leaves only.  To find the face under a point, cast a
+	* ray at the leaf: leaf->castRay(rigging, x, y).
+	*
+	* Everything must be called with the OpenGL context current, and the
+	* leaves must outlive the results.
+	*/
+	class IdBuffer {
+	public:
+
+		/** A pixel, measured from the top left of the viewport */
+		struct Pixel {
+
+			/** The distance from the left of the viewport */
+			int x;
+
+			/** The distance from the top of the viewport */
+			int y;
+
+			/** Constructs a pixel from its coordinates */
+			Pixel(int x, int y) : x(x), y(y) {}
+
+		};
+
+		/** Constructor; no OpenGL objects are made until the first pick */
+		IdBuffer();
+
+		/** Destructor; releases the OpenGL objects */
+		~IdBuffer();
+
+		/** Determines whether or not the context can draw offscreen, which picking needs */
+		static bool isSupported();
+
+		/** Draws the scene's IDs and starts reading back a rectangle, which may be empty, and a list of points */
+		void pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, int x, int y, int width, int height, const std::vector<Pixel> &points);
+
+		/** Draws the scene's IDs and starts reading back a list of points */
+		void pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, const std::vector<Pixel> &points);
+
+		/** Draws the scene's IDs and starts reading back a rectangle */
+		void pick(const SceneGraphNodeBase &scene, CameraRigging &rigging, int x, int y, int width, int height);
+
+		/** Determines, without waiting, whether or not the last pick's pixels have been read back */
+		bool isReady() const;
+
+		/** Waits for the last pick's pixels if need be, and decodes them */
+		void finish();
+
+		/** Gets the leaves with any pixel in the rectangle, each once, in the order they were drawn */
+		const std::vector<const SceneGraphLeaf *> &getLeavesInRectangle() const { return this->leavesInRectangle; }
+
+		/** Gets the leaf under each point, or NULL where there is none */
+		const std::vector<const SceneGraphLeaf *> &getLeavesAtPoints() const { return this->leavesAtPoints; }
+
+		/** Releases the OpenGL objects, which are made again by the next pick */
+		void release();
+
+	protected:
+
+		/** A rectangle of pixels read back, in window coordinates relative to the drawn bounds */
+		struct Region {
+
+			/** The left of the region */
+			int x;
+
+			/** The bottom of the region */
+			int y;
+
+			/** The width of the region */
+			int width;
+
+			/** The height of the region */
+			int height;
+
+			/** Where the region's pixels start in the read-back data, in bytes */
+			size_t offset;
+
+		};
+
+		/** Where a point's pixel was read back: a region, and the pixel's place in it */
+		struct PointRead {
+
+			/** The index of the region, or -1 if the point was outside the viewport */
+			int region;
+
+			/** The pixel's distance from the left of the region */
+			int x;
+
+			/** The pixel's distance from the bottom of the region */
+			int y;
+
+		};
+
+		/** Makes the framebuffer at least the given size */
+		void reserveTarget(int width, int height);
+
+		/** Reads the regions' pixels, into the pixel-pack buffer if there is one */
+		void readRegions(size_t size);
+
+		/** Decodes the read-back pixels into the results */
+		void decode(const GLubyte *pixels);
+
+		/** The most points read one pixel at a time; past this, their bounds are read in one go */
+		static const size_t maxPointReads;
+
+		/** The framebuffer object the IDs are drawn into */
+		GLuint framebuffer;
+
+		/** The colour renderbuffer, 8 bits per channel */
+		GLuint colorBuffer;
+
+		/** The depth renderbuffer */
+		GLuint depthBuffer;
+
+		/** The width of the renderbuffers */
+		int targetWidth;
+
+		/** The height of the renderbuffers */
+		int targetHeight;
+
+		/** The pixel-pack buffer the regions are read into, or 0 if they are read synchronously */
+		GLuint packBuffer;
+
+		/** The size of the pixel-pack buffer's storage, in bytes */
+		size_t packBufferSize;
+
+		/** The fence after the reads, or 0 if fences aren't available */
+		GLsync fence;
+
+		/** Whether or not a pick is waiting to be decoded */
+		bool pending;
+
+		/** The pixels read synchronously, when there is no pixel-pack buffer */
+		std::vector<GLubyte> clientPixels;
+
+		/** The regions the last pick read; the rectangle's, if any, comes first */
+		std::vector<Region> regions;
+
+		/** Whether or not the last pick read a rectangle */
+		bool haveRectangle;
+
+		/** Where each of the last pick's points was read */
+		std::vector<PointRead> pointReads;
+
+		/** The IDs given out in the last pick */
+		PickingIds ids;
+
+		/** The leaves in the rectangle */
+		std::vector<const SceneGraphLeaf *> leavesInRectangle;
+
+		/** The leaf under each point */
+		std::vector<const SceneGraphLeaf *> leavesAtPoints;
+
+	private:
+
+		/** Owns OpenGL objects, so cannot be copied */
+		IdBuffer(const IdBuffer &);
+
+		/** Owns OpenGL objects, so cannot be copied */
+		IdBuffer &operator=(const IdBuffer &);
+
+	};
+
+}
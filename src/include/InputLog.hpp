@@ -0,0 +1,89 @@
+/**
+* @file InputLog.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <boost/cstdint.hpp>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief A recording of the input events an engine dispatched, for replaying the same interaction later
+	*
+	* Key presses, mouse buttons, mouse motion and custom events are kept,
+	* each with when it was taken, in microseconds, and how many frames had
+	* been drawn by then, both counted from when recording began.  Key
+	* presses also keep where the pointer was, which key handlers are given.
+	* Bound keys are replayed as keys, so they are turned into actions by
+	* the engine's bindings again.
+	*
+	* Logs are saved in a compact binary form: a short header, then each
+	* event as its type, then variable-length integers for the time and
+	* frame since the event before and for the event's fields.
+	*/
+	class InputLog {
+	public:
+
+		/** An event, and when it was taken */
+		struct Entry {
+
+			/** When the event was taken, in microseconds since recording began */
+			boost::uint64_t time;
+
+			/** The number of frames drawn before the event was taken, since recording began */
+			unsigned long frame;
+
+			/** The event */
+			SDL_Event event;
+
+			/** Where the pointer was, for a key press */
+			int x, y;
+
+		};
+
+		/** Constructs an empty log */
+		InputLog();
+
+		/** Gets whether events of the given event's type are recorded */
+		static bool isRecorded(const SDL_Event &event);
+
+		/** Adds an event; the time and frame must not be before the last event's */
+		void add(const SDL_Event &event, int x, int y, boost::uint64_t time, unsigned long frame);
+
+		/** Removes every event */
+		void clear();
+
+		/** Gets the number of events */
+		inline size_t size() const { return this->entries.size(); }
+
+		/** Gets an event */
+		inline const Entry &get(size_t i) const { return this->entries[i]; }
+
+		/** Gets the number of frames drawn before the last event, or 0 if there are none */
+		inline unsigned long getLastFrame() const { return this->entries.empty() ? 0 : this->entries.back().frame; }
+
+		/** Writes the log */
+		void save(std::ostream &out) const;
+
+		/** Writes the log to a file; throws std::runtime_error if it can't */
+		void save(const std::string &fileName) const;
+
+		/** Replaces the events with those read; throws std::runtime_error if they aren't a log */
+		void load(std::istream &in);
+
+		/** Replaces the events with those read from a file; throws std::runtime_error if it can't */
+		void load(const std::string &fileName);
+
+	protected:
+
+		/** The events, oldest first */
+		std::vector<Entry> entries;
+
+	};
+
+}
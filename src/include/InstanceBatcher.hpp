@@ -0,0 +1,111 @@
+/**
+* @file InstanceBatcher.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "Geometry.hpp"
+#include "Material.hpp"
+#include <vector>
+
+namespace peek {
+
+	class SmoothMesh;
+
+	/**
+	* @brief Draws many copies of a mesh in one call, each with its own transformation and material
+	*
+	* The transformation and material of every instance in a frame are
+	* gathered into one buffer, which is uploaded once; each batch is then an
+	* instanced draw reading its own stretch of the buffer.  The instances are
+	* drawn by a small GLSL program that does the fixed-function pipeline's
+	* per-vertex lighting for the enabled lights, so batches look the same as
+	* meshes drawn one at a time.
+	*
+	* Transformations must be affine, which those of models and cameras are.
+	* Spot lights are lit as point lights.
+	*/
+	class InstanceBatcher {
+	public:
+
+		/** Constructs a batcher; nothing is created until it is first used */
+		InstanceBatcher();
+
+		/** Destructor */
+		~InstanceBatcher();
+
+		/** Whether or not instances can be drawn, compiling the program the first time; needs a current context */
+		bool isAvailable();
+
+		/** Forgets the instances of the last frame */
+		void clear();
+
+		/** Adds an instance, in the given material or in plain grey if there is none, and returns its number */
+		size_t add(const Matrix<double> &modelView, const Material *material);
+
+		/** Uploads the instances added since the last clear() */
+		void upload();
+
+		/** Draws a run of consecutive instances of a mesh, lit or unlit, with the current projection and polygon state */
+		void draw(const SmoothMesh &mesh, size_t firstInstance, size_t instanceCount, bool lighting);
+
+		/** Releases the program and buffer */
+		void release();
+
+	protected:
+
+		/** What the program reads for each instance */
+		struct Instance {
+
+			/** The top three rows of the modelview matrix */
+			GLfloat rows[3][4];
+
+			/** The ambient colour */
+			GLfloat ambient[4];
+
+			/** The diffuse colour, which is also the colour of unlit instances */
+			GLfloat diffuse[4];
+
+			/** The specular colour, with the shininess in place of alpha */
+			GLfloat specular[4];
+
+			/** The emitted colour */
+			GLfloat emission[4];
+
+		};
+
+		/** Compiles and links the program */
+		bool build();
+
+		/** Whether or not build() has been tried */
+		bool built;
+
+		/** The program, or 0 if it could not be built */
+		GLuint program;
+
+		/** The location of the lighting flag */
+		GLint lightingLocation;
+
+		/** The location of the enabled flag of each light */
+		GLint lightsLocation;
+
+		/** The buffer the instances are uploaded to */
+		GLuint buffer;
+
+		/** The instances of the frame */
+		std::vector<Instance> instances;
+
+		/** Whether each light was enabled when the instances were uploaded */
+		GLint lightsEnabled[8];
+
+	private:
+
+		/** The program and buffer belong to one batcher */
+		InstanceBatcher(const InstanceBatcher &);
+
+		/** The program and buffer belong to one batcher */
+		InstanceBatcher &operator=(const InstanceBatcher &);
+
+	};
+
+}
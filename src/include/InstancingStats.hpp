@@ -0,0 +1,42 @@
+/**
+* @file InstancingStats.hpp
+*/
+#pragma once
+
+namespace peek {
+
+	/**
+	* @brief Counts how a frame drawn through the render queue was split into instanced batches and single draws
+	*/
+	struct InstancingStats {
+
+		/** Constructs a set of zeroed counters */
+		InstancingStats() { reset(); }
+
+		/** Zeroes the counters */
+		inline void reset() {
+			this->batches = 0;
+			this->batchedInstances = 0;
+			this->largestBatch = 0;
+			this->singleDraws = 0;
+			this->drawCalls = 0;
+		}
+
+		/** The number of instanced draws of a mesh */
+		unsigned int batches;
+
+		/** The number of mesh instances drawn in batches */
+		unsigned int batchedInstances;
+
+		/** The number of instances in the largest batch */
+		unsigned int largestBatch;
+
+		/** The number of meshes drawn one at a time, including the normals pass */
+		unsigned int singleDraws;
+
+		/** The number of OpenGL draw calls made for the meshes, batched or not */
+		unsigned int drawCalls;
+
+	};
+
+}
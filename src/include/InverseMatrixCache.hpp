@@ -0,0 +1,49 @@
+/**
+* @file InverseMatrixCache.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Remembers the inverse of the last matrix it was asked to invert
+	*
+	* Cameras and riggings rebuild their matrices from a handful of parameters,
+	* which is cheap; inverting them is not.  Comparing against the last matrix
+	* means the owner need not track every change to its parameters.  Affine
+	* matrices, such as views, take the cheaper affine inverse.
+	*/
+	class InverseMatrixCache {
+	public:
+
+		/** Constructs an empty cache */
+		InverseMatrixCache() : valid(false) {}
+
+		/** Gets the inverse of the matrix (the identity if it is singular), recalculating it only if the matrix has changed */
+		inline const Matrix<double> &getInverse(const Matrix<double> &m) {
+			if(!this->valid || m != this->matrix) {
+				this->matrix = m;
+				bool invertible = (m.isAffine() ? invertAffine(m, this->inverse) : invert(m, this->inverse));
+				if(!invertible)
+					this->inverse.setIdentity();
+				this->valid = true;
+			}
+			return this->inverse;
+		}
+
+	protected:
+
+		/** Whether or not a matrix has been inverted yet */
+		bool valid;
+
+		/** The last matrix inverted */
+		Matrix<double> matrix;
+
+		/** The inverse of the last matrix */
+		Matrix<double> inverse;
+
+	};
+
+}
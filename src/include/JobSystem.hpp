@@ -0,0 +1,161 @@
+/**
+* @file JobSystem.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <boost/detail/atomic_count.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+#include <deque>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief Runs jobs on a fixed set of worker threads, which steal work from each other when idle
+	*
+	* Each thread has a deque of its own.  Jobs submitted from a worker go on
+	* the back of its deque, and it takes its next job from the back too, so
+	* the work a job spawns is done while its data is still in the cache.  A
+	* thread whose deque is empty steals from the front of another's, taking
+	* the oldest, and usually largest, piece of work.  Idle workers sleep
+	* until something is submitted.
+	*
+	* Jobs are counted by a Group, and a thread that waits on a group runs
+	* jobs while it waits rather than blocking, so jobs may wait on the jobs
+	* they submit, and the thread that submits a frame's work does its share.
+	* Threads that are not workers, such as the one that made the system,
+	* share the first deque.
+	*
+	* A job that throws is counted as finished, and the first exception
+	* thrown under a group is rethrown by wait() once the rest are done.
+	*/
+	class JobSystem : boost::noncopyable {
+	public:
+
+		/** A job */
+		typedef boost::function<void ()> Job;
+
+		/** Counts the jobs submitted under it that have not yet finished */
+		class Group : boost::noncopyable {
+		public:
+
+			/** Constructs a group with no jobs */
+			Group() : pending(0) {}
+
+			/** Gets whether every job submitted under the group has finished */
+			inline bool isDone() const { return this->pending == 0; }
+
+		protected:
+			friend class JobSystem;
+
+			/** The number of jobs not yet finished */
+			boost::detail::atomic_count pending;
+
+			/** The first exception thrown by a job under the group, until wait() rethrows it */
+			boost::exception_ptr error;
+
+			/** Guards error */
+			boost::mutex errorMutex;
+
+		};
+
+		/** Starts one worker thread fewer than the machine has cores, since the thread that waits works too */
+		JobSystem();
+
+		/** Starts the given number of worker threads; with none, jobs are run by the thread that waits for them */
+		explicit JobSystem(unsigned int workerCount);
+
+		/** Waits for the jobs that are running, discards the rest, and stops the workers */
+		~JobSystem();
+
+		/** Queues a job under a group */
+		void submit(Group &group, const Job &job);
+
+		/** Runs jobs until every job in the group has finished, then rethrows the first exception any of them threw */
+		void wait(Group &group);
+
+		/** Gets the number of worker threads */
+		inline unsigned int getWorkerCount() const { return (unsigned int) this->workers.size(); }
+
+		/** Gets the number of threads that run jobs: the workers, and the thread that waits */
+		inline unsigned int getThreadCount() const { return getWorkerCount() + 1; }
+
+		/** Gets the number of jobs stolen from another thread's deque so far */
+		unsigned long getStealCount() const;
+
+	protected:
+
+		/** Makes the deques and starts the workers */
+		void start(unsigned int workerCount);
+
+		/** A queued job, and the group it counts against */
+		struct Task {
+
+			/** The job */
+			Job job;
+
+			/** The group */
+			Group *group;
+
+		};
+
+		/** A thread's deque of tasks */
+		struct Deque {
+
+			/** The tasks, oldest first */
+			std::deque<Task> tasks;
+
+			/** Guards the tasks */
+			boost::mutex mutex;
+
+		};
+
+		/** Runs one task, from the given deque or stolen from another; returns false if there was none */
+		bool runOne(size_t self);
+
+		/** Takes a task off the back of a deque */
+		bool pop(size_t index, Task &task);
+
+		/** Takes a task off the front of a deque */
+		bool steal(size_t index, Task &task);
+
+		/** Gets the index of the calling thread's deque */
+		size_t getDequeIndex() const;
+
+		/** Runs tasks until the system is destroyed; runs on each worker */
+		void work(size_t index);
+
+		/** The deques, the first shared by the threads that are not workers */
+		std::vector<Deque *> deques;
+
+		/** The worker threads */
+		std::vector<boost::thread *> workers;
+
+		/** The index of each worker's deque, unset on other threads */
+		boost::thread_specific_ptr<size_t> dequeIndex;
+
+		/** The number of tasks queued and not yet taken */
+		boost::detail::atomic_count queued;
+
+		/** The number of tasks stolen */
+		boost::detail::atomic_count steals;
+
+		/** Whether or not the workers should exit */
+		bool stopping;
+
+		/** Guards stopping, and the sleeping of idle workers */
+		boost::mutex wakeMutex;
+
+		/** Signalled when a task is queued, or the system is stopping */
+		boost::condition_variable wakeCondition;
+
+	};
+
+}
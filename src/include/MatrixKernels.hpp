@@ -0,0 +1,23 @@
+/**
+* @file MatrixKernels.hpp
+*
+* SIMD kernels behind Matrix<double> and Matrix<float>.  Scalar, SSE2 or AVX2
+* code is picked once, the first time any of them runs, according to
+* getSimdLevel().  Matrices are column-major arrays of 16 elements and need not be aligned.
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace peek {
+
+	/** Multiplies two column-major 4x4 matrices (out = a * b); out may not alias a or b */
+	void multiplyMatrices(const double *a, const double *b, double *out);
+
+	/** Multiplies two column-major 4x4 matrices (out = a * b); out may not alias a or b */
+	void multiplyMatrices(const float *a, const float *b, float *out);
+
+	/** Transforms an array of homogeneous (x, y, z, h) records by a column-major 4x4 matrix; in and out may be the same */
+	void transformHomogeneous(const double *m, const double *in, double *out, size_t count);
+
+}
@@ -0,0 +1,122 @@
+/**
+* @file MeshBuffers.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "Geometry.hpp"
+#include "PrimitiveStreams.hpp"
+#include <vector>
+
+using std::vector;
+
+namespace peek {
+
+	/**
+	* @brief GPU-resident vertex and index buffers for a mesh
+	*
+	* Vertex positions and normals are interleaved into a single vertex buffer and
+	* the indices of every primitive go into a single index buffer, grouped into
+	* one range per OpenGL primitive type.  Independent primitives (triangles,
+	* quads) are drawn with one call per range; strips and fans are drawn with one
+	* multi-draw per range.  If buffer objects are not available, the same arrays
+	* are kept in client memory and drawn as ordinary vertex arrays.
+	*/
+	class MeshBuffers {
+	public:
+
+		/** Constructs an empty set of buffers */
+		MeshBuffers();
+
+		/** Constructs an empty set of buffers; GPU resources are never shared between copies */
+		MeshBuffers(const MeshBuffers &other);
+
+		/** Destructor */
+		~MeshBuffers();
+
+		/** Releases this set of buffers; GPU resources are never shared between copies */
+		MeshBuffers &operator=(const MeshBuffers &other);
+
+		/** Uploads the given geometry, replacing anything previously uploaded */
+		void upload(const Vertex3d::list &verts, const Normal3d::list &normals, const PrimitiveStreams &primitives);
+
+		/** Releases any GPU resources held by the buffers */
+		void release();
+
+		/** Whether or not geometry has been uploaded */
+		inline bool isUploaded() const { return this->uploaded; }
+
+		/** Draws the primitives, optionally supplying vertex normals */
+		void draw(bool withNormals) const;
+
+		/** Draws the primitives with normals once for each instance, for a program that reads per-instance attributes */
+		void drawInstanced(GLsizei instanceCount) const;
+
+		/** Draws each of the vertices as a point */
+		void drawPoints() const;
+
+		/** Gets the number of draw calls needed to draw the primitives */
+		unsigned int getDrawCallCount() const;
+
+		/** Gets the number of draw calls drawInstanced() makes */
+		unsigned int getInstancedDrawCallCount() const;
+
+	protected:
+
+		/** The vertex attributes interleaved in the vertex buffer */
+		struct InterleavedVertex {
+			GLfloat position[3];
+			GLfloat normal[3];
+		};
+
+		/** A contiguous range of the index buffer drawn with a single primitive type */
+		struct DrawRange {
+			/** The OpenGL primitive type */
+			GLenum mode;
+
+			/** The smallest vertex index referenced by the range */
+			GLuint minIndex;
+
+			/** The largest vertex index referenced by the range */
+			GLuint maxIndex;
+
+			/** The index count of each strip/fan in the range (a single entry for independent primitives) */
+			vector<GLsizei> counts;
+
+			/** The location of each strip/fan within the index buffer (or client index array) */
+			vector<const GLvoid *> offsets;
+		};
+
+		/** Binds the vertex arrays for drawing */
+		void bind(bool withNormals) const;
+
+		/** Unbinds the vertex arrays */
+		void unbind() const;
+
+		/** Draws a single range of the index buffer */
+		void drawRange(const DrawRange &range) const;
+
+		/** Whether or not geometry has been uploaded */
+		bool uploaded;
+
+		/** The number of vertices uploaded */
+		GLsizei vertexCount;
+
+		/** The vertex buffer object (0 if buffer objects are not available) */
+		GLuint vertexBuffer;
+
+		/** The index buffer object (0 if buffer objects are not available) */
+		GLuint indexBuffer;
+
+		/** Client-side vertex data, used only when buffer objects are not available */
+		vector<InterleavedVertex> clientVertices;
+
+		/** Client-side index data, used only when buffer objects are not available */
+		vector<GLuint> clientIndices;
+
+		/** The ranges of the index buffer, one per primitive type */
+		vector<DrawRange> ranges;
+
+	};
+
+}
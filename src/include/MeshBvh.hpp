@@ -0,0 +1,95 @@
+/**
+* @file MeshBvh.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "BoundingBox.hpp"
+#include "PrimitiveStreams.hpp"
+#include "Ray.hpp"
+#include "RayHit.hpp"
+#include <handle_traits.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+
+namespace peek {
+
+	/**
+	* @brief A bounding volume hierarchy over the faces of a mesh, for casting rays
+	*
+	* The hierarchy is built top-down, splitting each node where the surface
+	* area heuristic, evaluated over a fixed number of bins along each axis,
+	* says the split is cheapest.  Quads are split into two triangles, both of
+	* which keep the quad's face index.
+	*
+	* The hierarchy keeps vertex indices rather than positions, so the
+	* vertices it was built from must be passed to intersect(), unchanged.
+	*/
+	class MeshBvh {
+	public:
+
+		/** Builds the hierarchy over the faces of a mesh */
+		MeshBvh(const Vertex3d::list &verts, const PrimitiveStreams &primitives);
+
+		/** Finds the nearest face the ray hits before hit.distance, and records it in the hit; returns false if there is none */
+		bool intersect(const Vertex3d::list &verts, const Ray &ray, RayHit &hit) const;
+
+		/** Gets the number of nodes in the hierarchy */
+		inline size_t getNodeCount() const { return this->nodes.size(); }
+
+		/** Gets the number of triangles in the hierarchy */
+		inline size_t getTriangleCount() const { return this->triangles.size(); }
+
+		/** Gets the number of levels in the hierarchy */
+		inline unsigned int getDepth() const { return this->depth; }
+
+		typedef handle_traits<MeshBvh>::handle_type handle;
+
+	protected:
+
+		/** A node of the hierarchy; a leaf if it has triangles, otherwise its children are adjacent */
+		struct Node {
+
+			/** The low corner of the node's bounds */
+			double low[3];
+
+			/** The high corner of the node's bounds */
+			double high[3];
+
+			/** The index of the first child for an interior node, or of the first triangle for a leaf */
+			boost::uint32_t first;
+
+			/** The number of triangles in a leaf, or zero for an interior node */
+			boost::uint32_t count;
+
+		};
+
+		/** A triangle, and the face it came from */
+		struct Triangle {
+
+			/** The triangle's vertices */
+			PrimitiveStreams::index v[3];
+
+			/** The index of the face */
+			boost::uint32_t face;
+
+		};
+
+		/** Collects the triangles of each face; quads are split in two */
+		struct TriangleCollector;
+
+		/** Splits the nodes until the heuristic says they are cheaper left whole */
+		void build(const Vertex3d::list &verts);
+
+		/** The nodes, the root first */
+		std::vector<Node> nodes;
+
+		/** The triangles, ordered so that each leaf's triangles are contiguous */
+		std::vector<Triangle> triangles;
+
+		/** The number of levels in the hierarchy */
+		unsigned int depth;
+
+	};
+
+}
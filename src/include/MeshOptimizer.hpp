@@ -0,0 +1,80 @@
+/**
+* @file MeshOptimizer.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "PrimitiveStreams.hpp"
+#include "VertexCacheStats.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Reorders a mesh's faces and vertices so they draw with fewer vertex transforms, less overdraw and better fetch locality
+	*
+	* Three passes run in turn, each on the triangle stream and the
+	* quadrilateral stream separately, since they are drawn separately:
+	*
+	* The faces are put in vertex cache order with Tipsy (Sander, Nehab and
+	* Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+	* Overdraw", 2007).  It fans out around one vertex at a time, moving on
+	* to the neighbour that will stay in the cache the longest, and jumps
+	* to a recently used vertex or the next unfinished one when it runs out.
+	*
+	* Those jumps split the faces into clusters, which are split further
+	* wherever a cluster's own miss ratio has come down to the threshold
+	* times the whole mesh's.  The clusters are then sorted by how far they
+	* face out from the mesh's centre, so the outer ones draw first and hide
+	* what is behind them from any direction.  The threshold trades vertex
+	* cache misses for overdraw; 0 leaves the cache order alone.
+	*
+	* The vertices are finally numbered in the order the index streams first
+	* use them, strips and fans included, so vertex fetches walk forward
+	* through memory.  The positions, normals and every stream are remapped;
+	* vertices no face uses are kept, at the end.
+	*/
+	class MeshOptimizer {
+	public:
+
+		/** Constructs an optimizer for a 16-vertex cache, with an overdraw threshold of 1.05, that reorders the vertices */
+		MeshOptimizer();
+
+		/** Sets the number of vertices the post-transform cache is taken to hold */
+		inline void setCacheSize(unsigned int cacheSize) { this->cacheSize = cacheSize; }
+
+		/** Gets the number of vertices the post-transform cache is taken to hold */
+		inline unsigned int getCacheSize() const { return this->cacheSize; }
+
+		/** Sets how far above the cache order's miss ratio a cluster may be cut for overdraw (0 for no overdraw pass) */
+		inline void setOverdrawThreshold(double overdrawThreshold) { this->overdrawThreshold = overdrawThreshold; }
+
+		/** Gets the overdraw threshold */
+		inline double getOverdrawThreshold() const { return this->overdrawThreshold; }
+
+		/** Sets whether the vertices are reordered for fetch locality */
+		inline void setFetchReordering(bool fetchReordering) { this->fetchReordering = fetchReordering; }
+
+		/** Gets whether the vertices are reordered for fetch locality */
+		inline bool isFetchReordering() const { return this->fetchReordering; }
+
+		/** Reorders a mesh's faces and vertices, optionally measuring the cache before and after */
+		void optimize(Vertex3d::list &verts, Normal3d::list &normals, PrimitiveStreams &primitives,
+			VertexCacheStats *before = NULL, VertexCacheStats *after = NULL) const;
+
+		/** Simulates drawing the streams through a cache of the configured size */
+		VertexCacheStats measure(const PrimitiveStreams &primitives) const;
+
+	protected:
+
+		/** The number of vertices the post-transform cache is taken to hold */
+		unsigned int cacheSize;
+
+		/** How far above the cache order's miss ratio a cluster may be cut for overdraw (0 for no overdraw pass) */
+		double overdrawThreshold;
+
+		/** Whether the vertices are reordered for fetch locality */
+		bool fetchReordering;
+
+	};
+
+}
@@ -4,25 +4,75 @@
 #pragma once
 
 #include "Geometry.hpp"
+#include "BoundingBox.hpp"
 #include "Object.hpp"
 #include "SmoothMesh.hpp"
+#include "Ray.hpp"
+#include "RayHit.hpp"
+#include "InverseMatrixCache.hpp"
+#include "RenderQueue.hpp"
 #include "handle_traits.hpp"
 #include "list_traits.hpp"
 
 namespace peek {
 
+	/**
+	* @interface ModelObserver
+	* @brief Something that needs to know when a model's world bounding box changes
+	*/
+	class ModelObserver {
+	public:
+
+		/** Destructor */
+		virtual ~ModelObserver() {}
+
+		/** Called after the model's world bounding box changes */
+		virtual void modelBoundsChanged() = 0;
+
+	};
+
 	class Model : public Object {
 	public:
 
+		/** The display toggles that decide which passes a model is queued in */
+		struct DisplayToggles {
+
+			/** Whether or not solid geometry is visible */
+			bool showSolid;
+
+			/** Whether or not the wireframe is visible */
+			bool showWireframe;
+
+			/** Whether or not normals are visible */
+			bool showNormals;
+
+			/** The scale at which to draw the normals */
+			double normalScale;
+
+		};
+
 		/** Constructor */
 		Model();
 
 		/** Draws the model */
 		void draw() const;
 
+		/** Queues the meshes to be drawn in each pass the display toggles call for, as draw() would draw them */
+		void enqueue(RenderQueue &queue) const;
+
+		/** Queues the meshes as enqueue(queue) does, placed by a matrix that outlives the frame in place of the model's own transformation */
+		void enqueue(RenderQueue &queue, const Matrix<double> *modelWorldMatrix, const Point3d &worldCenter) const;
+
+		/** Queues meshes in each pass a set of display toggles calls for, so a copy of a model can be queued without the model */
+		static void enqueue(RenderQueue &queue, const DisplayToggles &toggles, SmoothMesh::list::const_iterator first,
+			SmoothMesh::list::const_iterator last, const Matrix<double> *modelWorldMatrix, const Point3d &worldCenter);
+
 		/** Draws the model for picking */
 		void pick() const;
 
+		/** Finds the nearest face of the meshes the world-space ray hits before hit.distance */
+		bool intersect(const Ray &ray, RayHit &hit) const;
+
 		/** Draws the vertices */
 		void drawVerts() const;
 
@@ -47,8 +97,26 @@ namespace peek {
 		/** Toggles visibility of face/vector normals */
 		void toggleShowNormals() { this->showNormals = !this->showNormals; }
 
-				/** Get the dimensions of the axis-aligned bouding box for the polygon mesh */
-		inline Vector3d getDimensions() { return this->boundingBoxHigh - this->boundingBoxLow; }
+		/** Gets the display toggles */
+		DisplayToggles getDisplayToggles() const;
+
+		/** Gets the meshes */
+		inline const SmoothMesh::list &getMeshes() const { return this->meshes; }
+
+		/** Get the dimensions of the axis-aligned bouding box for the polygon mesh */
+		inline Vector3d getDimensions() const { return this->boundingBox.getDimensions(); }
+
+		/** Get the axis-aligned bounding box of the meshes, in model space */
+		inline const BoundingBox &getBoundingBox() const { return this->boundingBox; }
+
+		/** Get the axis-aligned bounding box of the meshes after the model's own transformation */
+		const BoundingBox &getWorldBoundingBox() const;
+
+		/** Registers an observer to be told when the world bounding box changes */
+		void addObserver(ModelObserver *observer);
+
+		/** Unregisters an observer */
+		void removeObserver(ModelObserver *observer);
 
 		typedef handle_traits<Model>::handle_type handle;
 
@@ -73,14 +141,26 @@ namespace peek {
 		/** The scale at which to draw the normals */
 		double normalScale;
 
-		/** The low corner of the axis-aligned bounding box which contains the mesh */
-		Point3d boundingBoxLow;
+		/** The axis-aligned bounding box which contains the meshes */
+		BoundingBox boundingBox;
+
+		/** The cached bounding box after the model's transformation */
+		mutable BoundingBox worldBoundingBox;
+
+		/** The inverse of the model's transformation, for bringing rays into model space */
+		mutable InverseMatrixCache transformInverse;
+
+		/** Whether or not the cached world bounding box is out of date */
+		mutable bool worldBoundingBoxDirty;
+
+		/** The observers to tell when the world bounding box changes */
+		list_traits<ModelObserver *>::list_type observers;
 
-		/** The high corner of the axis-aligned bounding box which contains the mesh */
-		Point3d boundingBoxHigh;
+		/** Marks the world bounding box as out of date and tells the observers */
+		virtual void transformChanged();
 
-		/** (Re)calculates the axis-aligned bounding box for the mesh. */
-		void findBoundingBox();
+		/** Tells the observers that the world bounding box has changed */
+		void notifyObservers();
 
 	};
 
@@ -0,0 +1,92 @@
+/**
+* @file MpscQueue.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace peek {
+
+	/**
+	* @brief A queue that any number of threads may push onto, without locking, and one thread pops from
+	*
+	* The queue is a singly linked list of nodes.  A push swaps its node in as
+	* the newest with one atomic exchange, then links the old newest node to
+	* it; the consumer follows the links from the oldest.  A push that has
+	* made the exchange but not yet the link hides the nodes after it from
+	* the consumer for that moment, so pop() may find nothing even though
+	* pushes have returned; they are found by the next pop() after it.
+	*
+	* Pushes never wait for each other or for the consumer, but do allocate
+	* a node each.
+	*/
+	template <class T>
+	class MpscQueue : boost::noncopyable {
+	public:
+
+		/** Constructs an empty queue */
+		MpscQueue() {
+			Node *stub = new Node();
+			this->newest.store(stub, boost::memory_order_relaxed);
+			this->oldest = stub;
+		}
+
+		/** Destructor; discards anything left in the queue */
+		~MpscQueue() {
+			T value;
+			while (pop(value)) {
+			}
+			delete this->oldest;
+		}
+
+		/** Adds a value; may be called from any thread */
+		void push(const T &value) {
+			Node *node = new Node();
+			node->value = value;
+
+			Node *previous = this->newest.exchange(node, boost::memory_order_acq_rel);
+			previous->next.store(node, boost::memory_order_release);
+		}
+
+		/** Takes the oldest value, returning false if there is none; for the consumer only */
+		bool pop(T &value) {
+			Node *oldest = this->oldest;
+			Node *next = oldest->next.load(boost::memory_order_acquire);
+			if (!next) {
+				return false;
+			}
+
+			// The node after the one already taken becomes the one already taken
+			value = next->value;
+			this->oldest = next;
+			delete oldest;
+			return true;
+		}
+
+	protected:
+
+		/** A link in the list */
+		struct Node {
+
+			/** Constructs an unlinked node */
+			Node() : next((Node *) 0) {}
+
+			/** The next newer node */
+			boost::atomic<Node *> next;
+
+			/** The value */
+			T value;
+
+		};
+
+		/** The node last pushed */
+		boost::atomic<Node *> newest;
+
+		/** The node whose value was last taken, or the stub the queue started with; its successor holds the oldest value */
+		Node *oldest;
+
+	};
+
+}
@@ -0,0 +1,53 @@
+/**
+* @file NormalGenerator.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "PrimitiveStreams.hpp"
+#include "Simd.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Generates smooth vertex normals for a mesh
+	*
+	* Face normals are computed in blocks with SIMD, using the best instruction
+	* set available at runtime, and the faces are split across threads.  Each
+	* vertex normal is then gathered from the faces that use the vertex through a
+	* vertex-to-face adjacency table.  No two threads ever write to the same
+	* vertex and each vertex sums its faces in face order, so the results do not
+	* depend on the number of threads.
+	*/
+	class NormalGenerator {
+	public:
+
+		/** Constructs a generator that uses every core and the best available instruction set */
+		NormalGenerator();
+
+		/** Sets the number of threads to use (0 for one per core) */
+		inline void setThreadCount(unsigned int threadCount) { this->threadCount = threadCount; }
+
+		/** Gets the number of threads that will be used */
+		unsigned int getThreadCount() const;
+
+		/** Sets the instruction set to use; it is limited to what the CPU supports */
+		void setSimdLevel(SimdLevel simdLevel);
+
+		/** Gets the instruction set that will be used */
+		inline SimdLevel getSimdLevel() const { return this->simdLevel; }
+
+		/** Generates the normalized vertex normals of the given mesh */
+		void generate(const Vertex3d::list &verts, const PrimitiveStreams &primitives, Normal3d::list &normals) const;
+
+	protected:
+
+		/** The number of threads to use (0 for one per core) */
+		unsigned int threadCount;
+
+		/** The instruction set to use */
+		SimdLevel simdLevel;
+
+	};
+
+}
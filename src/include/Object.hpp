@@ -23,19 +23,22 @@ class Object {
   inline Vector3d getOrigin() const {return this->origin;}
 
   /** Sets the origin */
-  inline void setOrigin(Vector3d origin) { this->origin = origin; }
+  inline void setOrigin(Vector3d origin) { this->origin = origin; invalidateTransform(); }
 
   /** Gets the rotation */
   inline Vector3d getRotation() const {return this->rotation;}
 
   /** Sets the rotation */
-  inline void setRotation(Vector3d rotation) { this->rotation = rotation; }
+  inline void setRotation(Vector3d rotation) { this->rotation = rotation; invalidateTransform(); }
 
   /** Gets the scaling factor */
   inline double getScale() const {return this->scale;}
 
   /** Sets the scaling factor */
-  inline void setScale(double scale) {this->scale = scale;}
+  inline void setScale(double scale) {this->scale = scale; invalidateTransform();}
+
+  /** Gets the matrix that transformModelviewMatrix() applies */
+  const Matrix<double> &getTransformMatrix() const;
 
  protected:
 
@@ -51,6 +54,20 @@ class Object {
   /** Transforms the modelview matrix */
   void transformModelviewMatrix() const;
 
+  /** Called whenever the origin, rotation or scale changes */
+  virtual void transformChanged() {}
+
+ private:
+
+  /** The cached transformation matrix */
+  mutable Matrix<double> transform;
+
+  /** Whether or not the cached transformation matrix is out of date */
+  mutable bool transformDirty;
+
+  /** Marks the transformation matrix out of date and tells the subclass */
+  inline void invalidateTransform() { this->transformDirty = true; transformChanged(); }
+
 };
 
 }
\ No newline at end of file
@@ -31,6 +31,15 @@ namespace peek {
 		/** Initializes the modelview matrix based on the camera's pose */
 		virtual void initModelviewMatrix();
 
+		/** Gets the view matrix for the camera's pose */
+		virtual Matrix<double> getViewMatrix();
+
+		/** Gets the inverse of the view matrix */
+		virtual const Matrix<double> &getInverseViewMatrix();
+
+		/** Gets the world-space frustum of the rigged camera in its current pose */
+		virtual Frustum getFrustum();
+
 		/** Provides access to the camera being rigged */
 		virtual Camera *getCamera();
 
@@ -5,6 +5,7 @@
 
 #include "Camera.hpp"
 #include "Geometry.hpp"
+#include "InverseMatrixCache.hpp"
 #include "handle_traits.hpp"
 #include "list_traits.hpp"
 
@@ -29,6 +30,12 @@ namespace peek {
 		/** (Re)sets the picking matrix with the camera's parameters and the given window coordinates */
 		void setPickingMatrix(int x, int y);
 
+		/** Gets the projection matrix that setProjectionMatrix() loads */
+		Matrix<double> getProjectionMatrix();
+
+		/** Gets the inverse of the projection matrix */
+		const Matrix<double> &getInverseProjectionMatrix();
+
 		/** Get the distance of the near-plane */
 		inline double getNear() {return this->nearVal;}
 
@@ -95,6 +102,9 @@ namespace peek {
 		/** The width and height of the picking region */
 		int pickingWindowSize;
 
+		/** The inverse of the last projection matrix */
+		InverseMatrixCache projectionInverse;
+
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+/**
+* @file PickingIds.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <vector>
+
+namespace peek {
+
+	class SceneGraphLeaf;
+
+	/**
+	* @brief The IDs handed out to the leaves drawn in a picking pass
+	*
+	* IDs are numbered from 1 in the order leaves are drawn, so that 0 can
+	* mean nothing was drawn.  An ID is drawn as a colour, a byte to each
+	* channel, which survives the trip through an 8-bit-per-channel target
+	* exactly as long as lighting, blending and dithering are off.
+	*/
+	class PickingIds {
+	public:
+
+		/** Gives a leaf the next ID */
+		inline GLuint add(const SceneGraphLeaf *leaf) {
+			this->leaves.push_back(leaf);
+			return (GLuint) this->leaves.size();
+		}
+
+		/** Gets the leaf an ID was given to, or NULL for 0 or an ID that was never given out */
+		inline const SceneGraphLeaf *getLeaf(GLuint id) const {
+			return (id > 0 && id <= this->leaves.size() ? this->leaves[id - 1] : NULL);
+		}
+
+		/** Gets the number of IDs given out */
+		inline size_t size() const { return this->leaves.size(); }
+
+		/** Forgets every ID given out */
+		inline void clear() { this->leaves.clear(); }
+
+		/** Sets the current colour to the one an ID is drawn as */
+		static inline void setColor(GLuint id) {
+			glColor4ub((GLubyte) id, (GLubyte) (id >> 8), (GLubyte) (id >> 16), (GLubyte) (id >> 24));
+		}
+
+		/** Gets the ID a pixel was drawn with, from its RGBA bytes */
+		static inline GLuint fromColor(const GLubyte *rgba) {
+			return (GLuint) rgba[0] | ((GLuint) rgba[1] << 8) | ((GLuint) rgba[2] << 16) | ((GLuint) rgba[3] << 24);
+		}
+
+	protected:
+
+		/** The leaf each ID was given to, ID 1 first */
+		std::vector<const SceneGraphLeaf *> leaves;
+
+	};
+
+}
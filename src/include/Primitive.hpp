@@ -3,10 +3,12 @@
 */
 #pragma once
 
+#include "Peek_base.hpp"
 #include <vector>
 #include <handle_traits.hpp>
 #include <list_traits.hpp>
 #include "Geometry.hpp"
+#include "PrimitiveStreams.hpp"
 
 using std::vector;
 using boost::shared_ptr;
@@ -16,6 +18,9 @@ namespace peek {
 	/**
 	* @interface Primitive
 	* @brief A primitive
+	*
+	* Meshes store their faces in PrimitiveStreams; the primitive classes serve
+	* to build those streams one primitive at a time.
 	*/
 	class Primitive {
 	public:
@@ -29,6 +34,9 @@ namespace peek {
 		/** Adds the normals of the primitives' faces to the given vertex normals */
 		virtual void addVertexNormals(const Vertex3d::list &verts, Normal3d::list &normals) const = 0;
 
+		/** Appends the primitive to the given index streams */
+		virtual void appendTo(PrimitiveStreams &streams) const = 0;
+
 		typedef handle_traits<Primitive>::handle_type handle;
 
 		typedef list_traits<Primitive::handle>::list_type list;
@@ -0,0 +1,226 @@
+/**
+* @file PrimitiveStreams.hpp
+*/
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "list_traits.hpp"
+
+using std::vector;
+
+namespace peek {
+
+	/**
+	* @brief The faces of a mesh, stored as flat index arrays grouped by primitive type
+	*
+	* Triangles and quadrilaterals are stored as runs of three and four indices.
+	* Triangle strips, triangle fans and quad strips are each stored as one
+	* concatenated index array plus a table of where each strip/fan starts; the
+	* table has one more entry than there are strips/fans, so strip i occupies
+	* [starts[i], starts[i+1]).
+	*
+	* Traversal with visitFaces() walks the arrays in order and hands each face
+	* to the visitor as a triangle or quadrilateral.  Faces are numbered in that
+	* order: triangles, then quads, then the triangles of each strip, the
+	* triangles of each fan, and the quads of each quad strip.  Strip triangles
+	* are reported with consistent (anti-clockwise) winding.
+	*/
+	class PrimitiveStreams {
+	public:
+
+		/** A vertex index */
+		typedef boost::uint32_t index;
+
+		/** A list of vertex indices */
+		typedef list_traits<index>::list_type indexList;
+
+		/** Constructs an empty set of streams */
+		PrimitiveStreams();
+
+		/** Adds a triangle */
+		inline void addTriangle(index v0, index v1, index v2) {
+			this->triangles.push_back(v0);
+			this->triangles.push_back(v1);
+			this->triangles.push_back(v2);
+		}
+
+		/** Adds a quadrilateral */
+		inline void addQuad(index v0, index v1, index v2, index v3) {
+			this->quads.push_back(v0);
+			this->quads.push_back(v1);
+			this->quads.push_back(v2);
+			this->quads.push_back(v3);
+		}
+
+		/** Adds a triangle strip with the vertices in the given range */
+		template <typename Iterator>
+		inline void addTriangleStrip(Iterator begin, Iterator end) {
+			addRun(this->triangleStrips, this->triangleStripStarts, begin, end);
+		}
+
+		/** Adds a triangle fan with the vertices in the given range */
+		template <typename Iterator>
+		inline void addTriangleFan(Iterator begin, Iterator end) {
+			addRun(this->triangleFans, this->triangleFanStarts, begin, end);
+		}
+
+		/** Adds a quad strip with the vertices in the given range */
+		template <typename Iterator>
+		inline void addQuadStrip(Iterator begin, Iterator end) {
+			addRun(this->quadStrips, this->quadStripStarts, begin, end);
+		}
+
+		/** Appends all the primitives of another set of streams */
+		void append(const PrimitiveStreams &other);
+
+		/** Removes all primitives */
+		void clear();
+
+		/** Exchanges the triangle indices with the given list, as when reordering the triangles */
+		inline void swapTriangles(indexList &triangles) { this->triangles.swap(triangles); }
+
+		/** Exchanges the quadrilateral indices with the given list, as when reordering the quadrilaterals */
+		inline void swapQuads(indexList &quads) { this->quads.swap(quads); }
+
+		/** Replaces each vertex index i in every stream with map[i], as when reordering the vertices */
+		void remap(const indexList &map);
+
+		/** Releases any memory held beyond what the primitives need */
+		void shrinkToFit();
+
+		/** Gets the triangle indices, three per triangle */
+		inline const indexList &getTriangles() const { return this->triangles; }
+
+		/** Gets the quadrilateral indices, four per quadrilateral */
+		inline const indexList &getQuads() const { return this->quads; }
+
+		/** Gets the concatenated triangle strip indices */
+		inline const indexList &getTriangleStrips() const { return this->triangleStrips; }
+
+		/** Gets the start of each triangle strip, plus a final end offset */
+		inline const indexList &getTriangleStripStarts() const { return this->triangleStripStarts; }
+
+		/** Gets the concatenated triangle fan indices */
+		inline const indexList &getTriangleFans() const { return this->triangleFans; }
+
+		/** Gets the start of each triangle fan, plus a final end offset */
+		inline const indexList &getTriangleFanStarts() const { return this->triangleFanStarts; }
+
+		/** Gets the concatenated quad strip indices */
+		inline const indexList &getQuadStrips() const { return this->quadStrips; }
+
+		/** Gets the start of each quad strip, plus a final end offset */
+		inline const indexList &getQuadStripStarts() const { return this->quadStripStarts; }
+
+		/** Gets the number of triangle strips */
+		inline size_t getTriangleStripCount() const { return this->triangleStripStarts.size() - 1; }
+
+		/** Gets the number of triangle fans */
+		inline size_t getTriangleFanCount() const { return this->triangleFanStarts.size() - 1; }
+
+		/** Gets the number of quad strips */
+		inline size_t getQuadStripCount() const { return this->quadStripStarts.size() - 1; }
+
+		/** Gets the total number of faces (triangles and quadrilaterals) */
+		size_t getFaceCount() const;
+
+		/** Gets the total number of indices in all the streams */
+		size_t getIndexCount() const;
+
+		/** Gets the number of bytes used by the streams */
+		size_t getMemoryUsage() const;
+
+		/** Determines whether or not there are any primitives */
+		inline bool empty() const { return getIndexCount() == 0; }
+
+		/**
+		 * Hands each face to the given visitor, which must provide
+		 * triangle(index v0, index v1, index v2) and
+		 * quad(index v0, index v1, index v2, index v3).
+		 */
+		template <typename Visitor>
+		void visitFaces(Visitor &visitor) const;
+
+	protected:
+
+		/** Appends a strip/fan to a concatenated index array and its start table */
+		template <typename Iterator>
+		static void addRun(indexList &indices, indexList &starts, Iterator begin, Iterator end) {
+			for (Iterator i = begin; i != end; ++i) {
+				indices.push_back((index) *i);
+			}
+			starts.push_back((index) indices.size());
+		}
+
+		/** Triangle indices, three per triangle */
+		indexList triangles;
+
+		/** Quadrilateral indices, four per quadrilateral */
+		indexList quads;
+
+		/** Concatenated triangle strip indices */
+		indexList triangleStrips;
+
+		/** Start offsets of the triangle strips, plus a final end offset */
+		indexList triangleStripStarts;
+
+		/** Concatenated triangle fan indices */
+		indexList triangleFans;
+
+		/** Start offsets of the triangle fans, plus a final end offset */
+		indexList triangleFanStarts;
+
+		/** Concatenated quad strip indices */
+		indexList quadStrips;
+
+		/** Start offsets of the quad strips, plus a final end offset */
+		indexList quadStripStarts;
+
+	};
+
+	template <typename Visitor>
+	void PrimitiveStreams::visitFaces(Visitor &visitor) const {
+		const index *v;
+
+		for (size_t i = 0; i + 2 < this->triangles.size(); i += 3) {
+			v = &this->triangles[i];
+			visitor.triangle(v[0], v[1], v[2]);
+		}
+
+		for (size_t i = 0; i + 3 < this->quads.size(); i += 4) {
+			v = &this->quads[i];
+			visitor.quad(v[0], v[1], v[2], v[3]);
+		}
+
+		for (size_t s = 0; s + 1 < this->triangleStripStarts.size(); s++) {
+			index start = this->triangleStripStarts[s], end = this->triangleStripStarts[s+1];
+			for (index i = start; i + 2 < end; i++) {
+				v = &this->triangleStrips[i];
+				// Every other triangle in a strip is wound clockwise
+				if ((i - start) % 2 == 0) {
+					visitor.triangle(v[0], v[1], v[2]);
+				}
+				else {
+					visitor.triangle(v[1], v[0], v[2]);
+				}
+			}
+		}
+
+		for (size_t f = 0; f + 1 < this->triangleFanStarts.size(); f++) {
+			index start = this->triangleFanStarts[f], end = this->triangleFanStarts[f+1];
+			for (index i = start + 1; i + 1 < end; i++) {
+				visitor.triangle(this->triangleFans[start], this->triangleFans[i], this->triangleFans[i+1]);
+			}
+		}
+
+		for (size_t s = 0; s + 1 < this->quadStripStarts.size(); s++) {
+			index start = this->quadStripStarts[s], end = this->quadStripStarts[s+1];
+			for (index i = start; i + 3 < end; i += 2) {
+				v = &this->quadStrips[i];
+				visitor.quad(v[0], v[1], v[3], v[2]);
+			}
+		}
+	}
+
+}
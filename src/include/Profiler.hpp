@@ -0,0 +1,168 @@
+/**
+* @file Profiler.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+* Profiling is compiled in only when PEEK_PROFILING is defined, as the
+* Profile configuration does; otherwise the macros expand to nothing, and
+* the hot paths they mark cost nothing.
+* Names must be string literals, since only the pointers are kept.
+*/
+#ifdef PEEK_PROFILING
+#  define PEEK_PROFILE_JOIN2(a, b) a##b
+#  define PEEK_PROFILE_JOIN(a, b) PEEK_PROFILE_JOIN2(a, b)
+#  define PEEK_PROFILE_SCOPE(name) ::peek::ProfileScope PEEK_PROFILE_JOIN(peekProfileScope, __LINE__)(name)
+#  define PEEK_PROFILE_GPU_BEGIN(name) ::peek::Profiler::beginGpu(name)
+#  define PEEK_PROFILE_GPU_END() ::peek::Profiler::endGpu()
+#  define PEEK_PROFILE_FRAME() ::peek::Profiler::endFrame()
+#  define PEEK_PROFILE_THREAD(name) ::peek::Profiler::setThreadName(name)
+#else
+#  define PEEK_PROFILE_SCOPE(name) ((void) 0)
+#  define PEEK_PROFILE_GPU_BEGIN(name) ((void) 0)
+#  define PEEK_PROFILE_GPU_END() ((void) 0)
+#  define PEEK_PROFILE_FRAME() ((void) 0)
+#  define PEEK_PROFILE_THREAD(name) ((void) 0)
+#endif
+
+namespace peek {
+
+	/**
+	* @brief Records timed scopes on every thread, and the GPU time of marked passes, for traces and summaries
+	*
+	* Each thread records the scopes it leaves into a ring of its own, which
+	* only it writes to, so recording takes no lock; the rings hold the most
+	* recent events, and older ones are overwritten.  Scopes nest, and are
+	* shown nested in the trace by their times.
+	*
+	* GPU time is measured with GL_TIME_ELAPSED queries, which cannot nest, so
+	* a GPU pass begun inside another is not measured.  The results are
+	* collected at the end of later frames, once the GPU has them, so
+	* measuring never waits for the GPU.
+	*
+	* Everything is static, since the scopes are marked throughout the
+	* library; recording is off until setEnabled() turns it on.
+	*/
+	class Profiler {
+	public:
+
+		/** The timing of a scope, over the events the rings hold */
+		struct Summary {
+
+			/** The scope's name */
+			std::string name;
+
+			/** Whether the times are GPU times */
+			bool gpu;
+
+			/** The number of times the scope was recorded */
+			unsigned long count;
+
+			/** The shortest time, in milliseconds */
+			double min;
+
+			/** The mean time, in milliseconds */
+			double average;
+
+			/** The 99th percentile time, in milliseconds */
+			double p99;
+
+			/** The total time, in milliseconds */
+			double total;
+
+		};
+
+		/** Turns recording on or off */
+		static void setEnabled(bool enabled);
+
+		/** Gets whether recording is on */
+		static inline bool isEnabled() { return enabled.load(boost::memory_order_relaxed); }
+
+		/** Names the calling thread in traces */
+		static void setThreadName(const std::string &name);
+
+		/** Records a scope the calling thread has left; the times are from getTicks() */
+		static void record(const char *name, boost::uint64_t start, boost::uint64_t end);
+
+		/** Begins measuring the GPU time of a pass; needs the context current */
+		static void beginGpu(const char *name);
+
+		/** Ends measuring the GPU time of the pass begun last */
+		static void endGpu();
+
+		/** Marks the end of a frame, and collects the GPU times that have become available; needs the context current */
+		static void endFrame();
+
+		/** Gets the number of frames ended */
+		static unsigned long getFrameCount();
+
+		/** Gets the time since profiling began, in nanoseconds */
+		static boost::uint64_t getTicks();
+
+		/** Gets the timing of each scope over the events the rings hold, in name order */
+		static void getSummaries(std::vector<Summary> &summaries);
+
+		/** Writes the summaries as a table */
+		static void printSummary(std::ostream &out);
+
+		/** Writes the events the rings hold in Chrome's trace event format, for chrome://tracing or Perfetto */
+		static void writeChromeTrace(std::ostream &out);
+
+		/** Writes the trace to a file; throws std::runtime_error if it can't */
+		static void writeChromeTrace(const std::string &fileName);
+
+		/** Discards the events recorded so far */
+		static void clear();
+
+		/** Releases the query objects; needs the context they were made in */
+		static void release();
+
+		/** The number of events each thread's ring holds */
+		static const size_t ringSize = 1 << 16;
+
+	protected:
+
+		/** Whether recording is on */
+		static boost::atomic<bool> enabled;
+
+	};
+
+	/**
+	* @brief Records the time from its construction to its destruction as a profiler scope
+	*/
+	class ProfileScope {
+	public:
+
+		/** Starts timing, if the profiler is recording */
+		explicit ProfileScope(const char *name) {
+			this->name = (Profiler::isEnabled() ? name : 0);
+			if (this->name) {
+				this->start = Profiler::getTicks();
+			}
+		}
+
+		/** Records the scope */
+		~ProfileScope() {
+			if (this->name) {
+				Profiler::record(this->name, this->start, Profiler::getTicks());
+			}
+		}
+
+	protected:
+
+		/** The scope's name, or NULL if it is not being timed */
+		const char *name;
+
+		/** When the scope began */
+		boost::uint64_t start;
+
+	};
+
+}
@@ -26,6 +26,9 @@ namespace peek {
 		/** Adds the quadrilateral's normal to the given vertex normals */
 		virtual void addVertexNormals(const Vertex3d::list &verts, Normal3d::list &normals) const;
 
+		/** Appends the quadrilateral to the given index streams */
+		virtual void appendTo(PrimitiveStreams &streams) const;
+
 		typedef handle_traits<Quadrilateral>::handle_type handle;
 
 		typedef list_traits<Quadrilateral::handle>::list_type list;
@@ -0,0 +1,82 @@
+/**
+* @file Ray.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "BoundingBox.hpp"
+#include <algorithm>
+
+namespace peek {
+
+	/**
+	* @brief A half-line, cast into the scene for picking
+	*
+	* The points along the ray are origin + t * direction, for t >= 0.  The
+	* direction need not be of unit length, and transforming a ray by an
+	* affine matrix leaves every point's t unchanged, so a distance found in a
+	* model's own space can be compared with one found in world space.
+	*/
+	class Ray {
+	public:
+
+		/** The point the ray starts from */
+		Point3d origin;
+
+		/** The direction the ray travels in */
+		Vector3d direction;
+
+		/** Constructs a ray from the origin along the z-axis */
+		inline Ray() : direction(0.0, 0.0, 1.0) {}
+
+		/** Constructs a ray from its origin and direction */
+		inline Ray(const Point3d &origin, const Vector3d &direction) : origin(origin), direction(direction) {}
+
+		/** Gets the point at the given parameter along the ray */
+		inline Point3d getPoint(double t) const {
+			return Point3d(this->origin.x + t * this->direction.x, this->origin.y + t * this->direction.y, this->origin.z + t * this->direction.z);
+		}
+
+		/** Gets the ray transformed by an affine matrix */
+		inline Ray transform(const Matrix<double> &m) const {
+			return Ray(m * this->origin, m * this->direction);
+		}
+
+		/** Finds where the ray enters a box, if it does so before tMax */
+		inline bool intersect(const BoundingBox &box, double tMax, double &tEnter) const {
+			if (box.isEmpty()) {
+				return false;
+			}
+
+			const double origin[3] = { this->origin.x, this->origin.y, this->origin.z };
+			const double direction[3] = { this->direction.x, this->direction.y, this->direction.z };
+			const double low[3] = { box.getLow().x, box.getLow().y, box.getLow().z };
+			const double high[3] = { box.getHigh().x, box.getHigh().y, box.getHigh().z };
+
+			double tNear = 0.0, tFar = tMax;
+			for (int axis = 0; axis < 3; axis++) {
+				if (direction[axis] == 0.0) {
+					// Parallel to the slab, so either always inside it or never
+					if (origin[axis] < low[axis] || origin[axis] > high[axis]) {
+						return false;
+					}
+					continue;
+				}
+
+				double inverse = 1.0 / direction[axis];
+				double t0 = (low[axis] - origin[axis]) * inverse;
+				double t1 = (high[axis] - origin[axis]) * inverse;
+				tNear = std::max(tNear, std::min(t0, t1));
+				tFar = std::min(tFar, std::max(t0, t1));
+				if (tNear > tFar) {
+					return false;
+				}
+			}
+
+			tEnter = tNear;
+			return true;
+		}
+
+	};
+
+}
@@ -0,0 +1,59 @@
+/**
+* @file RayHit.hpp
+*/
+#pragma once
+
+#include "Geometry.hpp"
+#include "PrimitiveStreams.hpp"
+#include <limits>
+
+namespace peek {
+
+	class SceneGraphLeaf;
+	class Model;
+	class SmoothMesh;
+
+	/**
+	* @brief The nearest face a ray has been found to hit, so far
+	*
+	* Intersection tests only replace the hit with one that is nearer, so the
+	* same hit can be handed to each candidate in turn.
+	*/
+	struct RayHit {
+
+		/** Constructs a miss, infinitely far away */
+		RayHit() : leaf(NULL), model(NULL), mesh(NULL), primitive(0), distance(std::numeric_limits<double>::infinity()) {
+			this->vertices[0] = this->vertices[1] = this->vertices[2] = 0;
+			this->barycentrics[0] = this->barycentrics[1] = this->barycentrics[2] = 0.0;
+		}
+
+		/** Determines whether or not anything was hit */
+		inline bool isHit() const { return this->mesh != NULL; }
+
+		/** The scene graph leaf that was hit, if the ray was cast into a scene graph */
+		const SceneGraphLeaf *leaf;
+
+		/** The model that was hit */
+		const Model *model;
+
+		/** The mesh that was hit */
+		const SmoothMesh *mesh;
+
+		/** The index of the face that was hit, in the order PrimitiveStreams::visitFaces() reports faces */
+		size_t primitive;
+
+		/** The vertices of the triangle that was hit; for a quad, this is the half of it that was hit */
+		PrimitiveStreams::index vertices[3];
+
+		/** The weights of the triangle's vertices at the point that was hit */
+		double barycentrics[3];
+
+		/** The ray parameter of the hit, which is the distance along the ray if its direction is of unit length */
+		double distance;
+
+		/** The point that was hit, in world space */
+		Point3d point;
+
+	};
+
+}
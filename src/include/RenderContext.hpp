@@ -0,0 +1,46 @@
+/**
+* @file RenderContext.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "handle_traits.hpp"
+
+namespace peek {
+
+	/**
+	* @interface RenderContext
+	* @brief Where the engine renders: an OpenGL context, its framebuffer, and the events that come with it
+	*/
+	class RenderContext {
+	public:
+
+		/** Destructor */
+		virtual ~RenderContext() {}
+
+		/** Gets the width of the framebuffer, in pixels */
+		virtual unsigned int getWidth() const = 0;
+
+		/** Gets the height of the framebuffer, in pixels */
+		virtual unsigned int getHeight() const = 0;
+
+		/** Gets whether or not buffer swaps are synchronized with the display's refresh */
+		virtual bool isVsync() const = 0;
+
+		/** Looks up an OpenGL entry point, or returns 0 if the driver does not provide it */
+		virtual void *getProcAddress(const char *name) = 0;
+
+		/** Finishes the frame that was just drawn */
+		virtual void swapBuffers() = 0;
+
+		/** Takes the next pending event, returning false if there is none */
+		virtual bool pollEvent(SDL_Event &evt) = 0;
+
+		/** Determines whether any events are pending, without taking them */
+		virtual bool hasPendingEvents() = 0;
+
+		typedef handle_traits<RenderContext>::handle_type handle;
+
+	};
+
+}
@@ -0,0 +1,210 @@
+/**
+* @file RenderQueue.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include "Geometry.hpp"
+#include "GlStateCache.hpp"
+#include "InstanceBatcher.hpp"
+#include "InstancingStats.hpp"
+#include "Material.hpp"
+#include <boost/cstdint.hpp>
+#include <map>
+#include <vector>
+
+namespace peek {
+
+	class SmoothMesh;
+
+	/**
+	* @brief Collects the meshes to draw in a frame, then draws them sorted by the state they need
+	*
+	* Each mesh is queued once for every pass it is drawn in, with a 64-bit
+	* key made of, from the top down, the pass, the fixed-function state, the
+	* material, the mesh and the distance from the camera.  The keys are radix
+	* sorted, so that meshes needing the same state and material are drawn
+	* together (each mesh's copies nearest first, which lets the depth test
+	* reject more of what follows), and the state is set through a
+	* GlStateCache, which drops the changes that would change nothing.
+	*
+	* Since copies of a mesh end up next to each other, runs of them are
+	* drawn as one instanced batch when the driver supports it, however many
+	* models or leaves they were queued from.
+	*
+	* A frame's queue can be filled by several threads at once, each adding
+	* to a queue of its own that is appended to the one that is drawn.
+	*/
+	class RenderQueue {
+	public:
+
+		/** The passes a frame is drawn in, in order */
+		enum Pass {
+
+			/** Filled polygons */
+			PASS_SOLID = 0,
+
+			/** Polygon outlines */
+			PASS_WIREFRAME = 1,
+
+			/** Vertex normals, as lines */
+			PASS_NORMALS = 2
+
+		};
+
+		/** The fixed-function state a mesh may be drawn with, as bits */
+		enum State {
+
+			/** Lighting is enabled */
+			STATE_LIGHTING = 1,
+
+			/** Back faces are culled */
+			STATE_CULL_FACE = 2,
+
+			/** Filled polygons are pushed back, so outlines drawn over them show */
+			STATE_POLYGON_OFFSET = 4,
+
+			/** The mesh's own material is used, rather than plain grey */
+			STATE_MATERIAL = 8
+
+		};
+
+		/** Constructs an empty queue */
+		RenderQueue();
+
+		/** Empties the queue, ready for a frame seen through the given view matrix */
+		void begin(const Matrix<double> &view);
+
+		/** Queues a mesh to be drawn in a pass, transformed by its model's matrix; the center is used to sort by distance */
+		void add(Pass pass, unsigned int state, const SmoothMesh *mesh, const Matrix<double> *modelMatrix, const Point3d &worldCenter, double normalScale = 0.0);
+
+		/** Adds everything queued in another queue begun with the same view matrix, after what is already queued */
+		void append(const RenderQueue &list);
+
+		/** Sorts the queue and draws it; the modelview matrix is left as it was */
+		void execute();
+
+		/** Gets the view matrix of the frame */
+		inline const Matrix<double> &getView() const { return this->view; }
+
+		/** Gets the number of meshes queued */
+		inline size_t size() const { return this->items.size(); }
+
+		/** Gets the state cache the queue draws through, and its counts */
+		inline GlStateCache &getStateCache() { return this->stateCache; }
+
+		/** Gets the number of distinct materials the queue has seen */
+		inline size_t getMaterialCount() const { return this->materialIds.size(); }
+
+		/** Sets whether runs of the same mesh are drawn as instanced batches, where the driver supports it */
+		inline void setInstancing(bool instancing) { this->instancing = instancing; }
+
+		/** Whether or not runs of the same mesh are drawn as instanced batches, where the driver supports it */
+		inline bool isInstancing() const { return this->instancing; }
+
+		/** Gets how the last frame was split into batches and single draws */
+		inline const InstancingStats &getInstancingStats() const { return this->instancingStats; }
+
+		/** Releases the instancing program and buffer; needs the context they were made in */
+		void release();
+
+		/** The fewest copies of a mesh that are drawn as a batch rather than one at a time */
+		static const size_t minBatchSize = 2;
+
+	protected:
+
+		/** What is needed to draw a queued mesh, besides its key */
+		struct Item {
+
+			/** The mesh */
+			const SmoothMesh *mesh;
+
+			/** The model's transformation matrix */
+			const Matrix<double> *modelMatrix;
+
+			/** The number of the mesh's material */
+			unsigned int materialId;
+
+			/** The length of the normals, for the normals pass */
+			double normalScale;
+
+		};
+
+		/** A sort key, and the item it belongs to */
+		struct SortEntry {
+
+			/** The key */
+			boost::uint64_t key;
+
+			/** The index of the item */
+			boost::uint32_t index;
+
+		};
+
+		/** A run of entries drawn as one instanced batch */
+		struct Batch {
+
+			/** The first entry */
+			size_t first;
+
+			/** The entry after the last */
+			size_t end;
+
+			/** The number of the batch's first instance */
+			size_t firstInstance;
+
+		};
+
+		/** Orders materials by their components, so equal materials can be given the same number */
+		struct MaterialLess {
+			bool operator()(const Material &a, const Material &b) const;
+		};
+
+		/** Gets the number of a material, giving it the next number if it is new */
+		unsigned int getMaterialId(const Material &material);
+
+		/** Gets the number of a mesh in this frame, giving it the next number if it is new */
+		unsigned int getMeshId(const SmoothMesh *mesh);
+
+		/** Sorts the entries by key, least significant byte first, skipping bytes every key shares */
+		void sort();
+
+		/** Finds the runs of sorted entries to draw as batches, and gives the batcher their instances */
+		void findBatches();
+
+		/** The view matrix of the frame */
+		Matrix<double> view;
+
+		/** The queued meshes */
+		std::vector<Item> items;
+
+		/** The sort keys */
+		std::vector<SortEntry> entries;
+
+		/** Scratch space for sorting */
+		std::vector<SortEntry> scratch;
+
+		/** The number of each material seen so far; kept from frame to frame so numbers are stable */
+		std::map<Material, unsigned int, MaterialLess> materialIds;
+
+		/** The number of each mesh queued this frame */
+		std::map<const SmoothMesh *, unsigned int> meshIds;
+
+		/** The state cache the queue draws through */
+		GlStateCache stateCache;
+
+		/** Whether or not to draw batches */
+		bool instancing;
+
+		/** The batches of the frame, in the order they are drawn */
+		std::vector<Batch> batches;
+
+		/** Draws the batches */
+		InstanceBatcher batcher;
+
+		/** How the last frame was drawn */
+		InstancingStats instancingStats;
+
+	};
+
+}
@@ -14,26 +14,76 @@ namespace peek {
 	/**
 	* @brief A leaf in a scene graph
 	*/
-	class SceneGraphLeaf : public SceneGraphNodeBase {
+	class SceneGraphLeaf : public SceneGraphNodeBase, public ModelObserver {
 	public:
 
 		/** Constructor */
 		SceneGraphLeaf(Model::handle model);
 
+		/** Destructor */
+		virtual ~SceneGraphLeaf();
+
 		/** Draws the leaf */
 		virtual void draw() const;
 
+		/** Draws the leaf if it lies inside the frustum */
+		virtual void draw(const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
+		/** Queues the leaf's model if it lies inside the frustum */
+		virtual void enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
 		/** Draws the leaf for picking */
 		virtual void pick() const;
 
+		/** Draws the leaf for picking in the colour of a new ID, if it lies inside the frustum */
+		virtual void pick(PickingIds &ids, const Frustum &frustum, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
+		/** Finds the nearest face of the model the ray hits, if the ray reaches the leaf's bounds */
+		virtual bool intersect(const Ray &ray, RayHit &hit) const;
+
+		/** Marks the leaf's bounds as out of date when its model changes */
+		virtual void modelBoundsChanged();
+
+		/** Gets the model's transformation followed by the leaf's world transformation */
+		const Matrix<double> &getModelWorldMatrix() const;
+
+		/** Gets the model the leaf places in the scene */
+		inline const Model::handle &getModel() const { return this->model; }
+
 		typedef handle_traits<SceneGraphLeaf>::handle_type handle;
 
 		typedef list_traits<SceneGraphLeaf::handle>::list_type list;
 
 	protected:
 
+		/** Takes the bounds from the model's cached world bounding box, placed by the leaf's world transformation */
+		virtual void findBounds(BoundingBox &box, BoundingSphere &sphere, unsigned int &leafCount) const;
+
+		/** Marks the model's world matrix as out of date */
+		virtual void worldTransformChanged();
+
+		/** Pushes the modelview matrix and applies the world transformation, unless there is none; returns whether it did */
+		bool pushWorldTransform() const;
+
 		Model::handle model;
 
+		/** The cached model-to-world matrix */
+		mutable Matrix<double> modelWorldMatrix;
+
+		/** Whether or not the cached model-to-world matrix is out of date */
+		mutable bool modelWorldDirty;
+
+		/** The inverse of the world transformation, for bringing rays into the leaf's space */
+		mutable InverseMatrixCache worldInverse;
+
+	private:
+
+		/** Leaves register themselves with their model, so they cannot be copied */
+		SceneGraphLeaf(const SceneGraphLeaf &);
+
+		/** Leaves register themselves with their model, so they cannot be copied */
+		SceneGraphLeaf &operator=(const SceneGraphLeaf &);
+
 	};
 
 }
\ No newline at end of file
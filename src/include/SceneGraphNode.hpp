@@ -12,6 +12,9 @@ namespace peek {
 
 	/**
 	* @brief A node in a scene graph
+	*
+	* A node may belong to only one parent, since it reports changes to its
+	* bounds to the last node it was added to.
 	*/
 	class SceneGraphNode : public SceneGraphNodeBase {
 	public:
@@ -22,18 +25,39 @@ namespace peek {
 		/** Adds a child to the node */
 		void addChild(SceneGraphNodeBase::handle child);
 
+		/** Gets the children of the node */
+		inline const SceneGraphNodeBase::list &getChildren() const { return this->children; }
+
 		/** Draws the leaf */
 		virtual void draw() const;
 
+		/** Draws the children that lie inside the frustum, skipping the node entirely if it lies outside */
+		virtual void draw(const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
+		/** Queues the children that lie inside the frustum, skipping the node entirely if it lies outside */
+		virtual void enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
 		/** Draws the leaf for picking */
 		virtual void pick() const;
 
+		/** Draws the children that lie inside the frustum for picking */
+		virtual void pick(PickingIds &ids, const Frustum &frustum, unsigned int planeMask = Frustum::ALL_PLANES) const;
+
+		/** Finds the nearest face of the children the ray hits, trying the children the ray reaches soonest first */
+		virtual bool intersect(const Ray &ray, RayHit &hit) const;
+
 		typedef handle_traits<SceneGraphNode>::handle_type handle;
 
 		typedef list_traits<SceneGraphNode::handle>::list_type list;
 
 	protected:
 
+		/** Merges the bounds of the children */
+		virtual void findBounds(BoundingBox &box, BoundingSphere &sphere, unsigned int &leafCount) const;
+
+		/** Marks the world transformations of the children as out of date */
+		virtual void worldTransformChanged();
+
 		SceneGraphNodeBase::list children;
 
 	};
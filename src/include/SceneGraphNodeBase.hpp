@@ -5,27 +5,145 @@
 
 #include "Peek_base.hpp"
 #include "Object.hpp"
+#include "BoundingBox.hpp"
+#include "BoundingSphere.hpp"
+#include "Frustum.hpp"
+#include "CullingStats.hpp"
+#include "CameraRigging.hpp"
+#include "Ray.hpp"
+#include "RayHit.hpp"
+#include "PickingIds.hpp"
+#include "RenderQueue.hpp"
 #include <handle_traits.hpp>
 #include <list_traits.hpp>
 
 namespace peek {
 
+	class SceneGraphNode;
+
 	/**
 	* @brief The base class for a node in a scene graph
+	*
+	* Each node caches the world-space bounds of everything under it.  When a
+	* node's bounds change, it marks itself and its ancestors out of date, and
+	* they are recalculated the next time they are asked for.
+	*
+	* A node's origin, rotation and scale place it within its parent, and its
+	* world transformation is the parent's followed by its own.  That too is
+	* cached: moving a node marks it and everything under it out of date, and
+	* the bounds of its ancestors, so animating one part of a large scene
+	* only costs as much as the part that moved.
 	*/
 	class SceneGraphNodeBase : public Object {
 	public:
 
+		/** Constructor */
+		SceneGraphNodeBase();
+
 		/** Draws the node */
 		virtual void draw() const = 0;
 
+		/** Draws the parts of the node that lie inside the frustum, testing only the planes in the mask */
+		virtual void draw(const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const = 0;
+
+		/** Queues the parts of the node that lie inside the frustum to be drawn, testing only the planes in the mask */
+		virtual void enqueue(RenderQueue &queue, const Frustum &frustum, CullingStats &stats, unsigned int planeMask = Frustum::ALL_PLANES) const = 0;
+
 		/** Draws the node for picking */
 		virtual void pick() const = 0;
 
+		/** Draws the parts of the node inside the frustum for picking, each leaf in the colour of an ID it is given */
+		virtual void pick(PickingIds &ids, const Frustum &frustum, unsigned int planeMask = Frustum::ALL_PLANES) const = 0;
+
+		/** Finds the nearest face under the node the world-space ray hits before hit.distance, and records it in the hit */
+		virtual bool intersect(const Ray &ray, RayHit &hit) const = 0;
+
+		/** Finds the nearest face under the node the world-space ray hits */
+		RayHit castRay(const Ray &ray) const;
+
+		/** Finds the nearest face under the node seen through a pixel of the rigging's camera, with y measured down from the top of the viewport */
+		RayHit castRay(CameraRigging &rigging, int x, int y) const;
+
+		/** Gets the axis-aligned bounding box of everything under the node */
+		const BoundingBox &getBoundingBox() const;
+
+		/** Gets the bounding sphere of everything under the node */
+		const BoundingSphere &getBoundingSphere() const;
+
+		/** Gets the number of leaves under the node */
+		unsigned int getLeafCount() const;
+
+		/** Marks the bounds of the node and its ancestors as out of date */
+		void invalidateBounds();
+
+		/** Gets the transformation from the node's space to world space, recalculating it only if it is out of date */
+		const Matrix<double> &getWorldTransformMatrix() const;
+
+		/** Whether or not the node and all of its ancestors have no transformation of their own */
+		bool hasIdentityWorldTransform() const;
+
+		/** Gets a number that changes each time the cached bounds are recalculated */
+		inline unsigned long getBoundsVersion() const { return this->boundsVersion; }
+
+		/** Gets a number that changes each time a child is added to the node itself */
+		inline unsigned long getStructureVersion() const { return this->structureVersion; }
+
+		/** Gets the node this node was added to, if any */
+		inline SceneGraphNodeBase *getParent() const { return this->parent; }
+
 		typedef handle_traits<SceneGraphNodeBase>::handle_type handle;
 
 		typedef list_traits<SceneGraphNodeBase::handle>::list_type list;
 
+	protected:
+
+		friend class SceneGraphNode;
+
+		/** Calculates the bounds and leaf count of the node */
+		virtual void findBounds(BoundingBox &box, BoundingSphere &sphere, unsigned int &leafCount) const = 0;
+
+		/** Recalculates the cached bounds if they are out of date */
+		void updateBounds() const;
+
+		/** Marks the world transformation out of date, and the bounds of the node and its ancestors */
+		virtual void transformChanged();
+
+		/** Marks the world transformation and bounds of the node and everything under it as out of date */
+		void invalidateWorldTransform();
+
+		/** Called when the world transformation goes out of date, for subclasses to pass on to what depends on it */
+		virtual void worldTransformChanged() {}
+
+		/** The node this node was added to */
+		SceneGraphNodeBase *parent;
+
+		/** The cached bounding box */
+		mutable BoundingBox boundingBox;
+
+		/** The cached bounding sphere */
+		mutable BoundingSphere boundingSphere;
+
+		/** The cached number of leaves */
+		mutable unsigned int leafCount;
+
+		/** Whether or not the cached bounds are out of date */
+		mutable bool boundsDirty;
+
+		/** The number of times the bounds have been calculated */
+		mutable unsigned long boundsVersion;
+
+		/** The number of times the node's own children have changed */
+		unsigned long structureVersion;
+
+		/** The cached world transformation */
+		mutable Matrix<double> worldTransform;
+
+		/** Whether or not the cached world transformation is the identity */
+		mutable bool worldIdentity;
+
+		/** Whether or not the cached world transformation is out of date */
+		mutable bool worldTransformDirty;
+
 	};
 
 }
\ No newline at end of file
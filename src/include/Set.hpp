@@ -8,17 +8,59 @@
 #pragma once
 
 #include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
 
 using namespace std;
 
 namespace peek {
 
+	/**
+	 * Describes how a Set hashes and compares its elements
+	 *
+	 * The default hashes with boost::hash and compares with operator==,
+	 * ignoring the set's tolerance.  Specializations that support welding
+	 * (see the one for Point3 in Geometry.hpp) treat elements within the
+	 * tolerance of one another as equal; since such elements may hash
+	 * differently, candidateHashes() lists every hash under which an equal
+	 * element could have been stored.
+	 */
+	template <class T>
+	struct SetTraits {
+
+		/** The most hashes candidateHashes() may produce */
+		static const int maxCandidates = 1;
+
+		/** Gets the hash under which an element is stored */
+		static inline size_t hash(const T &t, double tolerance) {
+			return boost::hash<T>()(t);
+		}
+
+		/** Gets the hashes under which an element equal to the given one could be stored */
+		static inline int candidateHashes(const T &t, double tolerance, size_t *hashes) {
+			hashes[0] = hash(t, tolerance);
+			return 1;
+		}
+
+		/** Determines if two elements are equal */
+		static inline bool equal(const T &a, const T &b, double tolerance) {
+			return a == b;
+		}
+
+	};
+
 	/**
 	 * Stores a set of objects
-	 * 
+	 *
 	 * Since std::set is ordered, and the STL hash_set is not part of the C++
 	 * standard, here we have our own template for an unordered set of items.
-	 * There are many ways it could be more efficient and more comprehensive.
+	 * The elements are kept contiguously, in no particular order, and are
+	 * found through an open-addressed table of indices into them, so
+	 * membership is O(1) and the bulk operations are linear.
+	 *
+	 * A set with a nonzero tolerance welds together elements its SetTraits
+	 * consider equal within that tolerance: adding an element near one that
+	 * is already present leaves the set unchanged.
 	 */
 	template <class T>
 	class Set {
@@ -27,19 +69,23 @@ namespace peek {
 		/** Non-initializing constructor */
 		Set();
 
+		/** Non-initializing constructor for a welding set */
+		explicit Set(double tolerance);
+
 		/** Initializing constructor (from a Set) */
-		inline Set(const Set<T> &tSet) {
-			addAll(tSet);
-		}
+		inline Set(const Set<T> &tSet) : elements(tSet.elements), slots(tSet.slots), tolerance(tSet.tolerance) {}
 
 		/** Initializing constructor (from a vector) */
-		inline Set(const vector<T> &tList) {
+		inline Set(const vector<T> &tList) : tolerance(0.0) {
 			addAll(tList);
 		}
 
 		/** Determines if the given object is in the set */
 		bool has(const T &t) const;
 
+		/** Finds the element of the set equal to the given object */
+		const T *find(const T &t) const;
+
 		/** Adds an object to the set */
 		void add(const T &t);
 
@@ -61,51 +107,105 @@ namespace peek {
 		/** Pops any one element out of the set */
 		T popOne();
 
+		/** Makes room for the given number of elements without rehashing */
+		void reserve(size_t count);
+
 		/** Gets a list of the objects in this set */
 		inline vector<T> getAsList() const { return this->elements; }
 
 		/** Gets the size of the set */
 		inline size_t size() const { return this->elements.size(); }
 
-		// Container stuff...
+		/** Gets the tolerance within which elements are welded together */
+		inline double getTolerance() const { return this->tolerance; }
+
+		// Container stuff...  Elements can't be changed in place, since that
+		// would leave them filed under the wrong hash.
 
-		typedef typename vector<T>::iterator iterator;
+		typedef typename vector<T>::const_iterator iterator;
 		typedef typename vector<T>::const_iterator const_iterator;
-		typedef typename vector<T>::reference reference;
+		typedef typename vector<T>::const_reference reference;
 		typedef typename vector<T>::const_reference const_reference;
 
-		inline iterator begin() { return this->elements.begin(); }
 		inline const_iterator begin() const { return this->elements.begin(); }
-		inline iterator end() { return this->elements.end(); }
 		inline const_iterator end() const { return this->elements.end(); }
-		inline void clear() { this->elements.clear(); }
+		inline void clear() { this->elements.clear(); this->slots.clear(); }
 
 	private:
 
+		/** A slot in the hash table */
+		struct Slot {
+
+			/** The hash of the element the slot refers to */
+			size_t hash;
+
+			/** The index of the element, or EMPTY */
+			size_t index;
+
+		};
+
+		/** Marks a slot that refers to no element */
+		static const size_t EMPTY = ~(size_t) 0;
+
+		/** Spreads a hash over the bits used to index the table */
+		static size_t mix(size_t hash);
+
+		/** Finds the slot referring to the element equal to the given object */
+		size_t findSlot(const T &t) const;
+
+		/** Finds the slot referring to the element at the given index */
+		size_t findSlot(size_t hash, size_t index) const;
+
+		/** Refers a free slot to the element at the given index */
+		void insertSlot(size_t hash, size_t index);
+
+		/** Frees a slot, shifting back the slots that probed past it */
+		void eraseSlot(size_t slot);
+
+		/** Removes the element at the given slot */
+		void removeAt(size_t slot);
+
+		/** Rebuilds the hash table with the given number of slots */
+		void rehash(size_t slotCount);
+
 		/** The elements of the set */
 		vector<T> elements;
 
+		/** The hash table, whose size is zero or a power of two */
+		vector<Slot> slots;
+
+		/** The tolerance within which elements are welded together */
+		double tolerance;
+
 	};
 
 
 
 	template <class T>
-	Set<T>::Set() {}
+	Set<T>::Set() : tolerance(0.0) {}
+
+	/**
+	 * \param tolerance The tolerance within which elements are considered equal
+	 */
+	template <class T>
+	Set<T>::Set(double tolerance) : tolerance(tolerance) {}
 
 	/**
 	 * \param t The object whose membership is to be determined
 	 */
 	template <class T>
 	bool Set<T>::has(const T &t) const {
-		vector<T>::const_iterator i;
-
-		for (i = this->elements.begin(); i != this->elements.end(); i++) {
-			if (t == (*i)) {
-				return true;
-			}
-		}
+		return findSlot(t) != EMPTY;
+	}
 
-		return false;
+	/**
+	 * \param t The object to look for
+	 * \return The element equal to the object, or NULL if there is none
+	 */
+	template <class T>
+	const T *Set<T>::find(const T &t) const {
+		size_t slot = findSlot(t);
+		return slot == EMPTY ? NULL : &this->elements[this->slots[slot].index];
 	}
 
 	/**
@@ -114,6 +214,8 @@ namespace peek {
 	template <class T>
 	void Set<T>::add(const T &t) {
 		if (!has(t)) {
+			reserve(this->elements.size() + 1);
+			insertSlot(SetTraits<T>::hash(t, this->tolerance), this->elements.size());
 			this->elements.push_back(t);
 		}
 	}
@@ -123,7 +225,9 @@ namespace peek {
 	 */
 	template <class T>
 	void Set<T>::addAll(const vector<T> &tList) {
-		vector<T>::const_iterator i;
+		typename vector<T>::const_iterator i;
+
+		reserve(this->elements.size() + tList.size());
 
 		for (i = tList.begin(); i != tList.end(); i++) {
 			add(*i);
@@ -135,7 +239,9 @@ namespace peek {
 	 */
 	template <class T>
 	void Set<T>::addAll(const Set<T> &tSet) {
-		addAll(tSet.elements);
+		if (&tSet != this) {
+			addAll(tSet.elements);
+		}
 	}
 
 	/**
@@ -143,13 +249,10 @@ namespace peek {
 	 */
 	template <class T>
 	void Set<T>::remove(const T &t) {
-		vector<T>::iterator i;
+		size_t slot = findSlot(t);
 
-		for (i = this->elements.begin(); i != this->elements.end(); i++) {
-			if (t == *i) {
-				this->elements.erase(i);
-				break;
-			}
+		if (slot != EMPTY) {
+			removeAt(slot);
 		}
 	}
 
@@ -159,7 +262,7 @@ namespace peek {
 	template <class T>
 	void Set<T>::removeAll(const Set<T> &tSet) {
 		vector<T> resultingElements;
-		vector<T>::const_iterator i;
+		typename vector<T>::const_iterator i;
 
 		for (i = this->elements.begin(); i != this->elements.end(); i++) {
 			// Only keep the object if the given set DOES NOT contain it
@@ -168,7 +271,8 @@ namespace peek {
 			}
 		}
 
-		this->elements = resultingElements;
+		this->elements.swap(resultingElements);
+		rehash(this->slots.size());
 	}
 
 	/**
@@ -177,7 +281,7 @@ namespace peek {
 	template <class T>
 	void Set<T>::retainAll(const Set<T> &tSet) {
 		vector<T> resultingElements;
-		vector<T>::const_iterator i;
+		typename vector<T>::const_iterator i;
 
 		for (i = this->elements.begin(); i != this->elements.end(); i++) {
 			// Only keep the object if the given set DOES contain it
@@ -186,7 +290,8 @@ namespace peek {
 			}
 		}
 
-		this->elements = resultingElements;
+		this->elements.swap(resultingElements);
+		rehash(this->slots.size());
 	}
 
 	/**
@@ -197,10 +302,175 @@ namespace peek {
 	template <class T>
 	T Set<T>::popOne() {
 		T t = this->elements.back();
-		this->elements.pop_back();
+		removeAt(findSlot(SetTraits<T>::hash(t, this->tolerance), this->elements.size() - 1));
 		return t;
 	}
 
+	/**
+	 * The table is kept at most three-quarters full.
+	 *
+	 * \param count The number of elements to make room for
+	 */
+	template <class T>
+	void Set<T>::reserve(size_t count) {
+		if (count * 4 > this->slots.size() * 3) {
+			size_t slotCount = 16;
+
+			while (count * 4 > slotCount * 3) {
+				slotCount *= 2;
+			}
+
+			this->elements.reserve(count);
+			rehash(slotCount);
+		}
+	}
+
+	/**
+	 * This is the 64-bit finalizer from MurmurHash3, which makes up for
+	 * weak hashes (such as boost::hash of an integer, which is the integer).
+	 *
+	 * \param hash The hash to mix
+	 * \return The mixed hash
+	 */
+	template <class T>
+	size_t Set<T>::mix(size_t hash) {
+		boost::uint64_t k = hash;
+
+		k ^= k >> 33;
+		k *= 0xff51afd7ed558ccdULL;
+		k ^= k >> 33;
+		k *= 0xc4ceb9fe1a85ec53ULL;
+		k ^= k >> 33;
+
+		return (size_t) k;
+	}
+
+	/**
+	 * \param t The object to look for
+	 * \return The slot, or EMPTY if no element is equal to the object
+	 */
+	template <class T>
+	size_t Set<T>::findSlot(const T &t) const {
+		if (this->elements.empty()) {
+			return EMPTY;
+		}
+
+		size_t hashes[SetTraits<T>::maxCandidates];
+		int hashCount = SetTraits<T>::candidateHashes(t, this->tolerance, hashes);
+		size_t mask = this->slots.size() - 1;
+
+		for (int h = 0; h < hashCount; h++) {
+			// Linear probing: an equal element is somewhere between the
+			// hash's home slot and the next free one
+			for (size_t slot = mix(hashes[h]) & mask; this->slots[slot].index != EMPTY; slot = (slot + 1) & mask) {
+				if (this->slots[slot].hash == hashes[h]
+					&& SetTraits<T>::equal(this->elements[this->slots[slot].index], t, this->tolerance)) {
+					return slot;
+				}
+			}
+		}
+
+		return EMPTY;
+	}
+
+	/**
+	 * \param hash The hash of the element
+	 * \param index The index of the element, which must be in the set
+	 * \return The slot referring to the element
+	 */
+	template <class T>
+	size_t Set<T>::findSlot(size_t hash, size_t index) const {
+		size_t mask = this->slots.size() - 1;
+		size_t slot = mix(hash) & mask;
+
+		while (this->slots[slot].index != index) {
+			slot = (slot + 1) & mask;
+		}
+
+		return slot;
+	}
+
+	/**
+	 * \param hash The hash of the element
+	 * \param index The index of the element
+	 */
+	template <class T>
+	void Set<T>::insertSlot(size_t hash, size_t index) {
+		size_t mask = this->slots.size() - 1;
+		size_t slot = mix(hash) & mask;
+
+		while (this->slots[slot].index != EMPTY) {
+			slot = (slot + 1) & mask;
+		}
+
+		this->slots[slot].hash = hash;
+		this->slots[slot].index = index;
+	}
+
+	/**
+	 * Rather than leaving a tombstone, this moves later slots in the same
+	 * probe run back into the hole whenever their home slot allows it, so
+	 * lookups never have to skip over deleted entries.
+	 *
+	 * \param slot The slot to free
+	 */
+	template <class T>
+	void Set<T>::eraseSlot(size_t slot) {
+		size_t mask = this->slots.size() - 1;
+		size_t hole = slot;
+
+		for (size_t next = (hole + 1) & mask; this->slots[next].index != EMPTY; next = (next + 1) & mask) {
+			size_t home = mix(this->slots[next].hash) & mask;
+
+			// The slot may fill the hole unless its home lies cyclically in (hole, next]
+			bool homeAfterHole = hole <= next
+				? (hole < home && home <= next)
+				: (hole < home || home <= next);
+
+			if (!homeAfterHole) {
+				this->slots[hole] = this->slots[next];
+				hole = next;
+			}
+		}
+
+		this->slots[hole].index = EMPTY;
+	}
+
+	/**
+	 * The last element is moved into the removed element's place, so the
+	 * elements stay contiguous.
+	 *
+	 * \param slot The slot referring to the element to remove
+	 */
+	template <class T>
+	void Set<T>::removeAt(size_t slot) {
+		size_t index = this->slots[slot].index;
+		size_t last = this->elements.size() - 1;
+
+		eraseSlot(slot);
+
+		if (index != last) {
+			this->slots[findSlot(SetTraits<T>::hash(this->elements[last], this->tolerance), last)].index = index;
+			this->elements[index] = this->elements[last];
+		}
+
+		this->elements.pop_back();
+	}
+
+	/**
+	 * \param slotCount The number of slots, which must be a power of two
+	 */
+	template <class T>
+	void Set<T>::rehash(size_t slotCount) {
+		Slot empty = { 0, EMPTY };
+
+		this->slots.assign(slotCount, empty);
+
+		for (size_t i = 0; i < this->elements.size(); i++) {
+			insertSlot(SetTraits<T>::hash(this->elements[i], this->tolerance), i);
+		}
+	}
+
 
 	/**
 	 * Calculates the union of two sets
@@ -218,14 +488,39 @@ namespace peek {
 
 	/**
 	 * Calculates the intersection of two sets
+	 *
+	 * The smaller set is scanned and the larger one probed, but the result
+	 * always holds the first set's elements, with its tolerance.
+	 *
 	 * \param set1 The first set
 	 * \param set2 The second set
 	 * \return The intersection of the two sets
 	 */
 	template <class T>
 	Set<T> setIntersection(const Set<T> &set1, const Set<T> &set2) {
-		Set<T> intersectionSet = set1;
-		intersectionSet.retainAll(set2);
+		Set<T> intersectionSet(set1.getTolerance());
+		typename Set<T>::const_iterator i;
+
+		if (set1.size() <= set2.size()) {
+			intersectionSet.reserve(set1.size());
+
+			for (i = set1.begin(); i != set1.end(); i++) {
+				if (set2.has(*i)) {
+					intersectionSet.add(*i);
+				}
+			}
+		}
+		else {
+			intersectionSet.reserve(set2.size());
+
+			for (i = set2.begin(); i != set2.end(); i++) {
+				const T *t = set1.find(*i);
+
+				if (t) {
+					intersectionSet.add(*t);
+				}
+			}
+		}
 
 		return intersectionSet;
 	}
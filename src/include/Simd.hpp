@@ -0,0 +1,38 @@
+/**
+ * \file Simd.hpp
+ * \author Douglas W. Paul
+ *
+ * Declares runtime detection of the SIMD instruction sets peek's kernels can
+ * use, along with the compiler-specific macros those kernels need.
+ */
+
+#pragma once
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#  define PEEK_X86_SIMD 1
+#endif
+
+#if defined(_MSC_VER)
+#  define PEEK_ALIGN(n) __declspec(align(n))
+#  define PEEK_TARGET_AVX2
+#else
+#  define PEEK_ALIGN(n) __attribute__((aligned(n)))
+#  define PEEK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace peek {
+
+	/** The SIMD instruction sets, in increasing order of capability */
+	enum SimdLevel {
+		SIMD_SCALAR = 0,
+		SIMD_SSE2 = 1,
+		SIMD_AVX2 = 2
+	};
+
+	/** Gets the most capable instruction set supported by this CPU and operating system */
+	SimdLevel getSimdLevel();
+
+	/** Gets the name of an instruction set */
+	const char *getSimdLevelName(SimdLevel level);
+
+}
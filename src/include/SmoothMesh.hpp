@@ -4,11 +4,16 @@
 #pragma once
 
 #include "Geometry.hpp"
+#include "BoundingBox.hpp"
 #include "Object.hpp"
 #include <vector>
 #include "Material.hpp"
 #include <boost/optional.hpp>
 #include "Primitive.hpp"
+#include "MeshBuffers.hpp"
+#include "MeshBvh.hpp"
+#include "InverseMatrixCache.hpp"
+#include "MeshOptimizer.hpp"
 
 using boost::optional;
 
@@ -26,6 +31,12 @@ namespace peek {
 		/** Constructs a smooth mesh from the provided components using the default material */
 		SmoothMesh(Vertex3d::list verts, Primitive::list primitives);
 
+		/** Constructs a smooth mesh from the provided vertices, index streams and material */
+		SmoothMesh(const Vertex3d::list &verts, const PrimitiveStreams &primitives, const Material &material);
+
+		/** Constructs a smooth mesh from the provided vertices and index streams using the default material */
+		SmoothMesh(const Vertex3d::list &verts, const PrimitiveStreams &primitives);
+
 		/** Gets the mesh's material */
 		optional<Material> getMaterial() const;
 
@@ -38,20 +49,50 @@ namespace peek {
 		/** Draws the mesh for picking */
 		void pick() const;
 
+		/** Draws the faces alone, with the current transformation and material, for a RenderQueue that has set them */
+		void drawGeometry() const;
+
+		/** Draws the faces once for each instance, for a RenderQueue that has bound a program reading the instances */
+		void drawGeometryInstanced(GLsizei instanceCount) const;
+
+		/** Gets the number of OpenGL draw calls drawGeometry(), or drawGeometryInstanced() if instanced, makes */
+		unsigned int getDrawCallCount(bool instanced) const;
+
+		/** Finds the nearest face the ray hits before hit.distance; the ray is in the space the mesh's transformation maps into */
+		bool intersect(const Ray &ray, RayHit &hit) const;
+
+		/** Gets the bounding volume hierarchy over the faces, building it the first time it is asked for */
+		const MeshBvh &getBvh() const;
+
+		/** Reorders the faces and vertices to draw faster, optionally measuring the vertex cache before and after */
+		void optimize(const MeshOptimizer &optimizer, VertexCacheStats *before = NULL, VertexCacheStats *after = NULL);
+
 		/** Draws the mesh normals */
 		void drawNormals(double normalScale) const;
 
 		/** Draws the mesh's vertices */
 		void drawVerts() const;
 
+		/** Gets the vertices that compose the mesh */
+		inline const Vertex3d::list &getVertices() const { return this->verts; }
+
+		/** Gets the vertex normals */
+		inline const Normal3d::list &getVertexNormals() const { return this->vertNormals; }
+
+		/** Gets the faces of the mesh */
+		inline const PrimitiveStreams &getPrimitives() const { return this->primitives; }
+
 		/** Get the dimensions of the axis-aligned bounding box for the mesh */
-		inline Vector3d getDimensions() { return this->boundingBoxHigh - this->boundingBoxLow; }
+		inline Vector3d getDimensions() const { return this->boundingBox.getDimensions(); }
+
+		/** Get the "high" point of the axis-aligned bounding box for the mesh */
+		inline Point3d getBoundingBoxHigh() const { return this->boundingBox.getHigh(); }
 
 		/** Get the "low" point of the axis-aligned bounding box for the mesh */
-		inline Point3d getBoundingBoxHigh() { return this->boundingBoxHigh; }
+		inline Point3d getBoundingBoxLow() const { return this->boundingBox.getLow(); }
 
-		/** Get the "high" point of the axis-aligned bounding box for the mesh */
-		inline Point3d getBoundingBoxLow() { return this->boundingBoxLow; }
+		/** Get the axis-aligned bounding box for the mesh */
+		inline const BoundingBox &getBoundingBox() const { return this->boundingBox; }
 
 		typedef handle_traits<SmoothMesh>::handle_type handle;
 
@@ -60,7 +101,10 @@ namespace peek {
 	protected:
 
 		/** Do the actual work of constructing */
-		void construct(Vertex3d::list verts, Primitive::list primitives, const Material &material);
+		void construct(const Vertex3d::list &verts, const PrimitiveStreams &primitives, const Material &material);
+
+		/** Converts a list of primitives into index streams */
+		static PrimitiveStreams toStreams(const Primitive::list &primitives);
 
 		/** The vertices that compose the mesh */
 		Vertex3d::list verts;
@@ -69,21 +113,36 @@ namespace peek {
 		Normal3d::list vertNormals;
 
 		/** The faces of the mesh; triangles, quads, etc. */
-		Primitive::list primitives;
+		PrimitiveStreams primitives;
 
 		/** Generates the normals of the mesh */
 		virtual void generateNormals();
 
-		/** The low corner of the axis-aligned bounding box which contains the mesh */
-		Point3d boundingBoxLow;
-
-		/** The high corner of the axis-aligned bounding box which contains the mesh */
-		Point3d boundingBoxHigh;
+		/** The axis-aligned bounding box which contains the mesh */
+		BoundingBox boundingBox;
 
 		/** (Re)calculates the axis-aligned bounding box for the mesh. */
 		void findBoundingBox();
 
+		/** Marks the GPU buffers as out of date, so they are re-uploaded before the next draw */
+		void invalidateBuffers();
+
+		/** Uploads the mesh to the GPU buffers if they are out of date */
+		void updateBuffers() const;
+
 		optional<Material> material;
+
+		/** The GPU-resident copy of the mesh */
+		mutable MeshBuffers buffers;
+
+		/** Whether or not the GPU buffers need to be re-uploaded */
+		mutable bool buffersDirty;
+
+		/** The hierarchy over the faces, for casting rays; built when first needed */
+		mutable MeshBvh::handle bvh;
+
+		/** The inverse of the mesh's transformation, for bringing rays into the mesh's space */
+		mutable InverseMatrixCache transformInverse;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+/**
+* @file StatePublisher.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+
+namespace peek {
+
+	/**
+	* @interface StatePublisher
+	* @brief Publishes a snapshot of the state that is drawn, once the event handlers have changed it
+	*/
+	class StatePublisher {
+	public:
+
+		/** Publishes a snapshot; called on the thread the handlers run on */
+		virtual void publishState() = 0;
+
+	};
+
+}
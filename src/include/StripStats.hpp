@@ -0,0 +1,71 @@
+/**
+* @file StripStats.hpp
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace peek {
+
+	/**
+	* @brief Counts what a Stripifier made of the triangles it was given
+	*/
+	struct StripStats {
+
+		/** Constructs a set of zeroed counters */
+		StripStats() { reset(); }
+
+		/** Zeroes the counters */
+		inline void reset() {
+			this->triangles = 0;
+			this->strips = 0;
+			this->stripTriangles = 0;
+			this->fans = 0;
+			this->fanTriangles = 0;
+			this->singleTriangles = 0;
+			this->indicesBefore = 0;
+			this->indicesAfter = 0;
+		}
+
+		/** Gets the mean number of triangles in a strip, or 0 if there are none */
+		inline double getAverageStripLength() const {
+			return this->strips ? (double) this->stripTriangles / this->strips : 0.0;
+		}
+
+		/** Gets the mean number of triangles in a fan, or 0 if there are none */
+		inline double getAverageFanLength() const {
+			return this->fans ? (double) this->fanTriangles / this->fans : 0.0;
+		}
+
+		/** Gets the fraction of the indices that stripping saved */
+		inline double getIndexReduction() const {
+			return this->indicesBefore ? 1.0 - (double) this->indicesAfter / this->indicesBefore : 0.0;
+		}
+
+		/** The number of triangles taken from the triangle stream */
+		size_t triangles;
+
+		/** The number of triangle strips grown, before any stitching */
+		size_t strips;
+
+		/** The number of triangles in the strips, not counting any degenerate ones joining them */
+		size_t stripTriangles;
+
+		/** The number of triangle fans made */
+		size_t fans;
+
+		/** The number of triangles in the fans */
+		size_t fanTriangles;
+
+		/** The number of triangles left on their own */
+		size_t singleTriangles;
+
+		/** The number of indices in all the streams before stripping */
+		size_t indicesBefore;
+
+		/** The number of indices in all the streams after stripping */
+		size_t indicesAfter;
+
+	};
+
+}
@@ -0,0 +1,70 @@
+/**
+* @file Stripifier.hpp
+*/
+#pragma once
+
+#include "PrimitiveStreams.hpp"
+#include "StripStats.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Turns the independent triangles of a mesh into triangle strips and fans
+	*
+	* An adjacency table is built over the triangles, linking each edge to
+	* the triangle that shares it with the opposite winding.  Fans are taken
+	* first, around vertices with enough unused triangles on them to be
+	* worth one.  Strips are then grown greedily: each starts at the unused
+	* triangle with the fewest unused neighbours, so strips begin at the
+	* edges of what is left rather than cutting it in two, and from the
+	* edge that gives the longest strip.  A strip ends when the triangle it
+	* would take next is already used; strips are never turned with swaps.
+	* Triangles left without a partner stay independent triangles.
+	*
+	* Strips keep the winding of the triangles they were made from.  Strips
+	* can optionally be stitched into one with degenerate triangles, for
+	* drivers without glMultiDrawElements, which would otherwise draw each
+	* strip with a call of its own.  Quads, and any strips and fans already
+	* in the streams, are passed through as they are.
+	*/
+	class Stripifier {
+	public:
+
+		/** Constructs a stripifier that makes fans of 8 or more triangles, strips of 2 or more, and does not stitch */
+		Stripifier();
+
+		/** Sets the fewest triangles worth a fan (0 for no fans) */
+		inline void setMinFanLength(unsigned int minFanLength) { this->minFanLength = minFanLength; }
+
+		/** Gets the fewest triangles worth a fan */
+		inline unsigned int getMinFanLength() const { return this->minFanLength; }
+
+		/** Sets the fewest triangles worth a strip; shorter strips are left as independent triangles */
+		inline void setMinStripLength(unsigned int minStripLength) { this->minStripLength = minStripLength; }
+
+		/** Gets the fewest triangles worth a strip */
+		inline unsigned int getMinStripLength() const { return this->minStripLength; }
+
+		/** Sets whether the strips are stitched into one with degenerate triangles */
+		inline void setStitching(bool stitching) { this->stitching = stitching; }
+
+		/** Gets whether the strips are stitched into one */
+		inline bool isStitching() const { return this->stitching; }
+
+		/** Makes the triangles of the given streams into strips and fans, optionally counting what was made */
+		PrimitiveStreams stripify(const PrimitiveStreams &primitives, StripStats *stats = NULL) const;
+
+	protected:
+
+		/** The fewest triangles worth a fan (0 for no fans) */
+		unsigned int minFanLength;
+
+		/** The fewest triangles worth a strip */
+		unsigned int minStripLength;
+
+		/** Whether the strips are stitched into one */
+		bool stitching;
+
+	};
+
+}
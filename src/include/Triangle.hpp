@@ -26,6 +26,9 @@ namespace peek {
 		/** Adds the triangle's normal to the given vertex normals */
 		virtual void addVertexNormals(const Vertex3d::list &verts, Normal3d::list &normals) const;
 
+		/** Appends the triangle to the given index streams */
+		virtual void appendTo(PrimitiveStreams &streams) const;
+
 		typedef handle_traits<Triangle>::handle_type handle;
 
 		typedef list_traits<Triangle::handle>::list_type list;
@@ -26,6 +26,9 @@ namespace peek {
 		/** Adds the fan's normal to the given vertex normals */
 		virtual void addVertexNormals(const Vertex3d::list &verts, Normal3d::list &normals) const;
 
+		/** Appends the fan to the given index streams */
+		virtual void appendTo(PrimitiveStreams &streams) const;
+
 		void addVertex(const Vertex3d::listIndex &v);
 
 		typedef handle_traits<TriangleFan>::handle_type handle;
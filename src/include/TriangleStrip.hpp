@@ -26,6 +26,9 @@ namespace peek {
 		/** Adds the triangle strip's normals to the given vertex normals */
 		virtual void addVertexNormals(const Vertex3d::list &verts, Normal3d::list &normals) const;
 
+		/** Appends the triangle strip to the given index streams */
+		virtual void appendTo(PrimitiveStreams &streams) const;
+
 		void addVertex(const Vertex3d::listIndex &v);
 
 		typedef handle_traits<TriangleStrip>::handle_type handle;
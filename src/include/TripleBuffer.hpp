@@ -0,0 +1,83 @@
+/**
+* @file TripleBuffer.hpp
+*/
+#pragma once
+
+#include "Peek_base.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+
+namespace peek {
+
+	/**
+	* @brief Hands the latest of a series of values from one thread to another, without either waiting for the other
+	*
+	* The writer fills the back slot and publishes it, which swaps it with the
+	* middle one.  The reader acquires the latest value, which swaps the
+	* middle slot with the front one if something new was published, and
+	* reads the front slot until it next acquires.  Neither thread holds the
+	* lock for more than the swap of two indices, so a slow reader never
+	* holds up the writer, and the reader never sees a value half written.
+	*
+	* Values the reader is too slow to see are skipped.  The slots are reused,
+	* so the writer must write the whole of the back slot each time.
+	*/
+	template <class T>
+	class TripleBuffer : boost::noncopyable {
+	public:
+
+		/** Constructs a buffer of default-constructed values, with nothing published */
+		TripleBuffer() {
+			this->back = 0;
+			this->middle = 1;
+			this->front = 2;
+			this->fresh = false;
+		}
+
+		/** Gets the slot to write the next value into; for the writer only */
+		inline T &getBack() { return this->slots[this->back]; }
+
+		/** Publishes the back slot, and gives the writer another */
+		void publish() {
+			boost::mutex::scoped_lock lock(this->mutex);
+			std::swap(this->back, this->middle);
+			this->fresh = true;
+		}
+
+		/** Takes the latest value published, if there is a new one, and gets it; for the reader only */
+		const T &acquire() {
+			boost::mutex::scoped_lock lock(this->mutex);
+			if (this->fresh) {
+				std::swap(this->front, this->middle);
+				this->fresh = false;
+			}
+			return this->slots[this->front];
+		}
+
+		/** Gets the value last acquired; for the reader only */
+		inline const T &getFront() const { return this->slots[this->front]; }
+
+	protected:
+
+		/** The three slots */
+		T slots[3];
+
+		/** The index of the slot being written */
+		int back;
+
+		/** The index of the slot last published, or last read if nothing has been published since */
+		int middle;
+
+		/** The index of the slot being read */
+		int front;
+
+		/** Whether the middle slot holds a value the reader has not acquired */
+		bool fresh;
+
+		/** Guards the indices and fresh */
+		boost::mutex mutex;
+
+	};
+
+}
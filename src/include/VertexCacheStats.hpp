@@ -0,0 +1,50 @@
+/**
+* @file VertexCacheStats.hpp
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace peek {
+
+	/**
+	* @brief Counts how often drawing a mesh's index streams would miss a first-in, first-out post-transform vertex cache
+	*/
+	struct VertexCacheStats {
+
+		/** Constructs a set of zeroed counters */
+		VertexCacheStats() { reset(); }
+
+		/** Zeroes the counters */
+		inline void reset() {
+			this->cacheSize = 0;
+			this->triangles = 0;
+			this->vertices = 0;
+			this->transforms = 0;
+		}
+
+		/** Gets the average cache miss ratio: vertices transformed per triangle, from 3 down to about 0.5 */
+		inline double getAcmr() const {
+			return this->triangles ? (double) this->transforms / this->triangles : 0.0;
+		}
+
+		/** Gets the average transform to vertex ratio: vertices transformed per vertex used, 1 at best */
+		inline double getAtvr() const {
+			return this->vertices ? (double) this->transforms / this->vertices : 0.0;
+		}
+
+		/** The number of vertices the simulated cache holds */
+		unsigned int cacheSize;
+
+		/** The number of triangles drawn, counting each quadrilateral as two */
+		size_t triangles;
+
+		/** The number of distinct vertices the streams use */
+		size_t vertices;
+
+		/** The number of vertices transformed, being every index that missed the cache */
+		size_t transforms;
+
+	};
+
+}
@@ -0,0 +1,51 @@
+/**
+* @file WindowRenderContext.hpp
+*/
+#pragma once
+
+#include "RenderContext.hpp"
+
+namespace peek {
+
+	/**
+	* @brief Renders to an SDL window, and takes events from it
+	*/
+	class WindowRenderContext : public RenderContext {
+	public:
+
+		/** Opens a window with the given size */
+		WindowRenderContext(unsigned int width, unsigned int height, bool fullscreen, bool vsync);
+
+		/** Destructor */
+		virtual ~WindowRenderContext();
+
+		virtual unsigned int getWidth() const { return this->width; }
+
+		virtual unsigned int getHeight() const { return this->height; }
+
+		virtual bool isVsync() const { return this->vsync; }
+
+		virtual void *getProcAddress(const char *name);
+
+		virtual void swapBuffers();
+
+		virtual bool pollEvent(SDL_Event &evt);
+
+		virtual bool hasPendingEvents();
+
+		typedef handle_traits<WindowRenderContext>::handle_type handle;
+
+	protected:
+
+		/** The width of the window, in pixels */
+		unsigned int width;
+
+		/** The height of the window, in pixels */
+		unsigned int height;
+
+		/** Whether or not the driver agreed to synchronize swaps with the display's refresh */
+		bool vsync;
+
+	};
+
+}